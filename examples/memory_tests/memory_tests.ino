@@ -0,0 +1,263 @@
+/* 
+ * This file is part of the Rishka distribution (https://github.com/rishka-esp32/rishka).
+ * Copyright (c) 2024 Nathanne Isip.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This example checks how a Rishka virtual machine keeps track of the guest
+ * memory a program writes. It writes a small test program to the SD card,
+ * runs it, and prints the result of each check on the serial port. The
+ * program stores a word across the boundary of two guest pages, which
+ * resetting, forking and saving the virtual machine to a snapshot all
+ * have to account for.
+ */
+
+#include <rishka.h>
+#include <SD.h>
+#include <SPI.h>
+
+#define SD_CS      2            // SD card chip select pin
+#define SD_SCK     14           // SD card SPI clock pin
+#define SD_MOSI    13           // SD card SPI MOSI pin
+#define SD_MISO    12           // SD card SPI MISO pin
+
+#define TEST_PROGRAM "/memtest.bin"     // SD card path of the test program
+#define TEST_SNAPSHOT "/memtest.rks"    // SD card path of the snapshot of the test program
+#define TEST_BOUNDARY 0x40000U          // Guest address of the page boundary the program stores across
+
+// SPI instance for SD card
+SPIClass sdSpi(HSPI);
+
+// Number of failed checks
+uint32_t failures = 0;
+
+// Encodes the RISC-V instructions the test program is made of.
+static inline uint32_t encodeLui(uint32_t rd, uint32_t upper) {
+    return (upper << 12) | (rd << 7) | 0x37;
+}
+
+static inline uint32_t encodeAddi(uint32_t rd, uint32_t rs1, int32_t imm) {
+    return (((uint32_t) imm &0xfff) << 20) | (rs1 << 15) | (rd << 7) | 0x13;
+}
+
+static inline uint32_t encodeStoreWord(uint32_t rs2, uint32_t rs1) {
+    return (rs2 << 20) | (rs1 << 15) | (2 << 12) | 0x23;
+}
+
+static inline uint32_t encodeLoadWord(uint32_t rd, uint32_t rs1) {
+    return (rs1 << 15) | (2 << 12) | (rd << 7) | 0x03;
+}
+
+// Writes the test program: it stores -1 to the word two bytes before
+// TEST_BOUNDARY, loads it back and exits with it. Its first four
+// instructions do the store.
+static bool writeTestProgram() {
+    const uint32_t code[] = {
+        encodeLui(5, TEST_BOUNDARY >> 12),      // lui  t0, TEST_BOUNDARY >> 12
+        encodeAddi(5, 5, -2),                   // addi t0, t0, -2
+        encodeAddi(6, 0, -1),                   // addi t1, zero, -1
+        encodeStoreWord(6, 5),                  // sw   t1, 0(t0)
+        encodeLoadWord(10, 5),                  // lw   a0, 0(t0)
+        encodeAddi(17, 0, RISHKA_SC_SYS_EXIT),  // addi a7, zero, exit
+        0x00000073                              // ecall
+    };
+
+    if(SD.exists(TEST_PROGRAM))
+        SD.remove(TEST_PROGRAM);
+
+    File file = SD.open(TEST_PROGRAM, FILE_WRITE);
+    if(!file)
+        return false;
+
+    bool written = file.write((const uint8_t*) code, sizeof(code)) == sizeof(code);
+    file.close();
+
+    return written;
+}
+
+// Prints the outcome of a check and counts it if it failed.
+static void check(const char* name, bool passed) {
+    Serial.println(String(passed ? "PASS " : "FAIL ") + name);
+
+    if(!passed)
+        failures++;
+}
+
+// Checks that the guest memory around TEST_BOUNDARY holds the stored word.
+static bool holdsStoredWord(RishkaVM* vm) {
+    uint8_t bytes[4];
+
+    if(!vm->readMemory(TEST_BOUNDARY - 2, bytes, sizeof(bytes)))
+        return false;
+
+    for(uint8_t i = 0; i < sizeof(bytes); i++)
+        if(bytes[i] != 0xff)
+            return false;
+
+    return true;
+}
+
+// A reset clears both pages of a store across a page boundary.
+static void testReset() {
+    RishkaVM* vm = new RishkaVM();
+    vm->initialize(NULL, NULL, NULL);
+
+    bool loaded = vm->loadFile(TEST_PROGRAM);
+    if(loaded)
+        vm->run(0, NULL);
+
+    check("store across a page boundary", loaded && vm->getExitCode() == -1 && holdsStoredWord(vm));
+
+    vm->reset();
+    check("reset clears both pages of the store", vm->isPristine(true));
+
+    delete vm;
+}
+
+// A fork of a program that stored across a page boundary starts with the
+// same memory as its parent on both sides of the boundary.
+static void testFork() {
+    RishkaVM* vm = new RishkaVM();
+    vm->initialize(NULL, NULL, NULL);
+
+    bool loaded = vm->loadFile(TEST_PROGRAM);
+    if(loaded)
+        vm->run(0, NULL);
+
+    RishkaVM* child = loaded ? vm->fork() : NULL;
+    bool same = child != NULL && holdsStoredWord(child);
+
+    for(uint64_t address = TEST_BOUNDARY - RISHKA_VM_PAGE_SIZE; same && address < TEST_BOUNDARY + RISHKA_VM_PAGE_SIZE; address += 256) {
+        uint8_t parentBytes[256], childBytes[256];
+
+        same = vm->readMemory(address, parentBytes, sizeof(parentBytes)) &&
+            child->readMemory(address, childBytes, sizeof(childBytes)) &&
+            memcmp(parentBytes, childBytes, sizeof(parentBytes)) == 0;
+    }
+
+    check("fork copies both pages of the store", same);
+
+    delete child;
+    delete vm;
+}
+
+// A program saved right after a store across a page boundary resumes
+// from its snapshot with both halves of the stored word.
+static void testSnapshot() {
+    RishkaVM* vm = new RishkaVM();
+    vm->initialize(NULL, NULL, NULL);
+
+    bool saved = vm->loadFile(TEST_PROGRAM);
+    if(saved) {
+        vm->start(0, NULL);
+        saved = vm->runFor(4) == RISHKA_RUN_BUDGET_EXHAUSTED &&
+            holdsStoredWord(vm) &&
+            vm->saveSnapshot(TEST_SNAPSHOT);
+    }
+
+    check("snapshot saved after the store", saved);
+    delete vm;
+
+    vm = new RishkaVM();
+    vm->initialize(NULL, NULL, NULL);
+
+    bool resumed = saved && vm->loadSnapshot(TEST_SNAPSHOT);
+    if(resumed)
+        vm->run(0, NULL);
+
+    check("snapshot restores both pages of the store", resumed && vm->getExitCode() == -1);
+    delete vm;
+
+    SD.remove(TEST_SNAPSHOT);
+}
+
+// Drops the last bytes of a file, as a power loss while copying it would.
+static bool truncateFile(const char* path, uint32_t dropped) {
+    File file = SD.open(path);
+    if(!file)
+        return false;
+
+    uint32_t size = (uint32_t) file.size();
+    uint8_t* data = size > dropped ? (uint8_t*) malloc(size) : NULL;
+    bool read = data != NULL && file.read(data, size) == size;
+    file.close();
+
+    bool written = false;
+    if(read && SD.remove(path)) {
+        file = SD.open(path, FILE_WRITE);
+        written = file && file.write(data, size - dropped) == size - dropped;
+        file.close();
+    }
+
+    free(data);
+    return written;
+}
+
+// A truncated snapshot is refused before the virtual machine is reset, so
+// the program loaded in it still runs.
+static void testDamagedSnapshot() {
+    RishkaVM* vm = new RishkaVM();
+    vm->initialize(NULL, NULL, NULL);
+
+    bool saved = vm->loadFile(TEST_PROGRAM);
+    if(saved) {
+        vm->start(0, NULL);
+        saved = vm->runFor(4) == RISHKA_RUN_BUDGET_EXHAUSTED &&
+            vm->saveSnapshot(TEST_SNAPSHOT) &&
+            truncateFile(TEST_SNAPSHOT, sizeof(uint32_t));
+    }
+
+    delete vm;
+
+    vm = new RishkaVM();
+    vm->initialize(NULL, NULL, NULL);
+
+    bool refused = saved && vm->loadFile(TEST_PROGRAM) && !vm->loadSnapshot(TEST_SNAPSHOT);
+    if(refused)
+        vm->run(0, NULL);
+
+    check("truncated snapshot keeps the loaded program", refused && vm->getExitCode() == -1 && holdsStoredWord(vm));
+    delete vm;
+
+    SD.remove(TEST_SNAPSHOT);
+}
+
+void setup() {
+    Serial.begin(115200);
+
+    // Initialize SD card
+    sdSpi.begin(SD_SCK, SD_MISO, SD_MOSI, SD_CS);
+    while(!SD.begin(SD_CS, sdSpi, 80000000)) {
+        Serial.println("Card Mount Failed");
+        delay(1000);
+    }
+
+    if(!writeTestProgram()) {
+        Serial.println("Cannot write the test program.");
+        return;
+    }
+
+    testReset();
+    testFork();
+    testSnapshot();
+    testDamagedSnapshot();
+
+    SD.remove(TEST_PROGRAM);
+    Serial.println(failures == 0 ? "All checks passed." : String(failures) + " check(s) failed.");
+}
+
+void loop() {
+    delay(1000);
+}
@@ -44,8 +44,15 @@ ArduinoNvs NvsStorage;
 // SPI instance for SD card
 SPIClass sdSpi(HSPI);
 
-// Rishka virtual machine instance
-RishkaVM* vm;
+// Pool of Rishka virtual machines, shared by the shell
+// and the commands run by its programs
+RishkaVMPool pool;
+
+// Rishka virtual machine running the current command
+RishkaVM* vm = NULL;
+
+// Working directory of the shell
+String workingDirectory = "/";
 
 // This function utilizes a LineEditor instance to read a line
 // from the terminal input. It then returns the read line as a String.
@@ -56,46 +63,6 @@ static inline String readLine() {
     return String(line.get());
 }
 
-// This function splits a given input string into tokens based on space characters.
-// It also handles quotes to allow space characters within quoted strings.
-void splitString(const String& input, char** tokens, int maxTokens, int &count) {
-    int tokenCount = 0, tokenStart = 0;
-    bool inQuotes = false;
-
-    // Iterate over each character in the input string
-    for(int i = 0; i < input.length(); i++) {
-        // Check if the current character is a quotation mark
-        if(input[i] == '"')
-            // Toggle the inQuotes flag to handle quoted strings
-            inQuotes = !inQuotes;
-        else if(input[i] == ' ' && !inQuotes) {
-            // If the current character is a space and not inside quotes,
-            // extract the token from the input string
-            if(tokenCount < maxTokens) {
-                // Extract the substring between tokenStart and i
-                // and copy it into the tokens array
-                input.substring(tokenStart, i)
-                    .toCharArray(tokens[tokenCount], i - tokenStart + 1);
-
-                // Null-terminate the token string
-                tokens[tokenCount++][i - tokenStart] = '\0';
-                tokenStart = i + 1;
-                count++;
-            }
-            else break; // Break if maximum token count reached
-        }
-    }
-
-    // Handle the case where there are remaining characters after the last space
-    if(tokenCount < maxTokens && tokenStart < input.length()) {
-        // Extract the substring starting from tokenStart to the end of the input string
-        // and copy it into the tokens array
-        input.substring(tokenStart).toCharArray(tokens[tokenCount], input.length() - tokenStart + 1);
-        tokens[tokenCount++][input.length() - tokenStart] = '\0';
-        count++;
-    }
-}
-
 void setup() {
     Serial.begin(115200);
     PS2Controller.begin(PS2Preset::KeyboardPort0);
@@ -136,23 +103,26 @@ void setup() {
         while(true);
     }
 
-    // Initialize the Rishka VM instance.
-    vm = new RishkaVM();
-    vm->initialize(&Terminal, &DisplayController, &NvsStorage);
+    // Allocate the Rishka VM instances once, so that
+    // running commands does not allocate memory
+    if(pool.initialize() == 0) {
+        Terminal.println("\e[94mCannot\e[97m allocate Rishka virtual machines.");
+        while(true);
+    }
 
     // Virtual key listener to halt program
     Terminal.onVirtualKeyItem = [&](VirtualKeyItem * vkItem) {
-        if(vkItem->CTRL && vkItem->vk == VirtualKey::VK_c && vm->isRunning()) {
-            // Stop the VM if CTRL+C was pressed
+        if(vkItem->CTRL && vkItem->vk == VirtualKey::VK_c && vm != NULL && vm->isRunning()) {
+            // Stop the VM if CTRL+C was pressed, it is
+            // reset once returned to the pool
             vm->stopVM();
-            vm->reset();
 
             Terminal.println("^C");
         }
     };
 
     // Print prompt
-    Terminal.print("\e[32m[\e[97m" + vm->getWorkingDirectory() + "\e[97m\e[32m]~\e[97m ");
+    Terminal.print("\e[32m[\e[97m" + workingDirectory + "\e[97m\e[32m]~\e[97m ");
 }
 
 void loop() {
@@ -163,17 +133,28 @@ void loop() {
     if(input == "") {
         // Print prompt
         Terminal.print(String("\e[32m[\e[97m") +
-            vm->getWorkingDirectory() + "\e[97m\e[32m]~\e[97m ");
+            workingDirectory + "\e[97m\e[32m]~\e[97m ");
         return;
     }
 
-    char* tokens[10];
-    int count = 0;
+    // Lease a Rishka virtual machine for the command
+    vm = pool.lease(&Terminal, &DisplayController, &NvsStorage, workingDirectory);
 
-    // Split input string as argument tokens
-    for(int i = 0; i < 10; i++)
-        tokens[i] = (char*) malloc(50 * sizeof(char));
-    splitString(input, tokens, 10, count);
+    // If every Rishka virtual machine of the pool
+    // is in use, print error message and return
+    if(vm == NULL) {
+        Terminal.println("\e[94mNo\e[97m Rishka virtual machine available.");
+
+        // Print prompt
+        Terminal.print(String("\e[32m[\e[97m") +
+            workingDirectory + "\e[97m\e[32m]~\e[97m ");
+        return;
+    }
+
+    // Split input string as argument tokens, kept in
+    // the buffers of the leased virtual machine
+    int count = 0;
+    char** tokens = pool.splitArguments(vm, input, count);
 
     // Attempt to load specified file into Rishka virtual machine
     if(!vm->loadFile(tokens[0])) {
@@ -181,29 +162,24 @@ void loop() {
         Terminal.println("Failed to \e[94mload\e[97m specified file: " +
           String(tokens[0]));
 
-        // Free all tokens in memory
-        for(int i = 0; i < 10; i++)
-            free(tokens[i]);
-
-        // Reset Rishka virtual machine for next execution
-        vm->reset();
+        // Return the Rishka virtual machine to the pool
+        pool.release(vm);
 
         // Print prompt
         Terminal.print(String("\e[32m[\e[97m") +
-            vm->getWorkingDirectory() + "\e[97m\e[32m]~\e[97m ");
+            workingDirectory + "\e[97m\e[32m]~\e[97m ");
         return;
     }
 
     // Run loaded program on Rishka virtual machine
     vm->run(count, tokens);
-    // Reset Rishka virtual machine for next execution
-    vm->reset();
+    workingDirectory = vm->getWorkingDirectory();
 
-    // Free all tokens in memory
-    for(int i = 0; i < 10; i++)
-        free(tokens[i]);
+    // Return the Rishka virtual machine to the pool,
+    // which resets it for the next command
+    pool.release(vm);
 
     // Print prompt for next input
     Terminal.print(String("\e[32m[\e[97m") +
-        vm->getWorkingDirectory() + "\e[97m\e[32m]~\e[97m ");
+        workingDirectory + "\e[97m\e[32m]~\e[97m ");
 }
@@ -34,10 +34,17 @@
  * @brief Class for handling memory management operations in Rishka applications.
  *
  * The Memory class provides static methods for allocating, reallocating, and freeing memory,
- * as well as functions for setting memory values on ESP32-WROVER microcontrollers.
+ * as well as functions for setting and copying memory values on ESP32-WROVER microcontrollers.
  */
 class Memory final {
 public:
+    /**
+     * @brief Initialize the heap.
+     *
+     * This method sets up the heap between the end of the program and its
+     * stack region, whose size is given by the `--memory` and `--stack`
+     * options of rishka-cc. It must be called before any allocation.
+     */
     static void initialize();
 
     /**
@@ -93,6 +100,19 @@ public:
      * @return Pointer to the memory block.
      */
     static any set(any dest, u8 c, usize n);
+
+    /**
+     * @brief Copy memory.
+     *
+     * This method copies n bytes from the memory block pointed to by src to the one pointed
+     * to by dest. The blocks must not overlap.
+     *
+     * @param dest Pointer to the destination memory block.
+     * @param src Pointer to the source memory block.
+     * @param n The number of bytes to copy.
+     * @return Pointer to the destination memory block.
+     */
+    static any copy(any dest, any src, usize n);
 };
 
 #endif /* LIBRISHKA_MEM_H */
\ No newline at end of file
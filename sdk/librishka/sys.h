@@ -123,16 +123,38 @@ public:
      */
     static u64 millis();
 
+    /**
+     * @brief Get the number of instructions executed by the program.
+     *
+     * This method reads the `instret` counter of the virtual machine directly,
+     * without a system call, which makes it suitable for timing short code regions.
+     *
+     * @return The number of instructions retired since the program started.
+     */
+    static u64 instructions();
+
+    /**
+     * @brief Get the number of cycles executed by the program.
+     *
+     * Rishka counts one cycle per retired instruction, so this method returns the
+     * same value as instructions(), read from the `cycle` counter instead.
+     *
+     * @return The number of cycles elapsed since the program started.
+     */
+    static u64 cycles();
+
     /**
      * @brief Execute a shell command.
      *
      * This method executes a shell command with the specified binary
      * program file name, argument count, and argument array.
      *
-     * @param program The file name of the binary program to execute.
-     * @param argc The number of arguments in the argument array.
-     * @param argv The array of arguments for the shell command.
-     * @return The exit status of the shell command.
+     * Commands of a program leased from a pool of the host run in
+     * instances of that pool. Other commands, and those nested deeper
+     * than the pool holds, run in temporary virtual machines.
+     *
+     * @param cmdline The file name of the binary program to execute, followed by its arguments.
+     * @return The exit status of the shell command, or -1 if it could not be run.
      */
     static i64 shellexec(string cmdline);
 
@@ -198,6 +220,47 @@ public:
      * @return A string representing the current working directory.
      */
     static string working_dir();
+
+    /**
+     * @brief Run a function on another hart.
+     *
+     * This method starts an additional hart that shares the memory of the program
+     * and calls `routine` with `arg` on the given stack, then exits once it returns.
+     * On the ESP32 the hart runs on the other core. Harts synchronize through atomic
+     * operations (std::atomic, or the __atomic builtins) and stop when the program exits.
+     *
+     * @param routine The function to run on the new hart.
+     * @param arg The argument passed to the function.
+     * @param stack The memory used as the stack of the new hart.
+     * @param size The size of the stack in bytes.
+     * @return The index of the new hart, or -1 if no hart could be started.
+     */
+    static i64 spawn(void (*routine)(any), any arg, any stack, usize size);
+
+    /**
+     * @brief Run a function in a copy of the program.
+     *
+     * This method copies the program, sharing its memory until either side writes
+     * to it, so the copy starts with every variable of the program and only costs
+     * the memory it changes. The copy calls `routine` with `arg` on the current stack
+     * and runs until the routine returns or the copy exits, before this method
+     * returns; its changes to memory are not seen by the program. Files opened by
+     * the program are not open in the copy. Harts started by spawn() must have
+     * returned first.
+     *
+     * @param routine The function to run in the copy.
+     * @param arg The argument passed to the function.
+     * @return The exit code of the copy, 0 if the routine returned, or -1 if the
+     *         program could not be copied.
+     */
+    static i64 fork(void (*routine)(any), any arg);
+
+    /**
+     * @brief Get the index of the hart running the caller.
+     *
+     * @return 0 on the hart that started the program, 1 and up on harts started by spawn().
+     */
+    static u64 hartid();
 };
 
 #endif /* LIBRISHKA_SYS_H */
\ No newline at end of file
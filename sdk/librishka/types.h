@@ -61,7 +61,7 @@ typedef signed int          i32;
  * @typedef i64
  * @brief Alias for the signed 64-bit integer type.
  */
-typedef signed long int     i64;
+typedef signed long long    i64;
 
 /**
  * @typedef u8
@@ -85,7 +85,7 @@ typedef unsigned int        u32;
  * @typedef u64
  * @brief Alias for the unsigned 64-bit integer type.
  */
-typedef unsigned long int   u64;
+typedef unsigned long long  u64;
 
 /**
  * @typedef usize
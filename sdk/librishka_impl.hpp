@@ -193,7 +193,10 @@ enum rishka_syscall {
 
     RISHKA_SC_RT_STRPASS,
     RISHKA_SC_RT_YIELD,
-    RISHKA_SC_RT_FORK_STREAM
+    RISHKA_SC_RT_FORK_STREAM,
+
+    RISHKA_SC_SYS_SPAWN,
+    RISHKA_SC_SYS_FORK
 };
 
 static inline long long int double_to_long(double d) {
@@ -217,46 +220,46 @@ static inline double long_to_float(long long int l) {
 }
 
 static inline i64 rishka_sc_0(i32 scallid) {
-    register i64 a0 asm("a0") = 0;
-    register i64 scid asm("a7") = scallid;
+    register long a0 asm("a0") = 0;
+    register long scid asm("a7") = scallid;
 
     asm volatile ("scall" : "+r"(a0) : "r"(scid));    
     return a0;
 }
 
 static inline i64 rishka_sc_1(i32 scallid, i64 arg0) {
-    register i64 a0 asm("a0") = arg0;
-    register i64 scid asm("a7") = scallid;
+    register long a0 asm("a0") = arg0;
+    register long scid asm("a7") = scallid;
 
     asm volatile ("scall" : "+r"(a0) : "r"(scid));
     return a0;
 }
 
 static inline i64 rishka_sc_2(i32 scallid, i64 arg0, i64 arg1) {
-    register i64 a0 asm("a0") = arg0;
-    register i64 a1 asm("a1") = arg1;
-    register i64 scid asm("a7") = scallid;
+    register long a0 asm("a0") = arg0;
+    register long a1 asm("a1") = arg1;
+    register long scid asm("a7") = scallid;
 
     asm volatile ("scall" : "+r"(a0) : "r"(a1), "r"(scid));
     return a0;
 }
 
 static inline i64 rishka_sc_3(i32 scallid, i64 arg0, i64 arg1, i64 arg2) {
-    register i64 a0 asm("a0") = arg0;
-    register i64 a1 asm("a1") = arg1;
-    register i64 a2 asm("a2") = arg2;
-    register i64 scid asm("a7") = scallid;
+    register long a0 asm("a0") = arg0;
+    register long a1 asm("a1") = arg1;
+    register long a2 asm("a2") = arg2;
+    register long scid asm("a7") = scallid;
 
     asm volatile ("scall" : "+r"(a0) : "r"(a1), "r"(a2), "r"(scid));
     return a0;
 }
 
 static inline i64 rishka_sc_4(i32 scallid, i64 arg0, i64 arg1, i64 arg2, i64 arg3) {
-    register i64 a0 asm("a0") = arg0;
-    register i64 a1 asm("a1") = arg1;
-    register i64 a2 asm("a2") = arg2;
-    register i64 a3 asm("a3") = arg3;
-    register i64 scid asm("a7") = scallid;
+    register long a0 asm("a0") = arg0;
+    register long a1 asm("a1") = arg1;
+    register long a2 asm("a2") = arg2;
+    register long a3 asm("a3") = arg3;
+    register long scid asm("a7") = scallid;
 
     asm volatile ("scall" : "+r"(a0) : "r"(a1), "r"(a2), "r"(a3), "r"(scid));
     return a0;
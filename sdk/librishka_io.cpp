@@ -63,11 +63,16 @@ void IO::println(u64 number) {
 }
 
 void IO::print(double number) {
+#if __riscv_xlen == 32
+    i64 bits = double_to_long(number);
+    rishka_sc_2(RISHKA_SC_IO_PRINTD, (u32) bits, (u32) (bits >> 32));
+#else
     rishka_sc_1(RISHKA_SC_IO_PRINTD, double_to_long(number));
+#endif
 }
 
 void IO::println(double number) {
-    rishka_sc_1(RISHKA_SC_IO_PRINTD, double_to_long(number));
+    IO::print(number);
     IO::println();
 }
 
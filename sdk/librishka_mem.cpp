@@ -18,8 +18,6 @@
 #include "librishka.h"
 #include "librishka_impl.hpp"
 
-#define MEMORY_POOL_SIZE 524288U
-
 /** @cond HIDE_STRUCT */
 typedef struct memory_pool {
     u64 size;
@@ -28,7 +26,10 @@ typedef struct memory_pool {
 } memory_pool;
 /** @endcond */
 
-static u8 memory_pool_block[MEMORY_POOL_SIZE];
+// Bounds of the heap, between the program and its stack region (see link.ld).
+extern u8 __heap_start[];
+extern u8 __heap_end[];
+
 static memory_pool* free_list = (memory_pool*) nil;
 
 #define ALIGN8(x) (((((x) - 1) >> 3) << 3) + 8)
@@ -60,8 +61,8 @@ static void merge_blocks() {
 }
 
 void Memory::initialize() {
-    free_list = (memory_pool*) memory_pool_block;
-    free_list->size = MEMORY_POOL_SIZE - sizeof(memory_pool);
+    free_list = (memory_pool*) __heap_start;
+    free_list->size = (u64)(__heap_end - __heap_start) - sizeof(memory_pool);
     free_list->free = 1;
     free_list->next = (memory_pool*) nil;
 }
@@ -125,8 +126,7 @@ any Memory::realloc(any ptr, usize size) {
         return nil;
 
     usize copy_size = (block->size < size) ? block->size : size;
-    for(usize i = 0; i < copy_size; i++)
-        ((rune*) new_ptr)[i] = ((rune*) ptr)[i];
+    Memory::copy(new_ptr, ptr, copy_size);
 
     Memory::free(ptr);
     return new_ptr;
@@ -136,7 +136,56 @@ __attribute__((optimize("no-tree-loop-distribute-patterns")))
 any Memory::set(any ptr, u8 value, usize num) {
     u8* p = (u8*) ptr;
 
+#if defined(__riscv_vector)
+    while(num > 0) {
+        usize count;
+
+        asm volatile(
+            "vsetvli %0, %1, e8, m8, ta, ma\n\t"
+            "vmv.v.x v8, %2\n\t"
+            "vse8.v v8, (%3)"
+            : "=&r" (count)
+            : "r" (num), "r" ((usize) value), "r" (p)
+            : "v8", "v9", "v10", "v11", "v12", "v13", "v14", "v15", "memory"
+        );
+
+        p += count;
+        num -= count;
+    }
+#else
     while(num--)
         *p++ = value;
+#endif
+
     return ptr;
+}
+
+__attribute__((optimize("no-tree-loop-distribute-patterns")))
+any Memory::copy(any dest, any src, usize num) {
+    u8* d = (u8*) dest;
+    const u8* s = (const u8*) src;
+
+#if defined(__riscv_vector)
+    while(num > 0) {
+        usize count;
+
+        asm volatile(
+            "vsetvli %0, %1, e8, m8, ta, ma\n\t"
+            "vle8.v v8, (%2)\n\t"
+            "vse8.v v8, (%3)"
+            : "=&r" (count)
+            : "r" (num), "r" (s), "r" (d)
+            : "v8", "v9", "v10", "v11", "v12", "v13", "v14", "v15", "memory"
+        );
+
+        d += count;
+        s += count;
+        num -= count;
+    }
+#else
+    while(num--)
+        *d++ = *s++;
+#endif
+
+    return dest;
 }
\ No newline at end of file
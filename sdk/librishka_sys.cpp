@@ -30,6 +30,82 @@ u64 Sys::millis() {
     return (u64) rishka_sc_0(RISHKA_SC_SYS_MILLIS);
 }
 
+// Harts started by spawn() begin here, with the routine and its argument
+// saved at the top of their stack.
+static void rishka_hart_entry(any* start) {
+    ((void (*)(any)) start[0])(start[1]);
+    Sys::exit(0);
+}
+
+i64 Sys::spawn(void (*routine)(any), any arg, any stack, usize size) {
+    any* start = (any*)(((unsigned long) stack + size - 2 * sizeof(any)) &~15UL);
+
+    start[0] = (any) routine;
+    start[1] = arg;
+
+    return rishka_sc_3(RISHKA_SC_SYS_SPAWN, (i64)(unsigned long) rishka_hart_entry,
+        (i64)(unsigned long) start, (i64)(unsigned long) start);
+}
+
+// Copies made by fork() begin here, with the routine and its argument in
+// the first two argument registers.
+static void rishka_fork_entry(void (*routine)(any), any arg) {
+    routine(arg);
+    Sys::exit(0);
+}
+
+i64 Sys::fork(void (*routine)(any), any arg) {
+    return rishka_sc_3(RISHKA_SC_SYS_FORK, (i64)(unsigned long) rishka_fork_entry,
+        (i64)(unsigned long) routine, (i64)(unsigned long) arg);
+}
+
+u64 Sys::hartid() {
+    unsigned long value;
+
+    asm volatile(".insn i 0x73, 2, %0, x0, -236" : "=r" (value));      // mhartid
+    return value;
+}
+
+// The counters are read with .insn so that the SDK builds without Zicsr in
+// -march; the immediates are the CSR numbers as signed 12-bit values.
+u64 Sys::instructions() {
+#if __riscv_xlen == 32
+    u32 high, low, check;
+
+    do {
+        asm volatile(".insn i 0x73, 2, %0, x0, -894" : "=r" (high));     // instreth
+        asm volatile(".insn i 0x73, 2, %0, x0, -1022" : "=r" (low));     // instret
+        asm volatile(".insn i 0x73, 2, %0, x0, -894" : "=r" (check));
+    } while(high != check);
+
+    return (((u64) high << 32) | low);
+#else
+    u64 value;
+
+    asm volatile(".insn i 0x73, 2, %0, x0, -1022" : "=r" (value));      // instret
+    return value;
+#endif
+}
+
+u64 Sys::cycles() {
+#if __riscv_xlen == 32
+    u32 high, low, check;
+
+    do {
+        asm volatile(".insn i 0x73, 2, %0, x0, -896" : "=r" (high));     // cycleh
+        asm volatile(".insn i 0x73, 2, %0, x0, -1024" : "=r" (low));     // cycle
+        asm volatile(".insn i 0x73, 2, %0, x0, -896" : "=r" (check));
+    } while(high != check);
+
+    return (((u64) high << 32) | low);
+#else
+    u64 value;
+
+    asm volatile(".insn i 0x73, 2, %0, x0, -1024" : "=r" (value));      // cycle
+    return value;
+#endif
+}
+
 i64 Sys::shellexec(string cmdline) {
     return (i64) rishka_sc_1(RISHKA_SC_SYS_SHELLEXEC, (i64) cmdline);
 }
@@ -33,10 +33,16 @@
 #include <SD.h>         ///< Include SD card library.
 #include <SPI.h>        ///< Include SPI communication library.
 
+#include <rishka_aot.h>            ///< Registry of ahead-of-time translated programs.
+#include <rishka_code_cache.h>     ///< Persistent SD card cache of decoded programs.
 #include <rishka_instructions.h>   ///< Instruction set architecture definitions.
+#include <rishka_jit.h>            ///< Native block translator for host builds.
+#include <rishka_mmu.h>            ///< Guest page table and software TLB lookups.
 #include <rishka_syscalls.h>       ///< System call interface and implementations.
 #include <rishka_types.h>          ///< Type definitions and aliases.
 #include <rishka_util.h>           ///< Utility functions and macros.
+#include <rishka_vector.h>         ///< Element-wise kernels of the vector instructions.
 #include <rishka_vm.h>             ///< Virtual machine core functionalities.
+#include <rishka_vm_pool.h>        ///< Pool of virtual machines reused between programs.
 
 #endif /* RISHKA_H */
\ No newline at end of file
@@ -0,0 +1,73 @@
+/* 
+ * This file is part of the Rishka distribution (https://github.com/rishka-esp32/rishka).
+ * Copyright (c) 2024 Nathanne Isip.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include <rishka_aot.h>
+#include <rishka_util.h>
+#include <rishka_vm.h>
+#include <string.h>
+
+#if RISHKA_VM_AOT
+
+static rishka_aot_program* rishka_aot_programs = NULL;
+
+bool rishka_aot_register(rishka_aot_program* program) {
+    program->next = rishka_aot_programs;
+    rishka_aot_programs = program;
+
+    return true;
+}
+
+const rishka_aot_program* rishka_aot_find(const char* name) {
+    for(const rishka_aot_program* program = rishka_aot_programs; program != NULL; program = program->next)
+        if(strcmp(program->name, name) == 0)
+            return program;
+
+    return NULL;
+}
+
+const rishka_aot_block* rishka_aot_lookup(const rishka_aot_program* program, int64_t pc) {
+    uint32_t low = 0, high = program->count;
+
+    while(low < high) {
+        uint32_t middle = low + ((high - low) >> 1);
+
+        if(program->blocks[middle].pc < pc)
+            low = middle + 1;
+        else high = middle;
+    }
+
+    if(low < program->count && program->blocks[low].pc == pc)
+        return &program->blocks[low];
+    return NULL;
+}
+
+uint32_t rishka_aot_checksum(const uint8_t* data, uint32_t size) {
+    return rishka_fnv1a(data, size);
+}
+
+bool rishka_aot_store(void* vm, uint64_t address, uint8_t size) {
+    return RishkaVM::nativeStoreHook(vm, address, size);
+}
+
+#if RISHKA_VM_PAGED_MEMORY
+void rishka_aot_access(void* vm, uint64_t address, void* data, uint8_t size, bool write) {
+    RishkaVM::nativeAccessHook(vm, address, data, size, write);
+}
+#endif
+
+#endif
@@ -0,0 +1,178 @@
+/* 
+ * This file is part of the Rishka distribution (https://github.com/rishka-esp32/rishka).
+ * Copyright (c) 2024 Nathanne Isip.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file rishka_aot.h
+ * @author [Nathanne Isip](https://github.com/nthnn)
+ * @brief Registry of the ahead-of-time translated Rishka programs.
+ *
+ * The rishka-aot tool translates the basic blocks of a program binary into
+ * C++ functions with the rishka_native_block signature. Compiling its
+ * output into the firmware (or a host build) registers the translation
+ * under the program name, and RishkaVM::loadFile() of that program runs
+ * the translated blocks instead of interpreting them. Instructions the
+ * tool does not translate, system calls among them, resume the
+ * interpreter, and blocks whose code no longer matches the translation
+ * are simply interpreted.
+ */
+
+#ifndef RISHKA_AOT_H
+#define RISHKA_AOT_H
+
+#include <rishka_mmu.h>
+#include <rishka_types.h>
+#include <stddef.h>
+
+#if RISHKA_VM_AOT
+
+/**
+ * @brief Describes one translated basic block of a program.
+ */
+typedef struct {
+    int64_t pc;                 ///< Guest address of the first instruction of the block.
+    uint16_t length;            ///< Number of instructions up to and including the one the translation leaves the block at.
+    uint16_t size;              ///< Size in bytes of the translated instructions.
+    uint32_t checksum;          ///< rishka_aot_checksum() of the translated instructions.
+    rishka_native_block entry;  ///< Translated block.
+} rishka_aot_block;
+
+/**
+ * @brief Describes the translation of a program, as registered by the generated code.
+ */
+typedef struct rishka_aot_program {
+    const char* name;                   ///< Name of the program, as passed to RishkaVM::loadFile().
+    const rishka_aot_block* blocks;     ///< Translated blocks, sorted by address.
+    uint32_t count;                     ///< Number of translated blocks.
+    struct rishka_aot_program* next;    ///< Next registered program, or NULL.
+} rishka_aot_program;
+
+/**
+ * @brief Registers the translation of a program.
+ *
+ * Called by the generated code during static initialization. A later
+ * registration of the same name takes precedence.
+ *
+ * @param program The program translation, which must outlive every virtual machine.
+ * @return Always true, so that the call can initialize a static flag.
+ */
+bool rishka_aot_register(rishka_aot_program* program);
+
+/**
+ * @brief Finds the registered translation of a program.
+ *
+ * @param name The name of the program, without directory or `.bin` extension.
+ * @return The program translation, or NULL if none is registered.
+ */
+const rishka_aot_program* rishka_aot_find(const char* name);
+
+/**
+ * @brief Finds the translated block starting at a guest address.
+ *
+ * @param program The program translation.
+ * @param pc The guest address of the first instruction of the block.
+ * @return The translated block, or NULL if `pc` does not start one.
+ */
+const rishka_aot_block* rishka_aot_lookup(const rishka_aot_program* program, int64_t pc);
+
+/**
+ * @brief Computes the checksum that guards a translated block against rewritten code.
+ *
+ * This is the 32-bit FNV-1a hash of the bytes, which rishka-aot computes
+ * on the program binary as well.
+ *
+ * @param data The instructions of the block.
+ * @param size The number of bytes of the instructions.
+ * @return The checksum.
+ */
+uint32_t rishka_aot_checksum(const uint8_t* data, uint32_t size);
+
+/**
+ * @brief Store callback of translated blocks, see rishka_native_store_hook.
+ *
+ * The generated code calls it after stores below the end of the decode
+ * cache range, and returns to the interpreter when it returns true.
+ */
+bool rishka_aot_store(void* vm, uint64_t address, uint8_t size);
+
+#if RISHKA_VM_PAGED_MEMORY
+/**
+ * @brief Slow path of rishka_aot_read() and rishka_aot_write().
+ *
+ * Handles the accesses the software TLB does not, allocating the pages
+ * they touch. Accesses outside of guest memory panic the virtual machine
+ * and read as zero.
+ *
+ * @param vm The virtual machine running the block.
+ * @param address The guest address of the access.
+ * @param data The value to be read or written.
+ * @param size The size of the access in bytes.
+ * @param write true to write `data` to guest memory, false to read it.
+ */
+void rishka_aot_access(void* vm, uint64_t address, void* data, uint8_t size, bool write);
+#endif
+
+/**
+ * @brief Loads a value from guest memory in a translated block.
+ *
+ * @tparam T The type of the value.
+ * @param memory The guest memory argument of the block.
+ * @param vm The virtual machine argument of the block.
+ * @param address The guest address of the value.
+ * @return The value.
+ */
+template<typename T>
+inline T rishka_aot_read(rishka_native_memory memory, void* vm, uint64_t address) {
+#if RISHKA_VM_PAGED_MEMORY
+    const T* host = rishka_tlb_lookup<T>(memory, address);
+    if(host != NULL)
+        return *host;
+
+    T value;
+    rishka_aot_access(vm, address, &value, sizeof(T), false);
+    return value;
+#else
+    (void) vm;
+    return *(T*)(&memory[address]);
+#endif
+}
+
+/**
+ * @brief Stores a value to guest memory in a translated block.
+ *
+ * @tparam T The type of the value.
+ * @param memory The guest memory argument of the block.
+ * @param vm The virtual machine argument of the block.
+ * @param address The guest address of the value.
+ * @param value The value.
+ */
+template<typename T>
+inline void rishka_aot_write(rishka_native_memory memory, void* vm, uint64_t address, T value) {
+#if RISHKA_VM_PAGED_MEMORY
+    T* host = rishka_tlb_lookup<T, true>(memory, address);
+    if(host != NULL)
+        *host = value;
+    else rishka_aot_access(vm, address, &value, sizeof(T), true);
+#else
+    (void) vm;
+    rishka_mark_dirty(memory, address, sizeof(T));
+    *(T*)(&memory[address]) = value;
+#endif
+}
+
+#endif
+
+#endif /* RISHKA_AOT_H */
@@ -0,0 +1,396 @@
+/* 
+ * This file is part of the Rishka distribution (https://github.com/rishka-esp32/rishka).
+ * Copyright (c) 2024 Nathanne Isip.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include <rishka_code_cache.h>
+#include <rishka_instructions.h>
+#include <rishka_util.h>
+#include <SD.h>
+
+#if RISHKA_VM_CODE_CACHE
+
+// Bump whenever decoding produces different entries for the same
+// instructions, so that files written by older builds are discarded.
+#define RISHKA_CODE_CACHE_VERSION 2U
+
+#define RISHKA_CODE_CACHE_MAGIC 0x43444b52U     // "RKDC"
+#define RISHKA_CODE_INDEX_MAGIC 0x49434b52U     // "RKCI"
+
+// Runs record their start as a 16-bit decode cache index.
+static_assert(RISHKA_VM_DECODE_CACHE_SIZE <= 65536U,
+    "RISHKA_VM_DECODE_CACHE_SIZE must not exceed 65536 with the code cache enabled.");
+
+// A cache file is this header, followed by runs of consecutive
+// instructions (a start index and a count, then the entries) and the
+// FNV-1a hash of everything before it.
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint8_t entrySize;
+    uint8_t xlen;
+    uint16_t vlen;
+    uint16_t operations;
+    uint32_t hash;
+    uint32_t address;
+    uint32_t size;
+    uint32_t entries;
+    uint32_t runs;
+} rishka_code_cache_header;
+
+// The index lists the cached programs from the least to the most
+// recently used.
+typedef struct {
+    uint32_t magic;
+    uint32_t clock;
+    uint32_t count;
+} rishka_code_index_header;
+
+static String rishka_code_cache_path(uint32_t hash) {
+    char name[16];
+
+    snprintf(name, sizeof(name), "/%08x.rdc", (unsigned int) hash);
+    return String(RISHKA_VM_CODE_CACHE_DIR) + name;
+}
+
+static String rishka_code_index_path() {
+    return String(RISHKA_VM_CODE_CACHE_DIR) + "/index";
+}
+
+static uint32_t rishka_code_index_read(rishka_code_cache_entry* entries, uint32_t* clock) {
+    String path = rishka_code_index_path();
+    rishka_code_index_header header;
+    uint32_t count = 0;
+
+    *clock = 0;
+    if(!SD.exists(path))
+        return 0;
+
+    File file = SD.open(path);
+    if(!file)
+        return 0;
+
+    if(file.read((uint8_t*) &header, sizeof(header)) == sizeof(header) &&
+        header.magic == RISHKA_CODE_INDEX_MAGIC &&
+        header.count <= RISHKA_VM_CODE_CACHE_ENTRIES &&
+        file.read((uint8_t*) entries, header.count * sizeof(rishka_code_cache_entry)) ==
+            header.count * sizeof(rishka_code_cache_entry)) {
+        count = header.count;
+        *clock = header.clock;
+    }
+
+    file.close();
+    return count;
+}
+
+static bool rishka_code_index_write(const rishka_code_cache_entry* entries, uint32_t count, uint32_t clock) {
+    rishka_code_index_header header = {RISHKA_CODE_INDEX_MAGIC, clock, count};
+
+    File file = SD.open(rishka_code_index_path(), FILE_WRITE);
+    if(!file)
+        return false;
+
+    bool written = file.write((const uint8_t*) &header, sizeof(header)) == sizeof(header) &&
+        file.write((const uint8_t*) entries, count * sizeof(rishka_code_cache_entry)) ==
+            count * sizeof(rishka_code_cache_entry);
+
+    file.close();
+    return written;
+}
+
+static uint32_t rishka_code_index_find(const rishka_code_cache_entry* entries, uint32_t count, uint32_t hash) {
+    uint32_t slot = 0;
+
+    while(slot < count && entries[slot].hash != hash)
+        slot++;
+    return slot;
+}
+
+static void rishka_code_index_remove(rishka_code_cache_entry* entries, uint32_t* count, uint32_t slot) {
+    memmove(&entries[slot], &entries[slot + 1], (*count - slot - 1) * sizeof(rishka_code_cache_entry));
+    (*count)--;
+}
+
+// End of the part of the binary inside the decode cache range.
+static uint32_t rishka_code_cache_end(const rishka_code_image* image) {
+    uint64_t end = (uint64_t) image->address + image->size;
+
+    if(end > (RISHKA_VM_DECODE_CACHE_SIZE << 1))
+        end = (RISHKA_VM_DECODE_CACHE_SIZE << 1);
+    return (uint32_t) end;
+}
+
+static uint32_t rishka_code_cache_chunk(rishka_guest_memory memory, uint32_t chunk, uint32_t end) {
+    uint32_t begin = chunk * RISHKA_CODE_CACHE_CHUNK_SIZE, finish = begin + RISHKA_CODE_CACHE_CHUNK_SIZE;
+
+    if(finish > end)
+        finish = end;
+    return rishka_guest_hash(memory, begin, finish - begin);
+}
+
+static void rishka_code_cache_header_init(rishka_code_cache_header* header, const rishka_code_image* image) {
+    header->magic = RISHKA_CODE_CACHE_MAGIC;
+    header->version = RISHKA_CODE_CACHE_VERSION;
+    header->entrySize = sizeof(rishka_decoded_inst);
+    header->xlen = RISHKA_VM_XLEN;
+    header->vlen = RISHKA_VM_VLEN;
+    header->operations = RISHKA_DOP_COUNT;
+    header->hash = image->hash;
+    header->address = image->address;
+    header->size = image->size;
+    header->entries = 0;
+    header->runs = 0;
+}
+
+void rishka_code_cache_describe(rishka_code_image* image, rishka_guest_memory memory, uint32_t address, uint32_t size) {
+    image->hash = rishka_guest_hash(memory, address, size);
+    image->address = address;
+    image->size = size;
+    image->restored = 0;
+
+    uint32_t end = rishka_code_cache_end(image);
+    for(uint32_t chunk = address / RISHKA_CODE_CACHE_CHUNK_SIZE; chunk * RISHKA_CODE_CACHE_CHUNK_SIZE < end; chunk++)
+        image->chunks[chunk] = rishka_code_cache_chunk(memory, chunk, end);
+}
+
+static uint32_t rishka_code_cache_read(const rishka_code_image* image, rishka_decoded_inst* cache) {
+    rishka_code_cache_header header, expected;
+    uint32_t limit = (rishka_code_cache_end(image) >> 1), restored = 0, checksum;
+
+    File file = SD.open(rishka_code_cache_path(image->hash));
+    if(!file)
+        return 0;
+
+    rishka_code_cache_header_init(&expected, image);
+    bool valid = file.read((uint8_t*) &header, sizeof(header)) == sizeof(header);
+
+    expected.entries = header.entries;
+    expected.runs = header.runs;
+    valid = valid && memcmp(&header, &expected, sizeof(header)) == 0;
+    checksum = rishka_fnv1a((const uint8_t*) &header, sizeof(header));
+
+    for(uint32_t run = 0; valid && run < header.runs; run++) {
+        uint16_t extent[2];
+
+        valid = file.read((uint8_t*) extent, sizeof(extent)) == sizeof(extent);
+        checksum = rishka_fnv1a((const uint8_t*) extent, sizeof(extent), checksum);
+
+        for(uint32_t index = extent[0], i = 0; valid && i < extent[1]; i++) {
+            rishka_decoded_inst entry;
+
+            valid = file.read((uint8_t*) &entry, sizeof(entry)) == sizeof(entry) &&
+                entry.op != RISHKA_DOP_UNDECODED && entry.op != RISHKA_DOP_HLE && entry.op < RISHKA_DOP_COUNT &&
+                (entry.length == 1 || entry.length == 2) &&
+                index >= (image->address >> 1) && index + entry.length <= limit;
+            if(!valid)
+                break;
+
+            checksum = rishka_fnv1a((const uint8_t*) &entry, sizeof(entry), checksum);
+            cache[index] = entry;
+            index += entry.length;
+            restored++;
+        }
+    }
+
+    uint32_t stored;
+    valid = valid && restored == header.entries &&
+        file.read((uint8_t*) &stored, sizeof(stored)) == sizeof(stored) && stored == checksum;
+    file.close();
+
+    if(!valid) {
+        memset(cache, 0, RISHKA_VM_DECODE_CACHE_SIZE * sizeof(rishka_decoded_inst));
+        return 0;
+    }
+    return restored;
+}
+
+uint32_t rishka_code_cache_restore(const rishka_code_image* image, rishka_decoded_inst* cache) {
+    rishka_code_cache_entry entries[RISHKA_VM_CODE_CACHE_ENTRIES];
+    uint32_t clock, count = rishka_code_index_read(entries, &clock);
+    uint32_t slot = rishka_code_index_find(entries, count, image->hash);
+
+    if(slot == count)
+        return 0;
+
+    rishka_code_cache_entry entry = entries[slot];
+    uint32_t restored = rishka_code_cache_read(image, cache);
+
+    rishka_code_index_remove(entries, &count, slot);
+    if(restored != 0) {
+        entry.lastUse = ++clock;
+        entries[count++] = entry;
+    }
+    else SD.remove(rishka_code_cache_path(image->hash));
+
+    rishka_code_index_write(entries, count, clock);
+    return restored;
+}
+
+// Entries are kept if they decode code still as loaded, a known routine
+// being decoded by its symbol rather than its instructions.
+static bool rishka_code_cache_keeps(const rishka_code_image* image, rishka_guest_memory memory,
+    const rishka_decoded_inst* cache, uint8_t* state, uint32_t index, uint32_t end) {
+    const rishka_decoded_inst* entry = &cache[index];
+
+    if(entry->op == RISHKA_DOP_UNDECODED || entry->op == RISHKA_DOP_HLE ||
+        ((index + entry->length) << 1) > end)
+        return false;
+
+    uint32_t last = (((index + entry->length) << 1) - 1) / RISHKA_CODE_CACHE_CHUNK_SIZE;
+    for(uint32_t chunk = (index << 1) / RISHKA_CODE_CACHE_CHUNK_SIZE; chunk <= last; chunk++) {
+        if(state[chunk] == 0)
+            state[chunk] = rishka_code_cache_chunk(memory, chunk, end) == image->chunks[chunk] ? 1 : 2;
+
+        if(state[chunk] != 1)
+            return false;
+    }
+
+    return true;
+}
+
+// Walks the runs of kept entries, counting them into the header and,
+// given a file, writing them out.
+static bool rishka_code_cache_runs(const rishka_code_image* image, rishka_guest_memory memory,
+    const rishka_decoded_inst* cache, uint8_t* state, rishka_code_cache_header* header,
+    File* file, uint32_t* checksum) {
+    uint32_t end = rishka_code_cache_end(image), limit = (end >> 1);
+
+    for(uint32_t index = (image->address >> 1); index < limit; index++) {
+        uint16_t extent[2] = {(uint16_t) index, 0};
+        uint32_t next = index;
+
+        while(next < limit && rishka_code_cache_keeps(image, memory, cache, state, next, end)) {
+            extent[1]++;
+            next += cache[next].length;
+        }
+
+        if(extent[1] == 0)
+            continue;
+
+        header->runs++;
+        header->entries += extent[1];
+
+        if(file != NULL) {
+            if(file->write((const uint8_t*) extent, sizeof(extent)) != sizeof(extent))
+                return false;
+            *checksum = rishka_fnv1a((const uint8_t*) extent, sizeof(extent), *checksum);
+
+            for(uint32_t at = index; at < next; at += cache[at].length) {
+                if(file->write((const uint8_t*) &cache[at], sizeof(rishka_decoded_inst)) != sizeof(rishka_decoded_inst))
+                    return false;
+                *checksum = rishka_fnv1a((const uint8_t*) &cache[at], sizeof(rishka_decoded_inst), *checksum);
+            }
+        }
+
+        index = next - 1;
+    }
+
+    return true;
+}
+
+bool rishka_code_cache_store(const rishka_code_image* image, rishka_guest_memory memory, const rishka_decoded_inst* cache) {
+    rishka_code_cache_header header, written;
+    uint8_t state[RISHKA_CODE_CACHE_CHUNKS];
+
+    if(image->size == 0)
+        return false;
+
+    memset(state, 0, sizeof(state));
+    rishka_code_cache_header_init(&header, image);
+    rishka_code_cache_runs(image, memory, cache, state, &header, NULL, NULL);
+
+    if(header.entries <= image->restored)
+        return false;
+
+    if(!SD.exists(RISHKA_VM_CODE_CACHE_DIR) && !SD.mkdir(RISHKA_VM_CODE_CACHE_DIR))
+        return false;
+
+    String path = rishka_code_cache_path(image->hash);
+    File file = SD.open(path, FILE_WRITE);
+    if(!file)
+        return false;
+
+    uint32_t checksum = rishka_fnv1a((const uint8_t*) &header, sizeof(header));
+    rishka_code_cache_header_init(&written, image);
+
+    bool stored = file.write((const uint8_t*) &header, sizeof(header)) == sizeof(header) &&
+        rishka_code_cache_runs(image, memory, cache, state, &written, &file, &checksum) &&
+        file.write((const uint8_t*) &checksum, sizeof(checksum)) == sizeof(checksum);
+    file.close();
+
+    if(!stored) {
+        SD.remove(path);
+        return false;
+    }
+
+    rishka_code_cache_entry entries[RISHKA_VM_CODE_CACHE_ENTRIES];
+    uint32_t clock, count = rishka_code_index_read(entries, &clock), total = 0;
+    uint32_t slot = rishka_code_index_find(entries, count, image->hash);
+
+    if(slot < count)
+        rishka_code_index_remove(entries, &count, slot);
+    else if(count == RISHKA_VM_CODE_CACHE_ENTRIES) {
+        SD.remove(rishka_code_cache_path(entries[0].hash));
+        rishka_code_index_remove(entries, &count, 0);
+    }
+
+    entries[count].hash = image->hash;
+    entries[count].size = sizeof(header) + header.runs * 2 * sizeof(uint16_t) +
+        header.entries * sizeof(rishka_decoded_inst) + sizeof(checksum);
+    entries[count++].lastUse = ++clock;
+
+    for(uint32_t i = 0; i < count; i++)
+        total += entries[i].size;
+
+    while(total > RISHKA_VM_CODE_CACHE_LIMIT) {
+        total -= entries[0].size;
+
+        SD.remove(rishka_code_cache_path(entries[0].hash));
+        rishka_code_index_remove(entries, &count, 0);
+    }
+
+    rishka_code_index_write(entries, count, clock);
+    return count != 0;
+}
+
+uint32_t rishka_code_cache_list(rishka_code_cache_entry* entries, uint32_t capacity) {
+    rishka_code_cache_entry index[RISHKA_VM_CODE_CACHE_ENTRIES];
+    uint32_t clock, count = rishka_code_index_read(index, &clock);
+
+    memcpy(entries, index, (count < capacity ? count : capacity) * sizeof(rishka_code_cache_entry));
+    return count;
+}
+
+bool rishka_code_cache_clear() {
+    rishka_code_cache_entry entries[RISHKA_VM_CODE_CACHE_ENTRIES];
+    uint32_t clock, count = rishka_code_index_read(entries, &clock);
+    bool cleared = true;
+
+    for(uint32_t i = 0; i < count; i++) {
+        String path = rishka_code_cache_path(entries[i].hash);
+
+        if(SD.exists(path) && !SD.remove(path))
+            cleared = false;
+    }
+
+    String path = rishka_code_index_path();
+    if(SD.exists(path) && !SD.remove(path))
+        cleared = false;
+
+    return cleared;
+}
+
+#endif
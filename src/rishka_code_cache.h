@@ -0,0 +1,119 @@
+/* 
+ * This file is part of the Rishka distribution (https://github.com/rishka-esp32/rishka).
+ * Copyright (c) 2024 Nathanne Isip.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file rishka_code_cache.h
+ * @author [Nathanne Isip](https://github.com/nthnn)
+ * @brief Persistent SD card cache of the decoded instructions of programs.
+ *
+ * When a program is loaded, the decode cache entries left by its previous
+ * runs are read back from a file named after the hash of its binary, so
+ * that a warm start executes without decoding the instructions it already
+ * ran before. The entries are written back when the virtual machine is
+ * reset or loads another program, if the run decoded new ones. Entries of
+ * code the program rewrote are not kept, and the least recently used
+ * programs are dropped once the cache outgrows RISHKA_VM_CODE_CACHE_LIMIT
+ * bytes or RISHKA_VM_CODE_CACHE_ENTRIES programs.
+ */
+
+#ifndef RISHKA_CODE_CACHE_H
+#define RISHKA_CODE_CACHE_H
+
+#include <rishka_mmu.h>
+#include <rishka_types.h>
+
+#if RISHKA_VM_CODE_CACHE
+
+#define RISHKA_CODE_CACHE_CHUNK_SIZE 256U   ///< Size in bytes of the pieces of a binary checked for rewritten code.
+#define RISHKA_CODE_CACHE_CHUNKS ((RISHKA_VM_DECODE_CACHE_SIZE << 1) / RISHKA_CODE_CACHE_CHUNK_SIZE)   ///< Number of chunks in the decode cache range.
+
+/**
+ * @brief Identifies a loaded program binary for the code cache.
+ */
+typedef struct {
+    uint32_t hash;                              ///< FNV-1a hash of the whole binary, which names its cache file.
+    uint32_t address;                           ///< Guest address the binary was loaded at.
+    uint32_t size;                              ///< Size of the binary in bytes, or 0 if no program is loaded.
+    uint32_t restored;                          ///< Number of decode cache entries restored when it was loaded.
+    uint32_t chunks[RISHKA_CODE_CACHE_CHUNKS];  ///< FNV-1a hash of each chunk of guest memory the binary was loaded into.
+} rishka_code_image;
+
+/**
+ * @brief Describes a program in the code cache.
+ */
+typedef struct {
+    uint32_t hash;      ///< Hash of the program binary.
+    uint32_t size;      ///< Size in bytes of its cache file.
+    uint32_t lastUse;   ///< Value of the use counter of the cache when the program was last loaded or stored.
+} rishka_code_cache_entry;
+
+/**
+ * @brief Computes the identity of a binary just loaded.
+ *
+ * @param image The identity to fill in.
+ * @param memory The guest memory the binary was loaded into.
+ * @param address The guest address the binary was loaded at.
+ * @param size The size of the binary in bytes.
+ */
+void rishka_code_cache_describe(rishka_code_image* image, rishka_guest_memory memory, uint32_t address, uint32_t size);
+
+/**
+ * @brief Restores the cached decode cache entries of a program.
+ *
+ * The decode cache must be empty. A cache file that does not match the
+ * binary or this build of the library is removed, leaving the decode
+ * cache empty again.
+ *
+ * @param image The identity of the loaded binary.
+ * @param cache The decode cache of the virtual machine.
+ * @return The number of entries restored.
+ */
+uint32_t rishka_code_cache_restore(const rishka_code_image* image, rishka_decoded_inst* cache);
+
+/**
+ * @brief Writes the decode cache entries of a program to its cache file.
+ *
+ * Only entries of code still unchanged since the binary was loaded are
+ * written, and nothing is written unless there are more of them than
+ * were restored.
+ *
+ * @param image The identity of the loaded binary.
+ * @param memory The guest memory of the program.
+ * @param cache The decode cache of the virtual machine.
+ * @return true if the cache file was written.
+ */
+bool rishka_code_cache_store(const rishka_code_image* image, rishka_guest_memory memory, const rishka_decoded_inst* cache);
+
+/**
+ * @brief Lists the programs in the code cache.
+ *
+ * @param entries The array to fill in, least recently used first.
+ * @param capacity The number of elements of `entries`.
+ * @return The number of programs in the cache, which may exceed `capacity`.
+ */
+uint32_t rishka_code_cache_list(rishka_code_cache_entry* entries, uint32_t capacity);
+
+/**
+ * @brief Removes every program from the code cache.
+ *
+ * @return true if all the cache files were removed.
+ */
+bool rishka_code_cache_clear();
+
+#endif
+
+#endif /* RISHKA_CODE_CACHE_H */
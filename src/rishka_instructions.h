@@ -51,6 +51,15 @@ enum rishka_instruction {
     RISHKA_OPINST_BRANCH = 0x63,    /**< Branch instruction. */
     RISHKA_OPINST_FENCE  = 0x0f,    /**< Fence instruction. */
     RISHKA_OPINST_CALL   = 0x73,    /**< Call instruction. */
+    RISHKA_OPINST_FLOAD  = 0x07,    /**< Floating-point load instruction. */
+    RISHKA_OPINST_FSTORE = 0x27,    /**< Floating-point store instruction. */
+    RISHKA_OPINST_FMADD  = 0x43,    /**< Fused multiply-add instruction. */
+    RISHKA_OPINST_FMSUB  = 0x47,    /**< Fused multiply-subtract instruction. */
+    RISHKA_OPINST_FNMSUB = 0x4b,    /**< Fused negated multiply-subtract instruction. */
+    RISHKA_OPINST_FNMADD = 0x4f,    /**< Fused negated multiply-add instruction. */
+    RISHKA_OPINST_FP     = 0x53,    /**< Floating-point arithmetic, conversion and move instruction. */
+    RISHKA_OPINST_VECTOR = 0x57,    /**< Vector arithmetic and configuration instruction. */
+    RISHKA_OPINST_AMO    = 0x2f,    /**< Atomic memory operation instruction. */
 };
 
 /**
@@ -138,4 +147,474 @@ enum rishka_branch_fc3 {
     RISHKA_FC3_BGEU = 0x07   /**< Branch if greater than or equal unsigned. */
 };
 
+/**
+ * @enum rishka_system_fc3
+ * @brief Enumeration of Rishka system instruction funct3 values.
+ *
+ * This enumeration defines symbolic names for the funct3 field
+ * values used in system instructions in the Rishka architecture.
+ * The immediate forms take a 5-bit unsigned immediate in place of rs1.
+ */
+enum rishka_system_fc3 {
+    RISHKA_FC3_PRIV   = 0x00,   /**< Environment call or break. */
+    RISHKA_FC3_CSRRW  = 0x01,   /**< Atomic read/write CSR. */
+    RISHKA_FC3_CSRRS  = 0x02,   /**< Atomic read and set bits in CSR. */
+    RISHKA_FC3_CSRRC  = 0x03,   /**< Atomic read and clear bits in CSR. */
+    RISHKA_FC3_CSRRWI = 0x05,   /**< Atomic read/write CSR with immediate. */
+    RISHKA_FC3_CSRRSI = 0x06,   /**< Atomic read and set bits in CSR with immediate. */
+    RISHKA_FC3_CSRRCI = 0x07    /**< Atomic read and clear bits in CSR with immediate. */
+};
+
+/**
+ * @enum rishka_csr
+ * @brief Enumeration of the control and status registers of the Rishka virtual machine.
+ */
+enum rishka_csr {
+    RISHKA_CSR_FFLAGS   = 0x001, /**< Floating-point accrued exception flags. */
+    RISHKA_CSR_FRM      = 0x002, /**< Floating-point dynamic rounding mode. */
+    RISHKA_CSR_FCSR     = 0x003, /**< Floating-point control and status register (frm and fflags). */
+    RISHKA_CSR_VSTART   = 0x008, /**< Vector start position, always zero. */
+    RISHKA_CSR_CYCLE    = 0xc00, /**< Cycle counter, one cycle per retired instruction (read-only). */
+    RISHKA_CSR_TIME     = 0xc01, /**< Microseconds since boot, as returned by micros() (read-only). */
+    RISHKA_CSR_INSTRET  = 0xc02, /**< Number of instructions retired by the guest (read-only). */
+    RISHKA_CSR_VL       = 0xc20, /**< Vector length (read-only). */
+    RISHKA_CSR_VTYPE    = 0xc21, /**< Vector data type (read-only). */
+    RISHKA_CSR_VLENB    = 0xc22, /**< Vector register width in bytes (read-only). */
+    RISHKA_CSR_CYCLEH   = 0xc80, /**< Upper 32 bits of cycle, on RV32 only (read-only). */
+    RISHKA_CSR_TIMEH    = 0xc81, /**< Upper 32 bits of time, on RV32 only (read-only). */
+    RISHKA_CSR_INSTRETH = 0xc82, /**< Upper 32 bits of instret, on RV32 only (read-only). */
+    RISHKA_CSR_MHARTID  = 0xf14  /**< Index of the hart running the instruction (read-only). */
+};
+
+/**
+ * @enum rishka_fp_funct5
+ * @brief Enumeration of Rishka floating-point instruction funct5 values.
+ *
+ * This enumeration defines symbolic names for the funct5 field (bits 31:27)
+ * of floating-point arithmetic, conversion and move instructions. The format
+ * field (bits 26:25) selects single (0) or double (1) precision.
+ */
+enum rishka_fp_funct5 {
+    RISHKA_FP5_FADD     = 0x00,     /**< Add. */
+    RISHKA_FP5_FSUB     = 0x01,     /**< Subtract. */
+    RISHKA_FP5_FMUL     = 0x02,     /**< Multiply. */
+    RISHKA_FP5_FDIV     = 0x03,     /**< Divide. */
+    RISHKA_FP5_FSGNJ    = 0x04,     /**< Sign injection. */
+    RISHKA_FP5_FMINMAX  = 0x05,     /**< Minimum or maximum. */
+    RISHKA_FP5_FCVT_FF  = 0x08,     /**< Conversion between single and double precision. */
+    RISHKA_FP5_FSQRT    = 0x0b,     /**< Square root. */
+    RISHKA_FP5_FCMP     = 0x14,     /**< Comparison. */
+    RISHKA_FP5_FCVT_XF  = 0x18,     /**< Conversion to integer. */
+    RISHKA_FP5_FCVT_FX  = 0x1a,     /**< Conversion from integer. */
+    RISHKA_FP5_FMV_XF   = 0x1c,     /**< Move to integer register, or classify. */
+    RISHKA_FP5_FMV_FX   = 0x1e      /**< Move from integer register. */
+};
+
+/**
+ * @enum rishka_amo_funct5
+ * @brief Enumeration of Rishka atomic instruction funct5 values.
+ *
+ * This enumeration defines symbolic names for the funct5 field (bits 31:27)
+ * of atomic memory operations. The funct3 field selects word (2) or
+ * double-word (3) operands, and the aq and rl bits (26:25) are ignored since
+ * every atomic instruction is sequentially consistent.
+ */
+enum rishka_amo_funct5 {
+    RISHKA_AMO5_ADD     = 0x00,     /**< Atomic add. */
+    RISHKA_AMO5_SWAP    = 0x01,     /**< Atomic swap. */
+    RISHKA_AMO5_LR      = 0x02,     /**< Load reserved. */
+    RISHKA_AMO5_SC      = 0x03,     /**< Store conditional. */
+    RISHKA_AMO5_XOR     = 0x04,     /**< Atomic XOR. */
+    RISHKA_AMO5_OR      = 0x08,     /**< Atomic OR. */
+    RISHKA_AMO5_AND     = 0x0c,     /**< Atomic AND. */
+    RISHKA_AMO5_MIN     = 0x10,     /**< Atomic signed minimum. */
+    RISHKA_AMO5_MAX     = 0x14,     /**< Atomic signed maximum. */
+    RISHKA_AMO5_MINU    = 0x18,     /**< Atomic unsigned minimum. */
+    RISHKA_AMO5_MAXU    = 0x1c      /**< Atomic unsigned maximum. */
+};
+
+/**
+ * @enum rishka_fp_rounding
+ * @brief Enumeration of the floating-point rounding modes.
+ */
+enum rishka_fp_rounding {
+    RISHKA_RM_RNE = 0x00,   /**< Round to nearest, ties to even. */
+    RISHKA_RM_RTZ = 0x01,   /**< Round towards zero. */
+    RISHKA_RM_RDN = 0x02,   /**< Round down (towards negative infinity). */
+    RISHKA_RM_RUP = 0x03,   /**< Round up (towards positive infinity). */
+    RISHKA_RM_RMM = 0x04,   /**< Round to nearest, ties to max magnitude. */
+    RISHKA_RM_DYN = 0x07    /**< Use the dynamic rounding mode of the frm register. */
+};
+
+/**
+ * @enum rishka_fp_flag
+ * @brief Enumeration of the floating-point accrued exception flags in fflags.
+ */
+enum rishka_fp_flag {
+    RISHKA_FFLAG_NX = 0x01, /**< Inexact. */
+    RISHKA_FFLAG_UF = 0x02, /**< Underflow. */
+    RISHKA_FFLAG_OF = 0x04, /**< Overflow. */
+    RISHKA_FFLAG_DZ = 0x08, /**< Divide by zero. */
+    RISHKA_FFLAG_NV = 0x10  /**< Invalid operation. */
+};
+
+/**
+ * @enum rishka_vector_fc3
+ * @brief Enumeration of Rishka vector instruction funct3 values.
+ *
+ * This enumeration defines symbolic names for the funct3 field values of
+ * vector instructions, which select the operand form of the vector
+ * arithmetic opcode, and the element width of vector loads and stores
+ * (which share the floating-point load and store opcodes).
+ */
+enum rishka_vector_fc3 {
+    RISHKA_FC3_OPIVV  = 0x00,   /**< Integer operation, vector-vector. */
+    RISHKA_FC3_OPMVV  = 0x02,   /**< Multiply, reduction and mask operation, vector-vector. */
+    RISHKA_FC3_OPIVI  = 0x03,   /**< Integer operation, vector-immediate. */
+    RISHKA_FC3_OPIVX  = 0x04,   /**< Integer operation, vector-scalar. */
+    RISHKA_FC3_OPMVX  = 0x06,   /**< Multiply and move operation, vector-scalar. */
+    RISHKA_FC3_OPCFG  = 0x07,   /**< Vector length and type configuration. */
+
+    RISHKA_FC3_VE8    = 0x00,   /**< Load or store 8-bit elements. */
+    RISHKA_FC3_VE16   = 0x05,   /**< Load or store 16-bit elements. */
+    RISHKA_FC3_VE32   = 0x06,   /**< Load or store 32-bit elements. */
+    RISHKA_FC3_VE64   = 0x07    /**< Load or store 64-bit elements. */
+};
+
+/**
+ * @enum rishka_vector_funct6
+ * @brief Enumeration of Rishka vector arithmetic instruction funct6 values.
+ *
+ * The integer operations (OPIVV, OPIVI and OPIVX) and the multiply,
+ * reduction and mask operations (OPMVV and OPMVX) number their funct6
+ * field independently, so values of the two groups overlap.
+ */
+enum rishka_vector_funct6 {
+    RISHKA_VF6_VADD     = 0x00, /**< Add. */
+    RISHKA_VF6_VSUB     = 0x02, /**< Subtract. */
+    RISHKA_VF6_VRSUB    = 0x03, /**< Reverse subtract. */
+    RISHKA_VF6_VMINU    = 0x04, /**< Minimum unsigned. */
+    RISHKA_VF6_VMIN     = 0x05, /**< Minimum. */
+    RISHKA_VF6_VMAXU    = 0x06, /**< Maximum unsigned. */
+    RISHKA_VF6_VMAX     = 0x07, /**< Maximum. */
+    RISHKA_VF6_VAND     = 0x09, /**< AND. */
+    RISHKA_VF6_VOR      = 0x0a, /**< OR. */
+    RISHKA_VF6_VXOR     = 0x0b, /**< XOR. */
+    RISHKA_VF6_VMERGE   = 0x17, /**< Merge under mask, or move when unmasked. */
+    RISHKA_VF6_VMSEQ    = 0x18, /**< Set mask if equal. */
+    RISHKA_VF6_VMSNE    = 0x19, /**< Set mask if not equal. */
+    RISHKA_VF6_VMSLTU   = 0x1a, /**< Set mask if less than unsigned. */
+    RISHKA_VF6_VMSLT    = 0x1b, /**< Set mask if less than. */
+    RISHKA_VF6_VMSLEU   = 0x1c, /**< Set mask if less than or equal unsigned. */
+    RISHKA_VF6_VMSLE    = 0x1d, /**< Set mask if less than or equal. */
+    RISHKA_VF6_VMSGTU   = 0x1e, /**< Set mask if greater than unsigned. */
+    RISHKA_VF6_VMSGT    = 0x1f, /**< Set mask if greater than. */
+    RISHKA_VF6_VSLL     = 0x25, /**< Shift left logical. */
+    RISHKA_VF6_VSRL     = 0x28, /**< Shift right logical. */
+    RISHKA_VF6_VSRA     = 0x29, /**< Shift right arithmetic. */
+
+    RISHKA_VF6_VREDSUM  = 0x00, /**< Sum reduction. */
+    RISHKA_VF6_VREDAND  = 0x01, /**< AND reduction. */
+    RISHKA_VF6_VREDOR   = 0x02, /**< OR reduction. */
+    RISHKA_VF6_VREDXOR  = 0x03, /**< XOR reduction. */
+    RISHKA_VF6_VREDMINU = 0x04, /**< Minimum unsigned reduction. */
+    RISHKA_VF6_VREDMIN  = 0x05, /**< Minimum reduction. */
+    RISHKA_VF6_VREDMAXU = 0x06, /**< Maximum unsigned reduction. */
+    RISHKA_VF6_VREDMAX  = 0x07, /**< Maximum reduction. */
+    RISHKA_VF6_VWXUNARY = 0x10, /**< Move element 0 to a scalar, count or find mask bits (OPMVV), or move a scalar to element 0 (OPMVX). */
+    RISHKA_VF6_VMUNARY  = 0x14, /**< Write element indices. */
+    RISHKA_VF6_VMANDN   = 0x18, /**< Mask AND-NOT. */
+    RISHKA_VF6_VMAND    = 0x19, /**< Mask AND. */
+    RISHKA_VF6_VMOR     = 0x1a, /**< Mask OR. */
+    RISHKA_VF6_VMXOR    = 0x1b, /**< Mask XOR. */
+    RISHKA_VF6_VMORN    = 0x1c, /**< Mask OR-NOT. */
+    RISHKA_VF6_VMNAND   = 0x1d, /**< Mask NAND. */
+    RISHKA_VF6_VMNOR    = 0x1e, /**< Mask NOR. */
+    RISHKA_VF6_VMXNOR   = 0x1f, /**< Mask XNOR. */
+    RISHKA_VF6_VMUL     = 0x25  /**< Multiply, low half. */
+};
+
+/**
+ * @enum rishka_compressed_inst
+ * @brief Enumeration of Rishka compressed (RVC) instruction groups.
+ *
+ * Each value combines the quadrant (bits 1:0) and the funct3 field
+ * (bits 15:13) of a 16-bit instruction as `(quadrant << 3) | funct3`.
+ * Groups sharing an encoding are told apart by their remaining fields.
+ */
+enum rishka_compressed_inst {
+    RISHKA_C_ADDI4SPN = 0x00,   /**< Add scaled immediate to stack pointer. */
+    RISHKA_C_FLD      = 0x01,   /**< Load double-precision float. */
+    RISHKA_C_LW       = 0x02,   /**< Load word. */
+    RISHKA_C_LD       = 0x03,   /**< Load double-word (RV64), or load single-precision float (RV32). */
+    RISHKA_C_FSD      = 0x05,   /**< Store double-precision float. */
+    RISHKA_C_SW       = 0x06,   /**< Store word. */
+    RISHKA_C_SD       = 0x07,   /**< Store double-word (RV64), or store single-precision float (RV32). */
+
+    RISHKA_C_ADDI     = 0x08,   /**< Add immediate, or no operation. */
+    RISHKA_C_ADDIW    = 0x09,   /**< Add immediate word (RV64), or jump and link (RV32). */
+    RISHKA_C_LI       = 0x0a,   /**< Load immediate. */
+    RISHKA_C_LUI      = 0x0b,   /**< Load upper immediate, or add immediate to stack pointer. */
+    RISHKA_C_MISC_ALU = 0x0c,   /**< Shifts, AND immediate and register-register arithmetic. */
+    RISHKA_C_J        = 0x0d,   /**< Jump. */
+    RISHKA_C_BEQZ     = 0x0e,   /**< Branch if zero. */
+    RISHKA_C_BNEZ     = 0x0f,   /**< Branch if not zero. */
+
+    RISHKA_C_SLLI     = 0x10,   /**< Shift left logical immediate. */
+    RISHKA_C_FLDSP    = 0x11,   /**< Load double-precision float from stack. */
+    RISHKA_C_LWSP     = 0x12,   /**< Load word from stack. */
+    RISHKA_C_LDSP     = 0x13,   /**< Load double-word from stack (RV64), or single-precision float (RV32). */
+    RISHKA_C_JR_MV    = 0x14,   /**< Jump register, move, jump and link register, add or environment break. */
+    RISHKA_C_FSDSP    = 0x15,   /**< Store double-precision float to stack. */
+    RISHKA_C_SWSP     = 0x16,   /**< Store word to stack. */
+    RISHKA_C_SDSP     = 0x17    /**< Store double-word to stack (RV64), or single-precision float (RV32). */
+};
+
+/**
+ * @enum rishka_decoded_op
+ * @brief Enumeration of fully resolved Rishka instruction forms.
+ *
+ * This enumeration defines symbolic names for the instruction forms stored
+ * in the decode cache of the Rishka virtual machine. Unlike the opcode and
+ * funct3 enumerations above, each entry identifies a single operation, so the
+ * interpreter can dispatch on it directly without re-examining the opcode,
+ * funct3 and funct7 fields of the raw instruction.
+ */
+enum rishka_decoded_op {
+    RISHKA_DOP_UNDECODED,   /**< Cache entry not yet decoded. */
+    RISHKA_DOP_INVALID,     /**< Invalid instruction, panics when executed. */
+    RISHKA_DOP_NOP,         /**< No operation (includes writes to x0). */
+
+    RISHKA_DOP_LB,          /**< Load byte. */
+    RISHKA_DOP_LHW,         /**< Load half-word. */
+    RISHKA_DOP_LW,          /**< Load word. */
+    RISHKA_DOP_LDW,         /**< Load double-word. */
+    RISHKA_DOP_LBU,         /**< Load byte unsigned. */
+    RISHKA_DOP_LHU,         /**< Load half-word unsigned. */
+    RISHKA_DOP_LRES,        /**< Reserved load format. */
+
+    RISHKA_DOP_SB,          /**< Store byte. */
+    RISHKA_DOP_SHW,         /**< Store half-word. */
+    RISHKA_DOP_SW,          /**< Store word. */
+    RISHKA_DOP_SDW,         /**< Store double-word. */
+
+    RISHKA_DOP_LR_W,        /**< Load reserved word. */
+    RISHKA_DOP_SC_W,        /**< Store conditional word. */
+    RISHKA_DOP_AMO_W,       /**< Atomic memory operation on a word (funct5 in imm). */
+    RISHKA_DOP_LR_D,        /**< Load reserved double-word. */
+    RISHKA_DOP_SC_D,        /**< Store conditional double-word. */
+    RISHKA_DOP_AMO_D,       /**< Atomic memory operation on a double-word (funct5 in imm). */
+
+    RISHKA_DOP_ADDI,        /**< Add immediate. */
+    RISHKA_DOP_SLLI,        /**< Shift left logical by decoded amount. */
+    RISHKA_DOP_SLTI,        /**< Set less than immediate. */
+    RISHKA_DOP_SLTIU,       /**< Set less than immediate unsigned. */
+    RISHKA_DOP_XORI,        /**< XOR immediate. */
+    RISHKA_DOP_SRLI,        /**< Shift right logical by decoded amount. */
+    RISHKA_DOP_SRAI,        /**< Shift right arithmetic by decoded amount. */
+    RISHKA_DOP_ORI,         /**< OR immediate. */
+    RISHKA_DOP_ANDI,        /**< AND immediate. */
+
+    RISHKA_DOP_ADD,         /**< Add. */
+    RISHKA_DOP_SUB,         /**< Subtract. */
+    RISHKA_DOP_SLL,         /**< Shift left logical. */
+    RISHKA_DOP_SLT,         /**< Set less than. */
+    RISHKA_DOP_SLTU,        /**< Set less than unsigned. */
+    RISHKA_DOP_XOR,         /**< XOR. */
+    RISHKA_DOP_SRL,         /**< Shift right logical. */
+    RISHKA_DOP_SRA,         /**< Shift right arithmetic. */
+    RISHKA_DOP_OR,          /**< OR. */
+    RISHKA_DOP_AND,         /**< AND. */
+    RISHKA_DOP_MUL,         /**< Multiply. */
+    RISHKA_DOP_MULH,        /**< Multiply high signed. */
+    RISHKA_DOP_MULHSU,      /**< Multiply high signed-unsigned. */
+    RISHKA_DOP_MULHU,       /**< Multiply high unsigned. */
+    RISHKA_DOP_DIV,         /**< Divide. */
+    RISHKA_DOP_DIVU,        /**< Divide unsigned. */
+    RISHKA_DOP_REM,         /**< Remainder. */
+    RISHKA_DOP_REMU,        /**< Remainder unsigned. */
+
+    RISHKA_DOP_MULW,        /**< Multiply word. */
+    RISHKA_DOP_DIVW,        /**< Divide word. */
+    RISHKA_DOP_DIVUW,       /**< Divide word unsigned. */
+    RISHKA_DOP_REMW,        /**< Remainder word. */
+    RISHKA_DOP_REMUW,       /**< Remainder word unsigned. */
+
+    RISHKA_DOP_LUI,         /**< Load upper immediate. */
+    RISHKA_DOP_AUIPC,       /**< Add upper immediate to PC. */
+    RISHKA_DOP_JAL,         /**< Jump and link. */
+    RISHKA_DOP_JALR,        /**< Jump and link register. */
+
+    RISHKA_DOP_BEQ,         /**< Branch if equal. */
+    RISHKA_DOP_BNE,         /**< Branch if not equal. */
+    RISHKA_DOP_BLT,         /**< Branch if less than. */
+    RISHKA_DOP_BGE,         /**< Branch if greater than or equal. */
+    RISHKA_DOP_BLTU,        /**< Branch if less than unsigned. */
+    RISHKA_DOP_BGEU,        /**< Branch if greater than or equal unsigned. */
+
+    RISHKA_DOP_FENCE,       /**< Memory fence between the harts sharing guest memory. */
+    RISHKA_DOP_FENCE_I,     /**< Instruction fence, flushes the decode cache. */
+    RISHKA_DOP_ECALL,       /**< Environment call (system call). */
+    RISHKA_DOP_EBREAK,      /**< Environment break. */
+    RISHKA_DOP_HLE,         /**< Entry of a known routine run natively (rishka_hle_routine in imm). */
+
+    RISHKA_DOP_CSRRW,       /**< Read/write CSR. */
+    RISHKA_DOP_CSRRS,       /**< Read and set bits in CSR. */
+    RISHKA_DOP_CSRRC,       /**< Read and clear bits in CSR. */
+    RISHKA_DOP_CSRRWI,      /**< Read/write CSR with immediate. */
+    RISHKA_DOP_CSRRSI,      /**< Read and set bits in CSR with immediate. */
+    RISHKA_DOP_CSRRCI,      /**< Read and clear bits in CSR with immediate. */
+
+    RISHKA_DOP_FLW,         /**< Load single-precision float. */
+    RISHKA_DOP_FSW,         /**< Store single-precision float. */
+    RISHKA_DOP_FLD,         /**< Load double-precision float. */
+    RISHKA_DOP_FSD,         /**< Store double-precision float. */
+
+    RISHKA_DOP_FMADD_S,     /**< Fused multiply-add, single precision. */
+    RISHKA_DOP_FMSUB_S,     /**< Fused multiply-subtract, single precision. */
+    RISHKA_DOP_FNMSUB_S,    /**< Fused negated multiply-subtract, single precision. */
+    RISHKA_DOP_FNMADD_S,    /**< Fused negated multiply-add, single precision. */
+    RISHKA_DOP_FADD_S,      /**< Add, single precision. */
+    RISHKA_DOP_FSUB_S,      /**< Subtract, single precision. */
+    RISHKA_DOP_FMUL_S,      /**< Multiply, single precision. */
+    RISHKA_DOP_FDIV_S,      /**< Divide, single precision. */
+    RISHKA_DOP_FSQRT_S,     /**< Square root, single precision. */
+    RISHKA_DOP_FSGNJ_S,     /**< Sign injection, single precision. */
+    RISHKA_DOP_FSGNJN_S,    /**< Negated sign injection, single precision. */
+    RISHKA_DOP_FSGNJX_S,    /**< XOR sign injection, single precision. */
+    RISHKA_DOP_FMIN_S,      /**< Minimum, single precision. */
+    RISHKA_DOP_FMAX_S,      /**< Maximum, single precision. */
+    RISHKA_DOP_FCVT_W_S,    /**< Convert single precision to signed word. */
+    RISHKA_DOP_FCVT_WU_S,   /**< Convert single precision to unsigned word. */
+    RISHKA_DOP_FCVT_L_S,    /**< Convert single precision to signed double-word. */
+    RISHKA_DOP_FCVT_LU_S,   /**< Convert single precision to unsigned double-word. */
+    RISHKA_DOP_FCVT_S_W,    /**< Convert signed word to single precision. */
+    RISHKA_DOP_FCVT_S_WU,   /**< Convert unsigned word to single precision. */
+    RISHKA_DOP_FCVT_S_L,    /**< Convert signed double-word to single precision. */
+    RISHKA_DOP_FCVT_S_LU,   /**< Convert unsigned double-word to single precision. */
+    RISHKA_DOP_FMV_X_W,     /**< Move single-precision bits to integer register. */
+    RISHKA_DOP_FMV_W_X,     /**< Move integer register bits to single precision. */
+    RISHKA_DOP_FEQ_S,       /**< Compare equal, single precision. */
+    RISHKA_DOP_FLT_S,       /**< Compare less than, single precision. */
+    RISHKA_DOP_FLE_S,       /**< Compare less than or equal, single precision. */
+    RISHKA_DOP_FCLASS_S,    /**< Classify, single precision. */
+
+    RISHKA_DOP_FMADD_D,     /**< Fused multiply-add, double precision. */
+    RISHKA_DOP_FMSUB_D,     /**< Fused multiply-subtract, double precision. */
+    RISHKA_DOP_FNMSUB_D,    /**< Fused negated multiply-subtract, double precision. */
+    RISHKA_DOP_FNMADD_D,    /**< Fused negated multiply-add, double precision. */
+    RISHKA_DOP_FADD_D,      /**< Add, double precision. */
+    RISHKA_DOP_FSUB_D,      /**< Subtract, double precision. */
+    RISHKA_DOP_FMUL_D,      /**< Multiply, double precision. */
+    RISHKA_DOP_FDIV_D,      /**< Divide, double precision. */
+    RISHKA_DOP_FSQRT_D,     /**< Square root, double precision. */
+    RISHKA_DOP_FSGNJ_D,     /**< Sign injection, double precision. */
+    RISHKA_DOP_FSGNJN_D,    /**< Negated sign injection, double precision. */
+    RISHKA_DOP_FSGNJX_D,    /**< XOR sign injection, double precision. */
+    RISHKA_DOP_FMIN_D,      /**< Minimum, double precision. */
+    RISHKA_DOP_FMAX_D,      /**< Maximum, double precision. */
+    RISHKA_DOP_FCVT_W_D,    /**< Convert double precision to signed word. */
+    RISHKA_DOP_FCVT_WU_D,   /**< Convert double precision to unsigned word. */
+    RISHKA_DOP_FCVT_L_D,    /**< Convert double precision to signed double-word. */
+    RISHKA_DOP_FCVT_LU_D,   /**< Convert double precision to unsigned double-word. */
+    RISHKA_DOP_FCVT_D_W,    /**< Convert signed word to double precision. */
+    RISHKA_DOP_FCVT_D_WU,   /**< Convert unsigned word to double precision. */
+    RISHKA_DOP_FCVT_D_L,    /**< Convert signed double-word to double precision. */
+    RISHKA_DOP_FCVT_D_LU,   /**< Convert unsigned double-word to double precision. */
+    RISHKA_DOP_FMV_X_D,     /**< Move double-precision bits to integer register. */
+    RISHKA_DOP_FMV_D_X,     /**< Move integer register bits to double precision. */
+    RISHKA_DOP_FEQ_D,       /**< Compare equal, double precision. */
+    RISHKA_DOP_FLT_D,       /**< Compare less than, double precision. */
+    RISHKA_DOP_FLE_D,       /**< Compare less than or equal, double precision. */
+    RISHKA_DOP_FCLASS_D,    /**< Classify, double precision. */
+
+    RISHKA_DOP_FCVT_S_D,    /**< Convert double precision to single precision. */
+    RISHKA_DOP_FCVT_D_S,    /**< Convert single precision to double precision. */
+
+    RISHKA_DOP_SH1ADD,      /**< Shift left by 1 and add. */
+    RISHKA_DOP_SH2ADD,      /**< Shift left by 2 and add. */
+    RISHKA_DOP_SH3ADD,      /**< Shift left by 3 and add. */
+    RISHKA_DOP_ADD_UW,      /**< Add unsigned word. */
+    RISHKA_DOP_SH1ADD_UW,   /**< Shift unsigned word left by 1 and add. */
+    RISHKA_DOP_SH2ADD_UW,   /**< Shift unsigned word left by 2 and add. */
+    RISHKA_DOP_SH3ADD_UW,   /**< Shift unsigned word left by 3 and add. */
+    RISHKA_DOP_SLLI_UW,     /**< Shift left logical unsigned word immediate. */
+
+    RISHKA_DOP_ANDN,        /**< AND with inverted operand. */
+    RISHKA_DOP_ORN,         /**< OR with inverted operand. */
+    RISHKA_DOP_XNOR,        /**< Exclusive NOR. */
+    RISHKA_DOP_CLZ,         /**< Count leading zero bits. */
+    RISHKA_DOP_CTZ,         /**< Count trailing zero bits. */
+    RISHKA_DOP_CPOP,        /**< Count set bits. */
+    RISHKA_DOP_CLZW,        /**< Count leading zero bits in word. */
+    RISHKA_DOP_CTZW,        /**< Count trailing zero bits in word. */
+    RISHKA_DOP_CPOPW,       /**< Count set bits in word. */
+    RISHKA_DOP_MAX,         /**< Maximum. */
+    RISHKA_DOP_MAXU,        /**< Maximum unsigned. */
+    RISHKA_DOP_MIN,         /**< Minimum. */
+    RISHKA_DOP_MINU,        /**< Minimum unsigned. */
+    RISHKA_DOP_SEXT_B,      /**< Sign-extend byte. */
+    RISHKA_DOP_SEXT_H,      /**< Sign-extend half-word. */
+    RISHKA_DOP_ZEXT_H,      /**< Zero-extend half-word. */
+    RISHKA_DOP_ROL,         /**< Rotate left. */
+    RISHKA_DOP_ROR,         /**< Rotate right. */
+    RISHKA_DOP_RORI,        /**< Rotate right by immediate. */
+    RISHKA_DOP_ROLW,        /**< Rotate word left. */
+    RISHKA_DOP_RORW,        /**< Rotate word right. */
+    RISHKA_DOP_RORIW,       /**< Rotate word right by immediate. */
+    RISHKA_DOP_ORC_B,       /**< Bitwise OR-combine within each byte. */
+    RISHKA_DOP_REV8,        /**< Reverse byte order. */
+
+    RISHKA_DOP_BCLR,        /**< Clear single bit. */
+    RISHKA_DOP_BCLRI,       /**< Clear single bit by immediate. */
+    RISHKA_DOP_BEXT,        /**< Extract single bit. */
+    RISHKA_DOP_BEXTI,       /**< Extract single bit by immediate. */
+    RISHKA_DOP_BINV,        /**< Invert single bit. */
+    RISHKA_DOP_BINVI,       /**< Invert single bit by immediate. */
+    RISHKA_DOP_BSET,        /**< Set single bit. */
+    RISHKA_DOP_BSETI,       /**< Set single bit by immediate. */
+
+    RISHKA_DOP_VSETVLI,     /**< Set vector length and type from a register and an immediate. */
+    RISHKA_DOP_VSETIVLI,    /**< Set vector length and type from two immediates. */
+    RISHKA_DOP_VSETVL,      /**< Set vector length and type from two registers. */
+    RISHKA_DOP_VLE,         /**< Unit-stride vector load. */
+    RISHKA_DOP_VSE,         /**< Unit-stride vector store. */
+    RISHKA_DOP_VALU,        /**< Element-wise vector arithmetic. */
+    RISHKA_DOP_VCMP,        /**< Element-wise vector comparison into a mask. */
+    RISHKA_DOP_VMERGE,      /**< Vector merge under mask, or move. */
+    RISHKA_DOP_VRED,        /**< Vector reduction into element 0. */
+    RISHKA_DOP_VMASK,       /**< Mask register logical operation. */
+    RISHKA_DOP_VMV_X_S,     /**< Move vector element 0 to an integer register. */
+    RISHKA_DOP_VMV_S_X,     /**< Move an integer register to vector element 0. */
+    RISHKA_DOP_VCPOP,       /**< Count active mask bits. */
+    RISHKA_DOP_VFIRST,      /**< Find the first active mask bit. */
+    RISHKA_DOP_VID,         /**< Write element indices. */
+
+    RISHKA_DOP_COUNT        /**< Number of resolved instruction forms. */
+};
+
+/**
+ * @enum rishka_invalid_inst
+ * @brief Enumeration of invalid instruction kinds recorded by the decoder.
+ *
+ * When the decoder meets an instruction it cannot resolve, it stores one of
+ * these values in the immediate field of a RISHKA_DOP_INVALID entry so the
+ * interpreter can report the same panic message as the original decoder.
+ */
+enum rishka_invalid_inst {
+    RISHKA_INVALID_LOAD,        /**< Invalid load instruction. */
+    RISHKA_INVALID_STORE,       /**< Invalid store instruction. */
+    RISHKA_INVALID_IMM_SHIFT,   /**< Invalid immediate shift instruction. */
+    RISHKA_INVALID_IMM,         /**< Invalid immediate instruction. */
+    RISHKA_INVALID_ARITH,       /**< Invalid arithmetic instruction. */
+    RISHKA_INVALID_ARITH32,     /**< Invalid 32-bit arithmetic instruction. */
+    RISHKA_INVALID_BRANCH,      /**< Invalid branch instruction. */
+    RISHKA_INVALID_SYSTEM,      /**< Invalid system instruction. */
+    RISHKA_INVALID_COMPRESSED,  /**< Invalid or unsupported compressed instruction. */
+    RISHKA_INVALID_FLOAT,       /**< Invalid floating-point instruction. */
+    RISHKA_INVALID_VECTOR,      /**< Invalid or unsupported vector instruction, or invalid vector type. */
+    RISHKA_INVALID_ATOMIC,      /**< Invalid atomic instruction, or misaligned atomic address. */
+    RISHKA_INVALID_OPCODE       /**< Invalid opcode instruction. */
+};
+
 #endif /* RISHKA_INSTRUCTIONS_H */
\ No newline at end of file
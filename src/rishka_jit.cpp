@@ -0,0 +1,758 @@
+/* 
+ * This file is part of the Rishka distribution (https://github.com/rishka-esp32/rishka).
+ * Copyright (c) 2024 Nathanne Isip.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <rishka_jit.h>
+
+#if RISHKA_VM_JIT
+
+#include <rishka_instructions.h>
+#include <string.h>
+#include <sys/mman.h>
+
+static_assert(sizeof(rishka_decoded_inst) == 8 && offsetof(rishka_decoded_inst, op) == 0,
+    "Native store checks assume 8-byte decode cache entries.");
+
+#define RISHKA_JIT_MAX_BLOCK        64U     ///< Maximum number of instructions translated per block
+#define RISHKA_JIT_MAX_INST_SIZE    384U    ///< Upper bound of the native code size of one instruction
+#define RISHKA_JIT_MAX_FRAME_SIZE   320U    ///< Upper bound of the prologue, register loads and final exit
+
+enum rishka_x64_reg {
+    RISHKA_X64_RAX, RISHKA_X64_RCX, RISHKA_X64_RDX, RISHKA_X64_RBX,
+    RISHKA_X64_RSP, RISHKA_X64_RBP, RISHKA_X64_RSI, RISHKA_X64_RDI,
+    RISHKA_X64_R8,  RISHKA_X64_R9,  RISHKA_X64_R10, RISHKA_X64_R11,
+    RISHKA_X64_R12, RISHKA_X64_R13, RISHKA_X64_R14, RISHKA_X64_R15
+};
+
+enum rishka_x64_cond {
+    RISHKA_X64_CC_B  = 0x2,
+    RISHKA_X64_CC_AE = 0x3,
+    RISHKA_X64_CC_E  = 0x4,
+    RISHKA_X64_CC_NE = 0x5,
+    RISHKA_X64_CC_L  = 0xc,
+    RISHKA_X64_CC_GE = 0xd
+};
+
+// Host registers available for caching guest registers. RAX, RCX, RDX, RSI
+// and RDI are scratch registers, R14 holds the guest memory base and R15 the
+// guest register file.
+static const uint8_t rishka_jit_cached[] = {
+    RISHKA_X64_RBX, RISHKA_X64_RBP, RISHKA_X64_R12, RISHKA_X64_R13,
+    RISHKA_X64_R8,  RISHKA_X64_R9,  RISHKA_X64_R10, RISHKA_X64_R11
+};
+
+#define RISHKA_JIT_REGISTERS    RISHKA_X64_R15
+#define RISHKA_JIT_MEMORY       RISHKA_X64_R14
+
+#define RISHKA_JIT_READS_RS1    1
+#define RISHKA_JIT_READS_RS2    2
+#define RISHKA_JIT_WRITES_RD    4
+
+static uint8_t rishka_jit_operands(uint8_t op) {
+    switch(op) {
+        case RISHKA_DOP_ADD:    case RISHKA_DOP_SUB:    case RISHKA_DOP_SLL:
+        case RISHKA_DOP_SLT:    case RISHKA_DOP_SLTU:   case RISHKA_DOP_XOR:
+        case RISHKA_DOP_SRL:    case RISHKA_DOP_SRA:    case RISHKA_DOP_OR:
+        case RISHKA_DOP_AND:    case RISHKA_DOP_MUL:    case RISHKA_DOP_SH1ADD:
+        case RISHKA_DOP_SH2ADD: case RISHKA_DOP_SH3ADD: case RISHKA_DOP_ANDN:
+        case RISHKA_DOP_ORN:    case RISHKA_DOP_XNOR:   case RISHKA_DOP_MAX:
+        case RISHKA_DOP_MAXU:   case RISHKA_DOP_MIN:    case RISHKA_DOP_MINU:
+        case RISHKA_DOP_ROL:    case RISHKA_DOP_ROR:    case RISHKA_DOP_BCLR:
+        case RISHKA_DOP_BEXT:   case RISHKA_DOP_BINV:   case RISHKA_DOP_BSET:
+            return RISHKA_JIT_READS_RS1 | RISHKA_JIT_READS_RS2 | RISHKA_JIT_WRITES_RD;
+
+        case RISHKA_DOP_LB:     case RISHKA_DOP_LHW:    case RISHKA_DOP_LW:
+        case RISHKA_DOP_LDW:    case RISHKA_DOP_LBU:    case RISHKA_DOP_LHU:
+        case RISHKA_DOP_LRES:   case RISHKA_DOP_ADDI:   case RISHKA_DOP_SLLI:
+        case RISHKA_DOP_SLTI:   case RISHKA_DOP_SLTIU:  case RISHKA_DOP_XORI:
+        case RISHKA_DOP_SRLI:   case RISHKA_DOP_SRAI:   case RISHKA_DOP_ORI:
+        case RISHKA_DOP_ANDI:   case RISHKA_DOP_JALR:   case RISHKA_DOP_SEXT_B:
+        case RISHKA_DOP_SEXT_H: case RISHKA_DOP_ZEXT_H: case RISHKA_DOP_REV8:
+        case RISHKA_DOP_RORI:   case RISHKA_DOP_BCLRI:  case RISHKA_DOP_BEXTI:
+        case RISHKA_DOP_BINVI:  case RISHKA_DOP_BSETI:
+            return RISHKA_JIT_READS_RS1 | RISHKA_JIT_WRITES_RD;
+
+        case RISHKA_DOP_SB:     case RISHKA_DOP_SHW:    case RISHKA_DOP_SW:
+        case RISHKA_DOP_SDW:    case RISHKA_DOP_BEQ:    case RISHKA_DOP_BNE:
+        case RISHKA_DOP_BLT:    case RISHKA_DOP_BGE:    case RISHKA_DOP_BLTU:
+        case RISHKA_DOP_BGEU:
+            return RISHKA_JIT_READS_RS1 | RISHKA_JIT_READS_RS2;
+
+        case RISHKA_DOP_LUI:    case RISHKA_DOP_AUIPC:  case RISHKA_DOP_JAL:
+            return RISHKA_JIT_WRITES_RD;
+
+        default:
+            return 0;
+    }
+}
+
+RishkaJIT::RishkaJIT() {
+    this->code = NULL;
+    this->used = 0;
+    this->out = NULL;
+    this->full = false;
+}
+
+RishkaJIT::~RishkaJIT() {
+    if(this->code != NULL)
+        munmap(this->code, RISHKA_VM_JIT_CODE_SIZE);
+}
+
+bool RishkaJIT::isFull() const {
+    return this->full;
+}
+
+void RishkaJIT::reset() {
+    this->used = 0;
+    this->full = false;
+}
+
+bool RishkaJIT::isSupported(const rishka_decoded_inst* inst) {
+    switch(inst->op) {
+        case RISHKA_DOP_SLLI:
+        case RISHKA_DOP_SRLI:
+        case RISHKA_DOP_SRAI:
+            return inst->imm >= 0 && inst->imm < 64;
+
+        case RISHKA_DOP_NOP:
+            return true;
+
+        default:
+            return rishka_jit_operands(inst->op) != 0;
+    }
+}
+
+rishka_native_block RishkaJIT::compile(
+    const rishka_decoded_inst* decodeCache,
+    int64_t pc,
+    void* vm,
+    rishka_native_store_hook hook
+) {
+    if(this->code == NULL) {
+        void* buffer = mmap(NULL, RISHKA_VM_JIT_CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if(buffer == MAP_FAILED)
+            return NULL;
+        this->code = (uint8_t*) buffer;
+    }
+
+    const rishka_decoded_inst* insts = &decodeCache[(uint64_t) pc >> 1];
+    uint32_t count = 0, span = 0;
+    bool terminated = false;
+
+    while(count < RISHKA_JIT_MAX_BLOCK && RishkaJIT::isSupported(&insts[span])) {
+        uint8_t op = insts[span].op;
+
+        span += insts[span].length;
+        count++;
+
+        if(op == RISHKA_DOP_JAL || op == RISHKA_DOP_JALR || (op >= RISHKA_DOP_BEQ && op <= RISHKA_DOP_BGEU)) {
+            terminated = true;
+            break;
+        }
+    }
+
+    if(count == 0)
+        return NULL;
+
+    if(this->used + RISHKA_JIT_MAX_FRAME_SIZE + count * RISHKA_JIT_MAX_INST_SIZE > RISHKA_VM_JIT_CODE_SIZE) {
+        this->full = true;
+        return NULL;
+    }
+
+    uint8_t* entry = &this->code[this->used];
+    this->out = entry;
+    this->allocateRegisters(insts, count);
+
+    this->emitPush(RISHKA_X64_RBX);
+    this->emitPush(RISHKA_X64_RBP);
+    this->emitPush(RISHKA_X64_R12);
+    this->emitPush(RISHKA_X64_R13);
+    this->emitPush(RISHKA_X64_R14);
+    this->emitPush(RISHKA_X64_R15);
+    this->emitAluImm(5, RISHKA_X64_RSP, 8);
+
+    this->emitMove(RISHKA_JIT_REGISTERS, RISHKA_X64_RDI);
+    this->emitMove(RISHKA_JIT_MEMORY, RISHKA_X64_RSI);
+
+    for(uint8_t guest = 1; guest < 32; guest++)
+        if(this->hostRegister[guest] != -1)
+            this->emitOpMem(0x8B, true, this->hostRegister[guest], RISHKA_JIT_REGISTERS, guest * 8);
+
+    for(uint32_t i = 0, at = 0; i < count; i++, at += insts[at].length)
+        this->emitInstruction(&insts[at], pc + (int64_t)(at << 1), decodeCache, vm, hook);
+
+    if(!terminated)
+        this->emitExit(pc + (int64_t)(span << 1), RISHKA_NATIVE_RESUME);
+
+    this->used = (size_t)(this->out - this->code);
+    return (rishka_native_block) entry;
+}
+
+void RishkaJIT::allocateRegisters(const rishka_decoded_inst* insts, uint32_t count) {
+    uint16_t uses[32];
+
+    memset(uses, 0, sizeof(uses));
+    memset(this->hostRegister, -1, sizeof(this->hostRegister));
+    this->dirtyRegisters = 0;
+
+    for(uint32_t i = 0, at = 0; i < count; i++, at += insts[at].length) {
+        uint8_t operands = rishka_jit_operands(insts[at].op);
+
+        if(operands & RISHKA_JIT_READS_RS1)
+            uses[insts[at].rs1]++;
+        if(operands & RISHKA_JIT_READS_RS2)
+            uses[insts[at].rs2]++;
+        if(operands & RISHKA_JIT_WRITES_RD) {
+            uses[insts[at].rd]++;
+            this->dirtyRegisters |= (1U << insts[at].rd);
+        }
+    }
+
+    uses[0] = 0;
+    for(uint8_t slot = 0; slot < sizeof(rishka_jit_cached); slot++) {
+        uint8_t best = 0;
+
+        for(uint8_t guest = 1; guest < 32; guest++)
+            if(this->hostRegister[guest] == -1 && uses[guest] > uses[best])
+                best = guest;
+
+        // A register used once is cheaper to access in memory than to load and spill.
+        if(uses[best] < 2)
+            break;
+
+        this->hostRegister[best] = rishka_jit_cached[slot];
+        uses[best] = 0;
+    }
+}
+
+void RishkaJIT::emitInstruction(
+    const rishka_decoded_inst* inst,
+    int64_t pc,
+    const rishka_decoded_inst* decodeCache,
+    void* vm,
+    rishka_native_store_hook hook
+) {
+    uint8_t a, b;
+
+    switch(inst->op) {
+        case RISHKA_DOP_NOP:
+            break;
+
+        case RISHKA_DOP_ADD:
+        case RISHKA_DOP_SUB:
+        case RISHKA_DOP_XOR:
+        case RISHKA_DOP_OR:
+        case RISHKA_DOP_AND:
+        case RISHKA_DOP_MUL: {
+            static const uint16_t opcodes[] = { 0x03, 0x2B, 0x33, 0x0B, 0x23, 0x0FAF };
+            uint8_t index = inst->op == RISHKA_DOP_ADD ? 0 : inst->op == RISHKA_DOP_SUB ? 1 :
+                inst->op == RISHKA_DOP_XOR ? 2 : inst->op == RISHKA_DOP_OR ? 3 :
+                inst->op == RISHKA_DOP_AND ? 4 : 5;
+
+            b = this->emitSource(inst->rs2, RISHKA_X64_RCX);
+            a = this->emitSource(inst->rs1, RISHKA_X64_RAX);
+
+            this->emitMove(RISHKA_X64_RAX, a);
+            this->emitOp(opcodes[index], true, RISHKA_X64_RAX, b);
+            this->emitDestination(inst->rd, RISHKA_X64_RAX);
+            break;
+        }
+
+        case RISHKA_DOP_SLL:
+        case RISHKA_DOP_SRL:
+        case RISHKA_DOP_SRA:
+            b = this->emitSource(inst->rs2, RISHKA_X64_RCX);
+            this->emitMove(RISHKA_X64_RCX, b);
+            this->emitOp(0x81, false, 4, RISHKA_X64_RCX);
+            this->emitDword(0x1f);
+
+            a = this->emitSource(inst->rs1, RISHKA_X64_RAX);
+            this->emitMove(RISHKA_X64_RAX, a);
+            this->emitOp(0xD3, true, inst->op == RISHKA_DOP_SLL ? 4 :
+                inst->op == RISHKA_DOP_SRL ? 5 : 7, RISHKA_X64_RAX);
+            this->emitDestination(inst->rd, RISHKA_X64_RAX);
+            break;
+
+        case RISHKA_DOP_SLT:
+        case RISHKA_DOP_SLTU:
+            a = this->emitSource(inst->rs1, RISHKA_X64_RAX);
+            b = this->emitSource(inst->rs2, RISHKA_X64_RCX);
+
+            this->emitOp(0x3B, true, a, b);
+            this->emitOp(inst->op == RISHKA_DOP_SLT ? 0x0F9C : 0x0F92, false, 0, RISHKA_X64_RAX);
+            this->emitOp(0x0FB6, false, RISHKA_X64_RAX, RISHKA_X64_RAX);
+            this->emitDestination(inst->rd, RISHKA_X64_RAX);
+            break;
+
+        case RISHKA_DOP_ADDI:
+        case RISHKA_DOP_XORI:
+        case RISHKA_DOP_ORI:
+        case RISHKA_DOP_ANDI:
+            a = this->emitSource(inst->rs1, RISHKA_X64_RAX);
+
+            this->emitMove(RISHKA_X64_RAX, a);
+            this->emitAluImm(inst->op == RISHKA_DOP_ADDI ? 0 : inst->op == RISHKA_DOP_XORI ? 6 :
+                inst->op == RISHKA_DOP_ORI ? 1 : 4, RISHKA_X64_RAX, inst->imm);
+            this->emitDestination(inst->rd, RISHKA_X64_RAX);
+            break;
+
+        case RISHKA_DOP_SLTI:
+        case RISHKA_DOP_SLTIU:
+            a = this->emitSource(inst->rs1, RISHKA_X64_RAX);
+
+            this->emitAluImm(7, a, inst->imm);
+            this->emitOp(inst->op == RISHKA_DOP_SLTI ? 0x0F9C : 0x0F92, false, 0, RISHKA_X64_RAX);
+            this->emitOp(0x0FB6, false, RISHKA_X64_RAX, RISHKA_X64_RAX);
+            this->emitDestination(inst->rd, RISHKA_X64_RAX);
+            break;
+
+        case RISHKA_DOP_SLLI:
+        case RISHKA_DOP_SRLI:
+        case RISHKA_DOP_SRAI:
+            a = this->emitSource(inst->rs1, RISHKA_X64_RAX);
+
+            this->emitMove(RISHKA_X64_RAX, a);
+            this->emitOp(0xC1, true, inst->op == RISHKA_DOP_SLLI ? 4 :
+                inst->op == RISHKA_DOP_SRLI ? 5 : 7, RISHKA_X64_RAX);
+            this->emitByte((uint8_t) inst->imm);
+            this->emitDestination(inst->rd, RISHKA_X64_RAX);
+            break;
+
+        case RISHKA_DOP_SH1ADD:
+        case RISHKA_DOP_SH2ADD:
+        case RISHKA_DOP_SH3ADD:
+            b = this->emitSource(inst->rs2, RISHKA_X64_RCX);
+            a = this->emitSource(inst->rs1, RISHKA_X64_RAX);
+
+            this->emitMove(RISHKA_X64_RAX, a);
+            this->emitOp(0xC1, true, 4, RISHKA_X64_RAX);
+            this->emitByte(inst->op - RISHKA_DOP_SH1ADD + 1);
+            this->emitOp(0x03, true, RISHKA_X64_RAX, b);
+            this->emitDestination(inst->rd, RISHKA_X64_RAX);
+            break;
+
+        case RISHKA_DOP_ANDN:
+        case RISHKA_DOP_ORN:
+        case RISHKA_DOP_XNOR:
+            b = this->emitSource(inst->rs2, RISHKA_X64_RCX);
+            this->emitMove(RISHKA_X64_RCX, b);
+            this->emitOp(0xF7, true, 2, RISHKA_X64_RCX);
+
+            a = this->emitSource(inst->rs1, RISHKA_X64_RAX);
+            this->emitMove(RISHKA_X64_RAX, a);
+            this->emitOp(inst->op == RISHKA_DOP_ANDN ? 0x23 : inst->op == RISHKA_DOP_ORN ? 0x0B : 0x33,
+                true, RISHKA_X64_RAX, RISHKA_X64_RCX);
+            this->emitDestination(inst->rd, RISHKA_X64_RAX);
+            break;
+
+        case RISHKA_DOP_MAX:
+        case RISHKA_DOP_MAXU:
+        case RISHKA_DOP_MIN:
+        case RISHKA_DOP_MINU: {
+            // CMOVL, CMOVB, CMOVG and CMOVA replace rs1 with rs2 when rs2 wins.
+            static const uint16_t opcodes[] = { 0x0F4C, 0x0F42, 0x0F4F, 0x0F47 };
+
+            b = this->emitSource(inst->rs2, RISHKA_X64_RCX);
+            a = this->emitSource(inst->rs1, RISHKA_X64_RAX);
+
+            this->emitMove(RISHKA_X64_RAX, a);
+            this->emitOp(0x3B, true, RISHKA_X64_RAX, b);
+            this->emitOp(opcodes[inst->op - RISHKA_DOP_MAX], true, RISHKA_X64_RAX, b);
+            this->emitDestination(inst->rd, RISHKA_X64_RAX);
+            break;
+        }
+
+        case RISHKA_DOP_SEXT_B:
+        case RISHKA_DOP_SEXT_H:
+        case RISHKA_DOP_ZEXT_H:
+            a = this->emitSource(inst->rs1, RISHKA_X64_RAX);
+
+            this->emitOp(inst->op == RISHKA_DOP_SEXT_B ? 0x0FBE : inst->op == RISHKA_DOP_SEXT_H ? 0x0FBF : 0x0FB7,
+                inst->op != RISHKA_DOP_ZEXT_H, RISHKA_X64_RAX, a);
+            this->emitDestination(inst->rd, RISHKA_X64_RAX);
+            break;
+
+        case RISHKA_DOP_REV8:
+            a = this->emitSource(inst->rs1, RISHKA_X64_RAX);
+
+            this->emitMove(RISHKA_X64_RAX, a);
+            this->emitRex(true, 0, RISHKA_X64_RAX);
+            this->emitByte(0x0F);
+            this->emitByte(0xC8 | RISHKA_X64_RAX);
+            this->emitDestination(inst->rd, RISHKA_X64_RAX);
+            break;
+
+        case RISHKA_DOP_ROL:
+        case RISHKA_DOP_ROR:
+            b = this->emitSource(inst->rs2, RISHKA_X64_RCX);
+            this->emitMove(RISHKA_X64_RCX, b);
+
+            a = this->emitSource(inst->rs1, RISHKA_X64_RAX);
+            this->emitMove(RISHKA_X64_RAX, a);
+            this->emitOp(0xD3, true, inst->op == RISHKA_DOP_ROL ? 0 : 1, RISHKA_X64_RAX);
+            this->emitDestination(inst->rd, RISHKA_X64_RAX);
+            break;
+
+        case RISHKA_DOP_RORI:
+            a = this->emitSource(inst->rs1, RISHKA_X64_RAX);
+
+            this->emitMove(RISHKA_X64_RAX, a);
+            this->emitOp(0xC1, true, 1, RISHKA_X64_RAX);
+            this->emitByte((uint8_t) inst->imm);
+            this->emitDestination(inst->rd, RISHKA_X64_RAX);
+            break;
+
+        // BT, BTS, BTR and BTC take the bit index modulo 64 from a register
+        // operand, as the guest instructions do.
+        case RISHKA_DOP_BCLR:
+        case RISHKA_DOP_BEXT:
+        case RISHKA_DOP_BINV:
+        case RISHKA_DOP_BSET:
+            b = this->emitSource(inst->rs2, RISHKA_X64_RCX);
+            a = this->emitSource(inst->rs1, RISHKA_X64_RAX);
+
+            this->emitMove(RISHKA_X64_RAX, a);
+            this->emitOp(inst->op == RISHKA_DOP_BCLR ? 0x0FB3 : inst->op == RISHKA_DOP_BEXT ? 0x0FA3 :
+                inst->op == RISHKA_DOP_BINV ? 0x0FBB : 0x0FAB, true, b, RISHKA_X64_RAX);
+
+            if(inst->op == RISHKA_DOP_BEXT) {
+                this->emitOp(0x0F92, false, 0, RISHKA_X64_RAX);
+                this->emitOp(0x0FB6, false, RISHKA_X64_RAX, RISHKA_X64_RAX);
+            }
+            this->emitDestination(inst->rd, RISHKA_X64_RAX);
+            break;
+
+        case RISHKA_DOP_BCLRI:
+        case RISHKA_DOP_BEXTI:
+        case RISHKA_DOP_BINVI:
+        case RISHKA_DOP_BSETI:
+            a = this->emitSource(inst->rs1, RISHKA_X64_RAX);
+
+            this->emitMove(RISHKA_X64_RAX, a);
+            this->emitOp(0x0FBA, true, inst->op == RISHKA_DOP_BCLRI ? 6 : inst->op == RISHKA_DOP_BEXTI ? 4 :
+                inst->op == RISHKA_DOP_BINVI ? 7 : 5, RISHKA_X64_RAX);
+            this->emitByte((uint8_t) inst->imm);
+
+            if(inst->op == RISHKA_DOP_BEXTI) {
+                this->emitOp(0x0F92, false, 0, RISHKA_X64_RAX);
+                this->emitOp(0x0FB6, false, RISHKA_X64_RAX, RISHKA_X64_RAX);
+            }
+            this->emitDestination(inst->rd, RISHKA_X64_RAX);
+            break;
+
+        case RISHKA_DOP_LUI:
+            this->emitMoveImm(RISHKA_X64_RAX, inst->imm);
+            this->emitDestination(inst->rd, RISHKA_X64_RAX);
+            break;
+
+        case RISHKA_DOP_AUIPC:
+            this->emitMoveImm(RISHKA_X64_RAX, pc + inst->imm);
+            this->emitDestination(inst->rd, RISHKA_X64_RAX);
+            break;
+
+        case RISHKA_DOP_LB:
+        case RISHKA_DOP_LBU:
+        case RISHKA_DOP_LHW:
+        case RISHKA_DOP_LHU:
+        case RISHKA_DOP_LW:
+        case RISHKA_DOP_LRES:
+        case RISHKA_DOP_LDW:
+            a = this->emitSource(inst->rs1, RISHKA_X64_RAX);
+
+            this->emitMove(RISHKA_X64_RAX, a);
+            this->emitAluImm(0, RISHKA_X64_RAX, inst->imm);
+            this->emitOp(0x03, true, RISHKA_X64_RAX, RISHKA_JIT_MEMORY);
+
+            // Loads zero-extend, matching the interpreter.
+            if(inst->op == RISHKA_DOP_LB || inst->op == RISHKA_DOP_LBU)
+                this->emitOpMem(0x0FB6, false, RISHKA_X64_RAX, RISHKA_X64_RAX, 0);
+            else if(inst->op == RISHKA_DOP_LHW || inst->op == RISHKA_DOP_LHU)
+                this->emitOpMem(0x0FB7, false, RISHKA_X64_RAX, RISHKA_X64_RAX, 0);
+            else this->emitOpMem(0x8B, inst->op == RISHKA_DOP_LDW, RISHKA_X64_RAX, RISHKA_X64_RAX, 0);
+
+            this->emitDestination(inst->rd, RISHKA_X64_RAX);
+            break;
+
+        case RISHKA_DOP_SB:
+        case RISHKA_DOP_SHW:
+        case RISHKA_DOP_SW:
+        case RISHKA_DOP_SDW: {
+            uint8_t size = inst->op == RISHKA_DOP_SB ? 1 : inst->op == RISHKA_DOP_SHW ? 2 :
+                inst->op == RISHKA_DOP_SW ? 4 : 8;
+
+            b = this->emitSource(inst->rs2, RISHKA_X64_RCX);
+            this->emitMove(RISHKA_X64_RCX, b);
+
+            a = this->emitSource(inst->rs1, RISHKA_X64_RAX);
+            this->emitMove(RISHKA_X64_RAX, a);
+            this->emitAluImm(0, RISHKA_X64_RAX, inst->imm);
+
+            this->emitMove(RISHKA_X64_RDX, RISHKA_X64_RAX);
+            this->emitOp(0x03, true, RISHKA_X64_RDX, RISHKA_JIT_MEMORY);
+            if(size == 2)
+                this->emitByte(0x66);
+            this->emitOpMem(size == 1 ? 0x88 : 0x89, size == 8, RISHKA_X64_RCX, RISHKA_X64_RDX, 0);
+
+            // Flag the pages of the first and last bytes as written, see
+            // rishka_mark_dirty(): the flag of page n lies at memory + ~n.
+            for(uint8_t last = 0; last < (size == 1 ? 1 : 2); last++) {
+                this->emitMove(RISHKA_X64_RDX, RISHKA_X64_RAX);
+                if(last != 0)
+                    this->emitAluImm(0, RISHKA_X64_RDX, size - 1);
+
+                this->emitOp(0xC1, true, 5, RISHKA_X64_RDX);
+                this->emitByte((uint8_t) __builtin_ctz(RISHKA_VM_PAGE_SIZE));
+                this->emitOp(0xF7, true, 2, RISHKA_X64_RDX);
+                this->emitOp(0x03, true, RISHKA_X64_RDX, RISHKA_JIT_MEMORY);
+                this->emitOpMem(0xC6, false, 0, RISHKA_X64_RDX, 0);
+                this->emitByte(1);
+            }
+
+            // Skip the hook unless a written halfword, or the one before it
+            // (which may start a 32-bit instruction), lies in decoded text.
+            // The entries read around the ends of the decode cache still
+            // lie inside the virtual machine, and the hook checks again.
+            this->emitAluImm(7, RISHKA_X64_RAX, (int32_t)(RISHKA_VM_DECODE_CACHE_SIZE << 1));
+            uint8_t* outside = this->emitJump(RISHKA_X64_CC_AE);
+
+            this->emitMoveImm(RISHKA_X64_RSI, (int64_t)(uintptr_t) decodeCache);
+            this->emitMove(RISHKA_X64_RDX, RISHKA_X64_RAX);
+            this->emitOp(0xC1, true, 5, RISHKA_X64_RDX);
+            this->emitByte(1);
+            this->emitOp(0xC1, true, 4, RISHKA_X64_RDX);
+            this->emitByte(3);
+            this->emitOp(0x03, true, RISHKA_X64_RDX, RISHKA_X64_RSI);
+            this->emitOpMem(0x0FB6, false, RISHKA_X64_RDI, RISHKA_X64_RDX, -8);
+
+            for(int32_t entry = 0; entry <= size / 2; entry++) {
+                this->emitOpMem(0x0FB6, false, RISHKA_X64_RSI, RISHKA_X64_RDX, entry * 8);
+                this->emitOp(0x0B, false, RISHKA_X64_RDI, RISHKA_X64_RSI);
+            }
+            uint8_t* undecoded = this->emitJump(RISHKA_X64_CC_E);
+
+            // Six pushes keep the stack 16-byte aligned for the call.
+            this->emitPush(RISHKA_X64_R8);
+            this->emitPush(RISHKA_X64_R9);
+            this->emitPush(RISHKA_X64_R10);
+            this->emitPush(RISHKA_X64_R11);
+            this->emitPush(RISHKA_X64_RAX);
+            this->emitPush(RISHKA_X64_RCX);
+
+            this->emitMove(RISHKA_X64_RSI, RISHKA_X64_RAX);
+            this->emitMoveImm(RISHKA_X64_RDI, (int64_t)(uintptr_t) vm);
+            this->emitMoveImm(RISHKA_X64_RDX, size);
+            this->emitMoveImm(RISHKA_X64_RAX, (int64_t)(uintptr_t) hook);
+            this->emitOp(0xFF, false, 2, RISHKA_X64_RAX);
+            this->emitOp(0x0FB6, false, RISHKA_X64_RDI, RISHKA_X64_RAX);
+
+            this->emitPop(RISHKA_X64_RCX);
+            this->emitPop(RISHKA_X64_RAX);
+            this->emitPop(RISHKA_X64_R11);
+            this->emitPop(RISHKA_X64_R10);
+            this->emitPop(RISHKA_X64_R9);
+            this->emitPop(RISHKA_X64_R8);
+
+            this->emitOp(0x85, false, RISHKA_X64_RDI, RISHKA_X64_RDI);
+            uint8_t* kept = this->emitJump(RISHKA_X64_CC_E);
+            this->emitExit(pc + (inst->length << 1), RISHKA_NATIVE_RESUME);
+
+            this->patchJump(outside);
+            this->patchJump(undecoded);
+            this->patchJump(kept);
+            break;
+        }
+
+        case RISHKA_DOP_JAL:
+            if(inst->rd != 0) {
+                this->emitMoveImm(RISHKA_X64_RAX, pc + (inst->length << 1));
+                this->emitDestination(inst->rd, RISHKA_X64_RAX);
+            }
+
+            this->emitExit(pc + inst->imm, RISHKA_NATIVE_TAKEN);
+            break;
+
+        case RISHKA_DOP_JALR:
+            a = this->emitSource(inst->rs1, RISHKA_X64_RAX);
+
+            this->emitMove(RISHKA_X64_RAX, a);
+            this->emitAluImm(0, RISHKA_X64_RAX, inst->imm);
+            this->emitAluImm(4, RISHKA_X64_RAX, -2);
+
+            if(inst->rd != 0) {
+                this->emitMoveImm(RISHKA_X64_RCX, pc + (inst->length << 1));
+                this->emitDestination(inst->rd, RISHKA_X64_RCX);
+            }
+
+            this->emitExit(-1, RISHKA_NATIVE_TAKEN);
+            break;
+
+        case RISHKA_DOP_BEQ:
+        case RISHKA_DOP_BNE:
+        case RISHKA_DOP_BLT:
+        case RISHKA_DOP_BGE:
+        case RISHKA_DOP_BLTU:
+        case RISHKA_DOP_BGEU: {
+            static const uint8_t conditions[] = {
+                RISHKA_X64_CC_E, RISHKA_X64_CC_NE, RISHKA_X64_CC_L,
+                RISHKA_X64_CC_GE, RISHKA_X64_CC_B, RISHKA_X64_CC_AE
+            };
+
+            a = this->emitSource(inst->rs1, RISHKA_X64_RAX);
+            b = this->emitSource(inst->rs2, RISHKA_X64_RCX);
+
+            this->emitOp(0x3B, true, a, b);
+            uint8_t* taken = this->emitJump(conditions[inst->op - RISHKA_DOP_BEQ]);
+
+            this->emitExit(pc + (inst->length << 1), RISHKA_NATIVE_FALLTHROUGH);
+            this->patchJump(taken);
+            this->emitExit(pc + inst->imm, RISHKA_NATIVE_TAKEN);
+            break;
+        }
+    }
+}
+
+void RishkaJIT::emitExit(int64_t pc, uint8_t kind) {
+    for(uint8_t guest = 1; guest < 32; guest++)
+        if(this->hostRegister[guest] != -1 && (this->dirtyRegisters & (1U << guest)))
+            this->emitOpMem(0x89, true, this->hostRegister[guest], RISHKA_JIT_REGISTERS, guest * 8);
+
+    if(pc != -1)
+        this->emitMoveImm(RISHKA_X64_RAX, pc);
+    this->emitMoveImm(RISHKA_X64_RDX, kind);
+
+    this->emitAluImm(0, RISHKA_X64_RSP, 8);
+    this->emitPop(RISHKA_X64_R15);
+    this->emitPop(RISHKA_X64_R14);
+    this->emitPop(RISHKA_X64_R13);
+    this->emitPop(RISHKA_X64_R12);
+    this->emitPop(RISHKA_X64_RBP);
+    this->emitPop(RISHKA_X64_RBX);
+    this->emitByte(0xC3);
+}
+
+uint8_t RishkaJIT::emitSource(uint8_t guest, uint8_t scratch) {
+    if(guest == 0) {
+        this->emitOp(0x33, false, scratch, scratch);
+        return scratch;
+    }
+
+    if(this->hostRegister[guest] != -1)
+        return (uint8_t) this->hostRegister[guest];
+
+    this->emitOpMem(0x8B, true, scratch, RISHKA_JIT_REGISTERS, guest * 8);
+    return scratch;
+}
+
+void RishkaJIT::emitDestination(uint8_t guest, uint8_t source) {
+    if(guest == 0)
+        return;
+
+    if(this->hostRegister[guest] != -1)
+        this->emitMove((uint8_t) this->hostRegister[guest], source);
+    else this->emitOpMem(0x89, true, source, RISHKA_JIT_REGISTERS, guest * 8);
+}
+
+inline void RishkaJIT::emitByte(uint8_t value) {
+    *this->out++ = value;
+}
+
+inline void RishkaJIT::emitDword(uint32_t value) {
+    memcpy(this->out, &value, 4);
+    this->out += 4;
+}
+
+inline void RishkaJIT::emitQword(uint64_t value) {
+    memcpy(this->out, &value, 8);
+    this->out += 8;
+}
+
+void RishkaJIT::emitRex(bool wide, uint8_t reg, uint8_t rm) {
+    if(wide || reg > 7 || rm > 7)
+        this->emitByte(0x40 | (wide ? 8 : 0) | ((reg >> 3) << 2) | (rm >> 3));
+}
+
+void RishkaJIT::emitOp(uint16_t opcode, bool wide, uint8_t reg, uint8_t rm) {
+    this->emitRex(wide, reg, rm);
+    if(opcode > 0xFF)
+        this->emitByte(opcode >> 8);
+
+    this->emitByte(opcode & 0xFF);
+    this->emitByte(0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+void RishkaJIT::emitOpMem(uint16_t opcode, bool wide, uint8_t reg, uint8_t base, int32_t disp) {
+    this->emitRex(wide, reg, base);
+    if(opcode > 0xFF)
+        this->emitByte(opcode >> 8);
+
+    // Bases are never RSP or R12, so no SIB byte is needed.
+    this->emitByte(opcode & 0xFF);
+    this->emitByte(0x80 | ((reg & 7) << 3) | (base & 7));
+    this->emitDword((uint32_t) disp);
+}
+
+void RishkaJIT::emitMove(uint8_t dst, uint8_t src) {
+    if(dst != src)
+        this->emitOp(0x8B, true, dst, src);
+}
+
+void RishkaJIT::emitMoveImm(uint8_t dst, int64_t value) {
+    if(value == (int64_t)(int32_t) value) {
+        this->emitOp(0xC7, true, 0, dst);
+        this->emitDword((uint32_t) value);
+        return;
+    }
+
+    this->emitRex(true, 0, dst);
+    this->emitByte(0xB8 | (dst & 7));
+    this->emitQword((uint64_t) value);
+}
+
+void RishkaJIT::emitAluImm(uint8_t ext, uint8_t dst, int32_t value) {
+    this->emitOp(0x81, true, ext, dst);
+    this->emitDword((uint32_t) value);
+}
+
+void RishkaJIT::emitPush(uint8_t reg) {
+    if(reg > 7)
+        this->emitByte(0x41);
+    this->emitByte(0x50 | (reg & 7));
+}
+
+void RishkaJIT::emitPop(uint8_t reg) {
+    if(reg > 7)
+        this->emitByte(0x41);
+    this->emitByte(0x58 | (reg & 7));
+}
+
+uint8_t* RishkaJIT::emitJump(uint8_t condition) {
+    this->emitByte(0x0F);
+    this->emitByte(0x80 | condition);
+
+    uint8_t* rel = this->out;
+    this->emitDword(0);
+
+    return rel;
+}
+
+void RishkaJIT::patchJump(uint8_t* rel) {
+    int32_t offset = (int32_t)(this->out - (rel + 4));
+    memcpy(rel, &offset, 4);
+}
+
+#endif
@@ -0,0 +1,222 @@
+/* 
+ * This file is part of the Rishka distribution (https://github.com/rishka-esp32/rishka).
+ * Copyright (c) 2024 Nathanne Isip.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file rishka_jit.h
+ * @author [Nathanne Isip](https://github.com/nthnn)
+ * @brief Definition of the RishkaJIT class, the native block translator of host builds.
+ *
+ * On x86-64 Linux hosts (used for CI, regression runs and load simulation),
+ * hot basic blocks are translated from their decode cache entries into
+ * native x86-64 code. The translator is compiled out of ESP32 builds, where
+ * RISHKA_VM_JIT is always 0.
+ */
+
+#ifndef RISHKA_JIT_H
+#define RISHKA_JIT_H
+
+#include <rishka_types.h>
+
+#if RISHKA_VM_JIT
+
+#if !defined(__x86_64__) || !defined(__linux__)
+#error "RISHKA_VM_JIT is only supported on x86-64 Linux hosts."
+#endif
+
+#if RISHKA_VM_XLEN != 64
+#error "RISHKA_VM_JIT only translates RV64IM code (RISHKA_VM_XLEN 64)."
+#endif
+
+#if RISHKA_VM_PAGED_MEMORY
+#error "RISHKA_VM_JIT addresses guest memory directly and needs RISHKA_VM_PAGED_MEMORY 0."
+#endif
+
+#include <stddef.h>
+
+/**
+ * @brief Callback invoked by native code after a store into decoded text.
+ *
+ * @return true if the store invalidated translated blocks, in which case
+ *         the native block returns to the interpreter right away.
+ */
+typedef bool (*rishka_native_store_hook)(void* vm, uint64_t address, uint8_t size);
+
+/**
+ * @brief RishkaJIT class translating basic blocks into native x86-64 code.
+ *
+ * Native blocks keep the most used guest registers of the block in host
+ * registers, load them on entry and write the modified ones back on every
+ * exit. Only the integer, load/store and control transfer instructions of
+ * RV64I, MUL and the bit-manipulation instructions with a baseline x86-64
+ * equivalent are translated; a block stops at the first instruction that
+ * is not, and the interpreter carries on from there. System instructions
+ * therefore always go through RishkaVM::handleSyscall.
+ */
+class RishkaJIT final {
+private:
+    uint8_t* code;          ///< Executable code buffer, mapped on first use
+    size_t used;            ///< Number of bytes of the code buffer in use
+    uint8_t* out;           ///< Emission cursor while translating a block
+    bool full;              ///< Flag set when a translation did not fit the buffer
+
+    int8_t hostRegister[32];    ///< Host register caching each guest register, or -1
+    uint32_t dirtyRegisters;    ///< Bitmask of cached guest registers written by the block
+
+    /**
+     * @brief Checks whether an instruction can be translated to native code.
+     *
+     * @param inst The decoded instruction.
+     * @return true if the instruction is supported by the translator.
+     */
+    static bool isSupported(const rishka_decoded_inst* inst);
+
+    /**
+     * @brief Assigns host registers to the most used guest registers of a block.
+     *
+     * @param insts The decoded instructions of the block.
+     * @param count The number of instructions to be translated.
+     */
+    void allocateRegisters(const rishka_decoded_inst* insts, uint32_t count);
+
+    /**
+     * @brief Emits the native code of a single instruction.
+     *
+     * @param inst The decoded instruction.
+     * @param pc The guest address of the instruction.
+     * @param decodeCache Base address of the decode cache of the virtual machine.
+     * @param vm The virtual machine passed to `hook`.
+     * @param hook Callback invoked after stores into decoded text.
+     */
+    void emitInstruction(
+        const rishka_decoded_inst* inst,
+        int64_t pc,
+        const rishka_decoded_inst* decodeCache,
+        void* vm,
+        rishka_native_store_hook hook
+    );
+
+    /**
+     * @brief Emits a block exit writing back the cached guest registers.
+     *
+     * @param pc The guest address to continue at, or -1 if it is already in RAX.
+     * @param kind The rishka_native_exit_kind of the exit.
+     */
+    void emitExit(int64_t pc, uint8_t kind);
+
+    /**
+     * @brief Returns the host register holding a guest register value.
+     *
+     * Guest registers without a host register are loaded into `scratch`,
+     * and x0 is materialized as zero.
+     *
+     * @param guest The guest register index.
+     * @param scratch The host register to use if the value is not cached.
+     * @return The host register holding the value.
+     */
+    uint8_t emitSource(uint8_t guest, uint8_t scratch);
+
+    /**
+     * @brief Writes a host register to a guest register.
+     *
+     * @param guest The guest register index.
+     * @param source The host register holding the value.
+     */
+    void emitDestination(uint8_t guest, uint8_t source);
+
+    /** @brief Emits a single byte of native code. */
+    void emitByte(uint8_t value);
+
+    /** @brief Emits a little-endian 32-bit value. */
+    void emitDword(uint32_t value);
+
+    /** @brief Emits a little-endian 64-bit value. */
+    void emitQword(uint64_t value);
+
+    /** @brief Emits a REX prefix if the operand size or registers need one. */
+    void emitRex(bool wide, uint8_t reg, uint8_t rm);
+
+    /** @brief Emits an instruction with a register-direct ModRM operand. */
+    void emitOp(uint16_t opcode, bool wide, uint8_t reg, uint8_t rm);
+
+    /** @brief Emits an instruction with a [base + disp32] ModRM operand. */
+    void emitOpMem(uint16_t opcode, bool wide, uint8_t reg, uint8_t base, int32_t disp);
+
+    /** @brief Emits a 64-bit register move, omitted if both registers match. */
+    void emitMove(uint8_t dst, uint8_t src);
+
+    /** @brief Emits the shortest 64-bit immediate move for `value`. */
+    void emitMoveImm(uint8_t dst, int64_t value);
+
+    /** @brief Emits a 64-bit ALU operation (group 1 extension `ext`) with a 32-bit immediate. */
+    void emitAluImm(uint8_t ext, uint8_t dst, int32_t value);
+
+    /** @brief Emits a push of a 64-bit register. */
+    void emitPush(uint8_t reg);
+
+    /** @brief Emits a pop of a 64-bit register. */
+    void emitPop(uint8_t reg);
+
+    /** @brief Emits a conditional jump and returns its displacement for patchJump(). */
+    uint8_t* emitJump(uint8_t condition);
+
+    /** @brief Points a jump emitted by emitJump() at the current position. */
+    void patchJump(uint8_t* rel);
+
+public:
+    /**
+     * @brief Creates a translator without a code buffer.
+     */
+    RishkaJIT();
+
+    /**
+     * @brief Releases the code buffer of the translator.
+     */
+    ~RishkaJIT();
+
+    /**
+     * @brief Translates the basic block starting at a guest address.
+     *
+     * @param decodeCache Base address of the decode cache of the virtual machine.
+     * @param pc The guest address of the first instruction of the block.
+     * @param vm The virtual machine passed to `hook`.
+     * @param hook Callback invoked after stores into decoded text.
+     * @return The native block, or NULL if its first instruction is not
+     *         supported or the code buffer is full (see isFull()).
+     */
+    rishka_native_block compile(
+        const rishka_decoded_inst* decodeCache,
+        int64_t pc,
+        void* vm,
+        rishka_native_store_hook hook
+    );
+
+    /**
+     * @brief Checks whether the last translation failed for lack of space.
+     *
+     * @return true if the code buffer must be reset before translating again.
+     */
+    bool isFull() const;
+
+    /**
+     * @brief Drops all native code; previously returned blocks become invalid.
+     */
+    void reset();
+};
+
+#endif
+
+#endif /* RISHKA_JIT_H */
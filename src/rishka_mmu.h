@@ -0,0 +1,125 @@
+/* 
+ * This file is part of the Rishka distribution (https://github.com/rishka-esp32/rishka).
+ * Copyright (c) 2024 Nathanne Isip.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file rishka_mmu.h
+ * @author [Nathanne Isip](https://github.com/nthnn)
+ * @brief Address translation of the paged guest memory.
+ *
+ * With RISHKA_VM_PAGED_MEMORY, guest memory is split into pages of
+ * RISHKA_VM_PAGE_SIZE bytes that are only allocated once the program
+ * touches them, so a virtual machine costs what its program uses rather
+ * than its whole memory size up front. Each hart looks the pages up
+ * through a small direct-mapped software TLB, whose hits cost a single
+ * compare; misses, misaligned accesses and accesses spanning two pages
+ * take the slower path of RishkaVM. Without it, guest memory is one
+ * flat allocation and these helpers index it directly.
+ *
+ * Either way, the pages written since the virtual machine was last reset
+ * are tracked, so that a reset only clears those. Paged memory maps a
+ * page writable in the TLB once it was first written, while flat memory
+ * flags the page on every store.
+ */
+
+#ifndef RISHKA_MMU_H
+#define RISHKA_MMU_H
+
+#include <rishka_types.h>
+#include <stddef.h>
+
+#if RISHKA_VM_PAGED_MEMORY
+/**
+ * @brief Translates a guest address through a software TLB.
+ *
+ * @tparam T The type of the access, at most 8 bytes wide.
+ * @tparam write true for a store, which misses on pages shared with a
+ *               forked virtual machine or not written since the last reset.
+ * @param tlb The software TLB of the hart.
+ * @param address The guest address of the access.
+ * @return The host address of the access, or NULL if its page is not in
+ *         the TLB or the access is not aligned to its size. Hits count
+ *         towards the memory tier of the page with RISHKA_VM_MEMORY_STATS.
+ */
+template<typename T, bool write = false>
+inline T* rishka_tlb_lookup(const rishka_tlb_entry* tlb, uint64_t address) {
+    const rishka_tlb_entry* entry = &tlb[(address / RISHKA_VM_PAGE_SIZE) & (RISHKA_VM_TLB_SIZE - 1)];
+
+    if(__builtin_expect((write ? entry->writeTag : entry->tag) !=
+        (address & (~(uint64_t)(RISHKA_VM_PAGE_SIZE - 1) | (sizeof(T) - 1))), 0))
+        return NULL;
+
+#if RISHKA_VM_MEMORY_STATS
+    (*entry->accesses)++;
+#endif
+    return (T*)(entry->page + (address & (RISHKA_VM_PAGE_SIZE - 1)));
+}
+
+/**
+ * @brief Guest memory as seen by code outside of RishkaVM: its page table.
+ */
+typedef uint8_t* const* rishka_guest_memory;
+
+/**
+ * @brief Returns the host address of a guest byte.
+ *
+ * The returned bytes are contiguous up to the end of the page.
+ *
+ * @param memory The guest memory.
+ * @param address The guest address, inside guest memory.
+ * @return The host address, or NULL if the page was never touched.
+ */
+inline const uint8_t* rishka_guest_bytes(rishka_guest_memory memory, uint64_t address) {
+    const uint8_t* page = memory[address / RISHKA_VM_PAGE_SIZE];
+    return page != NULL ? &page[address & (RISHKA_VM_PAGE_SIZE - 1)] : NULL;
+}
+#else
+/**
+ * @brief Guest memory as seen by code outside of RishkaVM: its flat allocation.
+ */
+typedef const uint8_t* rishka_guest_memory;
+
+/**
+ * @brief Returns the host address of a guest byte.
+ *
+ * @param memory The guest memory.
+ * @param address The guest address, inside guest memory.
+ * @return The host address.
+ */
+inline const uint8_t* rishka_guest_bytes(rishka_guest_memory memory, uint64_t address) {
+    return &memory[address];
+}
+
+/**
+ * @brief Flags the pages of a guest store as written since the last reset.
+ *
+ * Flat guest memory is preceded by one flag per page, the flag of page
+ * `n` lying `n + 1` bytes before the first guest byte, so that stores of
+ * interpreted, native and ahead-of-time translated code all reach it from
+ * the guest memory alone. A misaligned store may cross into the next
+ * page, so the pages of its first and last bytes are both flagged.
+ *
+ * @param memory The guest memory.
+ * @param address The guest address written.
+ * @param size The size of the store in bytes, at most RISHKA_VM_PAGE_SIZE.
+ */
+inline void rishka_mark_dirty(uint8_t* memory, uint64_t address, uint32_t size) {
+    memory[-1 - (int64_t)(address / RISHKA_VM_PAGE_SIZE)] = 1;
+    memory[-1 - (int64_t)((address + size - 1) / RISHKA_VM_PAGE_SIZE)] = 1;
+}
+#endif
+
+#endif /* RISHKA_MMU_H */
@@ -27,6 +27,7 @@
 #include <rishka_types.h>
 #include <rishka_util.h>
 #include <rishka_vm.h>
+#include <rishka_vm_pool.h>
 
 extern "C" {
     uint8_t temprature_sens_read();
@@ -93,9 +94,16 @@ void RishkaSyscall::IO::printu(RishkaVM* vm) {
 }
 
 void RishkaSyscall::IO::printd(RishkaVM* vm) {
+#if RISHKA_VM_XLEN == 32
+    // RV32IM guests pass the low and high words of the double in a0 and a1.
+    auto arg = rishka_long_to_double(
+        (int64_t) (vm->getParam<uint32_t>(0) | ((uint64_t) vm->getParam<uint32_t>(1) << 32))
+    );
+#else
     auto arg = rishka_long_to_double(
         vm->getParam<int64_t>(0)
     );
+#endif
 
     vm->getTerminal()->print(arg);
     vm->appendToOutputStream(arg);
@@ -131,8 +139,8 @@ int RishkaSyscall::IO::peek(RishkaVM* vm) {
 }
 
 bool RishkaSyscall::IO::find(RishkaVM* vm) {
-    auto target = vm->getPointerParam<char*>(0);
     auto length = vm->getParam<size_t>(1);
+    auto target = vm->getPointerParam<char*>(0, length);
 
     return vm->getTerminal()->find(target, length);
 }
@@ -155,7 +163,7 @@ uint64_t RishkaSyscall::IO::getTimeout(RishkaVM* vm) {
 
 void RishkaSyscall::Sys::delayImpl(RishkaVM* vm) {
     auto ms = vm->getParam<uint64_t>(0);
-    delay(ms);
+    vm->suspend(ms);
 }
 
 unsigned long RishkaSyscall::Sys::microsImpl() {
@@ -166,37 +174,83 @@ unsigned long RishkaSyscall::Sys::millisImpl() {
     return millis();
 }
 
-int64_t RishkaSyscall::Sys::shellExec(RishkaVM* parent_vm) {
-    auto cmdline = parent_vm->getPointerParam<char*>(0);
-
-    char* tokens[10];
-    int count = 0;
-
-    for(int i = 0; i < 10; i++)
-        tokens[i] = (char*) malloc(50 * sizeof(char));
-    rishka_split_cmd(String(cmdline), tokens, 10, count);
+// Creates the temporary virtual machine of a command, in the memory
+// layout of the pool of the calling program if it has one.
+static RishkaVM* rishka_shell_create(RishkaVM* parent_vm, RishkaVMPool* pool) {
+    if(pool != NULL)
+        return pool->create(
+            parent_vm->getTerminal(),
+            parent_vm->getDisplay(),
+            parent_vm->getNvsStorage(),
+            parent_vm->getWorkingDirectory()
+        );
 
-    RishkaVM* child_vm = new RishkaVM();
-    child_vm->initialize(
+    RishkaVM* vm = new RishkaVM();
+    vm->initialize(
         parent_vm->getTerminal(),
         parent_vm->getDisplay(),
         parent_vm->getNvsStorage(),
         parent_vm->getWorkingDirectory()
     );
 
-    if(!child_vm->loadFile(tokens[0])) {
-        child_vm->reset();
-        delete child_vm;
+    if(vm->getMemoryLayout().memorySize == 0) {
+        delete vm;
+        return NULL;
+    }
 
+    return vm;
+}
+
+static int64_t rishka_shell_run(RishkaVM* parent_vm, RishkaVM* child_vm, char** tokens, int count) {
+    if(count == 0 || !child_vm->loadFile(tokens[0]))
         return -1;
-    }
 
     child_vm->run(count, tokens);
     parent_vm->setWorkingDirectory(child_vm->getWorkingDirectory());
-    child_vm->reset();
 
-    int64_t exitCode = child_vm->getExitCode();
+    return child_vm->getExitCode();
+}
+
+int64_t RishkaSyscall::Sys::shellExec(RishkaVM* parent_vm) {
+    auto cmdline = parent_vm->getPointerParam<char*>(0);
+
+    RishkaVMPool* pool = parent_vm->getPool();
+    RishkaVM* child_vm = pool == NULL ? NULL : pool->lease(
+        parent_vm->getTerminal(),
+        parent_vm->getDisplay(),
+        parent_vm->getNvsStorage(),
+        parent_vm->getWorkingDirectory()
+    );
+
+    int count = 0;
+    if(child_vm != NULL) {
+        char** tokens = pool->splitArguments(child_vm, String(cmdline), count);
+        int64_t exitCode = rishka_shell_run(parent_vm, child_vm, tokens, count);
+
+        pool->release(child_vm);
+        return exitCode;
+    }
+
+    // Commands of programs not leased from a pool, or nested deeper than
+    // the pool has instances, run in a temporary virtual machine, with
+    // buffers of their own.
+    child_vm = rishka_shell_create(parent_vm, pool);
+
+    char* arguments = (char*) malloc(RISHKA_VM_ARG_COUNT * RISHKA_VM_ARG_LENGTH);
+    char* tokens[RISHKA_VM_ARG_COUNT];
+    int64_t exitCode = -1;
+
+    if(child_vm != NULL && arguments != NULL) {
+        for(uint8_t i = 0; i < RISHKA_VM_ARG_COUNT; i++)
+            tokens[i] = &arguments[i * RISHKA_VM_ARG_LENGTH];
+
+        rishka_split_cmd(String(cmdline), tokens, RISHKA_VM_ARG_COUNT, RISHKA_VM_ARG_LENGTH, count);
+        exitCode = rishka_shell_run(parent_vm, child_vm, tokens, count);
+        child_vm->reset();
+    }
+
     delete child_vm;
+    free(arguments);
 
     return exitCode;
 }
@@ -337,6 +391,22 @@ uint32_t RishkaSyscall::Sys::workingDirectory(RishkaVM* vm) {
     return strlen(data);
 }
 
+int64_t RishkaSyscall::Sys::spawn(RishkaVM* vm) {
+    auto entry = vm->getParam<uint64_t>(0);
+    auto stack = vm->getParam<uint64_t>(1);
+    auto arg = vm->getParam<uint64_t>(2);
+
+    return vm->spawnHart((int64_t) entry, (rishka_uxlen_t) stack, (rishka_uxlen_t) arg);
+}
+
+int64_t RishkaSyscall::Sys::fork(RishkaVM* vm) {
+    auto entry = vm->getParam<uint64_t>(0);
+    auto routine = vm->getParam<uint64_t>(1);
+    auto arg = vm->getParam<uint64_t>(2);
+
+    return vm->runFork((int64_t) entry, (rishka_uxlen_t) routine, (rishka_uxlen_t) arg);
+}
+
 void RishkaSyscall::Gpio::pinModeImpl(RishkaVM* vm) {
     auto pin = vm->getParam<uint8_t>(0);
     auto mode = vm->getParam<uint8_t>(1);
@@ -629,15 +699,15 @@ uint8_t RishkaSyscall::I2C::end_transmission(RishkaVM* vm) {
 }
 
 size_t RishkaSyscall::I2C::write(RishkaVM* vm) {
-    auto data = vm->getPointerParam<uint8_t*>(0);
     auto size = vm->getParam<size_t>(1);
+    auto data = vm->getPointerParam<uint8_t*>(0, size);
 
     return Wire.write(data, size);
 }
 
 size_t RishkaSyscall::I2C::slave_write(RishkaVM* vm) {
-    auto data = vm->getPointerParam<uint8_t*>(0);
     auto size = vm->getParam<size_t>(1);
+    auto data = vm->getPointerParam<uint8_t*>(0, size);
 
     return Wire.slaveWrite(data, size);
 }
@@ -1046,7 +1116,7 @@ bool RishkaSyscall::WiFiDev::connect(RishkaVM* vm) {
     auto ssid = vm->getPointerParam<char*>(0);
     auto passkey = vm->getPointerParam<char*>(1);
     auto channel = vm->getParam<int32_t>(2);
-    auto bssid = vm->getPointerParam<uint8_t*>(3);
+    auto bssid = vm->getPointerParam<uint8_t*>(3, 6);
     auto connect = vm->getParam<bool>(4);
 
     return WiFi.begin(
@@ -1184,8 +1254,8 @@ char RishkaSyscall::Runtime::strpass() {
     return strpass_data.charAt(strpass_idx++);
 }
 
-void RishkaSyscall::Runtime::yield() {
-    yield();
+void RishkaSyscall::Runtime::yield(RishkaVM* vm) {
+    vm->suspend(0);
 }
 
 uint32_t RishkaSyscall::Runtime::getForkString(RishkaVM* vm) {
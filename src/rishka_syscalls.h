@@ -227,7 +227,11 @@ enum rishka_syscall {
     // Runtime System Calls
     RISHKA_SC_RT_STRPASS, ///< Pass string from runtime to syscalls
     RISHKA_SC_RT_YIELD, ///< Yield execution to other tasks
-    RISHKA_SC_RT_FORK_STREAM ///< Passes the program fork output stream
+    RISHKA_SC_RT_FORK_STREAM, ///< Passes the program fork output stream
+
+    // Hart System Calls
+    RISHKA_SC_SYS_SPAWN, ///< Start a hart sharing the memory of the program
+    RISHKA_SC_SYS_FORK ///< Run a routine in a copy-on-write copy of the program
 };
 
 /**
@@ -288,6 +292,8 @@ public:
         static long randomImpl();
         static bool changeDir(RishkaVM* vm);
         static uint32_t workingDirectory(RishkaVM* vm);
+        static int64_t spawn(RishkaVM* vm);
+        static int64_t fork(RishkaVM* vm);
     };
 
     /**
@@ -585,7 +591,7 @@ public:
     class Runtime final {
     public:
         static char strpass();
-        static void yield();
+        static void yield(RishkaVM* vm);
         static uint32_t getForkString(RishkaVM* vm);
     };
 };
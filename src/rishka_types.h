@@ -31,7 +31,167 @@
 
 #include <stdint.h>
 
-#define  RISHKA_VM_STACK_SIZE 1048576U  ///< Define the stack size for the Rishka virtual machine.
+#ifndef RISHKA_VM_STACK_SIZE
+#define  RISHKA_VM_STACK_SIZE 1048576U      ///< Default size in bytes of the guest memory of a virtual machine.
+#endif
+
+#ifndef RISHKA_VM_CODE_ADDRESS
+#define  RISHKA_VM_CODE_ADDRESS 4096U       ///< Default address programs are loaded at.
+#endif
+
+#ifndef RISHKA_VM_STACK_RESERVE
+#define  RISHKA_VM_STACK_RESERVE 65536U     ///< Default number of bytes at the top of guest memory reserved for the stack.
+#endif
+
+#ifndef RISHKA_VM_XLEN
+#define  RISHKA_VM_XLEN 64                  ///< Guest register width in bits: 64 runs RV64IM binaries, 32 runs RV32IM binaries.
+#endif
+
+#if RISHKA_VM_XLEN != 32 && RISHKA_VM_XLEN != 64
+#error "RISHKA_VM_XLEN must be either 32 or 64."
+#endif
+
+#ifndef RISHKA_VM_VLEN
+#define  RISHKA_VM_VLEN 128U                ///< Width of each vector register in bits (Zve64x), a power of two from 64 to 1024.
+#endif
+
+#if RISHKA_VM_VLEN < 64 || RISHKA_VM_VLEN > 1024 || (RISHKA_VM_VLEN & (RISHKA_VM_VLEN - 1)) != 0
+#error "RISHKA_VM_VLEN must be a power of two from 64 to 1024."
+#endif
+
+#define  RISHKA_VM_VLENB (RISHKA_VM_VLEN / 8)   ///< Width of each vector register in bytes.
+
+#ifndef RISHKA_VM_THREADED_DISPATCH
+#define  RISHKA_VM_THREADED_DISPATCH 1      ///< Use direct-threaded (computed goto) dispatch when supported by the compiler.
+#endif
+
+#ifndef RISHKA_VM_DECODE_CACHE_SIZE
+#define  RISHKA_VM_DECODE_CACHE_SIZE 32768U ///< Number of decode cache entries, one per halfword (covers the first 64 KiB of guest memory, 256 KiB per VM).
+#endif
+
+#ifndef RISHKA_VM_BLOCK_CACHE_SIZE
+#define  RISHKA_VM_BLOCK_CACHE_SIZE 256U    ///< Number of basic-block descriptors (direct-mapped, must be a power of two).
+#endif
+
+#ifndef RISHKA_VM_HOTNESS_TABLE_SIZE
+#define  RISHKA_VM_HOTNESS_TABLE_SIZE 256U  ///< Number of hotness counters (indexed by target pc, must be a power of two).
+#endif
+
+#ifndef RISHKA_VM_RETURN_STACK_SIZE
+#define  RISHKA_VM_RETURN_STACK_SIZE 16U    ///< Number of return-address stack entries (must be a power of two).
+#endif
+
+#ifndef RISHKA_VM_JUMP_CACHE_SIZE
+#define  RISHKA_VM_JUMP_CACHE_SIZE 64U      ///< Number of indirect jump target cache entries (indexed by jump address, must be a power of two).
+#endif
+
+#ifndef RISHKA_VM_PROMOTION_THRESHOLD
+#define  RISHKA_VM_PROMOTION_THRESHOLD 16U  ///< Default number of counted entries after which code is promoted to a block.
+#endif
+
+#ifndef RISHKA_VM_PAGED_MEMORY
+#if defined(__x86_64__) && defined(__linux__) && RISHKA_VM_XLEN == 64 && (!defined(RISHKA_VM_JIT) || RISHKA_VM_JIT)
+#define  RISHKA_VM_PAGED_MEMORY 0           ///< Host builds with the JIT keep the flat memory its native code addresses directly.
+#else
+#define  RISHKA_VM_PAGED_MEMORY 1           ///< Allocate guest memory in pages on first touch instead of all at once.
+#endif
+#endif
+
+#ifndef RISHKA_VM_PAGE_SIZE
+#define  RISHKA_VM_PAGE_SIZE 4096U          ///< Size in bytes of each guest memory page (a power of two from 256 to RISHKA_VM_STACK_SIZE).
+#endif
+
+#if RISHKA_VM_PAGE_SIZE < 256 || RISHKA_VM_PAGE_SIZE > RISHKA_VM_STACK_SIZE || (RISHKA_VM_PAGE_SIZE & (RISHKA_VM_PAGE_SIZE - 1)) != 0
+#error "RISHKA_VM_PAGE_SIZE must be a power of two from 256 to RISHKA_VM_STACK_SIZE."
+#endif
+
+#ifndef RISHKA_VM_TLB_SIZE
+#define  RISHKA_VM_TLB_SIZE 16U             ///< Number of software TLB entries of each hart (direct-mapped, must be a power of two).
+#endif
+
+#ifndef RISHKA_VM_MEMORY_STATS
+#define  RISHKA_VM_MEMORY_STATS 1           ///< Count the guest memory accesses served by each memory tier (paged memory only).
+#endif
+
+#ifndef RISHKA_VM_SRAM_RESERVE
+#define  RISHKA_VM_SRAM_RESERVE 65536U      ///< Bytes of internal RAM left free for the firmware when placing guest pages in it (ESP32 builds).
+#endif
+
+#ifndef RISHKA_VM_HEATMAP
+#define  RISHKA_VM_HEATMAP 0                ///< Count the instruction fetches, loads and stores of each guest page (instrumentation builds).
+#endif
+
+#ifndef RISHKA_VM_HEATMAP_FILE
+#define  RISHKA_VM_HEATMAP_FILE "/heatmap.csv"  ///< Default SD card file the heatmap is written to when a program exits.
+#endif
+
+#ifndef RISHKA_VM_JIT
+#if defined(__x86_64__) && defined(__linux__) && RISHKA_VM_XLEN == 64 && !RISHKA_VM_PAGED_MEMORY && !RISHKA_VM_HEATMAP
+#define  RISHKA_VM_JIT 1                    ///< Translate hot blocks to native code (x86-64 Linux host builds only).
+#else
+#define  RISHKA_VM_JIT 0
+#endif
+#endif
+
+#ifndef RISHKA_VM_JIT_THRESHOLD
+#define  RISHKA_VM_JIT_THRESHOLD 32U        ///< Default number of block executions after which it is translated to native code.
+#endif
+
+#ifndef RISHKA_VM_JIT_CODE_SIZE
+#define  RISHKA_VM_JIT_CODE_SIZE 1048576U   ///< Size in bytes of the native code buffer of each virtual machine.
+#endif
+
+#ifndef RISHKA_VM_DEADLINE_INTERVAL
+#define  RISHKA_VM_DEADLINE_INTERVAL 64U    ///< Number of block exits between time limit checks of RishkaVM::runFor().
+#endif
+
+#ifndef RISHKA_VM_MAX_HARTS
+#define  RISHKA_VM_MAX_HARTS 4U             ///< Maximum number of harts sharing the memory of one virtual machine, including the first.
+#endif
+
+#ifndef RISHKA_VM_HART_TASK_STACK
+#define  RISHKA_VM_HART_TASK_STACK 8192U    ///< Size in bytes of the host task stack of each additional hart (ESP32 builds).
+#endif
+
+#ifndef RISHKA_VM_POOL_SIZE
+#define  RISHKA_VM_POOL_SIZE 2U             ///< Maximum number of virtual machines in a RishkaVMPool (see rishka_vm_pool.h).
+#endif
+
+#ifndef RISHKA_VM_ARG_COUNT
+#define  RISHKA_VM_ARG_COUNT 10U            ///< Maximum number of arguments of a command run by a shell.
+#endif
+
+#ifndef RISHKA_VM_ARG_LENGTH
+#define  RISHKA_VM_ARG_LENGTH 50U           ///< Size in bytes of the buffer of each argument, including the terminating null.
+#endif
+
+#ifndef RISHKA_VM_HLE
+#if RISHKA_VM_HEATMAP
+#define  RISHKA_VM_HLE 0                    ///< Instrumented builds interpret the known routines too, so their accesses are counted.
+#else
+#define  RISHKA_VM_HLE 1                    ///< Run the known routines listed in the symbol table of a program natively.
+#endif
+#endif
+
+#ifndef RISHKA_VM_AOT
+#define  RISHKA_VM_AOT 1                    ///< Run the ahead-of-time translations registered for a program (see rishka_aot.h).
+#endif
+
+#ifndef RISHKA_VM_CODE_CACHE
+#define  RISHKA_VM_CODE_CACHE 1             ///< Keep the decoded instructions of programs on the SD card between runs (see rishka_code_cache.h).
+#endif
+
+#ifndef RISHKA_VM_CODE_CACHE_DIR
+#define  RISHKA_VM_CODE_CACHE_DIR "/.rishka"    ///< SD card directory holding the code cache.
+#endif
+
+#ifndef RISHKA_VM_CODE_CACHE_LIMIT
+#define  RISHKA_VM_CODE_CACHE_LIMIT 1048576U    ///< Total size in bytes of the code cache, beyond which the least recently used programs are dropped.
+#endif
+
+#ifndef RISHKA_VM_CODE_CACHE_ENTRIES
+#define  RISHKA_VM_CODE_CACHE_ENTRIES 32U   ///< Maximum number of programs in the code cache.
+#endif
 
 /**
  * @brief Represents an array of 8-bit unsigned integers in Rishka.
@@ -49,18 +209,255 @@ typedef union {
 } rishka_u8_arrptr;
 
 /**
- * @brief Represents an array of 64-bit unsigned integers in Rishka.
+ * @brief Integer types of a guest register width.
+ *
+ * @tparam xlen The register width in bits, either 32 or 64.
+ */
+template<unsigned xlen>
+struct rishka_xlen_traits;
+
+/**
+ * @brief Integer types of the RV32IM register width.
+ */
+template<>
+struct rishka_xlen_traits<32> {
+    typedef int32_t signed_type;                        ///< Signed register value.
+    typedef uint32_t unsigned_type;                     ///< Unsigned register value.
+    static constexpr int32_t minimum = INT32_MIN;       ///< Most negative register value.
+};
+
+/**
+ * @brief Integer types of the RV64IM register width.
+ */
+template<>
+struct rishka_xlen_traits<64> {
+    typedef int64_t signed_type;                        ///< Signed register value.
+    typedef uint64_t unsigned_type;                     ///< Unsigned register value.
+    static constexpr int64_t minimum = INT64_MIN;       ///< Most negative register value.
+};
+
+/**
+ * @brief Signed integer of the configured guest register width.
+ */
+typedef rishka_xlen_traits<RISHKA_VM_XLEN>::signed_type rishka_xlen_t;
+
+/**
+ * @brief Unsigned integer of the configured guest register width.
+ */
+typedef rishka_xlen_traits<RISHKA_VM_XLEN>::unsigned_type rishka_uxlen_t;
+
+/**
+ * @brief Represents an array of register-width unsigned integers in Rishka.
  */
 typedef struct {
-    uint64_t v[32];
-} rishka_u64_arr;
+    rishka_uxlen_t v[32];
+} rishka_uxlen_arr;
 
 /**
- * @brief Represents a pointer to an array of 64-bit unsigned integers in Rishka.
+ * @brief Represents a pointer to an array of register-width unsigned integers in Rishka.
  */
 typedef union {
-    rishka_u64_arr a;
-    uint64_t p[32];
-} rishka_u64_arrptr;
+    rishka_uxlen_arr a;
+    rishka_uxlen_t p[32];
+} rishka_uxlen_arrptr;
+
+/**
+ * @brief Represents a pre-decoded instruction in the Rishka decode cache.
+ *
+ * The immediate is stored already sign-extended (or, for shifts, as the
+ * effective shift amount), so executing a cached entry needs no further
+ * bit manipulation of the original instruction word. Compressed (RVC)
+ * instructions are stored as the 32-bit instruction they expand to.
+ */
+typedef struct {
+    uint8_t op;             ///< Resolved instruction form (see rishka_decoded_op).
+    uint8_t rd;             ///< Destination register index.
+    uint8_t rs1;            ///< First source register index.
+    uint8_t rs2 : 5;        ///< Second source register index.
+    uint8_t length : 3;     ///< Instruction length in halfwords: 1 if compressed, 2 otherwise.
+    int32_t imm;            ///< Sign-extended immediate value.
+} rishka_decoded_inst;
+
+/**
+ * @enum rishka_memory_region
+ * @brief Enumeration of the regions of the guest address space.
+ */
+enum rishka_memory_region {
+    RISHKA_REGION_IMAGE,        /**< The program binary: its code and initialized data. */
+    RISHKA_REGION_HEAP,         /**< Everything between the program binary and the stack region. */
+    RISHKA_REGION_STACK,        /**< The stack region at the top of the memory. */
+    RISHKA_REGION_COUNT         /**< Number of regions. */
+};
+
+/**
+ * @enum rishka_memory_tier
+ * @brief Enumeration of the kinds of host memory backing guest pages.
+ */
+enum rishka_memory_tier {
+    RISHKA_MEMORY_PSRAM,        /**< External PSRAM, large but several times slower. */
+    RISHKA_MEMORY_SRAM,         /**< Internal SRAM of the chip. */
+    RISHKA_MEMORY_TIER_COUNT    /**< Number of tiers. */
+};
+
+/**
+ * @brief Guest memory accesses and allocations of each memory tier.
+ */
+typedef struct {
+    uint64_t accesses[RISHKA_MEMORY_TIER_COUNT];    ///< Loads, stores and fetches of the hart served by each tier.
+    uint64_t bytes[RISHKA_MEMORY_TIER_COUNT];       ///< Bytes of guest memory allocated in each tier.
+} rishka_memory_stats;
+
+/**
+ * @enum rishka_heat_kind
+ * @brief Enumeration of the guest memory accesses counted by the heatmap.
+ */
+enum rishka_heat_kind {
+    RISHKA_HEAT_FETCH,          /**< Instruction fetches. */
+    RISHKA_HEAT_LOAD,           /**< Loads, including load-reserved and vector loads. */
+    RISHKA_HEAT_STORE,          /**< Stores, including store-conditional, atomic and vector stores. */
+    RISHKA_HEAT_KIND_COUNT      /**< Number of kinds. */
+};
+
+/**
+ * @brief Guest memory accesses of a page or region, counted with RISHKA_VM_HEATMAP.
+ */
+typedef struct {
+    uint64_t counts[RISHKA_HEAT_KIND_COUNT];    ///< Accesses of each kind (see rishka_heat_kind).
+} rishka_page_heat;
+
+/**
+ * @brief Represents an entry of the software TLB of a hart.
+ *
+ * `tag` is the guest address of the mapped page, which has its low bits
+ * clear, so comparing it with an address masked to the page number and
+ * the alignment bits of an access checks both the page and the alignment
+ * at once. Stores compare with `writeTag` instead, which has every bit set
+ * while the page is shared with a forked virtual machine or was not
+ * written since the last reset, so that their first store copies it or
+ * flags it as written. Unused entries have every bit of both tags set.
+ */
+typedef struct {
+    uint64_t tag;                   ///< Guest address of the mapped page.
+    uint64_t writeTag;              ///< Guest address of the mapped page if it may be written in place.
+    uint8_t* page;                  ///< Host memory of the page.
+
+#if RISHKA_VM_MEMORY_STATS
+    uint64_t* accesses;             ///< Access counter of the memory tier of the page.
+#endif
+} rishka_tlb_entry;
+
+/**
+ * @brief Describes the guest address space of a virtual machine.
+ *
+ * The program binary is loaded at `codeAddress` and the stack pointer
+ * starts at the top of the memory, growing down into the `stackSize`
+ * bytes reserved for it. The heap of the program lies between the end of
+ * its image and the stack. Programs must be linked for the same layout
+ * (see the `--memory`, `--stack` and `--code` options of rishka-cc).
+ */
+typedef struct {
+    uint64_t memorySize;            ///< Size in bytes of the guest memory, a multiple of RISHKA_VM_PAGE_SIZE.
+    uint64_t codeAddress;           ///< Address the program binary is loaded at, a multiple of 4.
+    uint64_t stackSize;             ///< Number of bytes at the top of the memory reserved for the stack.
+} rishka_memory_layout;
+
+#if RISHKA_VM_JIT || RISHKA_VM_AOT
+/**
+ * @enum rishka_native_exit_kind
+ * @brief Enumeration of the ways control can leave a native block.
+ */
+enum rishka_native_exit_kind {
+    RISHKA_NATIVE_FALLTHROUGH,  /**< Continue at the fall-through successor. */
+    RISHKA_NATIVE_TAKEN,        /**< Continue at the taken jump or branch successor. */
+    RISHKA_NATIVE_RESUME        /**< Interpret the rest of the block starting at the returned pc. */
+};
+
+/**
+ * @brief Describes how control left a natively translated block.
+ *
+ * The structure is returned in registers by native blocks; `kind` is one
+ * of the rishka_native_exit_kind values.
+ */
+typedef struct {
+    int64_t pc;     ///< Guest address at which execution continues.
+    int64_t kind;   ///< Successor slot taken, or RISHKA_NATIVE_RESUME.
+} rishka_native_exit;
+
+#if RISHKA_VM_PAGED_MEMORY
+typedef rishka_tlb_entry* rishka_native_memory;    ///< Software TLB of the hart running a native block.
+#else
+typedef uint8_t* rishka_native_memory;             ///< Guest memory of the virtual machine running a native block.
+#endif
+
+/**
+ * @brief Entry point of a natively translated block.
+ *
+ * `vm` is the RishkaVM running the block, passed back to
+ * rishka_aot_store() by ahead-of-time translations after their stores.
+ * Blocks translated at run time embed it in their code instead.
+ */
+typedef rishka_native_exit (*rishka_native_block)(rishka_uxlen_t* registers, rishka_native_memory memory, void* vm);
+#endif
+
+/**
+ * @brief Represents a translated basic block in the Rishka block cache.
+ *
+ * A block is a straight-line run of decode cache entries starting at `pc`
+ * and ending at the first control transfer or system instruction. The
+ * successor links let the interpreter enter the next block without a
+ * lookup; they are only followed after checking the successor's `pc`,
+ * so links to evicted or invalidated blocks are harmless.
+ */
+typedef struct rishka_block {
+    int64_t pc;                     ///< Guest address of the first instruction, or -1 if unused.
+    struct rishka_block* next[2];   ///< Chained successors: [0] fall-through, [1] taken jump or branch.
+    uint16_t length;                ///< Number of instructions of the block, including the terminator.
+
+#if RISHKA_VM_JIT || RISHKA_VM_AOT
+    rishka_native_block native;     ///< Native translation of the block, or NULL.
+#endif
+
+#if RISHKA_VM_JIT
+    uint32_t hits;                  ///< Number of interpreted executions, saturating at the native threshold.
+#endif
+
+#if RISHKA_VM_AOT
+    bool precompiled;               ///< Flag set if `native` is an ahead-of-time translation rather than JIT code.
+#endif
+} rishka_block;
+
+/**
+ * @brief Represents an entry of the return-address stack.
+ *
+ * The block at the return address is cached in the fall-through link of
+ * the calling block, which a block ending in a call never takes itself.
+ */
+typedef struct {
+    int64_t pc;                     ///< Return address of the call.
+    rishka_block** link;            ///< Successor slot caching the block at `pc`, or NULL for calls from cold code.
+} rishka_return_entry;
+
+/**
+ * @brief Represents an entry of the indirect jump target cache.
+ */
+typedef struct {
+    int64_t site;                   ///< Guest address of the jump instruction, or -1 if unused.
+    rishka_block* block;            ///< Block at the last target of the jump, or NULL.
+} rishka_jump_entry;
+
+/**
+ * @brief Promotion statistics of the tiered execution engine.
+ */
+typedef struct {
+    uint32_t promotions;            ///< Blocks promoted from the interpreter to the block tier.
+    uint32_t evictions;             ///< Promoted blocks evicted by a colliding block.
+    uint32_t invalidations;         ///< Block cache flushes caused by rewritten text.
+    uint32_t nativeTranslations;    ///< Blocks translated to native code (host builds only).
+    uint32_t nativeFlushes;         ///< Native code buffer resets after running full (host builds only).
+    uint32_t emulatedCalls;         ///< Calls to known routines that ran natively instead of being interpreted.
+    uint32_t predictedJumps;        ///< Returns and indirect jumps whose successor block was predicted.
+    uint32_t precompiledBlocks;     ///< Blocks run from an ahead-of-time translation of the program.
+    uint32_t restoredEntries;       ///< Decode cache entries restored from the code cache when the program was loaded.
+} rishka_tier_stats;
 
 #endif /* RISHKA_TYPES_H */
\ No newline at end of file
@@ -21,12 +21,13 @@
  * @brief Rishka Utility Functions
  *
  * This file contains utility functions for converting value
- * between double precision floating-point and long integer values.
+ * between floating-point and integer values of the same width.
  */
 
 #ifndef RISHKA_UTIL_H
 #define RISHKA_UTIL_H
 
+#include <rishka_mmu.h>
 #include <rishka_types.h>
 
 /**
@@ -65,6 +66,86 @@ inline double rishka_long_to_double(int64_t l) {
     return data.output;
 }
 
+/**
+ * @brief Converts a float value to an integer.
+ *
+ * This function converts a single precision floating-point value `f` to an integer with the same bits and returns it.
+ *
+ * @param f The single precision floating-point value to be converted.
+ * @return The converted integer value.
+ */
+inline uint32_t rishka_float_to_int(float f) {
+    union {
+        float input;
+        uint32_t output;
+    } data;
+
+    data.input = f;
+    return data.output;
+}
+
+/**
+ * @brief Converts an integer to a float value.
+ *
+ * This function converts an integer `i` to a single precision floating-point value with the same bits and returns it.
+ *
+ * @param i The integer value to be converted.
+ * @return The converted single precision floating-point value.
+ */
+inline float rishka_int_to_float(uint32_t i) {
+    union {
+        float output;
+        uint32_t input;
+    } data;
+
+    data.input = i;
+    return data.output;
+}
+
+/**
+ * @brief Computes the 32-bit FNV-1a hash of a byte range.
+ *
+ * @param data The bytes to hash.
+ * @param size The number of bytes.
+ * @param hash The hash to continue from, the FNV offset basis for a new hash.
+ * @return The hash of the bytes.
+ */
+inline uint32_t rishka_fnv1a(const uint8_t* data, uint32_t size, uint32_t hash = 2166136261U) {
+    for(uint32_t i = 0; i < size; i++)
+        hash = ((hash ^ data[i]) * 16777619U);
+    return hash;
+}
+
+/**
+ * @brief Computes the 32-bit FNV-1a hash of a range of guest memory.
+ *
+ * Pages the program never touched hash as the zeros they would read as.
+ *
+ * @param memory The guest memory.
+ * @param address The guest address of the range.
+ * @param size The number of bytes, all of them inside guest memory.
+ * @param hash The hash to continue from, the FNV offset basis for a new hash.
+ * @return The hash of the bytes.
+ */
+inline uint32_t rishka_guest_hash(rishka_guest_memory memory, uint64_t address, uint32_t size, uint32_t hash = 2166136261U) {
+    while(size > 0) {
+        uint32_t length = RISHKA_VM_PAGE_SIZE - (uint32_t)(address & (RISHKA_VM_PAGE_SIZE - 1));
+        if(length > size)
+            length = size;
+
+        const uint8_t* bytes = rishka_guest_bytes(memory, address);
+        if(bytes != NULL)
+            hash = rishka_fnv1a(bytes, length, hash);
+        else for(uint32_t i = 0; i < length; i++)
+            hash *= 16777619U;
+
+        address += length;
+        size -= length;
+    }
+
+    return hash;
+}
+
 /**
  * @brief Sanitizes a file path by resolving it relative to the current working directory.
  *
@@ -122,19 +203,24 @@ inline String rishka_sanitize_path(String currentWorkingDirectory, char* path) {
     return sanitizedPath;
 }
 
-inline void rishka_split_cmd(const String& input, char** tokens, int maxTokens, int &count) {
+// Tokens longer than tokenSize - 1 characters are truncated to fit the buffers.
+inline void rishka_split_cmd(const String& input, char** tokens, int maxTokens, int tokenSize, int &count) {
     int tokenCount = 0, tokenStart = 0;
     bool inQuotes = false;
 
-    for(int i = 0; i < input.length(); i++) {
+    for(int i = 0; i < (int) input.length(); i++) {
         if(input[i] == '"')
             inQuotes = !inQuotes;
         else if(input[i] == ' ' && !inQuotes) {
             if(tokenCount < maxTokens) {
-                input.substring(tokenStart, i)
-                    .toCharArray(tokens[tokenCount], i - tokenStart + 1);
+                int length = i - tokenStart;
+                if(length >= tokenSize)
+                    length = tokenSize - 1;
 
-                tokens[tokenCount++][i - tokenStart] = '\0';
+                input.substring(tokenStart, tokenStart + length)
+                    .toCharArray(tokens[tokenCount], length + 1);
+
+                tokens[tokenCount++][length] = '\0';
                 tokenStart = i + 1;
                 count++;
             }
@@ -142,13 +228,17 @@ inline void rishka_split_cmd(const String& input, char** tokens, int maxTokens,
         }
     }
 
-    if(tokenCount < maxTokens && tokenStart < input.length()) {
-        input.substring(tokenStart).toCharArray(
+    if(tokenCount < maxTokens && tokenStart < (int) input.length()) {
+        int length = input.length() - tokenStart;
+        if(length >= tokenSize)
+            length = tokenSize - 1;
+
+        input.substring(tokenStart, tokenStart + length).toCharArray(
             tokens[tokenCount],
-            input.length() - tokenStart + 1
+            length + 1
         );
 
-        tokens[tokenCount++][input.length() - tokenStart] = '\0';
+        tokens[tokenCount++][length] = '\0';
         count++;
     }
 }
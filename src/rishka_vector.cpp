@@ -0,0 +1,431 @@
+/* 
+ * This file is part of the Rishka distribution (https://github.com/rishka-esp32/rishka).
+ * Copyright (c) 2024 Nathanne Isip.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <rishka_vector.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+
+#include <immintrin.h>
+
+typedef __m256i rishka_simd;
+
+#define RISHKA_SIMD_BYTES           32U
+#define RISHKA_SIMD_MINMAX_ALL      1
+#define RISHKA_SIMD_OP(name)        _mm256_##name
+#define RISHKA_SIMD_LOAD(p)         _mm256_loadu_si256((const __m256i*)(p))
+#define RISHKA_SIMD_STORE(p, x)     _mm256_storeu_si256((__m256i*)(p), (x))
+#define RISHKA_SIMD_AND(a, b)       _mm256_and_si256((a), (b))
+#define RISHKA_SIMD_OR(a, b)        _mm256_or_si256((a), (b))
+#define RISHKA_SIMD_XOR(a, b)       _mm256_xor_si256((a), (b))
+
+#elif defined(__SSE2__)
+
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#define RISHKA_SIMD_MINMAX_ALL      1
+#else
+#include <emmintrin.h>
+#define RISHKA_SIMD_MINMAX_ALL      0
+#endif
+
+typedef __m128i rishka_simd;
+
+#define RISHKA_SIMD_BYTES           16U
+#define RISHKA_SIMD_OP(name)        _mm_##name
+#define RISHKA_SIMD_LOAD(p)         _mm_loadu_si128((const __m128i*)(p))
+#define RISHKA_SIMD_STORE(p, x)     _mm_storeu_si128((__m128i*)(p), (x))
+#define RISHKA_SIMD_AND(a, b)       _mm_and_si128((a), (b))
+#define RISHKA_SIMD_OR(a, b)        _mm_or_si128((a), (b))
+#define RISHKA_SIMD_XOR(a, b)       _mm_xor_si128((a), (b))
+
+#endif
+
+#define RISHKA_VECTOR_BIT(bits, index) (((bits)[(index) >> 3] >> ((index) &7)) &1)
+
+#if defined(RISHKA_SIMD_BYTES)
+
+static inline bool rishka_simd_supports(uint8_t op, uint8_t size) {
+    switch(op) {
+        case RISHKA_VOP_ADD:
+        case RISHKA_VOP_SUB:
+        case RISHKA_VOP_AND:
+        case RISHKA_VOP_OR:
+        case RISHKA_VOP_XOR:
+            return true;
+
+        // There are no 64-bit minimum and maximum instructions below AVX-512.
+        case RISHKA_VOP_MINU:
+        case RISHKA_VOP_MAXU:
+            return size < 8 && (RISHKA_SIMD_MINMAX_ALL || size == 1);
+
+        case RISHKA_VOP_MIN:
+        case RISHKA_VOP_MAX:
+            return size < 8 && (RISHKA_SIMD_MINMAX_ALL || size == 2);
+    }
+
+    return false;
+}
+
+static inline rishka_simd rishka_simd_add(uint8_t size, rishka_simd a, rishka_simd b) {
+    switch(size) {
+        case 1:     return RISHKA_SIMD_OP(add_epi8)(a, b);
+        case 2:     return RISHKA_SIMD_OP(add_epi16)(a, b);
+        case 4:     return RISHKA_SIMD_OP(add_epi32)(a, b);
+        default:    return RISHKA_SIMD_OP(add_epi64)(a, b);
+    }
+}
+
+static inline rishka_simd rishka_simd_sub(uint8_t size, rishka_simd a, rishka_simd b) {
+    switch(size) {
+        case 1:     return RISHKA_SIMD_OP(sub_epi8)(a, b);
+        case 2:     return RISHKA_SIMD_OP(sub_epi16)(a, b);
+        case 4:     return RISHKA_SIMD_OP(sub_epi32)(a, b);
+        default:    return RISHKA_SIMD_OP(sub_epi64)(a, b);
+    }
+}
+
+static inline rishka_simd rishka_simd_minmax(uint8_t op, uint8_t size, rishka_simd a, rishka_simd b) {
+#if RISHKA_SIMD_MINMAX_ALL
+    switch(op) {
+        case RISHKA_VOP_MINU:
+            return size == 1 ? RISHKA_SIMD_OP(min_epu8)(a, b) :
+                size == 2 ? RISHKA_SIMD_OP(min_epu16)(a, b) : RISHKA_SIMD_OP(min_epu32)(a, b);
+
+        case RISHKA_VOP_MIN:
+            return size == 1 ? RISHKA_SIMD_OP(min_epi8)(a, b) :
+                size == 2 ? RISHKA_SIMD_OP(min_epi16)(a, b) : RISHKA_SIMD_OP(min_epi32)(a, b);
+
+        case RISHKA_VOP_MAXU:
+            return size == 1 ? RISHKA_SIMD_OP(max_epu8)(a, b) :
+                size == 2 ? RISHKA_SIMD_OP(max_epu16)(a, b) : RISHKA_SIMD_OP(max_epu32)(a, b);
+
+        default:
+            return size == 1 ? RISHKA_SIMD_OP(max_epi8)(a, b) :
+                size == 2 ? RISHKA_SIMD_OP(max_epi16)(a, b) : RISHKA_SIMD_OP(max_epi32)(a, b);
+    }
+#else
+    (void) size;
+
+    switch(op) {
+        case RISHKA_VOP_MINU:   return _mm_min_epu8(a, b);
+        case RISHKA_VOP_MIN:    return _mm_min_epi16(a, b);
+        case RISHKA_VOP_MAXU:   return _mm_max_epu8(a, b);
+        default:                return _mm_max_epi16(a, b);
+    }
+#endif
+}
+
+/**
+ * Runs an element-wise operation over the leading whole SIMD words of the
+ * arrays and returns the number of bytes done, which is 0 if the host has
+ * no instruction for the operation at this element width.
+ */
+static uint32_t rishka_simd_binary(uint8_t op, uint8_t size, uint8_t* dst,
+    const uint8_t* a, const uint8_t* b, uint32_t bytes) {
+    if(!rishka_simd_supports(op, size))
+        return 0;
+
+    uint32_t done = 0;
+    for(; done + RISHKA_SIMD_BYTES <= bytes; done += RISHKA_SIMD_BYTES) {
+        rishka_simd x = RISHKA_SIMD_LOAD(a + done), y = RISHKA_SIMD_LOAD(b + done), result;
+
+        switch(op) {
+            case RISHKA_VOP_ADD:    result = rishka_simd_add(size, x, y); break;
+            case RISHKA_VOP_SUB:    result = rishka_simd_sub(size, x, y); break;
+            case RISHKA_VOP_AND:    result = RISHKA_SIMD_AND(x, y); break;
+            case RISHKA_VOP_OR:     result = RISHKA_SIMD_OR(x, y); break;
+            case RISHKA_VOP_XOR:    result = RISHKA_SIMD_XOR(x, y); break;
+            default:                result = rishka_simd_minmax(op, size, x, y); break;
+        }
+
+        RISHKA_SIMD_STORE(dst + done, result);
+    }
+
+    return done;
+}
+
+#endif
+
+template<typename T, typename S>
+static void rishka_vector_binary_scalar(uint8_t op, T* dst, const T* a, const T* b, uint32_t count) {
+    const T shift = (T) (sizeof(T) * 8 - 1);
+
+    #define RISHKA_VECTOR_LOOP(expression)              \
+        for(uint32_t i = 0; i < count; i++) {           \
+            T x = a[i], y = b[i];                       \
+            dst[i] = (T) (expression);                  \
+        }                                               \
+        break
+
+    switch(op) {
+        case RISHKA_VOP_ADD:    RISHKA_VECTOR_LOOP(x + y);
+        case RISHKA_VOP_SUB:    RISHKA_VECTOR_LOOP(x - y);
+        case RISHKA_VOP_RSUB:   RISHKA_VECTOR_LOOP(y - x);
+        case RISHKA_VOP_AND:    RISHKA_VECTOR_LOOP(x & y);
+        case RISHKA_VOP_OR:     RISHKA_VECTOR_LOOP(x | y);
+        case RISHKA_VOP_XOR:    RISHKA_VECTOR_LOOP(x ^ y);
+        case RISHKA_VOP_MINU:   RISHKA_VECTOR_LOOP(x < y ? x : y);
+        case RISHKA_VOP_MIN:    RISHKA_VECTOR_LOOP((S) x < (S) y ? x : y);
+        case RISHKA_VOP_MAXU:   RISHKA_VECTOR_LOOP(x > y ? x : y);
+        case RISHKA_VOP_MAX:    RISHKA_VECTOR_LOOP((S) x > (S) y ? x : y);
+        case RISHKA_VOP_SLL:    RISHKA_VECTOR_LOOP(x << (y & shift));
+        case RISHKA_VOP_SRL:    RISHKA_VECTOR_LOOP(x >> (y & shift));
+        case RISHKA_VOP_SRA:    RISHKA_VECTOR_LOOP((S) x >> (y & shift));
+        case RISHKA_VOP_MUL:    RISHKA_VECTOR_LOOP((uint64_t) x * y);
+    }
+
+    #undef RISHKA_VECTOR_LOOP
+}
+
+template<typename T, typename S>
+static void rishka_vector_compare_scalar(uint8_t op, uint8_t* bits, const T* a, const T* b, uint32_t count) {
+    memset(bits, 0, (count + 7) >> 3);
+
+    #define RISHKA_VECTOR_TEST(expression)              \
+        for(uint32_t i = 0; i < count; i++) {           \
+            T x = a[i], y = b[i];                       \
+            bits[i >> 3] |= (uint8_t) ((expression) << (i & 7)); \
+        }                                               \
+        break
+
+    switch(op) {
+        case RISHKA_VOP_EQ:     RISHKA_VECTOR_TEST(x == y);
+        case RISHKA_VOP_NE:     RISHKA_VECTOR_TEST(x != y);
+        case RISHKA_VOP_LTU:    RISHKA_VECTOR_TEST(x < y);
+        case RISHKA_VOP_LT:     RISHKA_VECTOR_TEST((S) x < (S) y);
+        case RISHKA_VOP_LEU:    RISHKA_VECTOR_TEST(x <= y);
+        case RISHKA_VOP_LE:     RISHKA_VECTOR_TEST((S) x <= (S) y);
+        case RISHKA_VOP_GTU:    RISHKA_VECTOR_TEST(x > y);
+        case RISHKA_VOP_GT:     RISHKA_VECTOR_TEST((S) x > (S) y);
+    }
+
+    #undef RISHKA_VECTOR_TEST
+}
+
+template<typename T, typename S>
+static T rishka_vector_reduce_scalar(uint8_t op, T result, const T* a, const uint8_t* mask, uint32_t count) {
+    for(uint32_t i = 0; i < count; i++) {
+        if(mask != NULL && !RISHKA_VECTOR_BIT(mask, i))
+            continue;
+
+        T x = a[i];
+        switch(op) {
+            case RISHKA_VOP_ADD:    result = (T) (result + x); break;
+            case RISHKA_VOP_AND:    result &= x; break;
+            case RISHKA_VOP_OR:     result |= x; break;
+            case RISHKA_VOP_XOR:    result ^= x; break;
+            case RISHKA_VOP_MINU:   result = x < result ? x : result; break;
+            case RISHKA_VOP_MIN:    result = (S) x < (S) result ? x : result; break;
+            case RISHKA_VOP_MAXU:   result = x > result ? x : result; break;
+            case RISHKA_VOP_MAX:    result = (S) x > (S) result ? x : result; break;
+        }
+    }
+
+    return result;
+}
+
+template<typename T>
+static void rishka_vector_select_scalar(uint8_t* dst, const uint8_t* src, const uint8_t* mask, uint32_t count) {
+    for(uint32_t i = 0; i < count; i++)
+        if(RISHKA_VECTOR_BIT(mask, i))
+            memcpy(dst + i * sizeof(T), src + i * sizeof(T), sizeof(T));
+}
+
+int64_t rishka_vector_get(uint8_t size, const uint8_t* vector, uint32_t index) {
+    switch(size) {
+        case 1:     return ((const int8_t*) vector)[index];
+        case 2:     return ((const int16_t*) vector)[index];
+        case 4:     return ((const int32_t*) vector)[index];
+        default:    return ((const int64_t*) vector)[index];
+    }
+}
+
+void rishka_vector_set(uint8_t size, uint8_t* vector, uint32_t index, uint64_t value) {
+    switch(size) {
+        case 1:     ((uint8_t*) vector)[index] = (uint8_t) value; break;
+        case 2:     ((uint16_t*) vector)[index] = (uint16_t) value; break;
+        case 4:     ((uint32_t*) vector)[index] = (uint32_t) value; break;
+        default:    ((uint64_t*) vector)[index] = value; break;
+    }
+}
+
+void rishka_vector_splat(uint8_t size, uint8_t* dst, uint64_t value, uint32_t count) {
+    if(size == 1) {
+        memset(dst, (uint8_t) value, count);
+        return;
+    }
+
+    for(uint32_t i = 0; i < count; i++)
+        rishka_vector_set(size, dst, i, value);
+}
+
+void rishka_vector_index(uint8_t size, uint8_t* dst, uint32_t count) {
+    for(uint32_t i = 0; i < count; i++)
+        rishka_vector_set(size, dst, i, i);
+}
+
+void rishka_vector_binary(uint8_t op, uint8_t size, uint8_t* dst,
+    const uint8_t* a, const uint8_t* b, uint32_t count) {
+    uint32_t done = 0;
+
+#if defined(RISHKA_SIMD_BYTES)
+    done = rishka_simd_binary(op, size, dst, a, b, count * size) / size;
+    dst += done * size;
+    a += done * size;
+    b += done * size;
+#endif
+
+    switch(size) {
+        case 1:
+            rishka_vector_binary_scalar<uint8_t, int8_t>(op, dst, a, b, count - done);
+            break;
+
+        case 2:
+            rishka_vector_binary_scalar<uint16_t, int16_t>(op, (uint16_t*) dst,
+                (const uint16_t*) a, (const uint16_t*) b, count - done);
+            break;
+
+        case 4:
+            rishka_vector_binary_scalar<uint32_t, int32_t>(op, (uint32_t*) dst,
+                (const uint32_t*) a, (const uint32_t*) b, count - done);
+            break;
+
+        default:
+            rishka_vector_binary_scalar<uint64_t, int64_t>(op, (uint64_t*) dst,
+                (const uint64_t*) a, (const uint64_t*) b, count - done);
+            break;
+    }
+}
+
+void rishka_vector_compare(uint8_t op, uint8_t size, uint8_t* bits,
+    const uint8_t* a, const uint8_t* b, uint32_t count) {
+    switch(size) {
+        case 1:
+            rishka_vector_compare_scalar<uint8_t, int8_t>(op, bits, a, b, count);
+            break;
+
+        case 2:
+            rishka_vector_compare_scalar<uint16_t, int16_t>(op, bits,
+                (const uint16_t*) a, (const uint16_t*) b, count);
+            break;
+
+        case 4:
+            rishka_vector_compare_scalar<uint32_t, int32_t>(op, bits,
+                (const uint32_t*) a, (const uint32_t*) b, count);
+            break;
+
+        default:
+            rishka_vector_compare_scalar<uint64_t, int64_t>(op, bits,
+                (const uint64_t*) a, (const uint64_t*) b, count);
+            break;
+    }
+}
+
+void rishka_vector_select(uint8_t size, uint8_t* dst, const uint8_t* src,
+    const uint8_t* mask, uint32_t count) {
+    switch(size) {
+        case 1:     rishka_vector_select_scalar<uint8_t>(dst, src, mask, count); break;
+        case 2:     rishka_vector_select_scalar<uint16_t>(dst, src, mask, count); break;
+        case 4:     rishka_vector_select_scalar<uint32_t>(dst, src, mask, count); break;
+        default:    rishka_vector_select_scalar<uint64_t>(dst, src, mask, count); break;
+    }
+}
+
+void rishka_vector_select_bits(uint8_t* dst, const uint8_t* src,
+    const uint8_t* mask, uint32_t count) {
+    uint32_t bytes = count >> 3;
+
+    if(mask == NULL)
+        memcpy(dst, src, bytes);
+    else for(uint32_t i = 0; i < bytes; i++)
+        dst[i] = (uint8_t) ((dst[i] & ~mask[i]) | (src[i] & mask[i]));
+
+    if((count & 7) != 0) {
+        uint8_t keep = (uint8_t) (0xff << (count & 7));
+        if(mask != NULL)
+            keep |= (uint8_t) ~mask[bytes];
+
+        dst[bytes] = (uint8_t) ((dst[bytes] & keep) | (src[bytes] & ~keep));
+    }
+}
+
+void rishka_vector_mask_logic(uint8_t op, uint8_t* bits,
+    const uint8_t* a, const uint8_t* b, uint32_t count) {
+    for(uint32_t i = 0; i < ((count + 7) >> 3); i++) {
+        uint8_t x = a[i], y = b[i];
+
+        switch(op) {
+            case RISHKA_VOP_AND:    bits[i] = x & y; break;
+            case RISHKA_VOP_OR:     bits[i] = x | y; break;
+            case RISHKA_VOP_XOR:    bits[i] = x ^ y; break;
+            case RISHKA_VOP_ANDN:   bits[i] = x & ~y; break;
+            case RISHKA_VOP_ORN:    bits[i] = x | ~y; break;
+            case RISHKA_VOP_NAND:   bits[i] = ~(x & y); break;
+            case RISHKA_VOP_NOR:    bits[i] = ~(x | y); break;
+            case RISHKA_VOP_XNOR:   bits[i] = ~(x ^ y); break;
+        }
+    }
+}
+
+uint64_t rishka_vector_reduce(uint8_t op, uint8_t size, uint64_t initial,
+    const uint8_t* a, const uint8_t* mask, uint32_t count) {
+    switch(size) {
+        case 1:
+            return rishka_vector_reduce_scalar<uint8_t, int8_t>(op,
+                (uint8_t) initial, a, mask, count);
+
+        case 2:
+            return rishka_vector_reduce_scalar<uint16_t, int16_t>(op,
+                (uint16_t) initial, (const uint16_t*) a, mask, count);
+
+        case 4:
+            return rishka_vector_reduce_scalar<uint32_t, int32_t>(op,
+                (uint32_t) initial, (const uint32_t*) a, mask, count);
+
+        default:
+            return rishka_vector_reduce_scalar<uint64_t, int64_t>(op,
+                initial, (const uint64_t*) a, mask, count);
+    }
+}
+
+uint32_t rishka_vector_popcount(const uint8_t* bits, const uint8_t* mask, uint32_t count) {
+    uint32_t total = 0;
+
+    for(uint32_t i = 0; i < ((count + 7) >> 3); i++) {
+        uint32_t active = bits[i] & (mask != NULL ? mask[i] : 0xff);
+        if(i == (count >> 3))
+            active &= (1U << (count & 7)) - 1;
+
+        total += __builtin_popcount(active);
+    }
+
+    return total;
+}
+
+int64_t rishka_vector_first(const uint8_t* bits, const uint8_t* mask, uint32_t count) {
+    for(uint32_t i = 0; i < ((count + 7) >> 3); i++) {
+        uint32_t active = bits[i] & (mask != NULL ? mask[i] : 0xff);
+        if(i == (count >> 3))
+            active &= (1U << (count & 7)) - 1;
+
+        if(active != 0)
+            return (int64_t) (i << 3) + __builtin_ctz(active);
+    }
+
+    return -1;
+}
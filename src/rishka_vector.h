@@ -0,0 +1,222 @@
+/* 
+ * This file is part of the Rishka distribution (https://github.com/rishka-esp32/rishka).
+ * Copyright (c) 2024 Nathanne Isip.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file rishka_vector.h
+ * @author [Nathanne Isip](https://github.com/nthnn)
+ * @brief Element-wise kernels behind the vector instructions of Rishka.
+ *
+ * The kernels work on raw element arrays of 1, 2, 4 or 8 bytes, so a
+ * single call runs a whole vector instruction. When the host compiler
+ * targets SSE2 or AVX2, the common integer operations use those units;
+ * everywhere else, including the ESP32, plain loops are used.
+ *
+ * Mask arguments are bit arrays holding one bit per element, element 0
+ * in the lowest bit of the first byte, as in the v0 register. A NULL mask
+ * makes every element active.
+ */
+
+#ifndef RISHKA_VECTOR_H
+#define RISHKA_VECTOR_H
+
+#include <rishka_types.h>
+
+/**
+ * @enum rishka_vector_op
+ * @brief Enumeration of the operations of the vector kernels.
+ *
+ * The element-wise operations take the vs2 operand as `a` and the vs1,
+ * scalar or immediate operand as `b`, so RISHKA_VOP_RSUB computes b - a
+ * and RISHKA_VOP_GT compares a > b.
+ */
+enum rishka_vector_op {
+    RISHKA_VOP_ADD,     /**< a + b, or sum reduction. */
+    RISHKA_VOP_SUB,     /**< a - b. */
+    RISHKA_VOP_RSUB,    /**< b - a. */
+    RISHKA_VOP_AND,     /**< a & b. */
+    RISHKA_VOP_OR,      /**< a | b. */
+    RISHKA_VOP_XOR,     /**< a ^ b. */
+    RISHKA_VOP_MINU,    /**< Unsigned minimum. */
+    RISHKA_VOP_MIN,     /**< Signed minimum. */
+    RISHKA_VOP_MAXU,    /**< Unsigned maximum. */
+    RISHKA_VOP_MAX,     /**< Signed maximum. */
+    RISHKA_VOP_SLL,     /**< a << b, modulo the element width. */
+    RISHKA_VOP_SRL,     /**< Logical a >> b, modulo the element width. */
+    RISHKA_VOP_SRA,     /**< Arithmetic a >> b, modulo the element width. */
+    RISHKA_VOP_MUL,     /**< Low half of a * b. */
+
+    RISHKA_VOP_EQ,      /**< a == b. */
+    RISHKA_VOP_NE,      /**< a != b. */
+    RISHKA_VOP_LTU,     /**< Unsigned a < b. */
+    RISHKA_VOP_LT,      /**< Signed a < b. */
+    RISHKA_VOP_LEU,     /**< Unsigned a <= b. */
+    RISHKA_VOP_LE,      /**< Signed a <= b. */
+    RISHKA_VOP_GTU,     /**< Unsigned a > b. */
+    RISHKA_VOP_GT,      /**< Signed a > b. */
+
+    RISHKA_VOP_ANDN,    /**< a & ~b. */
+    RISHKA_VOP_ORN,     /**< a | ~b. */
+    RISHKA_VOP_NAND,    /**< ~(a & b). */
+    RISHKA_VOP_NOR,     /**< ~(a | b). */
+    RISHKA_VOP_XNOR     /**< ~(a ^ b). */
+};
+
+/**
+ * @brief Reads an element, sign-extended to 64 bits.
+ *
+ * @param size The element width in bytes.
+ * @param vector The element array.
+ * @param index The index of the element.
+ * @return The sign-extended element.
+ */
+int64_t rishka_vector_get(uint8_t size, const uint8_t* vector, uint32_t index);
+
+/**
+ * @brief Writes an element, truncating the value to the element width.
+ *
+ * @param size The element width in bytes.
+ * @param vector The element array.
+ * @param index The index of the element.
+ * @param value The new value of the element.
+ */
+void rishka_vector_set(uint8_t size, uint8_t* vector, uint32_t index, uint64_t value);
+
+/**
+ * @brief Fills elements with the same value.
+ *
+ * @param size The element width in bytes.
+ * @param dst The element array to fill.
+ * @param value The value, truncated to the element width.
+ * @param count The number of elements.
+ */
+void rishka_vector_splat(uint8_t size, uint8_t* dst, uint64_t value, uint32_t count);
+
+/**
+ * @brief Writes the index of each element to the element.
+ *
+ * @param size The element width in bytes.
+ * @param dst The element array.
+ * @param count The number of elements.
+ */
+void rishka_vector_index(uint8_t size, uint8_t* dst, uint32_t count);
+
+/**
+ * @brief Runs an element-wise arithmetic or logical operation.
+ *
+ * `dst` may be the same array as `a` or `b`, but must not overlap them
+ * otherwise.
+ *
+ * @param op The operation, from RISHKA_VOP_ADD to RISHKA_VOP_MUL.
+ * @param size The element width in bytes.
+ * @param dst The element array receiving the results.
+ * @param a The first operand (vs2).
+ * @param b The second operand (vs1, or the splatted scalar).
+ * @param count The number of elements.
+ */
+void rishka_vector_binary(uint8_t op, uint8_t size, uint8_t* dst,
+    const uint8_t* a, const uint8_t* b, uint32_t count);
+
+/**
+ * @brief Compares elements into a mask.
+ *
+ * The bits past `count` in the last byte of `bits` are cleared.
+ *
+ * @param op The comparison, from RISHKA_VOP_EQ to RISHKA_VOP_GT.
+ * @param size The element width in bytes.
+ * @param bits The bit array receiving one result per element.
+ * @param a The first operand (vs2).
+ * @param b The second operand (vs1, or the splatted scalar).
+ * @param count The number of elements.
+ */
+void rishka_vector_compare(uint8_t op, uint8_t size, uint8_t* bits,
+    const uint8_t* a, const uint8_t* b, uint32_t count);
+
+/**
+ * @brief Copies the active elements of an array into another.
+ *
+ * The elements are copied byte-wise, so either array may be unaligned
+ * guest memory.
+ *
+ * @param size The element width in bytes.
+ * @param dst The element array receiving the active elements.
+ * @param src The element array to copy from.
+ * @param mask The mask selecting the elements to copy.
+ * @param count The number of elements.
+ */
+void rishka_vector_select(uint8_t size, uint8_t* dst, const uint8_t* src,
+    const uint8_t* mask, uint32_t count);
+
+/**
+ * @brief Copies the active bits of a bit array into another.
+ *
+ * @param dst The bit array receiving the active bits.
+ * @param src The bit array to copy from.
+ * @param mask The mask selecting the bits to copy, or NULL to copy all.
+ * @param count The number of bits.
+ */
+void rishka_vector_select_bits(uint8_t* dst, const uint8_t* src,
+    const uint8_t* mask, uint32_t count);
+
+/**
+ * @brief Runs a logical operation on whole masks.
+ *
+ * @param op One of RISHKA_VOP_AND, RISHKA_VOP_OR, RISHKA_VOP_XOR and
+ *           RISHKA_VOP_ANDN to RISHKA_VOP_XNOR.
+ * @param bits The bit array receiving the results.
+ * @param a The first mask (vs2).
+ * @param b The second mask (vs1).
+ * @param count The number of bits.
+ */
+void rishka_vector_mask_logic(uint8_t op, uint8_t* bits,
+    const uint8_t* a, const uint8_t* b, uint32_t count);
+
+/**
+ * @brief Reduces the active elements of an array to a single value.
+ *
+ * @param op One of RISHKA_VOP_ADD, RISHKA_VOP_AND, RISHKA_VOP_OR,
+ *           RISHKA_VOP_XOR and RISHKA_VOP_MINU to RISHKA_VOP_MAX.
+ * @param size The element width in bytes.
+ * @param initial The initial value of the reduction.
+ * @param a The element array to reduce.
+ * @param mask The mask of active elements.
+ * @param count The number of elements.
+ * @return The result, truncated to the element width.
+ */
+uint64_t rishka_vector_reduce(uint8_t op, uint8_t size, uint64_t initial,
+    const uint8_t* a, const uint8_t* mask, uint32_t count);
+
+/**
+ * @brief Counts the set bits of a bit array.
+ *
+ * @param bits The bit array.
+ * @param mask The mask of bits to count.
+ * @param count The number of bits.
+ * @return The number of active set bits.
+ */
+uint32_t rishka_vector_popcount(const uint8_t* bits, const uint8_t* mask, uint32_t count);
+
+/**
+ * @brief Finds the first set bit of a bit array.
+ *
+ * @param bits The bit array.
+ * @param mask The mask of bits to search.
+ * @param count The number of bits.
+ * @return The index of the first active set bit, or -1 if there is none.
+ */
+int64_t rishka_vector_first(const uint8_t* bits, const uint8_t* mask, uint32_t count);
+
+#endif /* RISHKA_VECTOR_H */
@@ -15,33 +15,239 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <limits>
+#include <math.h>
 #include <rishka_instructions.h>
 #include <rishka_syscalls.h>
 #include <rishka_types.h>
 #include <rishka_util.h>
+#include <rishka_vector.h>
 #include <rishka_vm.h>
 
+#if defined(ESP_PLATFORM)
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#endif
+
+#if RISHKA_VM_THREADED_DISPATCH && defined(__GNUC__)
+#define RISHKA_VM_COMPUTED_GOTO 1
+#else
+#define RISHKA_VM_COMPUTED_GOTO 0
+#endif
+
+RishkaVM::RishkaVM() {
+#if RISHKA_VM_PAGED_MEMORY
+    this->pages = NULL;
+    this->pageTiers = NULL;
+    this->dirtyPages = NULL;
+    memset(this->tlb, -1, sizeof(this->tlb));
+    memset(this->pinned, 0, sizeof(this->pinned));
+
+    this->placement[RISHKA_REGION_IMAGE] = RISHKA_MEMORY_PSRAM;
+    this->placement[RISHKA_REGION_HEAP] = RISHKA_MEMORY_PSRAM;
+    this->placement[RISHKA_REGION_STACK] = RISHKA_MEMORY_SRAM;
+    this->resetMemoryStats();
+#else
+    this->memory = NULL;
+#endif
+    memset(&this->layout, 0, sizeof(this->layout));
+    this->imageEnd = 0;
+
+#if RISHKA_VM_HEATMAP
+    this->heat = NULL;
+    this->heatmapFile = RISHKA_VM_HEATMAP_FILE;
+#endif
+
+    this->pool = NULL;
+    this->primary = this;
+    this->hartId = 0;
+    this->finished = false;
+    this->syscallOwner = NULL;
+    memset(this->harts, 0, sizeof(this->harts));
+
+    this->tierPolicy = RISHKA_TIER_HOTNESS;
+    this->promotionThreshold = RISHKA_VM_PROMOTION_THRESHOLD;
+
+#if RISHKA_VM_JIT
+    this->nativeThreshold = RISHKA_VM_JIT_THRESHOLD;
+#endif
+
+#if RISHKA_VM_HLE
+    memset(this->routines, -1, sizeof(this->routines));
+    this->hasRoutines = false;
+#endif
+
+#if RISHKA_VM_AOT
+    this->translations = NULL;
+#endif
+
+#if RISHKA_VM_CODE_CACHE
+    this->codeImage.size = 0;
+#endif
+
+    this->resetTierStats();
+}
+
+RishkaVM::~RishkaVM() {
+    this->stopHarts();
+
+#if RISHKA_VM_PAGED_MEMORY
+    this->releaseParams();
+#endif
+
+    if(this->primary == this)
+        this->releaseMemory();
+}
+
+// The stack pointer must hold the top of the memory, and the binary needs
+// room between the code address and the stack.
+static bool rishka_layout_valid(const rishka_memory_layout* layout) {
+    return layout->memorySize != 0 &&
+        (layout->memorySize &(RISHKA_VM_PAGE_SIZE - 1)) == 0 &&
+        layout->memorySize <= (uint64_t)(rishka_uxlen_t) -1 &&
+        (size_t) layout->memorySize == layout->memorySize &&
+        (layout->codeAddress &3) == 0 &&
+        layout->stackSize < layout->memorySize &&
+        layout->codeAddress < layout->memorySize - layout->stackSize;
+}
+
 void RishkaVM::initialize(
     fabgl::Terminal* terminal,
     fabgl::BaseDisplayController* displayCtrl,
     ArduinoNvs* nvsStorage,
-    String workingDirectory
+    String workingDirectory,
+    rishka_memory_layout layout
 ) {
     this->running = false;
+    this->panicked = false;
+    this->suspended = false;
     this->argv = NULL;
     this->argc = 0;
     this->pc = 0;
+    this->fcsr = 0;
+    this->vl = 0;
+    this->vtype = ((rishka_uxlen_t) 1 << (RISHKA_VM_XLEN - 1));
+    this->instret = 0;
+    this->reserved = false;
     this->exitCode = 0;
+
+    memset(this->registers, 0, sizeof(this->registers));
+    memset(this->fregisters, 0, sizeof(this->fregisters));
+    memset(this->vregisters, 0, sizeof(this->vregisters));
+
+    memset(this->returnStack, 0, sizeof(this->returnStack));
+    this->returnTop = 0;
+
+    for(uint32_t i = 0; i < RISHKA_VM_JUMP_CACHE_SIZE; i++) {
+        this->jumpCache[i].site = -1;
+        this->jumpCache[i].block = NULL;
+    }
+
     this->workingDirectory = workingDirectory;
     this->outputStream = "";
 
     this->terminal = terminal;
     this->display = displayCtrl;
     this->nvsStorage = nvsStorage;
+
+    // Additional harts get the layout and memory of the primary hart.
+    if(this->primary != this) {
+        this->layout = layout;
+        return;
+    }
+
+    if(!rishka_layout_valid(&layout) || layout.memorySize != this->layout.memorySize)
+        this->releaseMemory();
+    if(!rishka_layout_valid(&layout))
+        return;
+
+#if RISHKA_VM_PAGED_MEMORY
+    if(this->pages == NULL) {
+        this->pages = (uint8_t**) calloc(layout.memorySize / RISHKA_VM_PAGE_SIZE, sizeof(uint8_t*));
+        this->pageTiers = (uint8_t*) calloc(layout.memorySize / RISHKA_VM_PAGE_SIZE, 1);
+        this->dirtyPages = (uint8_t*) calloc(layout.memorySize / RISHKA_VM_PAGE_SIZE, 1);
+
+        if(this->pages == NULL || this->pageTiers == NULL || this->dirtyPages == NULL)
+            this->releaseMemory();
+    }
+#else
+    if(this->memory == NULL) {
+        // The written flags of the pages come first, see rishka_mark_dirty().
+        size_t flags = (size_t)(layout.memorySize / RISHKA_VM_PAGE_SIZE);
+        uint8_t* block = (uint8_t*) calloc(flags + (size_t) layout.memorySize, 1);
+
+        this->memory = block != NULL ? &block[flags] : NULL;
+    }
+#endif
+
+#if RISHKA_VM_HEATMAP
+    if(this->guestMemory() != NULL && this->heat == NULL) {
+        this->heat = (rishka_page_heat*) calloc(layout.memorySize / RISHKA_VM_PAGE_SIZE, sizeof(rishka_page_heat));
+
+        if(this->heat == NULL)
+            this->releaseMemory();
+    }
+#endif
+
+    if(this->guestMemory() != NULL)
+        this->layout = layout;
+}
+
+#if RISHKA_VM_PAGED_MEMORY
+// Pages may be shared by the virtual machines forked from one another; a
+// word past their last byte counts the page tables holding them, and a
+// page is only written in place while it has a single owner.
+static inline uint32_t* rishka_page_owners(uint8_t* page) {
+    return (uint32_t*)(&page[RISHKA_VM_PAGE_SIZE]);
+}
+
+static inline void rishka_page_release(uint8_t* page) {
+    if(page != NULL && __atomic_sub_fetch(rishka_page_owners(page), 1, __ATOMIC_ACQ_REL) == 0)
+        free(page);
+}
+#endif
+
+void RishkaVM::releaseMemory() {
+#if RISHKA_VM_CODE_CACHE
+    this->codeImage.size = 0;
+#endif
+
+#if RISHKA_VM_PAGED_MEMORY
+    if(this->pages != NULL) {
+        for(uint64_t page = 0; page < this->layout.memorySize / RISHKA_VM_PAGE_SIZE; page++)
+            rishka_page_release(this->pages[page]);
+        free(this->pages);
+    }
+
+    free(this->pageTiers);
+    free(this->dirtyPages);
+    this->pages = NULL;
+    this->pageTiers = NULL;
+    this->dirtyPages = NULL;
+    memset(this->tlb, -1, sizeof(this->tlb));
+#else
+    if(this->memory != NULL)
+        free(this->memory - this->layout.memorySize / RISHKA_VM_PAGE_SIZE);
+    this->memory = NULL;
+#endif
+
+#if RISHKA_VM_HEATMAP
+    free(this->heat);
+    this->heat = NULL;
+#endif
+
+    memset(&this->layout, 0, sizeof(this->layout));
+}
+
+rishka_memory_layout RishkaVM::getMemoryLayout() const {
+    return this->layout;
 }
 
 void RishkaVM::stopVM() {
-    this->running = false;
+    __atomic_store_n(&this->running, false, __ATOMIC_RELAXED);
 }
 
 void RishkaVM::setExitCode(int64_t exitCode) {
@@ -64,6 +270,10 @@ ArduinoNvs* RishkaVM::getNvsStorage() const {
     return this->nvsStorage;
 }
 
+RishkaVMPool* RishkaVM::getPool() const {
+    return this->primary->pool;
+}
+
 uint8_t RishkaVM::getArgCount() const {
     return this->argc;
 }
@@ -72,6 +282,44 @@ char* RishkaVM::getArgValue(const uint8_t index) const {
     return this->argv[index];
 }
 
+void RishkaVM::setTierPolicy(rishka_tier_policy policy) {
+    this->tierPolicy = policy;
+}
+
+rishka_tier_policy RishkaVM::getTierPolicy() const {
+    return this->tierPolicy;
+}
+
+void RishkaVM::setPromotionThreshold(uint16_t threshold) {
+    this->promotionThreshold = threshold == 0 ? 1 : threshold;
+}
+
+uint16_t RishkaVM::getPromotionThreshold() const {
+    return this->promotionThreshold;
+}
+
+#if RISHKA_VM_JIT
+void RishkaVM::setNativeThreshold(uint32_t threshold) {
+    this->nativeThreshold = threshold;
+}
+
+uint32_t RishkaVM::getNativeThreshold() const {
+    return this->nativeThreshold;
+}
+#endif
+
+rishka_tier_stats RishkaVM::getTierStats() const {
+    return this->tierStats;
+}
+
+void RishkaVM::resetTierStats() {
+    memset(&this->tierStats, 0, sizeof(this->tierStats));
+}
+
+uint64_t RishkaVM::getRetiredCount() const {
+    return this->instret;
+}
+
 bool RishkaVM::loadFile(const char* fileName, bool enableBoot) {
     String absoluteFilename = "/bin/" + String(fileName) + ".bin";
     if(!SD.exists(absoluteFilename))
@@ -90,17 +338,64 @@ bool RishkaVM::loadFile(const char* fileName, bool enableBoot) {
     if(!enableBoot && absoluteFilename == "/bin/boot.bin")
         return false;
 
+    if(this->guestMemory() == NULL)
+        return false;
+
     File file = SD.open(absoluteFilename);
     if(!file) {
         file.close();
         return false;
     }
 
-    if(file.read(&(((rishka_u8_arrptr*) &this->memory)->a).v[4096], file.size())) {
+    uint64_t address = this->layout.codeAddress;
+    uint32_t size = file.size();
+
+    if(size == 0 || size > this->layout.memorySize - this->layout.stackSize - address) {
+        file.close();
+        return false;
+    }
+
+#if RISHKA_VM_CODE_CACHE
+    this->storeCodeCache();
+#endif
+
+    this->invalidateDecodeCache();
+    this->imageEnd = address + size;
+
+#if RISHKA_VM_HEATMAP
+    this->resetHeatmap();
+#endif
+
+#if RISHKA_VM_PAGED_MEMORY
+    // The binary is read one page at a time, allocating the pages it covers.
+    uint32_t loaded = 0;
+
+    while(loaded < size) {
+        uint8_t* page = this->mapPage(address + loaded, true);
+        uint32_t offset = (uint32_t)((address + loaded) &(RISHKA_VM_PAGE_SIZE - 1)), length = RISHKA_VM_PAGE_SIZE - offset;
+
+        if(length > size - loaded)
+            length = size - loaded;
+        if(page == NULL || file.read(&page[offset], length) != length)
+            break;
+
+        loaded += length;
+    }
+
+    if(loaded == size) {
+#else
+    this->markDirty(address, size);
+    if(file.read(&this->memory[address], size) == size) {
+#endif
         file.close();
+        this->attachProgram(absoluteFilename);
+
+#if RISHKA_VM_CODE_CACHE
+        this->restoreCodeCache(size);
+#endif
 
-        (((rishka_u64_arrptr*) &this->registers)->a).v[2] = RISHKA_VM_STACK_SIZE;
-        this->pc = 4096;
+        (((rishka_uxlen_arrptr*) &this->registers)->a).v[2] = (rishka_uxlen_t) this->layout.memorySize;
+        this->pc = (int64_t) address;
 
         return true;
     }
@@ -108,13 +403,343 @@ bool RishkaVM::loadFile(const char* fileName, bool enableBoot) {
     return false;
 }
 
+void RishkaVM::attachProgram(String fileName) {
+    this->programFile = fileName;
+
+#if RISHKA_VM_HLE
+    this->loadSymbols(fileName.endsWith(".bin") ?
+        fileName.substring(0, fileName.length() - 4) + ".sym" :
+        fileName + ".sym");
+#endif
+
+#if RISHKA_VM_AOT
+    String programName = fileName.substring(fileName.lastIndexOf('/') + 1);
+    if(programName.endsWith(".bin"))
+        programName = programName.substring(0, programName.length() - 4);
+
+    this->translations = rishka_aot_find(programName.c_str());
+#endif
+}
+
 void RishkaVM::run(int argc, char** argv) {
+    this->start(argc, argv);
+    this->runUntilExit();
+    this->stopHarts();
+}
+
+void RishkaVM::runUntilExit() {
+    while(this->runFor(UINT64_MAX) == RISHKA_RUN_SYSCALL_BLOCKED) {
+        long wait = (long)(this->resumeTime - millis());
+
+        if(wait > 0)
+            delay(wait);
+        else yield();
+    }
+}
+
+void RishkaVM::runHart(void* hart) {
+    RishkaVM* vm = (RishkaVM*) hart;
+
+    vm->runUntilExit();
+    __atomic_store_n(&vm->finished, true, __ATOMIC_RELEASE);
+
+#if defined(ESP_PLATFORM)
+    vTaskDelete(NULL);
+#endif
+}
+
+#if defined(__linux__) && !defined(ESP_PLATFORM)
+void* RishkaVM::runHartThread(void* hart) {
+    RishkaVM::runHart(hart);
+    return NULL;
+}
+#endif
+
+int64_t RishkaVM::spawnHart(int64_t entry, rishka_uxlen_t stackPointer, rishka_uxlen_t argument) {
+    RishkaVM* primary = this->primary;
+    uint32_t slot = 0;
+
+    for(; slot < RISHKA_VM_MAX_HARTS - 1; slot++) {
+        RishkaVM* hart = primary->harts[slot];
+
+        if(hart == NULL)
+            break;
+
+        // A hart whose task has returned leaves its slot to the next one.
+        if(__atomic_load_n(&hart->finished, __ATOMIC_ACQUIRE)) {
+            delete hart;
+            primary->harts[slot] = NULL;
+            break;
+        }
+    }
+
+    if(slot == RISHKA_VM_MAX_HARTS - 1)
+        return -1;
+
+#if RISHKA_VM_PAGED_MEMORY
+    // Harts share one page table, so the pages still shared with forked
+    // virtual machines are copied first. Only the primary hart can find
+    // any, as no virtual machine is forked while it has harts running.
+    if(this == primary && !primary->unsharePages())
+        return -1;
+#endif
+
+    RishkaVM* hart = new RishkaVM();
+#if RISHKA_VM_PAGED_MEMORY
+    hart->pages = primary->pages;
+    hart->pageTiers = primary->pageTiers;
+    hart->dirtyPages = primary->dirtyPages;
+#else
+    hart->memory = primary->memory;
+#endif
+
+#if RISHKA_VM_HEATMAP
+    hart->heat = primary->heat;
+#endif
+    hart->primary = primary;
+    hart->hartId = slot + 1;
+    hart->tierPolicy = this->tierPolicy;
+    hart->promotionThreshold = this->promotionThreshold;
+
+#if RISHKA_VM_JIT
+    hart->nativeThreshold = this->nativeThreshold;
+#endif
+
+#if RISHKA_VM_HLE
+    memcpy(hart->routines, this->routines, sizeof(this->routines));
+    hart->hasRoutines = this->hasRoutines;
+#endif
+
+#if RISHKA_VM_AOT
+    hart->translations = this->translations;
+#endif
+
+    hart->initialize(this->terminal, this->display, this->nvsStorage, this->workingDirectory, primary->layout);
+    hart->invalidateDecodeCache();
+
+    memset(hart->registers, 0, sizeof(hart->registers));
+    memset(hart->fregisters, 0, sizeof(hart->fregisters));
+    hart->registers[2] = stackPointer;
+    hart->registers[3] = this->registers[3];
+    hart->registers[4] = this->registers[4];
+    hart->registers[10] = argument;
+    hart->pc = entry;
+    hart->start(0, NULL);
+
+    primary->harts[slot] = hart;
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+#if defined(ESP_PLATFORM)
+    bool started = xTaskCreatePinnedToCore(RishkaVM::runHart, "rishka_hart",
+        RISHKA_VM_HART_TASK_STACK, hart, uxTaskPriorityGet(NULL), NULL,
+        portNUM_PROCESSORS > 1 ? (xPortGetCoreID() ^ 1) : tskNO_AFFINITY) == pdPASS;
+#elif defined(__linux__)
+    pthread_t thread;
+    bool started = pthread_create(&thread, NULL, RishkaVM::runHartThread, hart) == 0;
+
+    if(started)
+        pthread_detach(thread);
+#else
+    bool started = false;
+#endif
+
+    if(!started) {
+        primary->harts[slot] = NULL;
+        delete hart;
+
+        return -1;
+    }
+
+    return slot + 1;
+}
+
+RishkaVM* RishkaVM::fork() {
+    if(this->primary != this || this->guestMemory() == NULL)
+        return NULL;
+
+    for(uint32_t slot = 0; slot < RISHKA_VM_MAX_HARTS - 1; slot++)
+        if(this->harts[slot] != NULL && !__atomic_load_n(&this->harts[slot]->finished, __ATOMIC_ACQUIRE))
+            return NULL;
+
+    RishkaVM* child = new RishkaVM();
+    child->initialize(this->terminal, this->display, this->nvsStorage, this->workingDirectory, this->layout);
+
+    if(child->guestMemory() == NULL) {
+        delete child;
+        return NULL;
+    }
+
+#if RISHKA_VM_PAGED_MEMORY
+    // Both page tables hold the touched pages from now on, and the TLB of
+    // this virtual machine may still map some of them writable.
+    for(uint64_t index = 0; index < this->layout.memorySize / RISHKA_VM_PAGE_SIZE; index++)
+        if(this->pages[index] != NULL) {
+            __atomic_add_fetch(rishka_page_owners(this->pages[index]), 1, __ATOMIC_ACQ_REL);
+            child->pages[index] = this->pages[index];
+            child->pageTiers[index] = this->pageTiers[index];
+            child->dirtyPages[index] = this->dirtyPages[index];
+        }
+
+    memset(this->tlb, -1, sizeof(this->tlb));
+    memcpy(child->placement, this->placement, sizeof(this->placement));
+#else
+    // Pages not written since the last reset are zero on both sides.
+    for(uint64_t index = 0; index < this->layout.memorySize / RISHKA_VM_PAGE_SIZE; index++)
+        if(this->isDirty(index)) {
+            memcpy(&child->memory[index * RISHKA_VM_PAGE_SIZE], &this->memory[index * RISHKA_VM_PAGE_SIZE], RISHKA_VM_PAGE_SIZE);
+            rishka_mark_dirty(child->memory, index * RISHKA_VM_PAGE_SIZE, 1);
+        }
+#endif
+
+    memcpy(child->registers, this->registers, sizeof(this->registers));
+    memcpy(child->fregisters, this->fregisters, sizeof(this->fregisters));
+    memcpy(child->vregisters, this->vregisters, sizeof(this->vregisters));
+    child->fcsr = this->fcsr;
+    child->vl = this->vl;
+    child->vtype = this->vtype;
+    child->instret = this->instret;
+    child->pc = this->pc;
+    child->imageEnd = this->imageEnd;
+    child->programFile = this->programFile;
+    child->argc = this->argc;
+    child->argv = this->argv;
+    child->outputStream = this->outputStream;
+
+    // The code is the same, so its decoded instructions are too; blocks
+    // link to one another and are built again.
+    memcpy(child->decodeCache, this->decodeCache, sizeof(this->decodeCache));
+    memcpy(child->hotness, this->hotness, sizeof(this->hotness));
+    child->invalidateBlockCache();
+
+    child->tierPolicy = this->tierPolicy;
+    child->promotionThreshold = this->promotionThreshold;
+
+#if RISHKA_VM_JIT
+    child->nativeThreshold = this->nativeThreshold;
+#endif
+
+#if RISHKA_VM_HLE
+    memcpy(child->routines, this->routines, sizeof(this->routines));
+    child->hasRoutines = this->hasRoutines;
+#endif
+
+#if RISHKA_VM_AOT
+    child->translations = this->translations;
+#endif
+
+#if RISHKA_VM_HEATMAP
+    child->heatmapFile = "";
+#endif
+
+    return child;
+}
+
+int64_t RishkaVM::runFork(int64_t entry, rishka_uxlen_t routine, rishka_uxlen_t argument) {
+    RishkaVM* child = this->fork();
+    if(child == NULL)
+        return -1;
+
+    child->registers[10] = routine;
+    child->registers[11] = argument;
+    child->pc = entry;
+    child->run(this->argc, this->argv);
+
+    int64_t exitCode = child->getExitCode();
+    delete child;
+
+    return exitCode;
+}
+
+void RishkaVM::stopHarts() {
+    // Holding the system call lock keeps harts from spawning others
+    // meanwhile; it is already held when a system call resets the VM.
+    bool locked = __atomic_load_n(&this->syscallOwner, __ATOMIC_RELAXED) != this;
+    RishkaVM* owner = NULL;
+
+    while(locked && !__atomic_compare_exchange_n(&this->syscallOwner, &owner, this,
+        false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        owner = NULL;
+        yield();
+    }
+
+    for(uint32_t slot = 0; slot < RISHKA_VM_MAX_HARTS - 1; slot++) {
+        RishkaVM* hart = this->harts[slot];
+
+        if(hart == NULL)
+            continue;
+
+        hart->stopVM();
+        while(!__atomic_load_n(&hart->finished, __ATOMIC_ACQUIRE))
+            delay(1);
+
+        delete hart;
+        this->harts[slot] = NULL;
+    }
+
+    if(locked)
+        __atomic_store_n(&this->syscallOwner, (RishkaVM*) NULL, __ATOMIC_RELEASE);
+}
+
+uint32_t RishkaVM::getHartId() const {
+    return this->hartId;
+}
+
+bool RishkaVM::lockSyscalls() {
+    RishkaVM* owner = NULL;
+
+    while(!__atomic_compare_exchange_n(&this->primary->syscallOwner, &owner, this,
+        false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        if(!__atomic_load_n(&this->running, __ATOMIC_RELAXED))
+            return false;
+
+        owner = NULL;
+        yield();
+    }
+
+    return true;
+}
+
+void RishkaVM::unlockSyscalls() {
+    __atomic_store_n(&this->primary->syscallOwner, (RishkaVM*) NULL, __ATOMIC_RELEASE);
+}
+
+void RishkaVM::start(int argc, char** argv) {
     this->running = true;
+    this->panicked = false;
+    this->suspended = false;
     this->argc = argc;
     this->argv = argv;
+}
+
+rishka_run_status RishkaVM::runFor(uint64_t instructionBudget, uint32_t timeLimit) {
+    if(!this->running)
+        return this->panicked ? RISHKA_RUN_PANICKED : RISHKA_RUN_EXITED;
+
+    if(this->suspended) {
+        if((long)(millis() - this->resumeTime) < 0)
+            return RISHKA_RUN_SYSCALL_BLOCKED;
+        this->suspended = false;
+    }
+
+#if RISHKA_VM_HEATMAP
+    rishka_run_status status = this->interpret(instructionBudget, timeLimit);
+
+    if((status == RISHKA_RUN_EXITED || status == RISHKA_RUN_PANICKED) &&
+        this->primary == this && this->heatmapFile.length() != 0)
+        this->writeHeatmap(this->heatmapFile);
+    return status;
+#else
+    return this->interpret(instructionBudget, timeLimit);
+#endif
+}
+
+rishka_run_status RishkaVM::step() {
+    return this->runFor(1);
+}
 
-    while(this->running)
-        this->execute(this->fetch());
+void RishkaVM::suspend(uint32_t milliseconds) {
+    this->suspended = true;
+    this->resumeTime = millis() + milliseconds;
 }
 
 bool RishkaVM::isRunning() {
@@ -129,10 +754,17 @@ void RishkaVM::panic(const char* message) {
     this->stopVM();
     this->reset();
     this->setExitCode(-1);
+    this->panicked = true;
 }
 
 void RishkaVM::reset() {
     this->running = false;
+    this->stopHarts();
+
+#if RISHKA_VM_CODE_CACHE
+    this->storeCodeCache();
+#endif
+
     this->argv = NULL;
     this->argc = 0;
     this->pc = 0;
@@ -140,541 +772,4241 @@ void RishkaVM::reset() {
     this->outputStream = "";
 
     this->fileHandles.clear();
+    if(this->primary == this && this->guestMemory() != NULL)
+        this->clearDirtyPages();
+
+    this->imageEnd = 0;
+    this->programFile = "";
     this->initialize(
         this->terminal,
         this->display,
         this->nvsStorage,
-        this->workingDirectory
+        this->workingDirectory,
+        this->layout
     );
 }
 
-void RishkaVM::execute(uint32_t inst) {
-    uint32_t opcode = ((inst >> 0) &127);
-    uint32_t rd = ((inst >> 7) &31),
-        rs1 = ((inst >> 15) &31),
-        rs2 = ((inst >> 20) &31);
+void RishkaVM::clearDirtyPages() {
+    for(uint64_t index = 0; index < this->layout.memorySize / RISHKA_VM_PAGE_SIZE; index++) {
+        if(!this->isDirty(index))
+            continue;
+
+#if RISHKA_VM_PAGED_MEMORY
+        uint8_t* page = this->pages[index];
+
+        if(page != NULL && __atomic_load_n(rishka_page_owners(page), __ATOMIC_ACQUIRE) == 1)
+            memset(page, 0, RISHKA_VM_PAGE_SIZE);
+        else if(page != NULL) {
+            this->pages[index] = NULL;
+            rishka_page_release(page);
+        }
+
+        this->dirtyPages[index] = 0;
+#else
+        memset(&this->memory[index * RISHKA_VM_PAGE_SIZE], 0, RISHKA_VM_PAGE_SIZE);
+        this->memory[-1 - (int64_t) index] = 0;
+#endif
+    }
+
+#if RISHKA_VM_PAGED_MEMORY
+    // Cleared pages are mapped read-only again, until written.
+    memset(this->tlb, -1, sizeof(this->tlb));
+#endif
+}
+
+uint32_t RishkaVM::getDirtyPageCount() const {
+    uint32_t count = 0;
+
+    if(this->guestMemory() != NULL)
+        for(uint64_t index = 0; index < this->layout.memorySize / RISHKA_VM_PAGE_SIZE; index++)
+            if(this->isDirty(index))
+                count++;
+
+    return count;
+}
+
+static bool rishka_all_zero(const void* data, size_t size) {
+    const uint8_t* bytes = (const uint8_t*) data;
+
+    for(size_t i = 0; i < size; i++)
+        if(bytes[i] != 0)
+            return false;
+
+    return true;
+}
+
+bool RishkaVM::isPristine(bool scanMemory) const {
+    if(this->running || this->pc != 0 || this->instret != 0 || this->imageEnd != 0 ||
+        this->fcsr != 0 || this->vl != 0 || this->fileHandles.getSize() != 0 ||
+        this->getDirtyPageCount() != 0)
+        return false;
+
+    if(!rishka_all_zero(this->registers, sizeof(this->registers)) ||
+        !rishka_all_zero(this->fregisters, sizeof(this->fregisters)) ||
+        !rishka_all_zero(this->vregisters, sizeof(this->vregisters)))
+        return false;
+
+    if(scanMemory && this->guestMemory() != NULL)
+        for(uint64_t index = 0; index < this->layout.memorySize / RISHKA_VM_PAGE_SIZE; index++) {
+#if RISHKA_VM_PAGED_MEMORY
+            const uint8_t* page = this->pages[index];
+#else
+            const uint8_t* page = &this->memory[index * RISHKA_VM_PAGE_SIZE];
+#endif
+
+            if(page != NULL && !rishka_all_zero(page, RISHKA_VM_PAGE_SIZE))
+                return false;
+        }
+
+    return true;
+}
+
+// Bump whenever the layout of snapshot files changes, so that files
+// written by older builds are refused.
+#define RISHKA_SNAPSHOT_VERSION 1U
+
+#define RISHKA_SNAPSHOT_MAGIC 0x4e534b52U       // "RKSN"
+#define RISHKA_SNAPSHOT_END 0xffffffffU         // Page index after the last page
+#define RISHKA_SNAPSHOT_PATH_LENGTH 256U        // Size of the buffer paths are read into
+
+#define RISHKA_SNAPSHOT_FILE_OPEN 1U
+#define RISHKA_SNAPSHOT_FILE_DIRECTORY 2U
+
+// A snapshot file is this header, followed by the integer, floating-point
+// and vector registers, the working directory and program paths, a record
+// of each file handle (its flags, position and path), the written pages
+// that are not all zero (an index, then the page) up to an index of
+// RISHKA_SNAPSHOT_END, and the FNV-1a hash of everything before it. Paths
+// are a 16-bit length followed by their characters.
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint8_t xlen;
+    uint8_t reserved;
+    uint16_t vlen;
+    uint16_t files;
+    uint32_t pageSize;
+    rishka_memory_layout layout;
+    int64_t pc;
+    uint64_t instret;
+    uint64_t imageEnd;
+    uint64_t vtype;
+    uint32_t fcsr;
+    uint32_t vl;
+} rishka_snapshot_header;
+
+static bool rishka_snapshot_write(File& file, const void* data, uint32_t size, uint32_t* checksum) {
+    *checksum = rishka_fnv1a((const uint8_t*) data, size, *checksum);
+    return file.write((const uint8_t*) data, size) == size;
+}
+
+static bool rishka_snapshot_read(File& file, void* data, uint32_t size, uint32_t* checksum) {
+    if(file.read((uint8_t*) data, size) != size)
+        return false;
+
+    *checksum = rishka_fnv1a((const uint8_t*) data, size, *checksum);
+    return true;
+}
+
+static bool rishka_snapshot_write_path(File& file, String path, uint32_t* checksum) {
+    uint16_t length = (uint16_t) path.length();
+
+    return path.length() < RISHKA_SNAPSHOT_PATH_LENGTH &&
+        rishka_snapshot_write(file, &length, sizeof(length), checksum) &&
+        rishka_snapshot_write(file, path.c_str(), length, checksum);
+}
+
+static bool rishka_snapshot_read_path(File& file, String& path, uint32_t* checksum) {
+    char buffer[RISHKA_SNAPSHOT_PATH_LENGTH];
+    uint16_t length;
+
+    if(!rishka_snapshot_read(file, &length, sizeof(length), checksum) ||
+        length >= RISHKA_SNAPSHOT_PATH_LENGTH ||
+        !rishka_snapshot_read(file, buffer, length, checksum))
+        return false;
+
+    buffer[length] = 0;
+    path = String(buffer);
+
+    return true;
+}
+
+// Reads bytes into the checksum only, in pieces of the smallest page size.
+static bool rishka_snapshot_skip(File& file, uint32_t size, uint32_t* checksum) {
+    uint8_t buffer[256];
+
+    while(size > 0) {
+        uint32_t length = size < sizeof(buffer) ? size : (uint32_t) sizeof(buffer);
+        if(!rishka_snapshot_read(file, buffer, length, checksum))
+            return false;
+
+        size -= length;
+    }
+
+    return true;
+}
+
+// Reads a snapshot past its header without restoring anything, to check
+// that it is complete and matches its checksum. `registersSize` is the
+// size of the three register files, which are stored one after another.
+static bool rishka_snapshot_verify(File& file, const rishka_snapshot_header* header, uint32_t registersSize) {
+    uint32_t checksum = rishka_fnv1a((const uint8_t*) header, sizeof(*header));
+    String path;
+
+    bool valid = rishka_snapshot_skip(file, registersSize, &checksum) &&
+        rishka_snapshot_read_path(file, path, &checksum) &&
+        rishka_snapshot_read_path(file, path, &checksum);
+
+    for(uint16_t index = 0; valid && index < header->files; index++)
+        valid = rishka_snapshot_skip(file, sizeof(uint8_t) + sizeof(uint32_t), &checksum) &&
+            rishka_snapshot_read_path(file, path, &checksum);
+
+    for(;;) {
+        uint32_t index;
+
+        valid = valid && rishka_snapshot_read(file, &index, sizeof(index), &checksum);
+        if(!valid || index == RISHKA_SNAPSHOT_END)
+            break;
+
+        valid = index < header->layout.memorySize / RISHKA_VM_PAGE_SIZE &&
+            rishka_snapshot_skip(file, RISHKA_VM_PAGE_SIZE, &checksum);
+    }
+
+    uint32_t stored;
+    return valid && file.read((uint8_t*) &stored, sizeof(stored)) == sizeof(stored) && stored == checksum;
+}
+
+bool RishkaVM::saveSnapshot(String path) {
+    if(this->primary != this || this->guestMemory() == NULL)
+        return false;
+
+    for(uint32_t slot = 0; slot < RISHKA_VM_MAX_HARTS - 1; slot++)
+        if(this->harts[slot] != NULL && !__atomic_load_n(&this->harts[slot]->finished, __ATOMIC_ACQUIRE))
+            return false;
+
+    rishka_snapshot_header header;
+    memset(&header, 0, sizeof(header));
+
+    header.magic = RISHKA_SNAPSHOT_MAGIC;
+    header.version = RISHKA_SNAPSHOT_VERSION;
+    header.xlen = RISHKA_VM_XLEN;
+    header.vlen = RISHKA_VM_VLEN;
+    header.files = (uint16_t) this->fileHandles.getSize();
+    header.pageSize = RISHKA_VM_PAGE_SIZE;
+    header.layout = this->layout;
+    header.pc = this->pc;
+    header.instret = this->instret;
+    header.imageEnd = this->imageEnd;
+    header.vtype = (uint64_t) this->vtype;
+    header.fcsr = this->fcsr;
+    header.vl = this->vl;
+
+    // The previous snapshot stays in place until this one is complete.
+    String temporary = path + ".tmp";
+    if(SD.exists(temporary) && !SD.remove(temporary))
+        return false;
+
+    File file = SD.open(temporary, FILE_WRITE);
+    if(!file)
+        return false;
+
+    uint32_t checksum = rishka_fnv1a((const uint8_t*) &header, sizeof(header));
+    bool written = file.write((const uint8_t*) &header, sizeof(header)) == sizeof(header) &&
+        rishka_snapshot_write(file, this->registers, sizeof(this->registers), &checksum) &&
+        rishka_snapshot_write(file, this->fregisters, sizeof(this->fregisters), &checksum) &&
+        rishka_snapshot_write(file, this->vregisters, sizeof(this->vregisters), &checksum) &&
+        rishka_snapshot_write_path(file, this->workingDirectory, &checksum) &&
+        rishka_snapshot_write_path(file, this->programFile, &checksum);
+
+    for(uint16_t index = 0; written && index < header.files; index++) {
+        File handle = this->fileHandles[index];
+        uint8_t flags = 0;
+        uint32_t position = 0;
+        String handlePath = "";
+
+        if(handle) {
+            flags = RISHKA_SNAPSHOT_FILE_OPEN;
+            if(handle.isDirectory())
+                flags |= RISHKA_SNAPSHOT_FILE_DIRECTORY;
+            else position = (uint32_t) handle.position();
+
+            handlePath = handle.path();
+        }
+
+        written = rishka_snapshot_write(file, &flags, sizeof(flags), &checksum) &&
+            rishka_snapshot_write(file, &position, sizeof(position), &checksum) &&
+            rishka_snapshot_write_path(file, handlePath, &checksum);
+    }
+
+    // Pages not written since the last reset are zero, as are many written ones.
+    for(uint64_t index = 0; written && index < this->layout.memorySize / RISHKA_VM_PAGE_SIZE; index++) {
+        if(!this->isDirty(index))
+            continue;
+
+#if RISHKA_VM_PAGED_MEMORY
+        const uint8_t* page = this->pages[index];
+#else
+        const uint8_t* page = &this->memory[index * RISHKA_VM_PAGE_SIZE];
+#endif
+
+        if(page == NULL || rishka_all_zero(page, RISHKA_VM_PAGE_SIZE))
+            continue;
+
+        uint32_t number = (uint32_t) index;
+        written = rishka_snapshot_write(file, &number, sizeof(number), &checksum) &&
+            rishka_snapshot_write(file, page, RISHKA_VM_PAGE_SIZE, &checksum);
+    }
+
+    uint32_t end = RISHKA_SNAPSHOT_END;
+    written = written && rishka_snapshot_write(file, &end, sizeof(end), &checksum) &&
+        file.write((const uint8_t*) &checksum, sizeof(checksum)) == sizeof(checksum);
+    file.close();
+
+    if(!written || (SD.exists(path) && !SD.remove(path)) || !SD.rename(temporary, path)) {
+        SD.remove(temporary);
+        return false;
+    }
+
+    return true;
+}
+
+bool RishkaVM::loadSnapshot(String path) {
+    if(this->primary != this || !SD.exists(path))
+        return false;
+
+    File file = SD.open(path);
+    if(!file)
+        return false;
+
+    rishka_snapshot_header header;
+    if(file.read((uint8_t*) &header, sizeof(header)) != sizeof(header) ||
+        header.magic != RISHKA_SNAPSHOT_MAGIC ||
+        header.version != RISHKA_SNAPSHOT_VERSION ||
+        header.xlen != RISHKA_VM_XLEN ||
+        header.vlen != RISHKA_VM_VLEN ||
+        header.pageSize != RISHKA_VM_PAGE_SIZE ||
+        !rishka_layout_valid(&header.layout)) {
+        file.close();
+        return false;
+    }
+
+    // A damaged snapshot is refused before the program in the VM is reset.
+    if(!rishka_snapshot_verify(file, &header, sizeof(this->registers) + sizeof(this->fregisters) + sizeof(this->vregisters)) ||
+        !file.seek(sizeof(header))) {
+        file.close();
+        return false;
+    }
+
+    this->reset();
+    this->initialize(this->terminal, this->display, this->nvsStorage, this->workingDirectory, header.layout);
+
+    if(this->guestMemory() == NULL) {
+        file.close();
+        return false;
+    }
+
+    uint32_t checksum = rishka_fnv1a((const uint8_t*) &header, sizeof(header));
+    String directory, program;
+
+    bool valid = rishka_snapshot_read(file, this->registers, sizeof(this->registers), &checksum) &&
+        rishka_snapshot_read(file, this->fregisters, sizeof(this->fregisters), &checksum) &&
+        rishka_snapshot_read(file, this->vregisters, sizeof(this->vregisters), &checksum) &&
+        rishka_snapshot_read_path(file, directory, &checksum) &&
+        rishka_snapshot_read_path(file, program, &checksum);
+
+    // Handles keep their index, which the program refers to them by.
+    for(uint16_t index = 0; valid && index < header.files; index++) {
+        uint8_t flags;
+        uint32_t position;
+        String handlePath;
+
+        valid = rishka_snapshot_read(file, &flags, sizeof(flags), &checksum) &&
+            rishka_snapshot_read(file, &position, sizeof(position), &checksum) &&
+            rishka_snapshot_read_path(file, handlePath, &checksum);
+
+        File handle;
+        if(valid && (flags & RISHKA_SNAPSHOT_FILE_OPEN) != 0 && SD.exists(handlePath)) {
+            if((flags & RISHKA_SNAPSHOT_FILE_DIRECTORY) != 0)
+                handle = SD.open(handlePath);
+            else {
+                handle = SD.open(handlePath, "r+");
+                if(handle)
+                    handle.seek(position);
+            }
+        }
+
+        this->fileHandles.add(handle);
+    }
+
+    for(;;) {
+        uint32_t index;
+
+        valid = valid && rishka_snapshot_read(file, &index, sizeof(index), &checksum);
+        if(!valid || index == RISHKA_SNAPSHOT_END)
+            break;
+
+        valid = index < this->layout.memorySize / RISHKA_VM_PAGE_SIZE;
+        if(!valid)
+            break;
+
+#if RISHKA_VM_PAGED_MEMORY
+        uint8_t* page = this->mapPage((uint64_t) index * RISHKA_VM_PAGE_SIZE, true);
+#else
+        uint8_t* page = &this->memory[(uint64_t) index * RISHKA_VM_PAGE_SIZE];
+        this->markDirty((uint64_t) index * RISHKA_VM_PAGE_SIZE, RISHKA_VM_PAGE_SIZE);
+#endif
+
+        valid = page != NULL && rishka_snapshot_read(file, page, RISHKA_VM_PAGE_SIZE, &checksum);
+    }
+
+    uint32_t stored;
+    valid = valid && file.read((uint8_t*) &stored, sizeof(stored)) == sizeof(stored) && stored == checksum;
+    file.close();
+
+    if(!valid) {
+        this->reset();
+        return false;
+    }
+
+    this->pc = header.pc;
+    this->instret = header.instret;
+    this->imageEnd = header.imageEnd;
+    this->vtype = (rishka_uxlen_t) header.vtype;
+    this->fcsr = header.fcsr;
+    this->vl = header.vl;
+    this->workingDirectory = directory;
+
+    this->invalidateDecodeCache();
+    this->attachProgram(program);
+
+#if RISHKA_VM_HEATMAP
+    this->resetHeatmap();
+#endif
+
+    return true;
+}
+
+static_assert((RISHKA_VM_BLOCK_CACHE_SIZE & (RISHKA_VM_BLOCK_CACHE_SIZE - 1)) == 0,
+    "RISHKA_VM_BLOCK_CACHE_SIZE must be a power of two.");
+
+static_assert((RISHKA_VM_RETURN_STACK_SIZE & (RISHKA_VM_RETURN_STACK_SIZE - 1)) == 0,
+    "RISHKA_VM_RETURN_STACK_SIZE must be a power of two.");
+
+static_assert((RISHKA_VM_JUMP_CACHE_SIZE & (RISHKA_VM_JUMP_CACHE_SIZE - 1)) == 0,
+    "RISHKA_VM_JUMP_CACHE_SIZE must be a power of two.");
+
+static_assert((RISHKA_VM_TLB_SIZE & (RISHKA_VM_TLB_SIZE - 1)) == 0,
+    "RISHKA_VM_TLB_SIZE must be a power of two.");
+
+// Calls and returns are told apart by their use of ra or t0, the link
+// registers of the calling convention.
+static inline bool rishka_is_link(uint8_t reg) {
+    return reg == 1 || reg == 5;
+}
+
+static inline bool rishka_ends_block(uint8_t op) {
+    switch(op) {
+        case RISHKA_DOP_JAL:
+        case RISHKA_DOP_JALR:
+        case RISHKA_DOP_BEQ:
+        case RISHKA_DOP_BNE:
+        case RISHKA_DOP_BLT:
+        case RISHKA_DOP_BGE:
+        case RISHKA_DOP_BLTU:
+        case RISHKA_DOP_BGEU:
+        case RISHKA_DOP_FENCE_I:
+        case RISHKA_DOP_ECALL:
+        case RISHKA_DOP_EBREAK:
+        case RISHKA_DOP_HLE:
+        case RISHKA_DOP_INVALID:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+static const char* const rishka_invalid_messages[] = {
+    "Invalid load instruction.",
+    "Invalid store instruction.",
+    "Invalid immediate shift instruction.",
+    "Invalid immediate instruction.",
+    "Invalid arithmetic instruction.",
+    "Invalid store doubleword instruction.",
+    "Invalid branch instruction.",
+    "Invalid system instruction.",
+    "Invalid compressed instruction.",
+    "Invalid floating-point instruction.",
+    "Invalid vector instruction.",
+    "Invalid or misaligned atomic instruction.",
+    "Invalid opcode instruction."
+};
+
+#if RISHKA_VM_PAGED_MEMORY
+static const char* const rishka_memory_fault = "Memory access out of bounds or out of memory.";
+#endif
+
+static inline uint32_t rishka_encode_i(uint32_t opcode, uint32_t fc3, uint32_t rd, uint32_t rs1, int32_t imm) {
+    return ((((uint32_t) imm &4095) << 20) | (rs1 << 15) | (fc3 << 12) | (rd << 7) | opcode);
+}
+
+static inline uint32_t rishka_encode_r(uint32_t opcode, uint32_t fc3, uint32_t fc7, uint32_t rd, uint32_t rs1, uint32_t rs2) {
+    return ((fc7 << 25) | (rs2 << 20) | (rs1 << 15) | (fc3 << 12) | (rd << 7) | opcode);
+}
+
+static inline uint32_t rishka_encode_s(uint32_t opcode, uint32_t fc3, uint32_t rs1, uint32_t rs2, int32_t imm) {
+    return ((((uint32_t) imm &4064) << 20) | (rs2 << 20) | (rs1 << 15) | (fc3 << 12) |
+        (((uint32_t) imm &31) << 7) | opcode);
+}
+
+static inline uint32_t rishka_encode_b(uint32_t fc3, uint32_t rs1, int32_t imm) {
+    return ((((uint32_t) imm &4096) << 19) | (((uint32_t) imm &2016) << 20) | (rs1 << 15) | (fc3 << 12) |
+        (((uint32_t) imm &30) << 7) | (((uint32_t) imm &2048) >> 4) | RISHKA_OPINST_BRANCH);
+}
+
+static inline uint32_t rishka_encode_j(uint32_t rd, int32_t imm) {
+    return ((((uint32_t) imm &1048576) << 11) | (((uint32_t) imm &2046) << 20) | (((uint32_t) imm &2048) << 9) |
+        ((uint32_t) imm &1044480) | (rd << 7) | RISHKA_OPINST_JAL);
+}
+
+static inline int32_t rishka_compressed_jump_offset(uint32_t inst) {
+    return (((int32_t)((((inst >> 1) &2048) | ((inst >> 7) &16) | ((inst >> 1) &768) | ((inst << 2) &1024) |
+        ((inst >> 1) &64) | ((inst << 1) &128) | ((inst >> 2) &14) | ((inst << 3) &32)) << 20)) >> 20);
+}
+
+uint32_t RishkaVM::expandCompressed(uint16_t inst) {
+    uint32_t rd = ((inst >> 7) &31);
+    uint32_t rs2 = ((inst >> 2) &31);
+    uint32_t rdc = (((inst >> 2) &7) + 8);
+    uint32_t rs1c = (((inst >> 7) &7) + 8);
+    uint32_t shamt = (((inst >> 7) &32) | ((inst >> 2) &31));
+    int32_t immediate = (((int32_t)(shamt << 26)) >> 26);
+    uint32_t offset;
+
+    switch((((inst &3) << 3) | ((inst >> 13) &7))) {
+        case RISHKA_C_ADDI4SPN:
+            offset = (((inst >> 7) &48) | ((inst >> 1) &960) | ((inst >> 4) &4) | ((inst >> 2) &8));
+            if(offset == 0)
+                return 0;
+            return rishka_encode_i(RISHKA_OPINST_IMM, RISHKA_FC3_ADDI, rdc, 2, offset);
+
+        case RISHKA_C_LW:
+            return rishka_encode_i(RISHKA_OPINST_LOAD, RISHKA_FC3_LW, rdc, rs1c,
+                ((inst >> 7) &56) | ((inst >> 4) &4) | ((inst << 1) &64));
+
+        case RISHKA_C_SW:
+            return rishka_encode_s(RISHKA_OPINST_STORE, RISHKA_FC3_SW, rs1c, rdc,
+                ((inst >> 7) &56) | ((inst >> 4) &4) | ((inst << 1) &64));
+
+        case RISHKA_C_FLD:
+            return rishka_encode_i(RISHKA_OPINST_FLOAD, RISHKA_FC3_LDW, rdc, rs1c,
+                ((inst >> 7) &56) | ((inst << 1) &192));
+
+        case RISHKA_C_FSD:
+            return rishka_encode_s(RISHKA_OPINST_FSTORE, RISHKA_FC3_SDW, rs1c, rdc,
+                ((inst >> 7) &56) | ((inst << 1) &192));
+
+#if RISHKA_VM_XLEN == 64
+        case RISHKA_C_LD:
+            return rishka_encode_i(RISHKA_OPINST_LOAD, RISHKA_FC3_LDW, rdc, rs1c,
+                ((inst >> 7) &56) | ((inst << 1) &192));
+
+        case RISHKA_C_SD:
+            return rishka_encode_s(RISHKA_OPINST_STORE, RISHKA_FC3_SDW, rs1c, rdc,
+                ((inst >> 7) &56) | ((inst << 1) &192));
+#else
+        case RISHKA_C_LD:
+            return rishka_encode_i(RISHKA_OPINST_FLOAD, RISHKA_FC3_LW, rdc, rs1c,
+                ((inst >> 7) &56) | ((inst >> 4) &4) | ((inst << 1) &64));
+
+        case RISHKA_C_SD:
+            return rishka_encode_s(RISHKA_OPINST_FSTORE, RISHKA_FC3_SW, rs1c, rdc,
+                ((inst >> 7) &56) | ((inst >> 4) &4) | ((inst << 1) &64));
+#endif
+
+        case RISHKA_C_ADDI:
+            return rishka_encode_i(RISHKA_OPINST_IMM, RISHKA_FC3_ADDI, rd, rd, immediate);
+
+        case RISHKA_C_ADDIW:
+#if RISHKA_VM_XLEN == 64
+            if(rd == 0)
+                return 0;
+            return rishka_encode_i(RISHKA_OPINST_IALU, 0, rd, rd, immediate);
+#else
+            return rishka_encode_j(1, rishka_compressed_jump_offset(inst));
+#endif
+
+        case RISHKA_C_LI:
+            return rishka_encode_i(RISHKA_OPINST_IMM, RISHKA_FC3_ADDI, rd, 0, immediate);
+
+        case RISHKA_C_LUI:
+            if(rd == 2) {
+                offset = (((inst >> 3) &512) | ((inst >> 2) &16) | ((inst << 1) &64) |
+                    ((inst << 4) &384) | ((inst << 3) &32));
+                if(offset == 0)
+                    return 0;
+
+                return rishka_encode_i(RISHKA_OPINST_IMM, RISHKA_FC3_ADDI, 2, 2,
+                    ((int32_t)(offset << 22)) >> 22);
+            }
+
+            if(immediate == 0)
+                return 0;
+            return ((((uint32_t) immediate << 12) &4294963200U) | (rd << 7) | RISHKA_OPINST_LUI);
+
+        case RISHKA_C_MISC_ALU:
+            switch((inst >> 10) &3) {
+                case 0: return rishka_encode_i(RISHKA_OPINST_IMM, RISHKA_FC3_SRLI, rs1c, rs1c, shamt);
+                case 1: return rishka_encode_i(RISHKA_OPINST_IMM, RISHKA_FC3_SRLI, rs1c, rs1c, shamt | 1024);
+                case 2: return rishka_encode_i(RISHKA_OPINST_IMM, RISHKA_FC3_ANDI, rs1c, rs1c, immediate);
+                default: break;
+            }
+
+            switch((((inst >> 10) &4) | ((inst >> 5) &3))) {
+                case 0: return rishka_encode_r(RISHKA_OPINST_RT64, 0, 32, rs1c, rs1c, rdc);
+                case 1: return rishka_encode_r(RISHKA_OPINST_RT64, 4, 0, rs1c, rs1c, rdc);
+                case 2: return rishka_encode_r(RISHKA_OPINST_RT64, 6, 0, rs1c, rs1c, rdc);
+                case 3: return rishka_encode_r(RISHKA_OPINST_RT64, 7, 0, rs1c, rs1c, rdc);
+#if RISHKA_VM_XLEN == 64
+                case 4: return rishka_encode_r(RISHKA_OPINST_RT32, 0, 32, rs1c, rs1c, rdc);
+                case 5: return rishka_encode_r(RISHKA_OPINST_RT32, 0, 0, rs1c, rs1c, rdc);
+#endif
+                default: return 0;
+            }
+
+        case RISHKA_C_J:
+            return rishka_encode_j(0, rishka_compressed_jump_offset(inst));
+
+        case RISHKA_C_BEQZ:
+        case RISHKA_C_BNEZ:
+            return rishka_encode_b((inst >> 13) == 6 ? RISHKA_FC3_BEQ : RISHKA_FC3_BNE, rs1c,
+                ((int32_t)((((inst >> 4) &256) | ((inst >> 7) &24) | ((inst << 1) &192) |
+                ((inst >> 2) &6) | ((inst << 3) &32)) << 23)) >> 23);
+
+        case RISHKA_C_SLLI:
+            return rishka_encode_i(RISHKA_OPINST_IMM, RISHKA_FC3_SLLI, rd, rd, shamt);
+
+        case RISHKA_C_LWSP:
+            if(rd == 0)
+                return 0;
+            return rishka_encode_i(RISHKA_OPINST_LOAD, RISHKA_FC3_LW, rd, 2,
+                ((inst >> 7) &32) | ((inst >> 2) &28) | ((inst << 4) &192));
+
+        case RISHKA_C_SWSP:
+            return rishka_encode_s(RISHKA_OPINST_STORE, RISHKA_FC3_SW, 2, rs2,
+                ((inst >> 7) &60) | ((inst >> 1) &192));
+
+        case RISHKA_C_FLDSP:
+            return rishka_encode_i(RISHKA_OPINST_FLOAD, RISHKA_FC3_LDW, rd, 2,
+                ((inst >> 7) &32) | ((inst >> 2) &24) | ((inst << 4) &448));
+
+        case RISHKA_C_FSDSP:
+            return rishka_encode_s(RISHKA_OPINST_FSTORE, RISHKA_FC3_SDW, 2, rs2,
+                ((inst >> 7) &56) | ((inst >> 1) &448));
+
+#if RISHKA_VM_XLEN == 64
+        case RISHKA_C_LDSP:
+            if(rd == 0)
+                return 0;
+            return rishka_encode_i(RISHKA_OPINST_LOAD, RISHKA_FC3_LDW, rd, 2,
+                ((inst >> 7) &32) | ((inst >> 2) &24) | ((inst << 4) &448));
+
+        case RISHKA_C_SDSP:
+            return rishka_encode_s(RISHKA_OPINST_STORE, RISHKA_FC3_SDW, 2, rs2,
+                ((inst >> 7) &56) | ((inst >> 1) &448));
+#else
+        case RISHKA_C_LDSP:
+            return rishka_encode_i(RISHKA_OPINST_FLOAD, RISHKA_FC3_LW, rd, 2,
+                ((inst >> 7) &32) | ((inst >> 2) &28) | ((inst << 4) &192));
+
+        case RISHKA_C_SDSP:
+            return rishka_encode_s(RISHKA_OPINST_FSTORE, RISHKA_FC3_SW, 2, rs2,
+                ((inst >> 7) &60) | ((inst >> 1) &192));
+#endif
+
+        case RISHKA_C_JR_MV:
+            if(((inst >> 12) &1) == 0) {
+                if(rs2 != 0)
+                    return rishka_encode_r(RISHKA_OPINST_RT64, 0, 0, rd, 0, rs2);
+                else if(rd == 0)
+                    return 0;
+                return rishka_encode_i(RISHKA_OPINST_JALR, 0, 0, rd, 0);
+            }
+
+            if(rs2 != 0)
+                return rishka_encode_r(RISHKA_OPINST_RT64, 0, 0, rd, rd, rs2);
+            else if(rd == 0)
+                return rishka_encode_i(RISHKA_OPINST_CALL, 0, 0, 0, 1);
+            return rishka_encode_i(RISHKA_OPINST_JALR, 0, 1, rd, 0);
+
+        default:
+            return 0;
+    }
+}
+
+void RishkaVM::decode(uint32_t inst, rishka_decoded_inst* decoded) {
+    if((inst &3) != 3) {
+        uint32_t expanded = RishkaVM::expandCompressed((uint16_t) inst);
+
+        if(expanded != 0)
+            RishkaVM::decode(expanded, decoded);
+        else {
+            decoded->op = RISHKA_DOP_INVALID;
+            decoded->rd = decoded->rs1 = decoded->rs2 = 0;
+            decoded->imm = RISHKA_INVALID_COMPRESSED;
+        }
+
+        decoded->length = 1;
+        return;
+    }
+
+    uint32_t opcode = ((inst >> 0) &127);
+    uint32_t function_code_3 = ((inst >> 12) &7);
+    int32_t immediate = (((int32_t)((uint32_t)((inst >> 20) &4095) << 20)) >> 20);
+    bool writesRegister = true;
+
+    decoded->op = RISHKA_DOP_INVALID;
+    decoded->rd = ((inst >> 7) &31);
+    decoded->rs1 = ((inst >> 15) &31);
+    decoded->rs2 = ((inst >> 20) &31);
+    decoded->length = 2;
+    decoded->imm = immediate;
+
+    switch(opcode) {
+        case RISHKA_OPINST_LOAD:
+            switch(function_code_3) {
+                case RISHKA_FC3_LB:     decoded->op = RISHKA_DOP_LB; break;
+                case RISHKA_FC3_LHW:    decoded->op = RISHKA_DOP_LHW; break;
+                case RISHKA_FC3_LW:     decoded->op = RISHKA_DOP_LW; break;
+                case RISHKA_FC3_LBU:    decoded->op = RISHKA_DOP_LBU; break;
+                case RISHKA_FC3_LHU:    decoded->op = RISHKA_DOP_LHU; break;
+#if RISHKA_VM_XLEN == 64
+                case RISHKA_FC3_LDW:    decoded->op = RISHKA_DOP_LDW; break;
+                case RISHKA_FC3_LRES:   decoded->op = RISHKA_DOP_LRES; break;
+#endif
+                default:                decoded->imm = RISHKA_INVALID_LOAD; break;
+            }
+            break;
+
+        case RISHKA_OPINST_STORE:
+            writesRegister = false;
+            decoded->imm = (((int32_t)((uint32_t)(((inst >> 20) &4064) | ((inst >> 7) &31)) << 20)) >> 20);
+
+            switch(function_code_3) {
+                case RISHKA_FC3_SB:     decoded->op = RISHKA_DOP_SB; break;
+                case RISHKA_FC3_SHW:    decoded->op = RISHKA_DOP_SHW; break;
+                case RISHKA_FC3_SW:     decoded->op = RISHKA_DOP_SW; break;
+#if RISHKA_VM_XLEN == 64
+                case RISHKA_FC3_SDW:    decoded->op = RISHKA_DOP_SDW; break;
+#endif
+                default:                decoded->imm = RISHKA_INVALID_STORE; break;
+            }
+            break;
+
+        case RISHKA_OPINST_IMM:
+            switch(function_code_3) {
+                case RISHKA_FC3_ADDI:   decoded->op = RISHKA_DOP_ADDI; break;
+                case RISHKA_FC3_SLTI:   decoded->op = RISHKA_DOP_SLTI; break;
+                case RISHKA_FC3_SLTIU:  decoded->op = RISHKA_DOP_SLTIU; break;
+                case RISHKA_FC3_XORI:   decoded->op = RISHKA_DOP_XORI; break;
+                case RISHKA_FC3_ORI:    decoded->op = RISHKA_DOP_ORI; break;
+                case RISHKA_FC3_ANDI:   decoded->op = RISHKA_DOP_ANDI; break;
+
+                case RISHKA_FC3_SLLI:
+                    switch((inst >> 20) &4095) {
+                        case 0x600: decoded->op = RISHKA_DOP_CLZ; break;
+                        case 0x601: decoded->op = RISHKA_DOP_CTZ; break;
+                        case 0x602: decoded->op = RISHKA_DOP_CPOP; break;
+                        case 0x604: decoded->op = RISHKA_DOP_SEXT_B; break;
+                        case 0x605: decoded->op = RISHKA_DOP_SEXT_H; break;
+
+                        default:
+                            switch((inst >> 26) &63) {
+                                case 0x12:  decoded->op = RISHKA_DOP_BCLRI; break;
+                                case 0x1a:  decoded->op = RISHKA_DOP_BINVI; break;
+                                case 0x0a:  decoded->op = RISHKA_DOP_BSETI; break;
+                                default:    decoded->op = RISHKA_DOP_SLLI; break;
+                            }
+
+                            decoded->imm = ((inst >> 20) &(RISHKA_VM_XLEN - 1));
+                            break;
+                    }
+                    break;
+
+                case RISHKA_FC3_SRLI:
+                    switch((inst >> 20) &4095) {
+                        case 0x287: decoded->op = RISHKA_DOP_ORC_B; break;
+#if RISHKA_VM_XLEN == 64
+                        case 0x6b8: decoded->op = RISHKA_DOP_REV8; break;
+#else
+                        case 0x698: decoded->op = RISHKA_DOP_REV8; break;
+#endif
+
+                        default:
+                            switch((inst >> 26) &63) {
+                                case 0x18:  decoded->op = RISHKA_DOP_RORI; break;
+                                case 0x12:  decoded->op = RISHKA_DOP_BEXTI; break;
+
+                                default:
+                                    switch(((inst >> 26) &63) >> 4) {
+                                        case 0x0: decoded->op = RISHKA_DOP_SRLI; break;
+                                        case 0x1: decoded->op = RISHKA_DOP_SRAI; break;
+                                    }
+                                    break;
+                            }
+
+                            decoded->imm = decoded->op == RISHKA_DOP_INVALID ?
+                                (int32_t) RISHKA_INVALID_IMM_SHIFT : ((inst >> 20) &(RISHKA_VM_XLEN - 1));
+                            break;
+                    }
+                    break;
+            }
+            break;
+
+#if RISHKA_VM_XLEN == 64
+        case RISHKA_OPINST_IALU:
+            switch(function_code_3) {
+                case RISHKA_FC3_SLLIW:
+                    decoded->op = RISHKA_DOP_ADDI;
+                    break;
+
+                case RISHKA_FC3_SRLIW:
+                    switch((inst >> 20) &4095) {
+                        case 0x600: decoded->op = RISHKA_DOP_CLZW; break;
+                        case 0x601: decoded->op = RISHKA_DOP_CTZW; break;
+                        case 0x602: decoded->op = RISHKA_DOP_CPOPW; break;
+
+                        default:
+                            if(((inst >> 26) &63) == 0x02) {
+                                decoded->op = RISHKA_DOP_SLLI_UW;
+                                decoded->imm = ((inst >> 20) &63);
+                            }
+                            else decoded->op = RISHKA_DOP_SLLI;
+                            break;
+                    }
+                    break;
+
+                case RISHKA_FC3_SRAIW:
+                    switch(((inst >> 25) &127) >> 5) {
+                        case 0x0: decoded->op = RISHKA_DOP_SRLI; break;
+                        case 0x1: decoded->op = RISHKA_DOP_SRAI; break;
+                    }
+
+                    decoded->imm = decoded->op == RISHKA_DOP_INVALID ?
+                        (int32_t) RISHKA_INVALID_IMM_SHIFT : decoded->rs2;
+                    break;
+
+                case RISHKA_FC3_SLLI64:
+                    decoded->op = RISHKA_DOP_SLLI;
+                    decoded->imm = immediate & 0x3F;
+                    break;
+
+                case RISHKA_FC3_SRLI64:
+                    decoded->op = RISHKA_DOP_SRLI;
+                    decoded->imm = immediate & 0x3F;
+                    break;
+
+                case RISHKA_FC3_SRAI64:
+                    if(((inst >> 25) &127) == 0x30) {
+                        decoded->op = RISHKA_DOP_RORIW;
+                        decoded->imm = decoded->rs2;
+                    }
+                    else {
+                        decoded->op = RISHKA_DOP_SRAI;
+                        decoded->imm = immediate & 0x3F;
+                    }
+                    break;
+
+                default:
+                    decoded->imm = RISHKA_INVALID_IMM;
+                    break;
+            }
+            break;
+#endif
+
+        case RISHKA_OPINST_RT64:
+            switch(((((inst >> 25) &127) << 3) | function_code_3)) {
+                case 0x0:   decoded->op = RISHKA_DOP_ADD; break;
+                case 0x100: decoded->op = RISHKA_DOP_SUB; break;
+                case 0x1:   decoded->op = RISHKA_DOP_SLL; break;
+                case 0x2:   decoded->op = RISHKA_DOP_SLT; break;
+                case 0x3:   decoded->op = RISHKA_DOP_SLTU; break;
+                case 0x4:   decoded->op = RISHKA_DOP_XOR; break;
+                case 0x5:   decoded->op = RISHKA_DOP_SRL; break;
+                case 0x105: decoded->op = RISHKA_DOP_SRA; break;
+                case 0x6:   decoded->op = RISHKA_DOP_OR; break;
+                case 0x7:   decoded->op = RISHKA_DOP_AND; break;
+                case 0x8:   decoded->op = RISHKA_DOP_MUL; break;
+                case 0x9:   decoded->op = RISHKA_DOP_MULH; break;
+                case 0xa:   decoded->op = RISHKA_DOP_MULHSU; break;
+                case 0xb:   decoded->op = RISHKA_DOP_MULHU; break;
+                case 0xc:   decoded->op = RISHKA_DOP_DIV; break;
+                case 0xd:   decoded->op = RISHKA_DOP_DIVU; break;
+                case 0xe:   decoded->op = RISHKA_DOP_REM; break;
+                case 0xf:   decoded->op = RISHKA_DOP_REMU; break;
+                case 0x82:  decoded->op = RISHKA_DOP_SH1ADD; break;
+                case 0x84:  decoded->op = RISHKA_DOP_SH2ADD; break;
+                case 0x86:  decoded->op = RISHKA_DOP_SH3ADD; break;
+                case 0x107: decoded->op = RISHKA_DOP_ANDN; break;
+                case 0x106: decoded->op = RISHKA_DOP_ORN; break;
+                case 0x104: decoded->op = RISHKA_DOP_XNOR; break;
+                case 0x2c:  decoded->op = RISHKA_DOP_MIN; break;
+                case 0x2d:  decoded->op = RISHKA_DOP_MINU; break;
+                case 0x2e:  decoded->op = RISHKA_DOP_MAX; break;
+                case 0x2f:  decoded->op = RISHKA_DOP_MAXU; break;
+                case 0x181: decoded->op = RISHKA_DOP_ROL; break;
+                case 0x185: decoded->op = RISHKA_DOP_ROR; break;
+                case 0x121: decoded->op = RISHKA_DOP_BCLR; break;
+                case 0x125: decoded->op = RISHKA_DOP_BEXT; break;
+                case 0x1a1: decoded->op = RISHKA_DOP_BINV; break;
+                case 0xa1:  decoded->op = RISHKA_DOP_BSET; break;
+#if RISHKA_VM_XLEN == 32
+                case 0x24:
+                    if(decoded->rs2 == 0)
+                        decoded->op = RISHKA_DOP_ZEXT_H;
+                    else decoded->imm = RISHKA_INVALID_ARITH;
+                    break;
+#endif
+                default:    decoded->imm = RISHKA_INVALID_ARITH; break;
+            }
+            break;
+
+#if RISHKA_VM_XLEN == 64
+        case RISHKA_OPINST_RT32:
+            switch(((((inst >> 25) &127) << 3) | function_code_3)) {
+                case 0x0:   decoded->op = RISHKA_DOP_ADD; break;
+                case 0x100: decoded->op = RISHKA_DOP_SUB; break;
+                case 0x1:   decoded->op = RISHKA_DOP_SLL; break;
+                case 0x5:   decoded->op = RISHKA_DOP_SRL; break;
+                case 0x105: decoded->op = RISHKA_DOP_SRA; break;
+                case 0x8:   decoded->op = RISHKA_DOP_MULW; break;
+                case 0xc:   decoded->op = RISHKA_DOP_DIVW; break;
+                case 0xd:   decoded->op = RISHKA_DOP_DIVUW; break;
+                case 0xe:   decoded->op = RISHKA_DOP_REMW; break;
+                case 0xf:   decoded->op = RISHKA_DOP_REMUW; break;
+                case 0x20:  decoded->op = RISHKA_DOP_ADD_UW; break;
+                case 0x82:  decoded->op = RISHKA_DOP_SH1ADD_UW; break;
+                case 0x84:  decoded->op = RISHKA_DOP_SH2ADD_UW; break;
+                case 0x86:  decoded->op = RISHKA_DOP_SH3ADD_UW; break;
+                case 0x181: decoded->op = RISHKA_DOP_ROLW; break;
+                case 0x185: decoded->op = RISHKA_DOP_RORW; break;
+
+                case 0x24:
+                    if(decoded->rs2 == 0)
+                        decoded->op = RISHKA_DOP_ZEXT_H;
+                    else decoded->imm = RISHKA_INVALID_ARITH32;
+                    break;
+
+                default:    decoded->imm = RISHKA_INVALID_ARITH32; break;
+            }
+            break;
+#endif
+
+        case RISHKA_OPINST_LUI:
+            decoded->op = RISHKA_DOP_LUI;
+            decoded->imm = (int32_t)((uint32_t)((inst << 0) &4294963200LL));
+            break;
+
+        case RISHKA_OPINST_AUIPC:
+            decoded->op = RISHKA_DOP_AUIPC;
+            decoded->imm = (int32_t)((uint32_t)((inst << 0) &4294963200LL));
+            break;
+
+        case RISHKA_OPINST_JAL:
+            writesRegister = false;
+            decoded->op = RISHKA_DOP_JAL;
+            decoded->imm = (((int32_t)((uint32_t)(((((inst >> 11) &1048576) | ((inst >> 20) &2046)) | ((inst >> 9) &2048)) | ((inst << 0) &1044480)) << 11)) >> 11);
+            break;
+
+        case RISHKA_OPINST_JALR:
+            writesRegister = false;
+            decoded->op = RISHKA_DOP_JALR;
+            break;
+
+        case RISHKA_OPINST_BRANCH:
+            writesRegister = false;
+            decoded->imm = (((int32_t)((uint32_t)(((((inst >> 19) &4096) | ((inst >> 20) &2016)) | ((inst >> 7) &30)) | ((inst << 4) &2048)) << 19)) >> 19);
+
+            switch(function_code_3) {
+                case RISHKA_FC3_BEQ:    decoded->op = RISHKA_DOP_BEQ; break;
+                case RISHKA_FC3_BNE:    decoded->op = RISHKA_DOP_BNE; break;
+                case RISHKA_FC3_BLT:    decoded->op = RISHKA_DOP_BLT; break;
+                case RISHKA_FC3_BGE:    decoded->op = RISHKA_DOP_BGE; break;
+                case RISHKA_FC3_BLTU:   decoded->op = RISHKA_DOP_BLTU; break;
+                case RISHKA_FC3_BGEU:   decoded->op = RISHKA_DOP_BGEU; break;
+                default:                decoded->imm = RISHKA_INVALID_BRANCH; break;
+            }
+            break;
+
+        case RISHKA_OPINST_FENCE:
+            writesRegister = false;
+            decoded->op = function_code_3 == 0x1 ?
+                RISHKA_DOP_FENCE_I : RISHKA_DOP_FENCE;
+            break;
+
+        case RISHKA_OPINST_AMO: {
+            uint32_t function_code_5 = ((inst >> 27) &31);
+
+            writesRegister = false;
+            decoded->imm = (int32_t) function_code_5;
+
+            switch(function_code_5) {
+                case RISHKA_AMO5_LR:
+                    if(decoded->rs2 == 0)
+                        decoded->op = RISHKA_DOP_LR_W;
+                    break;
+
+                case RISHKA_AMO5_SC:
+                    decoded->op = RISHKA_DOP_SC_W;
+                    break;
+
+                case RISHKA_AMO5_ADD:
+                case RISHKA_AMO5_SWAP:
+                case RISHKA_AMO5_XOR:
+                case RISHKA_AMO5_OR:
+                case RISHKA_AMO5_AND:
+                case RISHKA_AMO5_MIN:
+                case RISHKA_AMO5_MAX:
+                case RISHKA_AMO5_MINU:
+                case RISHKA_AMO5_MAXU:
+                    decoded->op = RISHKA_DOP_AMO_W;
+                    break;
+            }
+
+            // The double-word forms follow the word forms in rishka_decoded_op.
+            if(function_code_3 == 3 && RISHKA_VM_XLEN == 64 && decoded->op != RISHKA_DOP_INVALID)
+                decoded->op += (RISHKA_DOP_LR_D - RISHKA_DOP_LR_W);
+            else if(function_code_3 != 2)
+                decoded->op = RISHKA_DOP_INVALID;
+
+            if(decoded->op == RISHKA_DOP_INVALID)
+                decoded->imm = RISHKA_INVALID_ATOMIC;
+            break;
+        }
+
+        case RISHKA_OPINST_CALL:
+            writesRegister = false;
+            decoded->imm = ((inst >> 20) &4095);
+
+            if(function_code_3 == RISHKA_FC3_PRIV) {
+                switch(decoded->imm) {
+                    case 0x0:   decoded->op = RISHKA_DOP_ECALL; break;
+                    case 0x1:   decoded->op = RISHKA_DOP_EBREAK; break;
+                    default:    decoded->imm = RISHKA_INVALID_SYSTEM; break;
+                }
+                break;
+            }
+
+            switch(decoded->imm) {
+                case RISHKA_CSR_FFLAGS:
+                case RISHKA_CSR_FRM:
+                case RISHKA_CSR_FCSR:
+                case RISHKA_CSR_VSTART:
+                case RISHKA_CSR_CYCLE:
+                case RISHKA_CSR_TIME:
+                case RISHKA_CSR_INSTRET:
+                case RISHKA_CSR_VL:
+                case RISHKA_CSR_VTYPE:
+                case RISHKA_CSR_VLENB:
+#if RISHKA_VM_XLEN == 32
+                case RISHKA_CSR_CYCLEH:
+                case RISHKA_CSR_TIMEH:
+                case RISHKA_CSR_INSTRETH:
+#endif
+                case RISHKA_CSR_MHARTID:
+                    break;
+
+                default:
+                    decoded->imm = RISHKA_INVALID_SYSTEM;
+                    return;
+            }
+
+            // CSRs numbered 0xc00 and up are read-only, so only csrrs and
+            // csrrc with a zero mask may access them.
+            if((decoded->imm >> 10) == 3 && (decoded->rs1 != 0 ||
+                function_code_3 == RISHKA_FC3_CSRRW || function_code_3 == RISHKA_FC3_CSRRWI)) {
+                decoded->imm = RISHKA_INVALID_SYSTEM;
+                return;
+            }
+
+            switch(function_code_3) {
+                case RISHKA_FC3_CSRRW:  decoded->op = RISHKA_DOP_CSRRW; break;
+                case RISHKA_FC3_CSRRS:  decoded->op = RISHKA_DOP_CSRRS; break;
+                case RISHKA_FC3_CSRRC:  decoded->op = RISHKA_DOP_CSRRC; break;
+                case RISHKA_FC3_CSRRWI: decoded->op = RISHKA_DOP_CSRRWI; break;
+                case RISHKA_FC3_CSRRSI: decoded->op = RISHKA_DOP_CSRRSI; break;
+                case RISHKA_FC3_CSRRCI: decoded->op = RISHKA_DOP_CSRRCI; break;
+                default:                decoded->imm = RISHKA_INVALID_SYSTEM; break;
+            }
+            break;
+
+        case RISHKA_OPINST_FLOAD:
+            writesRegister = false;
+            switch(function_code_3) {
+                case RISHKA_FC3_LW:     decoded->op = RISHKA_DOP_FLW; break;
+                case RISHKA_FC3_LDW:    decoded->op = RISHKA_DOP_FLD; break;
+
+                case RISHKA_FC3_VE8:
+                case RISHKA_FC3_VE16:
+                case RISHKA_FC3_VE32:
+                case RISHKA_FC3_VE64:
+                    RishkaVM::decodeVector(inst, decoded);
+                    return;
+
+                default:                decoded->imm = RISHKA_INVALID_FLOAT; break;
+            }
+            break;
+
+        case RISHKA_OPINST_FSTORE:
+            writesRegister = false;
+            decoded->imm = (((int32_t)((uint32_t)(((inst >> 20) &4064) | ((inst >> 7) &31)) << 20)) >> 20);
+
+            switch(function_code_3) {
+                case RISHKA_FC3_SW:     decoded->op = RISHKA_DOP_FSW; break;
+                case RISHKA_FC3_SDW:    decoded->op = RISHKA_DOP_FSD; break;
+
+                case RISHKA_FC3_VE8:
+                case RISHKA_FC3_VE16:
+                case RISHKA_FC3_VE32:
+                case RISHKA_FC3_VE64:
+                    RishkaVM::decodeVector(inst, decoded);
+                    return;
+
+                default:                decoded->imm = RISHKA_INVALID_FLOAT; break;
+            }
+            break;
+
+        case RISHKA_OPINST_FMADD:
+        case RISHKA_OPINST_FMSUB:
+        case RISHKA_OPINST_FNMSUB:
+        case RISHKA_OPINST_FNMADD:
+        case RISHKA_OPINST_FP:
+            RishkaVM::decodeFloat(inst, decoded);
+            return;
+
+        case RISHKA_OPINST_VECTOR:
+            RishkaVM::decodeVector(inst, decoded);
+            return;
+
+        default:
+            decoded->imm = RISHKA_INVALID_OPCODE;
+            break;
+    }
+
+    if(writesRegister && decoded->rd == 0 && decoded->op != RISHKA_DOP_INVALID)
+        decoded->op = RISHKA_DOP_NOP;
+}
+
+void RishkaVM::decodeFloat(uint32_t inst, rishka_decoded_inst* decoded) {
+    uint32_t opcode = ((inst >> 0) &127);
+    uint32_t format = ((inst >> 25) &3);
+    uint32_t rounding = ((inst >> 12) &7);
+    uint8_t precision = format == 1 ? (RISHKA_DOP_FMADD_D - RISHKA_DOP_FMADD_S) : 0;
+    bool writesRegister = false;
+
+    decoded->op = RISHKA_DOP_INVALID;
+    decoded->imm = rounding;
+
+    if(format > 1 || rounding == 5 || rounding == 6) {
+        decoded->imm = RISHKA_INVALID_FLOAT;
+        return;
+    }
+
+    if(opcode != RISHKA_OPINST_FP) {
+        decoded->op = RISHKA_DOP_FMADD_S + precision + ((opcode - RISHKA_OPINST_FMADD) >> 2);
+        decoded->imm = ((inst >> 27) | (rounding << 5));
+        return;
+    }
+
+    switch((inst >> 27)) {
+        case RISHKA_FP5_FADD:   decoded->op = RISHKA_DOP_FADD_S + precision; break;
+        case RISHKA_FP5_FSUB:   decoded->op = RISHKA_DOP_FSUB_S + precision; break;
+        case RISHKA_FP5_FMUL:   decoded->op = RISHKA_DOP_FMUL_S + precision; break;
+        case RISHKA_FP5_FDIV:   decoded->op = RISHKA_DOP_FDIV_S + precision; break;
+
+        case RISHKA_FP5_FSQRT:
+            if(decoded->rs2 == 0)
+                decoded->op = RISHKA_DOP_FSQRT_S + precision;
+            break;
+
+        case RISHKA_FP5_FSGNJ:
+            if(rounding <= 2)
+                decoded->op = RISHKA_DOP_FSGNJ_S + precision + rounding;
+            break;
+
+        case RISHKA_FP5_FMINMAX:
+            if(rounding <= 1)
+                decoded->op = RISHKA_DOP_FMIN_S + precision + rounding;
+            break;
+
+        case RISHKA_FP5_FCVT_FF:
+            if(format == 0 && decoded->rs2 == 1)
+                decoded->op = RISHKA_DOP_FCVT_S_D;
+            else if(format == 1 && decoded->rs2 == 0)
+                decoded->op = RISHKA_DOP_FCVT_D_S;
+            break;
+
+        case RISHKA_FP5_FCMP:
+            if(rounding <= 2)
+                decoded->op = RISHKA_DOP_FEQ_S + precision + (2 - rounding);
+            break;
+
+        case RISHKA_FP5_FCVT_XF:
+            if(decoded->rs2 < (RISHKA_VM_XLEN == 64 ? 4 : 2))
+                decoded->op = RISHKA_DOP_FCVT_W_S + precision + decoded->rs2;
+            break;
+
+        case RISHKA_FP5_FCVT_FX:
+            if(decoded->rs2 < (RISHKA_VM_XLEN == 64 ? 4 : 2))
+                decoded->op = RISHKA_DOP_FCVT_S_W + precision + decoded->rs2;
+            break;
+
+        case RISHKA_FP5_FMV_XF:
+            writesRegister = true;
+            if(decoded->rs2 == 0 && rounding == 0 && (format == 0 || RISHKA_VM_XLEN == 64))
+                decoded->op = RISHKA_DOP_FMV_X_W + precision;
+            else if(decoded->rs2 == 0 && rounding == 1)
+                decoded->op = RISHKA_DOP_FCLASS_S + precision;
+            break;
+
+        case RISHKA_FP5_FMV_FX:
+            if(decoded->rs2 == 0 && rounding == 0 && (format == 0 || RISHKA_VM_XLEN == 64))
+                decoded->op = RISHKA_DOP_FMV_W_X + precision;
+            break;
+    }
+
+    if(decoded->op == RISHKA_DOP_INVALID)
+        decoded->imm = RISHKA_INVALID_FLOAT;
+    else if(writesRegister && decoded->rd == 0)
+        decoded->op = RISHKA_DOP_NOP;
+}
+
+void RishkaVM::decodeVector(uint32_t inst, rishka_decoded_inst* decoded) {
+    uint32_t opcode = ((inst >> 0) &127);
+    uint32_t function_code_3 = ((inst >> 12) &7);
+    uint32_t function_code_6 = ((inst >> 26) &63);
+    uint32_t vm = ((inst >> 25) &1);
+
+    decoded->op = RISHKA_DOP_INVALID;
+    decoded->imm = RISHKA_INVALID_VECTOR;
+
+    // Only unit-stride loads and stores of single fields are supported,
+    // so nf, mew, mop and lumop (in the rs2 field) must all be zero.
+    if(opcode != RISHKA_OPINST_VECTOR) {
+        if(function_code_6 != 0 || decoded->rs2 != 0)
+            return;
+
+        decoded->op = opcode == RISHKA_OPINST_FLOAD ? RISHKA_DOP_VLE : RISHKA_DOP_VSE;
+        decoded->imm = (vm | ((function_code_3 == RISHKA_FC3_VE8 ? 0 : function_code_3 - 4) << 1));
+        return;
+    }
+
+    if(function_code_3 == RISHKA_FC3_OPCFG) {
+        if((inst >> 31) == 0) {
+            decoded->op = RISHKA_DOP_VSETVLI;
+            decoded->imm = ((inst >> 20) &2047);
+        }
+        else if((inst >> 30) == 3) {
+            decoded->op = RISHKA_DOP_VSETIVLI;
+            decoded->imm = ((inst >> 20) &1023);
+        }
+        else if(((inst >> 25) &127) == 0x40) {
+            decoded->op = RISHKA_DOP_VSETVL;
+            decoded->imm = 0;
+        }
+        return;
+    }
+
+    bool vector = (function_code_3 == RISHKA_FC3_OPIVV || function_code_3 == RISHKA_FC3_OPMVV);
+    bool immediate = (function_code_3 == RISHKA_FC3_OPIVI);
+    uint8_t op = RISHKA_DOP_INVALID, kernel = 0;
+
+    switch(function_code_3) {
+        case RISHKA_FC3_OPIVV:
+        case RISHKA_FC3_OPIVX:
+        case RISHKA_FC3_OPIVI:
+            switch(function_code_6) {
+                case RISHKA_VF6_VADD:   op = RISHKA_DOP_VALU; kernel = RISHKA_VOP_ADD; break;
+                case RISHKA_VF6_VAND:   op = RISHKA_DOP_VALU; kernel = RISHKA_VOP_AND; break;
+                case RISHKA_VF6_VOR:    op = RISHKA_DOP_VALU; kernel = RISHKA_VOP_OR; break;
+                case RISHKA_VF6_VXOR:   op = RISHKA_DOP_VALU; kernel = RISHKA_VOP_XOR; break;
+                case RISHKA_VF6_VSLL:   op = RISHKA_DOP_VALU; kernel = RISHKA_VOP_SLL; break;
+                case RISHKA_VF6_VSRL:   op = RISHKA_DOP_VALU; kernel = RISHKA_VOP_SRL; break;
+                case RISHKA_VF6_VSRA:   op = RISHKA_DOP_VALU; kernel = RISHKA_VOP_SRA; break;
+                case RISHKA_VF6_VMSEQ:  op = RISHKA_DOP_VCMP; kernel = RISHKA_VOP_EQ; break;
+                case RISHKA_VF6_VMSNE:  op = RISHKA_DOP_VCMP; kernel = RISHKA_VOP_NE; break;
+                case RISHKA_VF6_VMSLEU: op = RISHKA_DOP_VCMP; kernel = RISHKA_VOP_LEU; break;
+                case RISHKA_VF6_VMSLE:  op = RISHKA_DOP_VCMP; kernel = RISHKA_VOP_LE; break;
+
+                case RISHKA_VF6_VSUB:
+                case RISHKA_VF6_VMINU:
+                case RISHKA_VF6_VMIN:
+                case RISHKA_VF6_VMAXU:
+                case RISHKA_VF6_VMAX:
+                    if(!immediate) {
+                        op = RISHKA_DOP_VALU;
+                        kernel = (function_code_6 == RISHKA_VF6_VSUB ? (uint32_t) RISHKA_VOP_SUB :
+                            RISHKA_VOP_MINU + (function_code_6 - RISHKA_VF6_VMINU));
+                    }
+                    break;
+
+                case RISHKA_VF6_VRSUB:
+                    if(!vector) {
+                        op = RISHKA_DOP_VALU;
+                        kernel = RISHKA_VOP_RSUB;
+                    }
+                    break;
+
+                case RISHKA_VF6_VMSLTU:
+                case RISHKA_VF6_VMSLT:
+                    if(!immediate) {
+                        op = RISHKA_DOP_VCMP;
+                        kernel = RISHKA_VOP_LTU + (function_code_6 - RISHKA_VF6_VMSLTU);
+                    }
+                    break;
+
+                case RISHKA_VF6_VMSGTU:
+                case RISHKA_VF6_VMSGT:
+                    if(!vector) {
+                        op = RISHKA_DOP_VCMP;
+                        kernel = RISHKA_VOP_GTU + (function_code_6 - RISHKA_VF6_VMSGTU);
+                    }
+                    break;
+
+                // Unmasked, this is vmv.v.v, vmv.v.x or vmv.v.i, which have no vs2.
+                case RISHKA_VF6_VMERGE:
+                    if(!vm || decoded->rs2 == 0)
+                        op = RISHKA_DOP_VMERGE;
+                    break;
+            }
+            break;
+
+        case RISHKA_FC3_OPMVV:
+            switch(function_code_6) {
+                case RISHKA_VF6_VREDSUM:    op = RISHKA_DOP_VRED; kernel = RISHKA_VOP_ADD; break;
+                case RISHKA_VF6_VREDAND:    op = RISHKA_DOP_VRED; kernel = RISHKA_VOP_AND; break;
+                case RISHKA_VF6_VREDOR:     op = RISHKA_DOP_VRED; kernel = RISHKA_VOP_OR; break;
+                case RISHKA_VF6_VREDXOR:    op = RISHKA_DOP_VRED; kernel = RISHKA_VOP_XOR; break;
+                case RISHKA_VF6_VREDMINU:   op = RISHKA_DOP_VRED; kernel = RISHKA_VOP_MINU; break;
+                case RISHKA_VF6_VREDMIN:    op = RISHKA_DOP_VRED; kernel = RISHKA_VOP_MIN; break;
+                case RISHKA_VF6_VREDMAXU:   op = RISHKA_DOP_VRED; kernel = RISHKA_VOP_MAXU; break;
+                case RISHKA_VF6_VREDMAX:    op = RISHKA_DOP_VRED; kernel = RISHKA_VOP_MAX; break;
+                case RISHKA_VF6_VMUL:       op = RISHKA_DOP_VALU; kernel = RISHKA_VOP_MUL; break;
+
+                case RISHKA_VF6_VWXUNARY:
+                    if(decoded->rs1 == 0x00 && vm)
+                        op = RISHKA_DOP_VMV_X_S;
+                    else if(decoded->rs1 == 0x10)
+                        op = RISHKA_DOP_VCPOP;
+                    else if(decoded->rs1 == 0x11)
+                        op = RISHKA_DOP_VFIRST;
+                    break;
+
+                case RISHKA_VF6_VMUNARY:
+                    if(decoded->rs1 == 0x11 && decoded->rs2 == 0)
+                        op = RISHKA_DOP_VID;
+                    break;
+
+                case RISHKA_VF6_VMANDN:     kernel = RISHKA_VOP_ANDN; break;
+                case RISHKA_VF6_VMAND:      kernel = RISHKA_VOP_AND; break;
+                case RISHKA_VF6_VMOR:       kernel = RISHKA_VOP_OR; break;
+                case RISHKA_VF6_VMXOR:      kernel = RISHKA_VOP_XOR; break;
+                case RISHKA_VF6_VMORN:      kernel = RISHKA_VOP_ORN; break;
+                case RISHKA_VF6_VMNAND:     kernel = RISHKA_VOP_NAND; break;
+                case RISHKA_VF6_VMNOR:      kernel = RISHKA_VOP_NOR; break;
+                case RISHKA_VF6_VMXNOR:     kernel = RISHKA_VOP_XNOR; break;
+            }
+
+            if(function_code_6 >= RISHKA_VF6_VMANDN && function_code_6 <= RISHKA_VF6_VMXNOR && vm)
+                op = RISHKA_DOP_VMASK;
+            break;
+
+        case RISHKA_FC3_OPMVX:
+            if(function_code_6 == RISHKA_VF6_VWXUNARY && decoded->rs2 == 0 && vm)
+                op = RISHKA_DOP_VMV_S_X;
+            else if(function_code_6 == RISHKA_VF6_VMUL) {
+                op = RISHKA_DOP_VALU;
+                kernel = RISHKA_VOP_MUL;
+            }
+            break;
+    }
+
+    if(op == RISHKA_DOP_INVALID)
+        return;
+
+    // Shift amounts are unsigned, every other immediate is sign-extended.
+    int32_t operand = (int32_t) decoded->rs1;
+    if(kernel < RISHKA_VOP_SLL || kernel > RISHKA_VOP_SRA)
+        operand = ((operand << 27) >> 27);
+
+    decoded->op = op;
+    decoded->imm = (int32_t) (vm | ((vector ? 0 : immediate ? 2 : 1) << 1) | (kernel << 3));
+    if(immediate)
+        decoded->imm |= (int32_t) ((uint32_t) operand << 8);
+}
+
+// Single-precision values that are not NaN-boxed read as the canonical NaN.
+static inline uint32_t rishka_fp_bits(uint64_t value) {
+    return (value >> 32) == 0xffffffffU ? (uint32_t) value : 0x7fc00000U;
+}
+
+static inline float rishka_fp_single(uint64_t value) {
+    return rishka_int_to_float(rishka_fp_bits(value));
+}
+
+static inline double rishka_fp_double(uint64_t value) {
+    return rishka_long_to_double((int64_t) value);
+}
+
+static inline uint64_t rishka_fp_box(float value) {
+    return (0xffffffff00000000ULL | rishka_float_to_int(value));
+}
+
+static inline uint64_t rishka_fp_box(double value) {
+    return (uint64_t) rishka_double_to_long(value);
+}
+
+static inline uint64_t rishka_fp_canonical(float) {
+    return 0xffffffff7fc00000ULL;
+}
+
+static inline uint64_t rishka_fp_canonical(double) {
+    return 0x7ff8000000000000ULL;
+}
+
+static inline bool rishka_fp_signaling(float value) {
+    return (rishka_float_to_int(value) &0x7fc00000U) == 0x7f800000U &&
+        (rishka_float_to_int(value) &0x003fffffU) != 0;
+}
+
+static inline bool rishka_fp_signaling(double value) {
+    return ((uint64_t) rishka_double_to_long(value) &0x7ff8000000000000ULL) == 0x7ff0000000000000ULL &&
+        ((uint64_t) rishka_double_to_long(value) &0x0007ffffffffffffULL) != 0;
+}
+
+// NaN results are replaced with the canonical NaN, and raise the invalid
+// operation flag unless they were propagated from a quiet NaN operand.
+template<typename T>
+static inline uint64_t rishka_fp_result(T result, T a, T b, T c, uint32_t* fcsr) {
+    if(result == result)
+        return rishka_fp_box(result);
+
+    if((a == a && b == b && c == c) || rishka_fp_signaling(a) ||
+        rishka_fp_signaling(b) || rishka_fp_signaling(c))
+        *fcsr |= RISHKA_FFLAG_NV;
+    return rishka_fp_canonical(result);
+}
+
+template<typename T>
+static inline uint64_t rishka_fp_divide(T a, T b, uint32_t* fcsr) {
+    if(b == 0 && a != 0 && isfinite(a))
+        *fcsr |= RISHKA_FFLAG_DZ;
+    return rishka_fp_result((T)(a / b), a, b, b, fcsr);
+}
+
+template<typename T>
+static inline uint64_t rishka_fp_minmax(T a, T b, bool maximum, uint32_t* fcsr) {
+    if(rishka_fp_signaling(a) || rishka_fp_signaling(b))
+        *fcsr |= RISHKA_FFLAG_NV;
+
+    if(a != a)
+        return b != b ? rishka_fp_canonical(a) : rishka_fp_box(b);
+    else if(b != b)
+        return rishka_fp_box(a);
+    else if(a == b)
+        return rishka_fp_box((signbit(a) != 0) == maximum ? b : a);
+    return rishka_fp_box((a < b) != maximum ? a : b);
+}
+
+template<typename T>
+static inline bool rishka_fp_compare(T a, T b, uint8_t op, bool quiet, uint32_t* fcsr) {
+    if(a != a || b != b) {
+        if(!quiet || rishka_fp_signaling(a) || rishka_fp_signaling(b))
+            *fcsr |= RISHKA_FFLAG_NV;
+        return false;
+    }
+
+    switch(op) {
+        case RISHKA_DOP_FLT_S: return a < b;
+        case RISHKA_DOP_FLE_S: return a <= b;
+        default: return a == b;
+    }
+}
+
+template<typename T>
+static inline uint32_t rishka_fp_classify(T value) {
+    bool negative = signbit(value) != 0;
+
+    switch(fpclassify(value)) {
+        case FP_INFINITE:   return negative ? 1 : 128;
+        case FP_NORMAL:     return negative ? 2 : 64;
+        case FP_SUBNORMAL:  return negative ? 4 : 32;
+        case FP_ZERO:       return negative ? 8 : 16;
+        default:            return rishka_fp_signaling(value) ? 256 : 512;
+    }
+}
+
+// Conversions to integers saturate, and return the largest value for NaN.
+template<typename T>
+static inline T rishka_fp_to_integer(double value, uint8_t rounding, uint32_t* fcsr) {
+    double rounded;
+
+    switch(rounding) {
+        case RISHKA_RM_RTZ: rounded = trunc(value); break;
+        case RISHKA_RM_RDN: rounded = floor(value); break;
+        case RISHKA_RM_RUP: rounded = ceil(value); break;
+        case RISHKA_RM_RMM: rounded = round(value); break;
+        default:            rounded = nearbyint(value); break;
+    }
+
+    if(rounded != rounded || rounded >= (double) std::numeric_limits<T>::max() + 1.0) {
+        *fcsr |= RISHKA_FFLAG_NV;
+        return std::numeric_limits<T>::max();
+    }
+    else if(rounded < (double) std::numeric_limits<T>::min()) {
+        *fcsr |= RISHKA_FFLAG_NV;
+        return std::numeric_limits<T>::min();
+    }
+
+    return (T) rounded;
+}
+
+// Bit-manipulation instructions map onto the host builtins; unlike the
+// builtins, counting the zeros of zero yields the width of the operand.
+static inline uint32_t rishka_bit_clz(uint32_t value) {
+    return value == 0 ? 32 : __builtin_clz(value);
+}
+
+static inline uint32_t rishka_bit_clz(uint64_t value) {
+    return value == 0 ? 64 : __builtin_clzll(value);
+}
+
+static inline uint32_t rishka_bit_ctz(uint32_t value) {
+    return value == 0 ? 32 : __builtin_ctz(value);
+}
+
+static inline uint32_t rishka_bit_ctz(uint64_t value) {
+    return value == 0 ? 64 : __builtin_ctzll(value);
+}
+
+static inline uint32_t rishka_bit_cpop(uint32_t value) {
+    return __builtin_popcount(value);
+}
+
+static inline uint32_t rishka_bit_cpop(uint64_t value) {
+    return __builtin_popcountll(value);
+}
+
+static inline uint32_t rishka_bit_rev8(uint32_t value) {
+    return __builtin_bswap32(value);
+}
+
+static inline uint64_t rishka_bit_rev8(uint64_t value) {
+    return __builtin_bswap64(value);
+}
+
+template<typename T>
+static inline T rishka_bit_rotate_left(T value, uint32_t amount) {
+    amount &= (sizeof(T) * 8 - 1);
+    return amount == 0 ? value : (T)((value << amount) | (value >> (sizeof(T) * 8 - amount)));
+}
+
+template<typename T>
+static inline T rishka_bit_rotate_right(T value, uint32_t amount) {
+    amount &= (sizeof(T) * 8 - 1);
+    return amount == 0 ? value : (T)((value >> amount) | (value << (sizeof(T) * 8 - amount)));
+}
+
+// Sets the top bit of every non-zero byte without carries between bytes,
+// then widens each top bit to the whole byte.
+template<typename T>
+static inline T rishka_bit_orc_b(T value) {
+    const T low = (T) ~(T) 0 / 255;
+    T top = ((((value &(low * 0x7f)) + (low * 0x7f)) | value) &(low * 0x80));
+
+    return (T)((top >> 7) * 0xff);
+}
+
+// Atomic memory operations use the atomics of the host, so they stay
+// atomic against the other harts sharing the guest memory.
+template<typename T, typename S>
+static inline T rishka_amo(T* address, T value, int32_t function) {
+    switch(function) {
+        case RISHKA_AMO5_SWAP:  return __atomic_exchange_n(address, value, __ATOMIC_SEQ_CST);
+        case RISHKA_AMO5_ADD:   return __atomic_fetch_add(address, value, __ATOMIC_SEQ_CST);
+        case RISHKA_AMO5_XOR:   return __atomic_fetch_xor(address, value, __ATOMIC_SEQ_CST);
+        case RISHKA_AMO5_AND:   return __atomic_fetch_and(address, value, __ATOMIC_SEQ_CST);
+        case RISHKA_AMO5_OR:    return __atomic_fetch_or(address, value, __ATOMIC_SEQ_CST);
+    }
+
+    T current = __atomic_load_n(address, __ATOMIC_SEQ_CST), result;
+    do {
+        switch(function) {
+            case RISHKA_AMO5_MIN:   result = (S) value < (S) current ? value : current; break;
+            case RISHKA_AMO5_MAX:   result = (S) value > (S) current ? value : current; break;
+            case RISHKA_AMO5_MINU:  result = value < current ? value : current; break;
+            default:                result = value > current ? value : current; break;
+        }
+    } while(!__atomic_compare_exchange_n(address, &current, result, true, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
+
+    return current;
+}
+
+static_assert(RISHKA_DOP_LR_D - RISHKA_DOP_LR_W == 3 && RISHKA_DOP_SC_D - RISHKA_DOP_SC_W == 3 &&
+    RISHKA_DOP_AMO_D - RISHKA_DOP_AMO_W == 3, "Double-word atomics must follow the word forms.");
+
+// Counts the instructions of a run that precede the one at the cursor.
+static inline uint64_t rishka_run_position(const rishka_decoded_inst* start, const rishka_decoded_inst* cursor) {
+    uint64_t position = 0;
+
+    for(; start < cursor; start += start->length)
+        position++;
+    return position;
+}
+
+rishka_run_status RishkaVM::interpret(uint64_t budget, uint32_t timeLimit) {
+    rishka_uxlen_t* registers = (((rishka_uxlen_arrptr*) &this->registers)->a).v;
+    uint64_t* fregisters = this->fregisters;
+
+#if !RISHKA_VM_PAGED_MEMORY
+    uint8_t* memory = this->memory;
+#endif
+
+    // The cursor walks the decoded instructions of the current block in place;
+    // the guest pc is only materialized when an instruction needs it.
+    rishka_decoded_inst* origin = this->decodeCache;
+    rishka_decoded_inst* cursor = this->decodeCache;
+    int64_t base = 0;
+
+    // Instructions are retired in bulk when the cursor leaves a run, by the
+    // length measured when it was entered; runs that do not fit the
+    // remaining budget are stepped through the scratch buffer instead.
+    int64_t runLength = 0;
+    int64_t remaining = budget > (uint64_t) INT64_MAX ? INT64_MAX : (int64_t) budget;
+
+    // The retired instruction count follows from the remaining budget; it is
+    // stored back on return, and when a counter CSR is read mid-run the
+    // instructions already executed from the current run are added as well.
+    uint64_t retiredBase = this->instret + (uint64_t) remaining;
+    rishka_decoded_inst* runStart = this->decodeCache;
+
+    unsigned long started = timeLimit != 0 ? micros() : 0;
+    uint32_t deadlinePoll = RISHKA_VM_DEADLINE_INTERVAL;
+
+    // Code outside the decode cache runs one instruction at a time from this
+    // buffer, whose next entries decode the following one.
+    rishka_decoded_inst scratch[3];
+    scratch[1].op = RISHKA_DOP_UNDECODED;
+    scratch[2].op = RISHKA_DOP_UNDECODED;
+
+    rishka_block* block = NULL;
+    uint8_t slot = 0;
+    bool counted = false;
+    rishka_decoded_inst inst;
+
+    // Successor slot predicted by the return-address stack or the jump
+    // target cache for the jump that left the last run, used in place of
+    // the block's own link, which every other caller would overwrite.
+    rishka_block** link = NULL;
+
+#if RISHKA_VM_COMPUTED_GOTO
+    // Handler addresses, in the same order as the rishka_decoded_op enumeration.
+    static const void* const handlers[] = {
+        &&RISHKA_DOP_UNDECODED_handler, &&RISHKA_DOP_INVALID_handler, &&RISHKA_DOP_NOP_handler,
+        &&RISHKA_DOP_LB_handler, &&RISHKA_DOP_LHW_handler, &&RISHKA_DOP_LW_handler,
+        &&RISHKA_DOP_LDW_handler, &&RISHKA_DOP_LBU_handler, &&RISHKA_DOP_LHU_handler,
+        &&RISHKA_DOP_LRES_handler,
+        &&RISHKA_DOP_SB_handler, &&RISHKA_DOP_SHW_handler, &&RISHKA_DOP_SW_handler,
+        &&RISHKA_DOP_SDW_handler,
+        &&RISHKA_DOP_LR_W_handler, &&RISHKA_DOP_SC_W_handler, &&RISHKA_DOP_AMO_W_handler,
+        &&RISHKA_DOP_LR_D_handler, &&RISHKA_DOP_SC_D_handler, &&RISHKA_DOP_AMO_D_handler,
+        &&RISHKA_DOP_ADDI_handler, &&RISHKA_DOP_SLLI_handler, &&RISHKA_DOP_SLTI_handler,
+        &&RISHKA_DOP_SLTIU_handler, &&RISHKA_DOP_XORI_handler, &&RISHKA_DOP_SRLI_handler,
+        &&RISHKA_DOP_SRAI_handler, &&RISHKA_DOP_ORI_handler, &&RISHKA_DOP_ANDI_handler,
+        &&RISHKA_DOP_ADD_handler, &&RISHKA_DOP_SUB_handler, &&RISHKA_DOP_SLL_handler,
+        &&RISHKA_DOP_SLT_handler, &&RISHKA_DOP_SLTU_handler, &&RISHKA_DOP_XOR_handler,
+        &&RISHKA_DOP_SRL_handler, &&RISHKA_DOP_SRA_handler, &&RISHKA_DOP_OR_handler,
+        &&RISHKA_DOP_AND_handler, &&RISHKA_DOP_MUL_handler, &&RISHKA_DOP_MULH_handler,
+        &&RISHKA_DOP_MULHSU_handler, &&RISHKA_DOP_MULHU_handler, &&RISHKA_DOP_DIV_handler,
+        &&RISHKA_DOP_DIVU_handler, &&RISHKA_DOP_REM_handler, &&RISHKA_DOP_REMU_handler,
+        &&RISHKA_DOP_MULW_handler, &&RISHKA_DOP_DIVW_handler, &&RISHKA_DOP_DIVUW_handler,
+        &&RISHKA_DOP_REMW_handler, &&RISHKA_DOP_REMUW_handler,
+        &&RISHKA_DOP_LUI_handler, &&RISHKA_DOP_AUIPC_handler, &&RISHKA_DOP_JAL_handler,
+        &&RISHKA_DOP_JALR_handler,
+        &&RISHKA_DOP_BEQ_handler, &&RISHKA_DOP_BNE_handler, &&RISHKA_DOP_BLT_handler,
+        &&RISHKA_DOP_BGE_handler, &&RISHKA_DOP_BLTU_handler, &&RISHKA_DOP_BGEU_handler,
+        &&RISHKA_DOP_FENCE_handler, &&RISHKA_DOP_FENCE_I_handler, &&RISHKA_DOP_ECALL_handler,
+        &&RISHKA_DOP_EBREAK_handler, &&RISHKA_DOP_HLE_handler,
+        &&RISHKA_DOP_CSRRW_handler, &&RISHKA_DOP_CSRRS_handler, &&RISHKA_DOP_CSRRC_handler,
+        &&RISHKA_DOP_CSRRWI_handler, &&RISHKA_DOP_CSRRSI_handler, &&RISHKA_DOP_CSRRCI_handler,
+        &&RISHKA_DOP_FLW_handler, &&RISHKA_DOP_FSW_handler, &&RISHKA_DOP_FLD_handler,
+        &&RISHKA_DOP_FSD_handler,
+        &&RISHKA_DOP_FMADD_S_handler, &&RISHKA_DOP_FMSUB_S_handler, &&RISHKA_DOP_FNMSUB_S_handler,
+        &&RISHKA_DOP_FNMADD_S_handler, &&RISHKA_DOP_FADD_S_handler, &&RISHKA_DOP_FSUB_S_handler,
+        &&RISHKA_DOP_FMUL_S_handler, &&RISHKA_DOP_FDIV_S_handler, &&RISHKA_DOP_FSQRT_S_handler,
+        &&RISHKA_DOP_FSGNJ_S_handler, &&RISHKA_DOP_FSGNJN_S_handler, &&RISHKA_DOP_FSGNJX_S_handler,
+        &&RISHKA_DOP_FMIN_S_handler, &&RISHKA_DOP_FMAX_S_handler, &&RISHKA_DOP_FCVT_W_S_handler,
+        &&RISHKA_DOP_FCVT_WU_S_handler, &&RISHKA_DOP_FCVT_L_S_handler,
+        &&RISHKA_DOP_FCVT_LU_S_handler, &&RISHKA_DOP_FCVT_S_W_handler,
+        &&RISHKA_DOP_FCVT_S_WU_handler, &&RISHKA_DOP_FCVT_S_L_handler,
+        &&RISHKA_DOP_FCVT_S_LU_handler, &&RISHKA_DOP_FMV_X_W_handler, &&RISHKA_DOP_FMV_W_X_handler,
+        &&RISHKA_DOP_FEQ_S_handler, &&RISHKA_DOP_FLT_S_handler, &&RISHKA_DOP_FLE_S_handler,
+        &&RISHKA_DOP_FCLASS_S_handler,
+        &&RISHKA_DOP_FMADD_D_handler, &&RISHKA_DOP_FMSUB_D_handler, &&RISHKA_DOP_FNMSUB_D_handler,
+        &&RISHKA_DOP_FNMADD_D_handler, &&RISHKA_DOP_FADD_D_handler, &&RISHKA_DOP_FSUB_D_handler,
+        &&RISHKA_DOP_FMUL_D_handler, &&RISHKA_DOP_FDIV_D_handler, &&RISHKA_DOP_FSQRT_D_handler,
+        &&RISHKA_DOP_FSGNJ_D_handler, &&RISHKA_DOP_FSGNJN_D_handler, &&RISHKA_DOP_FSGNJX_D_handler,
+        &&RISHKA_DOP_FMIN_D_handler, &&RISHKA_DOP_FMAX_D_handler, &&RISHKA_DOP_FCVT_W_D_handler,
+        &&RISHKA_DOP_FCVT_WU_D_handler, &&RISHKA_DOP_FCVT_L_D_handler,
+        &&RISHKA_DOP_FCVT_LU_D_handler, &&RISHKA_DOP_FCVT_D_W_handler,
+        &&RISHKA_DOP_FCVT_D_WU_handler, &&RISHKA_DOP_FCVT_D_L_handler,
+        &&RISHKA_DOP_FCVT_D_LU_handler, &&RISHKA_DOP_FMV_X_D_handler, &&RISHKA_DOP_FMV_D_X_handler,
+        &&RISHKA_DOP_FEQ_D_handler, &&RISHKA_DOP_FLT_D_handler, &&RISHKA_DOP_FLE_D_handler,
+        &&RISHKA_DOP_FCLASS_D_handler,
+        &&RISHKA_DOP_FCVT_S_D_handler, &&RISHKA_DOP_FCVT_D_S_handler,
+        &&RISHKA_DOP_SH1ADD_handler, &&RISHKA_DOP_SH2ADD_handler, &&RISHKA_DOP_SH3ADD_handler,
+        &&RISHKA_DOP_ADD_UW_handler, &&RISHKA_DOP_SH1ADD_UW_handler, &&RISHKA_DOP_SH2ADD_UW_handler,
+        &&RISHKA_DOP_SH3ADD_UW_handler, &&RISHKA_DOP_SLLI_UW_handler,
+        &&RISHKA_DOP_ANDN_handler, &&RISHKA_DOP_ORN_handler, &&RISHKA_DOP_XNOR_handler,
+        &&RISHKA_DOP_CLZ_handler, &&RISHKA_DOP_CTZ_handler, &&RISHKA_DOP_CPOP_handler,
+        &&RISHKA_DOP_CLZW_handler, &&RISHKA_DOP_CTZW_handler, &&RISHKA_DOP_CPOPW_handler,
+        &&RISHKA_DOP_MAX_handler, &&RISHKA_DOP_MAXU_handler, &&RISHKA_DOP_MIN_handler,
+        &&RISHKA_DOP_MINU_handler, &&RISHKA_DOP_SEXT_B_handler, &&RISHKA_DOP_SEXT_H_handler,
+        &&RISHKA_DOP_ZEXT_H_handler, &&RISHKA_DOP_ROL_handler, &&RISHKA_DOP_ROR_handler,
+        &&RISHKA_DOP_RORI_handler, &&RISHKA_DOP_ROLW_handler, &&RISHKA_DOP_RORW_handler,
+        &&RISHKA_DOP_RORIW_handler, &&RISHKA_DOP_ORC_B_handler, &&RISHKA_DOP_REV8_handler,
+        &&RISHKA_DOP_BCLR_handler, &&RISHKA_DOP_BCLRI_handler, &&RISHKA_DOP_BEXT_handler,
+        &&RISHKA_DOP_BEXTI_handler, &&RISHKA_DOP_BINV_handler, &&RISHKA_DOP_BINVI_handler,
+        &&RISHKA_DOP_BSET_handler, &&RISHKA_DOP_BSETI_handler,
+        &&RISHKA_DOP_VSETVLI_handler, &&RISHKA_DOP_VSETIVLI_handler, &&RISHKA_DOP_VSETVL_handler,
+        &&RISHKA_DOP_VLE_handler, &&RISHKA_DOP_VSE_handler, &&RISHKA_DOP_VALU_handler,
+        &&RISHKA_DOP_VCMP_handler, &&RISHKA_DOP_VMERGE_handler, &&RISHKA_DOP_VRED_handler,
+        &&RISHKA_DOP_VMASK_handler, &&RISHKA_DOP_VMV_X_S_handler, &&RISHKA_DOP_VMV_S_X_handler,
+        &&RISHKA_DOP_VCPOP_handler, &&RISHKA_DOP_VFIRST_handler, &&RISHKA_DOP_VID_handler,
+
+    };
+
+    static_assert(sizeof(handlers) / sizeof(handlers[0]) == RISHKA_DOP_COUNT,
+        "Handler table does not match rishka_decoded_op.");
+
+    #define RISHKA_VM_HANDLER(op)       op##_handler:
+    #define RISHKA_VM_DISPATCH()        do { inst = *cursor; RISHKA_VM_FETCHED(); goto *handlers[inst.op]; } while(0)
+    #define RISHKA_VM_NEXT()            do { cursor += inst.length; RISHKA_VM_DISPATCH(); } while(0)
+#else
+    #define RISHKA_VM_HANDLER(op)       case op:
+    #define RISHKA_VM_DISPATCH()        continue
+    #define RISHKA_VM_NEXT()            cursor += inst.length; continue
+#endif
+
+    #define RISHKA_VM_PC()              (base + ((int64_t)(cursor - origin) << 1))
+    #define RISHKA_VM_SIZE()            ((int64_t) inst.length << 1)
+    #define RISHKA_VM_ROUNDING()        (inst.imm == RISHKA_RM_DYN ? (uint8_t)(this->fcsr >> 5) : (uint8_t) inst.imm)
+    #define RISHKA_VM_RETIRE()          remaining -= runLength
+    #define RISHKA_VM_PUSH_RETURN(address) \
+        do { \
+            rishka_return_entry* entry = &this->returnStack[this->returnTop++ & (RISHKA_VM_RETURN_STACK_SIZE - 1)]; \
+            entry->pc = (address); \
+            entry->link = block != NULL ? &block->next[0] : NULL; \
+        } while(0)
+    #define RISHKA_VM_EXIT(successor) \
+        do { RISHKA_VM_RETIRE(); slot = (successor); counted = false; goto resolve; } while(0)
+    #define RISHKA_VM_EXIT_COUNTED(successor, edge) \
+        do { RISHKA_VM_RETIRE(); slot = (successor); counted = (edge); goto resolve; } while(0)
+    #define RISHKA_VM_LEAVE()           do { RISHKA_VM_RETIRE(); block = NULL; goto resolve; } while(0)
+    #define RISHKA_VM_RETIRED()         (retiredBase - (uint64_t) remaining)
+    #define RISHKA_VM_RETURN(status)    do { this->instret = RISHKA_VM_RETIRED(); return (status); } while(0)
+    #define RISHKA_VM_SYNC_COUNTERS()   this->instret = (RISHKA_VM_RETIRED() + rishka_run_position(runStart, cursor))
+
+#if RISHKA_VM_HEATMAP
+    // Undecoded entries dispatch again once decoded, and count then.
+    #define RISHKA_VM_FETCHED() \
+        do { if(inst.op != RISHKA_DOP_UNDECODED) this->recordAccess(RISHKA_VM_PC(), RISHKA_HEAT_FETCH); } while(0)
+    #define RISHKA_VM_HEAT(address, kind)   this->recordAccess((uint64_t)(address), (kind))
+#else
+    #define RISHKA_VM_FETCHED()             do { } while(0)
+    #define RISHKA_VM_HEAT(address, kind)   do { } while(0)
+#endif
+
+#if RISHKA_VM_PAGED_MEMORY
+    #define RISHKA_VM_LOAD(type, address, value) \
+        do { \
+            RISHKA_VM_HEAT(address, RISHKA_HEAT_LOAD); \
+            if(!this->load<type>((address), &(value))) goto memory_fault; \
+        } while(0)
+    #define RISHKA_VM_STORE(type, address, value) \
+        do { \
+            RISHKA_VM_HEAT(address, RISHKA_HEAT_STORE); \
+            if(!this->store<type>((address), (type)(value))) goto memory_fault; \
+        } while(0)
+    #define RISHKA_VM_ATOMIC(type, address, host) \
+        do { if(((host) = this->translate<type>(address)) == NULL) goto memory_fault; } while(0)
+#else
+    #define RISHKA_VM_LOAD(type, address, value) \
+        do { RISHKA_VM_HEAT(address, RISHKA_HEAT_LOAD); (value) = *(type*)(&memory[address]); } while(0)
+    #define RISHKA_VM_STORE(type, address, value) \
+        do { \
+            RISHKA_VM_HEAT(address, RISHKA_HEAT_STORE); \
+            rishka_mark_dirty(memory, (address), sizeof(type)); \
+            (*(type*)(&memory[address])) = (type)(value); \
+        } while(0)
+    #define RISHKA_VM_ATOMIC(type, address, host) \
+        do { rishka_mark_dirty(memory, (address), sizeof(type)); (host) = (type*)(&memory[address]); } while(0)
+#endif
+
+resolve:
+    if(!__atomic_load_n(&this->running, __ATOMIC_RELAXED))
+        RISHKA_VM_RETURN(this->panicked ? RISHKA_RUN_PANICKED : RISHKA_RUN_EXITED);
+
+    if(remaining <= 0)
+        RISHKA_VM_RETURN(RISHKA_RUN_BUDGET_EXHAUSTED);
+
+    if(timeLimit != 0 && --deadlinePoll == 0) {
+        if(micros() - started >= timeLimit)
+            RISHKA_VM_RETURN(RISHKA_RUN_BUDGET_EXHAUSTED);
+        deadlinePoll = RISHKA_VM_DEADLINE_INTERVAL;
+    }
+
+    if(link != NULL && *link != NULL && (*link)->pc == this->pc) {
+        block = *link;
+        this->tierStats.predictedJumps++;
+    }
+    else if(block != NULL && block->next[slot] != NULL && block->next[slot]->pc == this->pc)
+        block = block->next[slot];
+    else {
+        rishka_block* previous = block;
+
+        block = this->lookupBlock(this->pc);
+        if(block == NULL && this->isHot(this->pc, previous != NULL, counted))
+            block = this->translateBlock(this->pc);
+
+        if(link != NULL)
+            *link = block;
+        else if(previous != NULL)
+            previous->next[slot] = block;
+    }
+    link = NULL;
+
+    if(block != NULL && block->length > remaining)
+        block = NULL;
+
+    // Instrumented builds run every block in the interpreter, where the
+    // heatmap sees its accesses.
+#if (RISHKA_VM_JIT || RISHKA_VM_AOT) && !RISHKA_VM_HEATMAP
+    if(block != NULL) {
+#if RISHKA_VM_JIT
+        if(block->native == NULL && block->hits < this->nativeThreshold &&
+            ++block->hits == this->nativeThreshold)
+            this->translateNative(block);
+#endif
+
+        if(block->native != NULL) {
+#if RISHKA_VM_PAGED_MEMORY
+            rishka_native_exit result = block->native(registers, this->tlb, this);
+#else
+            rishka_native_exit result = block->native(registers, memory, this);
+#endif
+
+            this->pc = result.pc;
+            if(result.kind != RISHKA_NATIVE_RESUME) {
+                remaining -= block->length;
+                slot = result.kind;
+                counted = false;
+                goto resolve;
+            }
+
+            // A store into decoded text drops every block, this one included;
+            // the rest of it then runs as cold code.
+            if(block->pc == -1)
+                block = NULL;
+        }
+    }
+#endif
+
+    // Cold code inside the decode cache runs from it as well, only without
+    // a block descriptor; its entries are decoded while measuring the run.
+    if(block != NULL)
+        runLength = block->length;
+    else if((this->pc & 1) == 0 && ((uint64_t) this->pc >> 1) < RISHKA_VM_DECODE_CACHE_SIZE)
+        runLength = this->measureRun(this->pc, remaining < RISHKA_VM_DECODE_CACHE_SIZE ?
+            (uint32_t) remaining : RISHKA_VM_DECODE_CACHE_SIZE);
+    else runLength = 0;
+
+    if(runLength != 0 && runLength <= remaining) {
+        origin = this->decodeCache;
+        cursor = &this->decodeCache[(uint64_t) this->pc >> 1];
+        base = 0;
+
+        // A native block that resumed in the interpreter has already run
+        // the instructions ahead of the cursor.
+        runStart = block != NULL ? &this->decodeCache[(uint64_t) block->pc >> 1] : cursor;
+    }
+    else {
+        this->decodeAt(this->pc, &scratch[0]);
+
+        origin = cursor = runStart = scratch;
+        base = this->pc;
+        runLength = 1;
+    }
+
+#if RISHKA_VM_COMPUTED_GOTO
+    RISHKA_VM_DISPATCH();
+#else
+    for(;;) {
+        inst = *cursor;
+        RISHKA_VM_FETCHED();
+
+        switch(inst.op) {
+#endif
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_NOP)
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_LB) {
+        uint8_t value;
+
+        RISHKA_VM_LOAD(uint8_t, registers[inst.rs1] + (rishka_uxlen_t)(rishka_xlen_t) inst.imm, value);
+        registers[inst.rd] = (rishka_uxlen_t)(rishka_xlen_t) value;
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_LHW) {
+        uint16_t value;
+
+        RISHKA_VM_LOAD(uint16_t, registers[inst.rs1] + (rishka_uxlen_t)(rishka_xlen_t) inst.imm, value);
+        registers[inst.rd] = (rishka_uxlen_t)(rishka_xlen_t) value;
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_LW) {
+        uint32_t value;
+
+        RISHKA_VM_LOAD(uint32_t, registers[inst.rs1] + (rishka_uxlen_t)(rishka_xlen_t) inst.imm, value);
+        registers[inst.rd] = (rishka_uxlen_t)(rishka_xlen_t) value;
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_LDW) {
+        uint64_t value;
+
+        RISHKA_VM_LOAD(uint64_t, registers[inst.rs1] + (rishka_uxlen_t)(rishka_xlen_t) inst.imm, value);
+        registers[inst.rd] = (rishka_uxlen_t)(rishka_xlen_t) value;
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_LBU) {
+        uint8_t value;
+
+        RISHKA_VM_LOAD(uint8_t, registers[inst.rs1] + (rishka_uxlen_t)(rishka_xlen_t) inst.imm, value);
+        registers[inst.rd] = (rishka_uxlen_t)(rishka_xlen_t) value;
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_LHU) {
+        uint16_t value;
+
+        RISHKA_VM_LOAD(uint16_t, registers[inst.rs1] + (rishka_uxlen_t)(rishka_xlen_t) inst.imm, value);
+        registers[inst.rd] = (rishka_uxlen_t)(rishka_xlen_t) value;
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_LRES) {
+        uint32_t value;
+
+        RISHKA_VM_LOAD(uint32_t, registers[inst.rs1] + (rishka_uxlen_t)(rishka_xlen_t) inst.imm, value);
+        registers[inst.rd] = (rishka_uxlen_t)(rishka_xlen_t) value;
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_SB) {
+        uint64_t addr = (registers[inst.rs1] + (rishka_uxlen_t)(rishka_xlen_t) inst.imm);
+
+        RISHKA_VM_STORE(uint8_t, addr, registers[inst.rs2]);
+        this->invalidateDecoded(addr, 1);
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_SHW) {
+        uint64_t addr = (registers[inst.rs1] + (rishka_uxlen_t)(rishka_xlen_t) inst.imm);
+
+        RISHKA_VM_STORE(uint16_t, addr, registers[inst.rs2]);
+        this->invalidateDecoded(addr, 2);
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_SW) {
+        uint64_t addr = (registers[inst.rs1] + (rishka_uxlen_t)(rishka_xlen_t) inst.imm);
+
+        RISHKA_VM_STORE(uint32_t, addr, registers[inst.rs2]);
+        this->invalidateDecoded(addr, 4);
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_SDW) {
+        uint64_t addr = (registers[inst.rs1] + (rishka_uxlen_t)(rishka_xlen_t) inst.imm);
+
+        RISHKA_VM_STORE(uint64_t, addr, registers[inst.rs2]);
+        this->invalidateDecoded(addr, 8);
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_LR_W) {
+        rishka_uxlen_t addr = registers[inst.rs1];
+
+        if((addr &3) != 0)
+            goto misaligned_atomic;
+
+        uint32_t* word;
+        RISHKA_VM_HEAT(addr, RISHKA_HEAT_LOAD);
+        RISHKA_VM_ATOMIC(uint32_t, addr, word);
+
+        this->reservedValue = __atomic_load_n(word, __ATOMIC_SEQ_CST);
+        this->reservation = addr;
+        this->reserved = true;
+
+        if(inst.rd != 0)
+            registers[inst.rd] = (rishka_uxlen_t)(rishka_xlen_t)(int32_t) this->reservedValue;
+        RISHKA_VM_NEXT();
+    }
+
+    // Store-conditional succeeds if the reserved word still holds the value
+    // load-reserved read, which the host compares and swaps atomically.
+    RISHKA_VM_HANDLER(RISHKA_DOP_SC_W) {
+        rishka_uxlen_t addr = registers[inst.rs1];
+        uint32_t expected = (uint32_t) this->reservedValue;
+
+        if((addr &3) != 0)
+            goto misaligned_atomic;
+
+        uint32_t* word;
+        RISHKA_VM_HEAT(addr, RISHKA_HEAT_STORE);
+        RISHKA_VM_ATOMIC(uint32_t, addr, word);
+
+        bool stored = this->reserved && this->reservation == addr &&
+            __atomic_compare_exchange_n(word, &expected,
+                (uint32_t) registers[inst.rs2], false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+
+        this->reserved = false;
+        if(stored)
+            this->invalidateDecoded(addr, 4);
+
+        if(inst.rd != 0)
+            registers[inst.rd] = stored ? 0 : 1;
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_AMO_W) {
+        rishka_uxlen_t addr = registers[inst.rs1];
+
+        if((addr &3) != 0)
+            goto misaligned_atomic;
+
+        uint32_t* word;
+        RISHKA_VM_HEAT(addr, RISHKA_HEAT_STORE);
+        RISHKA_VM_ATOMIC(uint32_t, addr, word);
+
+        uint32_t value = rishka_amo<uint32_t, int32_t>(word,
+            (uint32_t) registers[inst.rs2], inst.imm);
+
+        this->invalidateDecoded(addr, 4);
+        if(inst.rd != 0)
+            registers[inst.rd] = (rishka_uxlen_t)(rishka_xlen_t)(int32_t) value;
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_LR_D) {
+        rishka_uxlen_t addr = registers[inst.rs1];
+
+        if((addr &7) != 0)
+            goto misaligned_atomic;
+
+        uint64_t* word;
+        RISHKA_VM_HEAT(addr, RISHKA_HEAT_LOAD);
+        RISHKA_VM_ATOMIC(uint64_t, addr, word);
+
+        this->reservedValue = __atomic_load_n(word, __ATOMIC_SEQ_CST);
+        this->reservation = addr;
+        this->reserved = true;
+
+        if(inst.rd != 0)
+            registers[inst.rd] = (rishka_uxlen_t) this->reservedValue;
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_SC_D) {
+        rishka_uxlen_t addr = registers[inst.rs1];
+        uint64_t expected = this->reservedValue;
+
+        if((addr &7) != 0)
+            goto misaligned_atomic;
+
+        uint64_t* word;
+        RISHKA_VM_HEAT(addr, RISHKA_HEAT_STORE);
+        RISHKA_VM_ATOMIC(uint64_t, addr, word);
+
+        bool stored = this->reserved && this->reservation == addr &&
+            __atomic_compare_exchange_n(word, &expected,
+                (uint64_t) registers[inst.rs2], false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+
+        this->reserved = false;
+        if(stored)
+            this->invalidateDecoded(addr, 8);
+
+        if(inst.rd != 0)
+            registers[inst.rd] = stored ? 0 : 1;
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_AMO_D) {
+        rishka_uxlen_t addr = registers[inst.rs1];
+
+        if((addr &7) != 0)
+            goto misaligned_atomic;
+
+        uint64_t* word;
+        RISHKA_VM_HEAT(addr, RISHKA_HEAT_STORE);
+        RISHKA_VM_ATOMIC(uint64_t, addr, word);
+
+        uint64_t value = rishka_amo<uint64_t, int64_t>(word,
+            (uint64_t) registers[inst.rs2], inst.imm);
+
+        this->invalidateDecoded(addr, 8);
+        if(inst.rd != 0)
+            registers[inst.rd] = (rishka_uxlen_t) value;
+        RISHKA_VM_NEXT();
+    }
+
+misaligned_atomic:
+        this->pc = RISHKA_VM_PC();
+        this->panic(rishka_invalid_messages[RISHKA_INVALID_ATOMIC]);
+
+        this->pc = (this->pc + RISHKA_VM_SIZE());
+        RISHKA_VM_LEAVE();
+
+#if RISHKA_VM_PAGED_MEMORY
+memory_fault:
+        this->pc = RISHKA_VM_PC();
+        this->panic(rishka_memory_fault);
+
+        this->pc = (this->pc + RISHKA_VM_SIZE());
+        RISHKA_VM_LEAVE();
+#endif
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_ADDI)
+        registers[inst.rd] = (registers[inst.rs1] + (rishka_uxlen_t)(rishka_xlen_t) inst.imm);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_SLLI)
+        registers[inst.rd] = (rishka_uxlen_t) RishkaVM::shiftLeft((rishka_xlen_t) registers[inst.rs1], inst.imm);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_SLTI)
+        registers[inst.rd] = ((rishka_xlen_t) registers[inst.rs1] < (rishka_xlen_t) inst.imm) ? 1 : 0;
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_SLTIU)
+        registers[inst.rd] = (registers[inst.rs1] < (rishka_uxlen_t)(rishka_xlen_t) inst.imm) ? 1 : 0;
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_XORI)
+        registers[inst.rd] = (registers[inst.rs1] ^ (rishka_uxlen_t)(rishka_xlen_t) inst.imm);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_SRLI)
+        registers[inst.rd] = (rishka_uxlen_t) RishkaVM::shiftRight((rishka_xlen_t) registers[inst.rs1], inst.imm);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_SRAI)
+        registers[inst.rd] = (rishka_uxlen_t) RishkaVM::arithmeticShiftRight((rishka_xlen_t) registers[inst.rs1], inst.imm);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_ORI)
+        registers[inst.rd] = (registers[inst.rs1] | (rishka_uxlen_t)(rishka_xlen_t) inst.imm);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_ANDI)
+        registers[inst.rd] = (registers[inst.rs1] &(rishka_uxlen_t)(rishka_xlen_t) inst.imm);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_ADD)
+        registers[inst.rd] = (registers[inst.rs1] + registers[inst.rs2]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_SUB)
+        registers[inst.rd] = (registers[inst.rs1] - registers[inst.rs2]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_SLL)
+        registers[inst.rd] = (rishka_uxlen_t) RishkaVM::shiftLeft((rishka_xlen_t) registers[inst.rs1], (registers[inst.rs2] & 0x1f));
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_SLT)
+        registers[inst.rd] = ((rishka_xlen_t) registers[inst.rs1] < (rishka_xlen_t) registers[inst.rs2]) ? 1 : 0;
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_SLTU)
+        registers[inst.rd] = (registers[inst.rs1] < registers[inst.rs2]) ? 1 : 0;
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_XOR)
+        registers[inst.rd] = (registers[inst.rs1] ^ registers[inst.rs2]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_SRL)
+        registers[inst.rd] = (rishka_uxlen_t) RishkaVM::shiftRight((rishka_xlen_t) registers[inst.rs1], (registers[inst.rs2] & 0x1f));
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_SRA)
+        registers[inst.rd] = (rishka_uxlen_t) RishkaVM::arithmeticShiftRight((rishka_xlen_t) registers[inst.rs1], (registers[inst.rs2] & 0x1f));
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_OR)
+        registers[inst.rd] = (registers[inst.rs1] | registers[inst.rs2]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_AND)
+        registers[inst.rd] = (registers[inst.rs1] &registers[inst.rs2]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_MUL)
+        registers[inst.rd] = (registers[inst.rs1] * registers[inst.rs2]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_MULH)
+#if RISHKA_VM_XLEN == 32
+        registers[inst.rd] = (rishka_uxlen_t)(((int64_t)(rishka_xlen_t) registers[inst.rs1] * (int64_t)(rishka_xlen_t) registers[inst.rs2]) >> 32);
+#else
+        registers[inst.rd] = (rishka_uxlen_t) RishkaVM::shiftRightInt128(((int64_t) registers[inst.rs1] * (int64_t) registers[inst.rs2]), 64);
+#endif
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_MULHSU)
+#if RISHKA_VM_XLEN == 32
+        registers[inst.rd] = (rishka_uxlen_t)(((int64_t)(rishka_xlen_t) registers[inst.rs1] * (int64_t) registers[inst.rs2]) >> 32);
+#else
+        registers[inst.rd] = (rishka_uxlen_t) RishkaVM::shiftRightInt128(((int64_t) registers[inst.rs1] * (int64_t)(uint64_t) registers[inst.rs2]), 64);
+#endif
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_MULHU)
+#if RISHKA_VM_XLEN == 32
+        registers[inst.rd] = (rishka_uxlen_t)(((uint64_t) registers[inst.rs1] * (uint64_t) registers[inst.rs2]) >> 32);
+#else
+        registers[inst.rd] = (rishka_uxlen_t) RishkaVM::shiftRightInt128(((int64_t)(uint64_t) registers[inst.rs1] * (int64_t)(uint64_t) registers[inst.rs2]), 64);
+#endif
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_DIV) {
+        rishka_xlen_t dividend = (rishka_xlen_t) registers[inst.rs1], divisor = (rishka_xlen_t) registers[inst.rs2];
+
+        if(dividend == rishka_xlen_traits<RISHKA_VM_XLEN>::minimum && divisor == -1)
+            registers[inst.rd] = (rishka_uxlen_t) rishka_xlen_traits<RISHKA_VM_XLEN>::minimum;
+        else if(divisor == 0)
+            registers[inst.rd] = (rishka_uxlen_t) -1;
+        else registers[inst.rd] = (rishka_uxlen_t)(dividend / divisor);
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_DIVU) {
+        rishka_uxlen_t dividend = registers[inst.rs1], divisor = registers[inst.rs2];
+
+        if(divisor == 0)
+            registers[inst.rd] = (rishka_uxlen_t) -1;
+        else registers[inst.rd] = (dividend / divisor);
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_REM) {
+        rishka_xlen_t dividend = (rishka_xlen_t) registers[inst.rs1], divisor = (rishka_xlen_t) registers[inst.rs2];
+
+        if(dividend == rishka_xlen_traits<RISHKA_VM_XLEN>::minimum && divisor == -1)
+            registers[inst.rd] = 0;
+        else if(divisor == 0)
+            registers[inst.rd] = (rishka_uxlen_t) dividend;
+        else registers[inst.rd] = (rishka_uxlen_t)(dividend % divisor);
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_REMU) {
+        rishka_uxlen_t dividend = registers[inst.rs1], divisor = registers[inst.rs2];
+
+        if(divisor == 0)
+            registers[inst.rd] = dividend;
+        else registers[inst.rd] = (dividend % divisor);
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_MULW)
+        registers[inst.rd] = (rishka_uxlen_t)(rishka_xlen_t)((int32_t) registers[inst.rs1] * (int32_t) registers[inst.rs2]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_DIVW) {
+        int32_t dividend = (int32_t) registers[inst.rs1], divisor = (int32_t) registers[inst.rs2];
+
+        if(dividend == (-2147483647 - 1) && divisor == -1)
+            registers[inst.rd] = (rishka_uxlen_t) -2147483648LL;
+        else if(divisor == 0)
+            registers[inst.rd] = (rishka_uxlen_t) -1;
+        else registers[inst.rd] = (rishka_uxlen_t)(rishka_xlen_t)(dividend / divisor);
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_DIVUW) {
+        uint32_t dividend = (uint32_t) registers[inst.rs1], divisor = (uint32_t) registers[inst.rs2];
+
+        if(divisor == 0)
+            registers[inst.rd] = (rishka_uxlen_t) -1;
+        else registers[inst.rd] = (rishka_uxlen_t)(dividend / divisor);
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_REMW) {
+        int32_t dividend = (int32_t) registers[inst.rs1], divisor = (int32_t) registers[inst.rs2];
+
+        if(dividend == (-2147483647 - 1) && divisor == -1)
+            registers[inst.rd] = 0;
+        else if(divisor == 0)
+            registers[inst.rd] = (rishka_uxlen_t)(rishka_xlen_t) dividend;
+        else registers[inst.rd] = (rishka_uxlen_t)(rishka_xlen_t)(dividend % divisor);
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_REMUW) {
+        uint32_t dividend = (uint32_t) registers[inst.rs1], divisor = (uint32_t) registers[inst.rs2];
+
+        if(divisor == 0)
+            registers[inst.rd] = (rishka_uxlen_t) dividend;
+        else registers[inst.rd] = (rishka_uxlen_t)(dividend % divisor);
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_LUI)
+        registers[inst.rd] = (rishka_uxlen_t)(rishka_xlen_t) inst.imm;
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_AUIPC)
+        registers[inst.rd] = (rishka_uxlen_t)(RISHKA_VM_PC() + inst.imm);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_JAL)
+        this->pc = RISHKA_VM_PC();
+        if(inst.rd != 0)
+            registers[inst.rd] = (rishka_uxlen_t)(this->pc + RISHKA_VM_SIZE());
+
+        if(rishka_is_link(inst.rd))
+            RISHKA_VM_PUSH_RETURN(this->pc + RISHKA_VM_SIZE());
+
+        this->pc = (this->pc + inst.imm);
+        RISHKA_VM_EXIT_COUNTED(1, inst.rd != 0 || inst.imm <= 0);
+
+    // Returns take their successor from the return-address stack and other
+    // indirect jumps from the target cache entry of their own address, as
+    // the return-address stack hints of the specification describe.
+    RISHKA_VM_HANDLER(RISHKA_DOP_JALR) {
+        int64_t site = RISHKA_VM_PC();
+        int64_t pc = (site + RISHKA_VM_SIZE());
+
+        this->pc = ((int64_t)(rishka_uxlen_t)(registers[inst.rs1] + inst.imm) &- 2);
+        if(inst.rd != 0)
+            registers[inst.rd] = (rishka_uxlen_t) pc;
+
+        if(rishka_is_link(inst.rs1) && inst.rs1 != inst.rd) {
+            rishka_return_entry* entry = &this->returnStack[--this->returnTop & (RISHKA_VM_RETURN_STACK_SIZE - 1)];
+
+            if(entry->pc == this->pc)
+                link = entry->link;
+        }
+        else {
+            rishka_jump_entry* entry = &this->jumpCache[((uint64_t) site >> 1) & (RISHKA_VM_JUMP_CACHE_SIZE - 1)];
+
+            if(entry->site != site) {
+                entry->site = site;
+                entry->block = NULL;
+            }
+            link = &entry->block;
+        }
+
+        if(rishka_is_link(inst.rd))
+            RISHKA_VM_PUSH_RETURN(pc);
+        RISHKA_VM_EXIT_COUNTED(1, inst.rd != 0);
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_BEQ)
+        this->pc = RISHKA_VM_PC();
+        if(registers[inst.rs1] == registers[inst.rs2]) {
+            this->pc = (this->pc + inst.imm);
+            RISHKA_VM_EXIT_COUNTED(1, inst.imm <= 0);
+        }
+
+        this->pc = (this->pc + RISHKA_VM_SIZE());
+        RISHKA_VM_EXIT(0);
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_BNE)
+        this->pc = RISHKA_VM_PC();
+        if(registers[inst.rs1] != registers[inst.rs2]) {
+            this->pc = (this->pc + inst.imm);
+            RISHKA_VM_EXIT_COUNTED(1, inst.imm <= 0);
+        }
+
+        this->pc = (this->pc + RISHKA_VM_SIZE());
+        RISHKA_VM_EXIT(0);
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_BLT)
+        this->pc = RISHKA_VM_PC();
+        if((rishka_xlen_t) registers[inst.rs1] < (rishka_xlen_t) registers[inst.rs2]) {
+            this->pc = (this->pc + inst.imm);
+            RISHKA_VM_EXIT_COUNTED(1, inst.imm <= 0);
+        }
+
+        this->pc = (this->pc + RISHKA_VM_SIZE());
+        RISHKA_VM_EXIT(0);
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_BGE)
+        this->pc = RISHKA_VM_PC();
+        if((rishka_xlen_t) registers[inst.rs1] >= (rishka_xlen_t) registers[inst.rs2]) {
+            this->pc = (this->pc + inst.imm);
+            RISHKA_VM_EXIT_COUNTED(1, inst.imm <= 0);
+        }
+
+        this->pc = (this->pc + RISHKA_VM_SIZE());
+        RISHKA_VM_EXIT(0);
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_BLTU)
+        this->pc = RISHKA_VM_PC();
+        if(registers[inst.rs1] < registers[inst.rs2]) {
+            this->pc = (this->pc + inst.imm);
+            RISHKA_VM_EXIT_COUNTED(1, inst.imm <= 0);
+        }
+
+        this->pc = (this->pc + RISHKA_VM_SIZE());
+        RISHKA_VM_EXIT(0);
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_BGEU)
+        this->pc = RISHKA_VM_PC();
+        if(registers[inst.rs1] >= registers[inst.rs2]) {
+            this->pc = (this->pc + inst.imm);
+            RISHKA_VM_EXIT_COUNTED(1, inst.imm <= 0);
+        }
+
+        this->pc = (this->pc + RISHKA_VM_SIZE());
+        RISHKA_VM_EXIT(0);
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FENCE)
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FENCE_I)
+        this->invalidateDecodeCache();
+        this->pc = (RISHKA_VM_PC() + RISHKA_VM_SIZE());
+        RISHKA_VM_LEAVE();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_ECALL)
+        this->pc = RISHKA_VM_PC();
+        if(this->lockSyscalls()) {
+            registers[10] = this->handleSyscall(registers[17]);
+#if RISHKA_VM_PAGED_MEMORY
+            this->releaseParams();
+#endif
+            this->unlockSyscalls();
+        }
+
+        this->pc = (this->pc + RISHKA_VM_SIZE());
+        if(this->suspended && this->running) {
+            RISHKA_VM_RETIRE();
+            RISHKA_VM_RETURN(RISHKA_RUN_SYSCALL_BLOCKED);
+        }
+        RISHKA_VM_EXIT(0);
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_EBREAK)
+        this->exitCode = -1;
+        this->running = false;
+
+        this->pc = (RISHKA_VM_PC() + RISHKA_VM_SIZE());
+        RISHKA_VM_EXIT(0);
+
+    // The whole routine retires as this one instruction and returns to
+    // the caller, as its final ret would.
+    RISHKA_VM_HANDLER(RISHKA_DOP_HLE)
+        this->pc = RISHKA_VM_PC();
+
+#if RISHKA_VM_HLE
+        if(!this->emulateRoutine((uint8_t) inst.imm)) {
+            this->panic("Memory routine accessed memory out of bounds.");
+            RISHKA_VM_LEAVE();
+        }
+#endif
+
+        this->pc = ((int64_t) registers[1] &- 2);
+        RISHKA_VM_LEAVE();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_CSRRW) {
+        uint64_t value = registers[inst.rs1];
+
+        RISHKA_VM_SYNC_COUNTERS();
+        if(inst.rd != 0)
+            registers[inst.rd] = (rishka_uxlen_t) this->readCsr(inst.imm);
+        this->writeCsr(inst.imm, value);
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_CSRRS) {
+        RISHKA_VM_SYNC_COUNTERS();
+        uint64_t value = this->readCsr(inst.imm), mask = registers[inst.rs1];
+
+        if(inst.rs1 != 0)
+            this->writeCsr(inst.imm, value | mask);
+        if(inst.rd != 0)
+            registers[inst.rd] = (rishka_uxlen_t) value;
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_CSRRC) {
+        RISHKA_VM_SYNC_COUNTERS();
+        uint64_t value = this->readCsr(inst.imm), mask = registers[inst.rs1];
+
+        if(inst.rs1 != 0)
+            this->writeCsr(inst.imm, value &~mask);
+        if(inst.rd != 0)
+            registers[inst.rd] = (rishka_uxlen_t) value;
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_CSRRWI)
+        RISHKA_VM_SYNC_COUNTERS();
+        if(inst.rd != 0)
+            registers[inst.rd] = (rishka_uxlen_t) this->readCsr(inst.imm);
+        this->writeCsr(inst.imm, inst.rs1);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_CSRRSI) {
+        RISHKA_VM_SYNC_COUNTERS();
+        uint64_t value = this->readCsr(inst.imm);
+
+        if(inst.rs1 != 0)
+            this->writeCsr(inst.imm, value | inst.rs1);
+        if(inst.rd != 0)
+            registers[inst.rd] = (rishka_uxlen_t) value;
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_CSRRCI) {
+        RISHKA_VM_SYNC_COUNTERS();
+        uint64_t value = this->readCsr(inst.imm);
+
+        if(inst.rs1 != 0)
+            this->writeCsr(inst.imm, value &~(uint64_t) inst.rs1);
+        if(inst.rd != 0)
+            registers[inst.rd] = (rishka_uxlen_t) value;
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FLW) {
+        uint32_t value;
+
+        RISHKA_VM_LOAD(uint32_t, registers[inst.rs1] + (rishka_uxlen_t)(rishka_xlen_t) inst.imm, value);
+        fregisters[inst.rd] = (0xffffffff00000000ULL | value);
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FSW) {
+        uint64_t addr = (registers[inst.rs1] + (rishka_uxlen_t)(rishka_xlen_t) inst.imm);
+
+        RISHKA_VM_STORE(uint32_t, addr, (uint32_t) fregisters[inst.rs2]);
+        this->invalidateDecoded(addr, 4);
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FLD)
+        RISHKA_VM_LOAD(uint64_t, registers[inst.rs1] + (rishka_uxlen_t)(rishka_xlen_t) inst.imm, fregisters[inst.rd]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FSD) {
+        uint64_t addr = (registers[inst.rs1] + (rishka_uxlen_t)(rishka_xlen_t) inst.imm);
+
+        RISHKA_VM_STORE(uint64_t, addr, fregisters[inst.rs2]);
+        this->invalidateDecoded(addr, 8);
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FMADD_S) {
+        float a = rishka_fp_single(fregisters[inst.rs1]), b = rishka_fp_single(fregisters[inst.rs2]), c = rishka_fp_single(fregisters[inst.imm &31]);
+
+        fregisters[inst.rd] = rishka_fp_result(fmaf(a, b, c), a, b, c, &this->fcsr);
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FMSUB_S) {
+        float a = rishka_fp_single(fregisters[inst.rs1]), b = rishka_fp_single(fregisters[inst.rs2]), c = rishka_fp_single(fregisters[inst.imm &31]);
+
+        fregisters[inst.rd] = rishka_fp_result(fmaf(a, b, -c), a, b, c, &this->fcsr);
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FNMSUB_S) {
+        float a = rishka_fp_single(fregisters[inst.rs1]), b = rishka_fp_single(fregisters[inst.rs2]), c = rishka_fp_single(fregisters[inst.imm &31]);
+
+        fregisters[inst.rd] = rishka_fp_result(fmaf(-a, b, c), a, b, c, &this->fcsr);
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FNMADD_S) {
+        float a = rishka_fp_single(fregisters[inst.rs1]), b = rishka_fp_single(fregisters[inst.rs2]), c = rishka_fp_single(fregisters[inst.imm &31]);
+
+        fregisters[inst.rd] = rishka_fp_result(fmaf(-a, b, -c), a, b, c, &this->fcsr);
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FADD_S) {
+        float a = rishka_fp_single(fregisters[inst.rs1]), b = rishka_fp_single(fregisters[inst.rs2]);
+
+        fregisters[inst.rd] = rishka_fp_result((float)(a + b), a, b, b, &this->fcsr);
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FSUB_S) {
+        float a = rishka_fp_single(fregisters[inst.rs1]), b = rishka_fp_single(fregisters[inst.rs2]);
+
+        fregisters[inst.rd] = rishka_fp_result((float)(a - b), a, b, b, &this->fcsr);
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FMUL_S) {
+        float a = rishka_fp_single(fregisters[inst.rs1]), b = rishka_fp_single(fregisters[inst.rs2]);
+
+        fregisters[inst.rd] = rishka_fp_result((float)(a * b), a, b, b, &this->fcsr);
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FDIV_S)
+        fregisters[inst.rd] = rishka_fp_divide(rishka_fp_single(fregisters[inst.rs1]), rishka_fp_single(fregisters[inst.rs2]), &this->fcsr);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FSQRT_S) {
+        float a = rishka_fp_single(fregisters[inst.rs1]);
+
+        fregisters[inst.rd] = rishka_fp_result(sqrtf(a), a, a, a, &this->fcsr);
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FSGNJ_S)
+        fregisters[inst.rd] = (0xffffffff00000000ULL | (rishka_fp_bits(fregisters[inst.rs1]) &0x7fffffffU) |
+            (rishka_fp_bits(fregisters[inst.rs2]) &0x80000000U));
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FSGNJN_S)
+        fregisters[inst.rd] = (0xffffffff00000000ULL | (rishka_fp_bits(fregisters[inst.rs1]) &0x7fffffffU) |
+            (~rishka_fp_bits(fregisters[inst.rs2]) &0x80000000U));
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FSGNJX_S)
+        fregisters[inst.rd] = (0xffffffff00000000ULL | (rishka_fp_bits(fregisters[inst.rs1]) ^
+            (rishka_fp_bits(fregisters[inst.rs2]) &0x80000000U)));
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FMIN_S)
+        fregisters[inst.rd] = rishka_fp_minmax(rishka_fp_single(fregisters[inst.rs1]), rishka_fp_single(fregisters[inst.rs2]), false, &this->fcsr);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FMAX_S)
+        fregisters[inst.rd] = rishka_fp_minmax(rishka_fp_single(fregisters[inst.rs1]), rishka_fp_single(fregisters[inst.rs2]), true, &this->fcsr);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FCVT_W_S) {
+        rishka_uxlen_t value = (rishka_uxlen_t)(rishka_xlen_t) rishka_fp_to_integer<int32_t>(rishka_fp_single(fregisters[inst.rs1]), RISHKA_VM_ROUNDING(), &this->fcsr);
+
+        if(inst.rd != 0)
+            registers[inst.rd] = value;
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FCVT_WU_S) {
+        rishka_uxlen_t value = (rishka_uxlen_t)(rishka_xlen_t)(int32_t) rishka_fp_to_integer<uint32_t>(rishka_fp_single(fregisters[inst.rs1]), RISHKA_VM_ROUNDING(), &this->fcsr);
+
+        if(inst.rd != 0)
+            registers[inst.rd] = value;
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FCVT_L_S) {
+        rishka_uxlen_t value = (rishka_uxlen_t) rishka_fp_to_integer<int64_t>(rishka_fp_single(fregisters[inst.rs1]), RISHKA_VM_ROUNDING(), &this->fcsr);
+
+        if(inst.rd != 0)
+            registers[inst.rd] = value;
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FCVT_LU_S) {
+        rishka_uxlen_t value = (rishka_uxlen_t) rishka_fp_to_integer<uint64_t>(rishka_fp_single(fregisters[inst.rs1]), RISHKA_VM_ROUNDING(), &this->fcsr);
+
+        if(inst.rd != 0)
+            registers[inst.rd] = value;
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FCVT_S_W)
+        fregisters[inst.rd] = rishka_fp_box((float)(int32_t) registers[inst.rs1]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FCVT_S_WU)
+        fregisters[inst.rd] = rishka_fp_box((float)(uint32_t) registers[inst.rs1]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FCVT_S_L)
+        fregisters[inst.rd] = rishka_fp_box((float)(int64_t)(rishka_xlen_t) registers[inst.rs1]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FCVT_S_LU)
+        fregisters[inst.rd] = rishka_fp_box((float)(uint64_t) registers[inst.rs1]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FMV_X_W)
+        registers[inst.rd] = (rishka_uxlen_t)(rishka_xlen_t)(int32_t)(uint32_t) fregisters[inst.rs1];
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FMV_W_X)
+        fregisters[inst.rd] = (0xffffffff00000000ULL | (uint32_t) registers[inst.rs1]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FEQ_S) {
+        rishka_uxlen_t value = rishka_fp_compare(rishka_fp_single(fregisters[inst.rs1]), rishka_fp_single(fregisters[inst.rs2]), RISHKA_DOP_FEQ_S, true, &this->fcsr) ? 1 : 0;
+
+        if(inst.rd != 0)
+            registers[inst.rd] = value;
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FLT_S) {
+        rishka_uxlen_t value = rishka_fp_compare(rishka_fp_single(fregisters[inst.rs1]), rishka_fp_single(fregisters[inst.rs2]), RISHKA_DOP_FLT_S, false, &this->fcsr) ? 1 : 0;
+
+        if(inst.rd != 0)
+            registers[inst.rd] = value;
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FLE_S) {
+        rishka_uxlen_t value = rishka_fp_compare(rishka_fp_single(fregisters[inst.rs1]), rishka_fp_single(fregisters[inst.rs2]), RISHKA_DOP_FLE_S, false, &this->fcsr) ? 1 : 0;
+
+        if(inst.rd != 0)
+            registers[inst.rd] = value;
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FCLASS_S)
+        registers[inst.rd] = rishka_fp_classify(rishka_fp_single(fregisters[inst.rs1]));
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FMADD_D) {
+        double a = rishka_fp_double(fregisters[inst.rs1]), b = rishka_fp_double(fregisters[inst.rs2]), c = rishka_fp_double(fregisters[inst.imm &31]);
+
+        fregisters[inst.rd] = rishka_fp_result(fma(a, b, c), a, b, c, &this->fcsr);
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FMSUB_D) {
+        double a = rishka_fp_double(fregisters[inst.rs1]), b = rishka_fp_double(fregisters[inst.rs2]), c = rishka_fp_double(fregisters[inst.imm &31]);
+
+        fregisters[inst.rd] = rishka_fp_result(fma(a, b, -c), a, b, c, &this->fcsr);
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FNMSUB_D) {
+        double a = rishka_fp_double(fregisters[inst.rs1]), b = rishka_fp_double(fregisters[inst.rs2]), c = rishka_fp_double(fregisters[inst.imm &31]);
+
+        fregisters[inst.rd] = rishka_fp_result(fma(-a, b, c), a, b, c, &this->fcsr);
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FNMADD_D) {
+        double a = rishka_fp_double(fregisters[inst.rs1]), b = rishka_fp_double(fregisters[inst.rs2]), c = rishka_fp_double(fregisters[inst.imm &31]);
+
+        fregisters[inst.rd] = rishka_fp_result(fma(-a, b, -c), a, b, c, &this->fcsr);
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FADD_D) {
+        double a = rishka_fp_double(fregisters[inst.rs1]), b = rishka_fp_double(fregisters[inst.rs2]);
+
+        fregisters[inst.rd] = rishka_fp_result((double)(a + b), a, b, b, &this->fcsr);
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FSUB_D) {
+        double a = rishka_fp_double(fregisters[inst.rs1]), b = rishka_fp_double(fregisters[inst.rs2]);
+
+        fregisters[inst.rd] = rishka_fp_result((double)(a - b), a, b, b, &this->fcsr);
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FMUL_D) {
+        double a = rishka_fp_double(fregisters[inst.rs1]), b = rishka_fp_double(fregisters[inst.rs2]);
+
+        fregisters[inst.rd] = rishka_fp_result((double)(a * b), a, b, b, &this->fcsr);
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FDIV_D)
+        fregisters[inst.rd] = rishka_fp_divide(rishka_fp_double(fregisters[inst.rs1]), rishka_fp_double(fregisters[inst.rs2]), &this->fcsr);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FSQRT_D) {
+        double a = rishka_fp_double(fregisters[inst.rs1]);
+
+        fregisters[inst.rd] = rishka_fp_result(sqrt(a), a, a, a, &this->fcsr);
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FSGNJ_D)
+        fregisters[inst.rd] = ((fregisters[inst.rs1] &0x7fffffffffffffffULL) | (fregisters[inst.rs2] &0x8000000000000000ULL));
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FSGNJN_D)
+        fregisters[inst.rd] = ((fregisters[inst.rs1] &0x7fffffffffffffffULL) | (~fregisters[inst.rs2] &0x8000000000000000ULL));
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FSGNJX_D)
+        fregisters[inst.rd] = (fregisters[inst.rs1] ^ (fregisters[inst.rs2] &0x8000000000000000ULL));
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FMIN_D)
+        fregisters[inst.rd] = rishka_fp_minmax(rishka_fp_double(fregisters[inst.rs1]), rishka_fp_double(fregisters[inst.rs2]), false, &this->fcsr);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FMAX_D)
+        fregisters[inst.rd] = rishka_fp_minmax(rishka_fp_double(fregisters[inst.rs1]), rishka_fp_double(fregisters[inst.rs2]), true, &this->fcsr);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FCVT_W_D) {
+        rishka_uxlen_t value = (rishka_uxlen_t)(rishka_xlen_t) rishka_fp_to_integer<int32_t>(rishka_fp_double(fregisters[inst.rs1]), RISHKA_VM_ROUNDING(), &this->fcsr);
+
+        if(inst.rd != 0)
+            registers[inst.rd] = value;
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FCVT_WU_D) {
+        rishka_uxlen_t value = (rishka_uxlen_t)(rishka_xlen_t)(int32_t) rishka_fp_to_integer<uint32_t>(rishka_fp_double(fregisters[inst.rs1]), RISHKA_VM_ROUNDING(), &this->fcsr);
+
+        if(inst.rd != 0)
+            registers[inst.rd] = value;
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FCVT_L_D) {
+        rishka_uxlen_t value = (rishka_uxlen_t) rishka_fp_to_integer<int64_t>(rishka_fp_double(fregisters[inst.rs1]), RISHKA_VM_ROUNDING(), &this->fcsr);
+
+        if(inst.rd != 0)
+            registers[inst.rd] = value;
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FCVT_LU_D) {
+        rishka_uxlen_t value = (rishka_uxlen_t) rishka_fp_to_integer<uint64_t>(rishka_fp_double(fregisters[inst.rs1]), RISHKA_VM_ROUNDING(), &this->fcsr);
+
+        if(inst.rd != 0)
+            registers[inst.rd] = value;
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FCVT_D_W)
+        fregisters[inst.rd] = rishka_fp_box((double)(int32_t) registers[inst.rs1]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FCVT_D_WU)
+        fregisters[inst.rd] = rishka_fp_box((double)(uint32_t) registers[inst.rs1]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FCVT_D_L)
+        fregisters[inst.rd] = rishka_fp_box((double)(int64_t)(rishka_xlen_t) registers[inst.rs1]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FCVT_D_LU)
+        fregisters[inst.rd] = rishka_fp_box((double)(uint64_t) registers[inst.rs1]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FMV_X_D)
+        registers[inst.rd] = (rishka_uxlen_t) fregisters[inst.rs1];
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FMV_D_X)
+        fregisters[inst.rd] = (uint64_t) registers[inst.rs1];
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FEQ_D) {
+        rishka_uxlen_t value = rishka_fp_compare(rishka_fp_double(fregisters[inst.rs1]), rishka_fp_double(fregisters[inst.rs2]), RISHKA_DOP_FEQ_S, true, &this->fcsr) ? 1 : 0;
+
+        if(inst.rd != 0)
+            registers[inst.rd] = value;
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FLT_D) {
+        rishka_uxlen_t value = rishka_fp_compare(rishka_fp_double(fregisters[inst.rs1]), rishka_fp_double(fregisters[inst.rs2]), RISHKA_DOP_FLT_S, false, &this->fcsr) ? 1 : 0;
+
+        if(inst.rd != 0)
+            registers[inst.rd] = value;
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FLE_D) {
+        rishka_uxlen_t value = rishka_fp_compare(rishka_fp_double(fregisters[inst.rs1]), rishka_fp_double(fregisters[inst.rs2]), RISHKA_DOP_FLE_S, false, &this->fcsr) ? 1 : 0;
+
+        if(inst.rd != 0)
+            registers[inst.rd] = value;
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FCLASS_D)
+        registers[inst.rd] = rishka_fp_classify(rishka_fp_double(fregisters[inst.rs1]));
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FCVT_S_D) {
+        double a = rishka_fp_double(fregisters[inst.rs1]);
+
+        if(rishka_fp_signaling(a))
+            this->fcsr |= RISHKA_FFLAG_NV;
+        fregisters[inst.rd] = a != a ? rishka_fp_canonical(0.0f) : rishka_fp_box((float) a);
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_FCVT_D_S) {
+        float a = rishka_fp_single(fregisters[inst.rs1]);
+
+        if(rishka_fp_signaling(a))
+            this->fcsr |= RISHKA_FFLAG_NV;
+        fregisters[inst.rd] = a != a ? rishka_fp_canonical(0.0) : rishka_fp_box((double) a);
+        RISHKA_VM_NEXT();
+    }
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_SH1ADD)
+        registers[inst.rd] = ((registers[inst.rs1] << 1) + registers[inst.rs2]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_SH2ADD)
+        registers[inst.rd] = ((registers[inst.rs1] << 2) + registers[inst.rs2]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_SH3ADD)
+        registers[inst.rd] = ((registers[inst.rs1] << 3) + registers[inst.rs2]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_ADD_UW)
+        registers[inst.rd] = ((rishka_uxlen_t)(uint32_t) registers[inst.rs1] + registers[inst.rs2]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_SH1ADD_UW)
+        registers[inst.rd] = (((rishka_uxlen_t)(uint32_t) registers[inst.rs1] << 1) + registers[inst.rs2]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_SH2ADD_UW)
+        registers[inst.rd] = (((rishka_uxlen_t)(uint32_t) registers[inst.rs1] << 2) + registers[inst.rs2]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_SH3ADD_UW)
+        registers[inst.rd] = (((rishka_uxlen_t)(uint32_t) registers[inst.rs1] << 3) + registers[inst.rs2]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_SLLI_UW)
+        registers[inst.rd] = ((uint64_t)(uint32_t) registers[inst.rs1] << inst.imm);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_ANDN)
+        registers[inst.rd] = (registers[inst.rs1] &~registers[inst.rs2]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_ORN)
+        registers[inst.rd] = (registers[inst.rs1] | ~registers[inst.rs2]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_XNOR)
+        registers[inst.rd] = ~(registers[inst.rs1] ^ registers[inst.rs2]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_CLZ)
+        registers[inst.rd] = rishka_bit_clz(registers[inst.rs1]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_CTZ)
+        registers[inst.rd] = rishka_bit_ctz(registers[inst.rs1]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_CPOP)
+        registers[inst.rd] = rishka_bit_cpop(registers[inst.rs1]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_CLZW)
+        registers[inst.rd] = rishka_bit_clz((uint32_t) registers[inst.rs1]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_CTZW)
+        registers[inst.rd] = rishka_bit_ctz((uint32_t) registers[inst.rs1]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_CPOPW)
+        registers[inst.rd] = rishka_bit_cpop((uint32_t) registers[inst.rs1]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_MAX)
+        registers[inst.rd] = ((rishka_xlen_t) registers[inst.rs1] < (rishka_xlen_t) registers[inst.rs2]) ?
+            registers[inst.rs2] : registers[inst.rs1];
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_MAXU)
+        registers[inst.rd] = (registers[inst.rs1] < registers[inst.rs2]) ?
+            registers[inst.rs2] : registers[inst.rs1];
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_MIN)
+        registers[inst.rd] = ((rishka_xlen_t) registers[inst.rs1] < (rishka_xlen_t) registers[inst.rs2]) ?
+            registers[inst.rs1] : registers[inst.rs2];
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_MINU)
+        registers[inst.rd] = (registers[inst.rs1] < registers[inst.rs2]) ?
+            registers[inst.rs1] : registers[inst.rs2];
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_SEXT_B)
+        registers[inst.rd] = (rishka_uxlen_t)(rishka_xlen_t)(int8_t) registers[inst.rs1];
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_SEXT_H)
+        registers[inst.rd] = (rishka_uxlen_t)(rishka_xlen_t)(int16_t) registers[inst.rs1];
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_ZEXT_H)
+        registers[inst.rd] = (uint16_t) registers[inst.rs1];
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_ROL)
+        registers[inst.rd] = rishka_bit_rotate_left(registers[inst.rs1], (uint32_t) registers[inst.rs2]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_ROR)
+        registers[inst.rd] = rishka_bit_rotate_right(registers[inst.rs1], (uint32_t) registers[inst.rs2]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_RORI)
+        registers[inst.rd] = rishka_bit_rotate_right(registers[inst.rs1], (uint32_t) inst.imm);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_ROLW)
+        registers[inst.rd] = (rishka_uxlen_t)(rishka_xlen_t)(int32_t) rishka_bit_rotate_left((uint32_t) registers[inst.rs1], (uint32_t) registers[inst.rs2]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_RORW)
+        registers[inst.rd] = (rishka_uxlen_t)(rishka_xlen_t)(int32_t) rishka_bit_rotate_right((uint32_t) registers[inst.rs1], (uint32_t) registers[inst.rs2]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_RORIW)
+        registers[inst.rd] = (rishka_uxlen_t)(rishka_xlen_t)(int32_t) rishka_bit_rotate_right((uint32_t) registers[inst.rs1], (uint32_t) inst.imm);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_ORC_B)
+        registers[inst.rd] = rishka_bit_orc_b(registers[inst.rs1]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_REV8)
+        registers[inst.rd] = rishka_bit_rev8(registers[inst.rs1]);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_BCLR)
+        registers[inst.rd] = (registers[inst.rs1] &~((rishka_uxlen_t) 1 << (registers[inst.rs2] &(RISHKA_VM_XLEN - 1))));
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_BCLRI)
+        registers[inst.rd] = (registers[inst.rs1] &~((rishka_uxlen_t) 1 << inst.imm));
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_BEXT)
+        registers[inst.rd] = ((registers[inst.rs1] >> (registers[inst.rs2] &(RISHKA_VM_XLEN - 1))) &1);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_BEXTI)
+        registers[inst.rd] = ((registers[inst.rs1] >> inst.imm) &1);
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_BINV)
+        registers[inst.rd] = (registers[inst.rs1] ^ ((rishka_uxlen_t) 1 << (registers[inst.rs2] &(RISHKA_VM_XLEN - 1))));
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_BINVI)
+        registers[inst.rd] = (registers[inst.rs1] ^ ((rishka_uxlen_t) 1 << inst.imm));
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_BSET)
+        registers[inst.rd] = (registers[inst.rs1] | ((rishka_uxlen_t) 1 << (registers[inst.rs2] &(RISHKA_VM_XLEN - 1))));
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_BSETI)
+        registers[inst.rd] = (registers[inst.rs1] | ((rishka_uxlen_t) 1 << inst.imm));
+        RISHKA_VM_NEXT();
+
+    // With rs1 = x0, the vector length becomes the maximum if rd is not x0,
+    // and is kept otherwise.
+    RISHKA_VM_HANDLER(RISHKA_DOP_VSETVLI)
+        this->configureVector((rishka_uxlen_t) inst.imm, inst.rs1 != 0 ?
+            (uint64_t) registers[inst.rs1] : inst.rd != 0 ? UINT64_MAX : this->vl);
+        if(inst.rd != 0)
+            registers[inst.rd] = this->vl;
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_VSETIVLI)
+        this->configureVector((rishka_uxlen_t) inst.imm, inst.rs1);
+        if(inst.rd != 0)
+            registers[inst.rd] = this->vl;
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_VSETVL)
+        this->configureVector(registers[inst.rs2], inst.rs1 != 0 ?
+            (uint64_t) registers[inst.rs1] : inst.rd != 0 ? UINT64_MAX : this->vl);
+        if(inst.rd != 0)
+            registers[inst.rd] = this->vl;
+        RISHKA_VM_NEXT();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_VLE)
+    RISHKA_VM_HANDLER(RISHKA_DOP_VSE)
+    RISHKA_VM_HANDLER(RISHKA_DOP_VALU)
+    RISHKA_VM_HANDLER(RISHKA_DOP_VCMP)
+    RISHKA_VM_HANDLER(RISHKA_DOP_VMERGE)
+    RISHKA_VM_HANDLER(RISHKA_DOP_VRED)
+    RISHKA_VM_HANDLER(RISHKA_DOP_VMASK)
+    RISHKA_VM_HANDLER(RISHKA_DOP_VMV_X_S)
+    RISHKA_VM_HANDLER(RISHKA_DOP_VMV_S_X)
+    RISHKA_VM_HANDLER(RISHKA_DOP_VCPOP)
+    RISHKA_VM_HANDLER(RISHKA_DOP_VFIRST)
+    RISHKA_VM_HANDLER(RISHKA_DOP_VID)
+        if(this->executeVector(inst)) {
+            RISHKA_VM_NEXT();
+        }
+
+        this->pc = RISHKA_VM_PC();
+        this->panic(rishka_invalid_messages[RISHKA_INVALID_VECTOR]);
+
+        this->pc = (this->pc + RISHKA_VM_SIZE());
+        RISHKA_VM_LEAVE();
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_UNDECODED)
+        this->pc = RISHKA_VM_PC();
+
+        // Straight-line code keeps running without another block lookup:
+        // code outside the decode cache is stepped through the scratch
+        // buffer, and entries of the decode cache are decoded in place.
+        if(origin == scratch) {
+            if(--remaining <= 0)
+                RISHKA_VM_RETURN(RISHKA_RUN_BUDGET_EXHAUSTED);
+            this->decodeAt(this->pc, &scratch[0]);
+
+            cursor = scratch;
+            base = this->pc;
+            RISHKA_VM_DISPATCH();
+        }
+        else if(cursor < &this->decodeCache[RISHKA_VM_DECODE_CACHE_SIZE]) {
+            this->decodeAt(this->pc, cursor);
+            RISHKA_VM_DISPATCH();
+        }
+
+        remaining -= runLength;
+        block = NULL;
+        goto resolve;
+
+    RISHKA_VM_HANDLER(RISHKA_DOP_INVALID)
+#if !RISHKA_VM_COMPUTED_GOTO
+    default:
+#endif
+        this->pc = RISHKA_VM_PC();
+        this->panic(rishka_invalid_messages[inst.op == RISHKA_DOP_INVALID ?
+            inst.imm : RISHKA_INVALID_OPCODE]);
+
+        this->pc = (this->pc + RISHKA_VM_SIZE());
+        RISHKA_VM_LEAVE();
+
+#if !RISHKA_VM_COMPUTED_GOTO
+        }
+    }
+#endif
+
+    #undef RISHKA_VM_HANDLER
+    #undef RISHKA_VM_DISPATCH
+    #undef RISHKA_VM_NEXT
+    #undef RISHKA_VM_PC
+    #undef RISHKA_VM_SIZE
+    #undef RISHKA_VM_ROUNDING
+    #undef RISHKA_VM_RETIRE
+    #undef RISHKA_VM_EXIT
+    #undef RISHKA_VM_EXIT_COUNTED
+    #undef RISHKA_VM_LEAVE
+    #undef RISHKA_VM_RETIRED
+    #undef RISHKA_VM_RETURN
+    #undef RISHKA_VM_SYNC_COUNTERS
+}
+
+rishka_block* RishkaVM::lookupBlock(int64_t pc) {
+    rishka_block* block = &this->blockCache[((uint64_t) pc >> 2) & (RISHKA_VM_BLOCK_CACHE_SIZE - 1)];
+
+    return block->pc == pc ? block : NULL;
+}
+
+bool RishkaVM::isHot(int64_t pc, bool fromBlock, bool counted) {
+    switch(this->tierPolicy) {
+        case RISHKA_TIER_EAGER:
+            return true;
+
+        case RISHKA_TIER_INTERPRET:
+            return false;
+
+        default:
+            break;
+    }
+
+#if RISHKA_VM_AOT
+    // Translated code is as hot as it gets from the start.
+    if(this->translations != NULL && rishka_aot_lookup(this->translations, pc) != NULL)
+        return true;
+#endif
+
+    if(fromBlock)
+        return true;
+    else if(!counted)
+        return false;
+
+    uint16_t* counter = &this->hotness[((uint64_t) pc >> 2) & (RISHKA_VM_HOTNESS_TABLE_SIZE - 1)];
+    if(++(*counter) < this->promotionThreshold)
+        return false;
+
+    *counter = 0;
+    return true;
+}
+
+rishka_block* RishkaVM::translateBlock(int64_t pc) {
+    if((pc & 1) != 0 || ((uint64_t) pc >> 1) >= RISHKA_VM_DECODE_CACHE_SIZE)
+        return NULL;
+
+    rishka_block* block = &this->blockCache[((uint64_t) pc >> 2) & (RISHKA_VM_BLOCK_CACHE_SIZE - 1)];
+    if(block->pc != -1)
+        this->tierStats.evictions++;
+    this->tierStats.promotions++;
+
+    block->pc = pc;
+    block->next[0] = NULL;
+    block->next[1] = NULL;
+    block->length = (uint16_t) this->measureRun(pc, RISHKA_VM_DECODE_CACHE_SIZE);
+
+#if RISHKA_VM_JIT || RISHKA_VM_AOT
+    block->native = NULL;
+#endif
+
+#if RISHKA_VM_JIT
+    block->hits = 0;
+#endif
+
+#if RISHKA_VM_AOT
+    block->precompiled = false;
+    if(this->translations != NULL)
+        this->attachTranslation(block);
+#endif
+
+    return block;
+}
+
+uint32_t RishkaVM::measureRun(int64_t pc, uint32_t limit) {
+    uint32_t length = 0;
+
+    for(uint64_t index = ((uint64_t) pc >> 1); index < RISHKA_VM_DECODE_CACHE_SIZE && length <= limit; index += this->decodeCache[index].length) {
+        rishka_decoded_inst* decoded = &this->decodeCache[index];
+
+        if(decoded->op == RISHKA_DOP_UNDECODED)
+            this->decodeAt(index << 1, decoded);
+
+        length++;
+        if(rishka_ends_block(decoded->op))
+            break;
+    }
+
+    return length;
+}
+
+#if RISHKA_VM_JIT
+void RishkaVM::translateNative(rishka_block* block) {
+    block->native = this->jit.compile(this->decodeCache, block->pc,
+        this, RishkaVM::nativeStoreHook);
+
+    if(block->native == NULL && this->jit.isFull()) {
+        for(uint32_t i = 0; i < RISHKA_VM_BLOCK_CACHE_SIZE; i++) {
+#if RISHKA_VM_AOT
+            if(this->blockCache[i].precompiled)
+                continue;
+#endif
+
+            this->blockCache[i].native = NULL;
+            this->blockCache[i].hits = 0;
+        }
+
+        this->jit.reset();
+        this->tierStats.nativeFlushes++;
+
+        block->native = this->jit.compile(this->decodeCache, block->pc,
+            this, RishkaVM::nativeStoreHook);
+    }
+
+    if(block->native != NULL)
+        this->tierStats.nativeTranslations++;
+}
+
+#endif
+
+#if RISHKA_VM_AOT
+void RishkaVM::attachTranslation(rishka_block* block) {
+    const rishka_aot_block* translation = rishka_aot_lookup(this->translations, block->pc);
+
+    // The block must run at least as far as the translation does, without
+    // a known routine in between, and its code must not have been rewritten.
+    if(translation == NULL || block->length < translation->length ||
+        this->decodeCache[(uint64_t) block->pc >> 1].op == RISHKA_DOP_HLE ||
+        rishka_guest_hash(this->guestMemory(), block->pc, translation->size) != translation->checksum)
+        return;
+
+    block->native = translation->entry;
+    block->precompiled = true;
+    this->tierStats.precompiledBlocks++;
+}
+#endif
+
+#if RISHKA_VM_CODE_CACHE
+void RishkaVM::restoreCodeCache(uint32_t size) {
+    // Only code inside the decode cache range has entries to keep.
+    if(this->layout.codeAddress >= (RISHKA_VM_DECODE_CACHE_SIZE << 1))
+        return;
+
+    rishka_code_cache_describe(&this->codeImage, this->guestMemory(), (uint32_t) this->layout.codeAddress, size);
+    this->codeImage.restored = rishka_code_cache_restore(&this->codeImage, this->decodeCache);
+    this->tierStats.restoredEntries += this->codeImage.restored;
+
+#if RISHKA_VM_HLE
+    // Known routines are decoded by symbol, which may differ from the
+    // symbol table of the run that wrote the cache.
+    for(uint8_t routine = 0; routine < RISHKA_HLE_COUNT; routine++)
+        if(this->routines[routine] >= 0 && ((uint64_t) this->routines[routine] >> 1) < RISHKA_VM_DECODE_CACHE_SIZE)
+            memset(&this->decodeCache[(uint64_t) this->routines[routine] >> 1], 0, sizeof(rishka_decoded_inst));
+#endif
+}
+
+void RishkaVM::storeCodeCache() {
+    if(this->codeImage.size == 0)
+        return;
+
+    rishka_code_cache_store(&this->codeImage, this->guestMemory(), this->decodeCache);
+    this->codeImage.size = 0;
+}
+#endif
+
+#if RISHKA_VM_JIT || RISHKA_VM_AOT
+bool RishkaVM::nativeStoreHook(void* vm, uint64_t address, uint8_t size) {
+    return ((RishkaVM*) vm)->invalidateDecoded(address, size);
+}
+#endif
+
+#if RISHKA_VM_AOT && RISHKA_VM_PAGED_MEMORY
+void RishkaVM::nativeAccessHook(void* vm, uint64_t address, void* data, uint8_t size, bool write) {
+    RishkaVM* hart = (RishkaVM*) vm;
+
+    if(write ? hart->writeMemory(address, data, size) : hart->readMemory(address, data, size))
+        return;
+
+    if(!write)
+        memset(data, 0, size);
+
+    // The block runs on to its exit, where the interpreter stops.
+    if(hart->running)
+        hart->panic(rishka_memory_fault);
+}
+#endif
+
+inline bool RishkaVM::invalidateDecoded(uint64_t address, uint32_t size) {
+    if(address >= (RISHKA_VM_DECODE_CACHE_SIZE << 1))
+        return false;
 
-    switch(opcode) {
-        case RISHKA_OPINST_LOAD: {
-            uint32_t function_code_3 = ((inst >> 12) &7);
-            int64_t immediate = (int64_t)(((int32_t)((uint32_t)((inst >> 20) &4095) << 20)) >> 20);
-            uint64_t addr = ((((rishka_u64_arrptr*) &this->registers)->a).v[rs1] + (uint64_t) immediate);
+    // A 32-bit instruction in the halfword before the store may span into it.
+    uint64_t first = (address >> 1);
+    if(first > 0 && this->decodeCache[first - 1].length == 2)
+        first--;
 
-            int64_t val;
-            switch(function_code_3) {
-                case RISHKA_FC3_LB:
-                    val = (int64_t)(*(&(((rishka_u8_arrptr*) &this->memory)->a).v[addr]));
-                    break;
+    uint64_t last = ((address + size - 1) >> 1);
+    if(last >= RISHKA_VM_DECODE_CACHE_SIZE)
+        last = RISHKA_VM_DECODE_CACHE_SIZE - 1;
 
-                case RISHKA_FC3_LHW:
-                    val = (int64_t)(*(uint16_t*)(&(((rishka_u8_arrptr*) &this->memory)->a).v[addr]));
-                    break;
+    bool translated = false;
+    for(uint64_t index = first; index <= last; index++)
+        if(this->decodeCache[index].op != RISHKA_DOP_UNDECODED) {
+            this->decodeCache[index].op = RISHKA_DOP_UNDECODED;
+            translated = true;
+        }
 
-                case RISHKA_FC3_LW:
-                    val = (int64_t) (*(uint32_t*)(&(((rishka_u8_arrptr*) &this->memory)->a).v[addr]));
-                    break;
+    if(translated) {
+        this->tierStats.invalidations++;
+        this->invalidateBlockCache();
+    }
 
-                case RISHKA_FC3_LDW:
-                    val = (int64_t)(*(uint64_t*)(&(((rishka_u8_arrptr*) &this->memory)->a).v[addr]));
-                    break;
+    return translated;
+}
 
-                case RISHKA_FC3_LBU:
-                    val = (int64_t)(*(&(((rishka_u8_arrptr*) &this->memory)->a).v[addr]));
-                    break;
+void RishkaVM::invalidateDecodeCache() {
+    memset(this->decodeCache, 0, sizeof(this->decodeCache));
+    memset(this->hotness, 0, sizeof(this->hotness));
 
-                case RISHKA_FC3_LHU:
-                    val = (int64_t)(*(uint16_t*)(&(((rishka_u8_arrptr*) &this->memory)->a).v[addr]));
-                    break;
+    this->invalidateBlockCache();
+}
 
-                case RISHKA_FC3_LRES:
-                    val = (int64_t)(*(uint32_t*)(&(((rishka_u8_arrptr*) &this->memory)->a).v[addr]));
-                    break;
+void RishkaVM::invalidateBlockCache() {
+    for(uint32_t i = 0; i < RISHKA_VM_BLOCK_CACHE_SIZE; i++) {
+        this->blockCache[i].pc = -1;
+        this->blockCache[i].next[0] = NULL;
+        this->blockCache[i].next[1] = NULL;
+    }
 
-                default:
-                    this->panic("Invalid load instruction.");
-                    break;
-            }
+#if RISHKA_VM_JIT
+    this->jit.reset();
+#endif
+}
+
+inline void RishkaVM::decodeAt(int64_t pc, rishka_decoded_inst* decoded) {
+    RishkaVM::decode(this->fetch(pc), decoded);
+
+#if RISHKA_VM_HLE
+    if(!this->hasRoutines)
+        return;
 
-            if(rd != 0)
-                (((rishka_u64_arrptr*) &this->registers)->a).v[rd] = (uint64_t) val;
+    for(uint8_t routine = 0; routine < RISHKA_HLE_COUNT; routine++)
+        if(this->routines[routine] == pc) {
+            decoded->op = RISHKA_DOP_HLE;
+            decoded->imm = routine;
             break;
         }
-    
-        case RISHKA_OPINST_STORE: {
-            uint32_t function_code_3 = ((inst >> 12) &7);
-            int64_t immediate = (int64_t)(((int32_t)((uint32_t)(((inst >> 20) &4064) | ((inst >> 7) &31)) << 20)) >> 20);
+#endif
+}
 
-            uint64_t addr = ((((rishka_u64_arrptr*) &this->registers)->a).v[rs1] + (uint64_t) immediate);
-            uint64_t val = (((rishka_u64_arrptr*) &this->registers)->a).v[rs2];
+#if RISHKA_VM_HLE
+static const char* const rishka_hle_symbols[] = {
+    "_ZN6Memory3setEPvhj",
+    "_ZN6Memory4copyEPvS0_j",
+    "memset",
+    "memcpy",
+    "memmove",
+    "strlen"
+};
 
-            switch(function_code_3) {
-                case RISHKA_FC3_SB:
-                    (*(&(((rishka_u8_arrptr*) &this->memory)->a).v[addr])) = val;
-                    break;
+static_assert(sizeof(rishka_hle_symbols) / sizeof(rishka_hle_symbols[0]) == RISHKA_HLE_COUNT,
+    "Symbol table does not match rishka_hle_routine.");
 
-                case RISHKA_FC3_SHW:
-                    (*(uint16_t*)(&(((rishka_u8_arrptr*) &this->memory)->a).v[addr])) = val;
-                    break;
+void RishkaVM::loadSymbols(String fileName) {
+    memset(this->routines, -1, sizeof(this->routines));
+    this->hasRoutines = false;
 
-                case RISHKA_FC3_SW:
-                    (*(uint32_t*)(&(((rishka_u8_arrptr*) &this->memory)->a).v[addr])) = val;
-                    break;
+    if(!SD.exists(fileName))
+        return;
 
-                case RISHKA_FC3_SDW:
-                    (*(uint64_t*)(&(((rishka_u8_arrptr*) &this->memory)->a).v[addr])) = val;
-                    break;
+    File file = SD.open(fileName);
+    if(!file)
+        return;
 
-                default:
-                    this->panic("Invalid store instruction.");
-                    break;
-            }
-            break;
+    char line[96];
+    uint32_t length = 0;
+
+    for(;;) {
+        int c = file.read();
+
+        if(c >= 0 && c != '\n') {
+            if(length < sizeof(line) - 1)
+                line[length++] = (char) c;
+            continue;
         }
 
-        case RISHKA_OPINST_IMM: {
-            uint32_t function_code_3 = ((inst >> 12) &7);
-            int64_t immediate = (int64_t)(((int32_t)((uint32_t)((inst >> 20) &4095) << 20)) >> 20);
-            uint32_t shift_amount = ((inst >> 20) &63);
-            int64_t val = (int64_t)(((rishka_u64_arrptr*) &this->registers)->a).v[rs1];
+        while(length > 0 && line[length - 1] == '\r')
+            length--;
+        line[length] = 0;
+        length = 0;
 
-            switch(function_code_3) {
-                case RISHKA_FC3_ADDI:
-                    val = (val + immediate);
-                    break;
+        char* name;
+        uint64_t address = strtoull(line, &name, 16);
 
-                case RISHKA_FC3_SLLI:
-                    val = RishkaVM::shiftLeftInt64(val, shift_amount);
-                    break;
+        if(name != line && name[0] == ' ' && name[1] != 0 && name[2] == ' ' &&
+            (address &1) == 0 && address < this->layout.memorySize)
+            for(uint8_t routine = 0; routine < RISHKA_HLE_COUNT; routine++)
+                if(strcmp(&name[3], rishka_hle_symbols[routine]) == 0) {
+                    this->routines[routine] = (int64_t) address;
+                    this->hasRoutines = true;
+                }
 
-                case RISHKA_FC3_SLTI:
-                    if((val < immediate))
-                        val = 1;
-                    else val = 0;
-                    break;
+        if(c < 0)
+            break;
+    }
 
-                case RISHKA_FC3_SLTIU:
-                    if(((uint64_t) val < (uint64_t) immediate))
-                        val = 1;
-                    else val = 0;
-                    break;
+    file.close();
+}
 
-                case RISHKA_FC3_XORI:
-                    val = (val ^ immediate);
-                    break;
+bool RishkaVM::emulateRoutine(uint8_t routine) {
+    uint64_t dest = this->registers[10], src = this->registers[11], size = this->registers[12];
+    const uint64_t limit = this->layout.memorySize;
+
+    this->tierStats.emulatedCalls++;
+    switch(routine) {
+        case RISHKA_HLE_MEMORY_SET:
+            size = (uint32_t) size;
+            // fall through
+
+        case RISHKA_HLE_MEMSET:
+            if(dest > limit || size > limit - dest)
+                return false;
+
+#if RISHKA_VM_PAGED_MEMORY
+            if(!this->fillMemory(dest, (uint8_t) src, size))
+                return false;
+#else
+            this->markDirty(dest, size);
+            memset(&this->memory[dest], (uint8_t) src, size);
+#endif
+            break;
 
-                case RISHKA_FC3_SRLI: {
-                    uint32_t function_code_6 = ((inst >> 26) &63);
-                    switch((function_code_6 >> 4)) {
-                        case 0x0:
-                            val = RishkaVM::shiftRightInt64(val, shift_amount);
-                            break;
+        case RISHKA_HLE_MEMORY_COPY:
+            size = (uint32_t) size;
+            if(dest > limit || size > limit - dest || src > limit || size > limit - src)
+                return false;
 
-                        case 0x1:
-                            val = RishkaVM::arithmeticShiftRightInt64(val, shift_amount);
-                            break;
+            // Copying forward one byte at a time repeats the overlapping
+            // start of the source when the destination lies inside it.
+            if(dest > src && dest < src + size) {
+#if RISHKA_VM_PAGED_MEMORY
+                for(uint64_t i = 0; i < size; i++) {
+                    uint8_t value;
 
-                        default:
-                            this->panic("Invalid immediate shift instruction.");
-                            break;
-                    }
-                    break;
+                    if(!this->load<uint8_t>(src + i, &value) || !this->store<uint8_t>(dest + i, value))
+                        return false;
                 }
+#else
+                this->markDirty(dest, size);
+                for(uint64_t i = 0; i < size; i++)
+                    this->memory[dest + i] = this->memory[src + i];
+#endif
+                break;
+            }
 
-                case RISHKA_FC3_ORI:
-                    val = (val | immediate);
-                    break;
+#if RISHKA_VM_PAGED_MEMORY
+            if(!this->moveMemory(dest, src, size))
+                return false;
+#else
+            this->markDirty(dest, size);
+            memmove(&this->memory[dest], &this->memory[src], size);
+#endif
+            break;
 
-                case RISHKA_FC3_ANDI: {
-                    val = (val &immediate);
-                    break;
+        case RISHKA_HLE_MEMCPY:
+        case RISHKA_HLE_MEMMOVE:
+            if(dest > limit || size > limit - dest || src > limit || size > limit - src)
+                return false;
+
+#if RISHKA_VM_PAGED_MEMORY
+            if(!this->moveMemory(dest, src, size))
+                return false;
+#else
+            this->markDirty(dest, size);
+            memmove(&this->memory[dest], &this->memory[src], size);
+#endif
+            break;
+
+        case RISHKA_HLE_STRLEN: {
+            if(dest >= limit)
+                return false;
+
+#if RISHKA_VM_PAGED_MEMORY
+            for(uint64_t address = dest; address < limit;) {
+                uint8_t* page = this->mapPage(address, false);
+                uint32_t offset = (uint32_t)(address &(RISHKA_VM_PAGE_SIZE - 1));
+
+                if(page == NULL)
+                    return false;
+
+                uint8_t* end = (uint8_t*) memchr(&page[offset], 0, RISHKA_VM_PAGE_SIZE - offset);
+                if(end != NULL) {
+                    this->registers[10] = (rishka_uxlen_t)(address + (uint64_t)(end - &page[offset]) - dest);
+                    return true;
                 }
 
-                default:
-                    this->panic("Invalid immediate instruction.");
-                    break;
+                address += RISHKA_VM_PAGE_SIZE - offset;
             }
 
-            if(rd != 0)
-                (((rishka_u64_arrptr*) &this->registers)->a).v[rd] = (uint64_t) val;
-            break;
-        }
+            return false;
+#else
+            uint8_t* end = (uint8_t*) memchr(&this->memory[dest], 0, limit - dest);
+            if(end == NULL)
+                return false;
 
-        case RISHKA_OPINST_IALU: {
-            uint32_t function_code_3 = ((inst >> 12) &7);
-            int64_t immediate = (int64_t)(((int32_t)((uint32_t)((inst >> 20) &4095) << 20)) >> 20);
-            int64_t val = (int64_t)(((rishka_u64_arrptr*) &this->registers)->a).v[rs1];
+            this->registers[10] = (rishka_uxlen_t)(end - &this->memory[dest]);
+            return true;
+#endif
+        }
 
-            switch(function_code_3) {
-                case RISHKA_FC3_SLLIW:
-                    val = (int64_t)(val + immediate);
-                    break;
+        default:
+            return false;
+    }
 
-                case RISHKA_FC3_SRLIW:
-                    val = RishkaVM::shiftLeftInt64(val, immediate);
-                    break;
+    if(size != 0)
+        this->invalidateDecoded(dest, (uint32_t) size);
+    return true;
+}
+#endif
+
+inline uint32_t RishkaVM::fetch(int64_t address) {
+#if RISHKA_VM_PAGED_MEMORY
+    // Instructions outside of guest memory fetch as the illegal all-zero one.
+    uint16_t low = 0, high = 0;
+
+    if(!this->load<uint16_t>((uint64_t) address, &low))
+        return 0;
+    if((low &3) == 3 && !this->load<uint16_t>((uint64_t) address + 2, &high))
+        return 0;
+
+    return (low | ((uint32_t) high << 16));
+#else
+    uint16_t* halfwords = (uint16_t*)(&this->memory[address]);
+    uint32_t inst = halfwords[0];
+
+    if((inst &3) == 3)
+        inst |= ((uint32_t) halfwords[1] << 16);
+    return inst;
+#endif
+}
 
-                case RISHKA_FC3_SRAIW: {
-                    uint32_t shift_amount = rs2;
-                    uint32_t function_code_7 = ((inst >> 25) &127);
+rishka_memory_region RishkaVM::regionOf(uint64_t address) const {
+    const RishkaVM* primary = this->primary;
 
-                    switch((function_code_7 >> 5)) {
-                        case 0x0:
-                            val = RishkaVM::shiftRightInt64(val, shift_amount);
-                            break;
+    if(address >= this->layout.memorySize - this->layout.stackSize)
+        return RISHKA_REGION_STACK;
+    if(address >= this->layout.codeAddress && address < primary->imageEnd)
+        return RISHKA_REGION_IMAGE;
+    return RISHKA_REGION_HEAP;
+}
 
-                        case 0x1:
-                            val = RishkaVM::arithmeticShiftRightInt64(val, shift_amount);
-                            break;
+#if RISHKA_VM_PAGED_MEMORY
+// Pages come from the requested tier if it has room, and from the other
+// one otherwise; `placed` receives the tier they came from. Internal RAM
+// is only used while enough of it stays free for the firmware. On other
+// hosts both tiers are plain heap allocations, told apart for the stats.
+static uint8_t* rishka_page_alloc(rishka_memory_tier tier, rishka_memory_tier* placed) {
+    uint8_t* page = NULL;
+
+#if defined(ESP_PLATFORM)
+    for(uint8_t attempt = 0; attempt < 2 && page == NULL; attempt++) {
+        if(tier == RISHKA_MEMORY_PSRAM)
+            page = (uint8_t*) heap_caps_calloc(1, RISHKA_VM_PAGE_SIZE + sizeof(uint32_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        else if(heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT) >= RISHKA_VM_SRAM_RESERVE + RISHKA_VM_PAGE_SIZE)
+            page = (uint8_t*) heap_caps_calloc(1, RISHKA_VM_PAGE_SIZE + sizeof(uint32_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+
+        if(page == NULL)
+            tier = (tier == RISHKA_MEMORY_SRAM ? RISHKA_MEMORY_PSRAM : RISHKA_MEMORY_SRAM);
+    }
+#else
+    page = (uint8_t*) calloc(1, RISHKA_VM_PAGE_SIZE + sizeof(uint32_t));
+#endif
 
-                        default:
-                            this->panic("Invalid immediate shift instruction.");
-                            break;
-                    }
+    if(page != NULL)
+        *rishka_page_owners(page) = 1;
 
-                    break;
-                }
+    *placed = tier;
+    return page;
+}
 
-                case RISHKA_FC3_SLLI64:
-                    val = RishkaVM::shiftLeftInt64(val, immediate & 0x3F);
-                    break;
+uint8_t* RishkaVM::mapPage(uint64_t address, bool write) {
+    if(address >= this->layout.memorySize)
+        return NULL;
 
-                case RISHKA_FC3_SRLI64:
-                    val = RishkaVM::shiftRightInt64(val, immediate & 0x3F);
-                    break;
+    uint64_t index = address / RISHKA_VM_PAGE_SIZE;
+    uint8_t** slot = &this->pages[index];
+    uint8_t* page = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
 
-                case RISHKA_FC3_SRAI64:
-                    val = RishkaVM::arithmeticShiftRightInt64(val, immediate & 0x3F);
-                    break;
+    if(page == NULL) {
+        uint8_t* touched = NULL;
+        rishka_memory_tier tier;
 
-                default:
-                    this->panic("Invalid immediate instruction.");
-                    break;
-            }
+        page = rishka_page_alloc(this->primary->placement[this->regionOf(address)], &tier);
+        if(page == NULL)
+            return NULL;
 
-            if(rd != 0)
-                (((rishka_u64_arrptr*) &this->registers)->a).v[rd] = (uint64_t) val;
-            break;
+        // Another hart may have touched the page in the meantime.
+        if(!__atomic_compare_exchange_n(slot, &touched, page, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            free(page);
+            page = touched;
         }
+        else __atomic_store_n(&this->pageTiers[index], (uint8_t) tier, __ATOMIC_RELAXED);
+    }
+    else if(write && (page = this->unsharePage(index)) == NULL)
+        return NULL;
+
+    if(write && !this->isDirty(index))
+        __atomic_store_n(&this->dirtyPages[index], 1, __ATOMIC_RELAXED);
+
+    // Stores to clean pages miss the TLB once, so that the page is flagged.
+    rishka_tlb_entry* entry = &this->tlb[index &(RISHKA_VM_TLB_SIZE - 1)];
+    entry->tag = (address &~(uint64_t)(RISHKA_VM_PAGE_SIZE - 1));
+    entry->writeTag = this->isDirty(index) && __atomic_load_n(rishka_page_owners(page), __ATOMIC_ACQUIRE) == 1 ?
+        entry->tag : ~(uint64_t) 0;
+    entry->page = page;
+
+#if RISHKA_VM_MEMORY_STATS
+    // The access that missed the TLB counts here, the next ones on a hit.
+    entry->accesses = &this->tierAccesses[__atomic_load_n(&this->pageTiers[index], __ATOMIC_RELAXED)];
+    (*entry->accesses)++;
+#endif
+
+    return page;
+}
 
-        case RISHKA_OPINST_RT64: {
-            uint32_t function_code_3 = ((inst >> 12) &7), function_code_7 = ((inst >> 25) &127);
-            int64_t val1 = (int64_t)(((rishka_u64_arrptr*) &this->registers)->a).v[rs1];
-            int64_t val2 = (int64_t)(((rishka_u64_arrptr*) &this->registers)->a).v[rs2];
+// Only virtual machines without additional harts share pages (see
+// fork()), so no other hart holds the page being replaced in its TLB.
+uint8_t* RishkaVM::unsharePage(uint64_t index) {
+    uint8_t* page = this->pages[index];
+    if(__atomic_load_n(rishka_page_owners(page), __ATOMIC_ACQUIRE) == 1)
+        return page;
 
-            int64_t val;
-            switch(((function_code_7 << 3) | function_code_3)) {
-                case 0x0:
-                    val = (val1 + val2);
-                    break;
+    rishka_memory_tier tier;
+    uint8_t* copy = rishka_page_alloc((rishka_memory_tier) this->pageTiers[index], &tier);
 
-                case 0x100:
-                    val = (val1 - val2);
-                    break;
+    if(copy == NULL)
+        return NULL;
 
-                case 0x1:
-                    val = RishkaVM::shiftLeftInt64(val1, (val2 & 0x1f));
-                    break;
+    memcpy(copy, page, RISHKA_VM_PAGE_SIZE);
+    __atomic_store_n(&this->pages[index], copy, __ATOMIC_RELEASE);
+    __atomic_store_n(&this->pageTiers[index], (uint8_t) tier, __ATOMIC_RELAXED);
 
-                case 0x2:
-                    if((val1 < val2))
-                        val = 1;
-                    else val = 0;
-                    break;
+    rishka_page_release(page);
+    return copy;
+}
 
-                case 0x3:
-                    if(((uint64_t) val1 < (uint64_t) val2))
-                        val = 1;
-                    else val = 0;
-                    break;
+bool RishkaVM::unsharePages() {
+    bool unshared = true;
 
-                case 0x4:
-                    val = (val1 ^ val2);
-                    break;
+    for(uint64_t index = 0; index < this->layout.memorySize / RISHKA_VM_PAGE_SIZE; index++)
+        if(this->pages[index] != NULL && this->unsharePage(index) == NULL)
+            unshared = false;
 
-                case 0x5:
-                    val = RishkaVM::shiftRightInt64(val1, (val2 & 0x1f));
-                    break;
+    memset(this->tlb, -1, sizeof(this->tlb));
+    return unshared;
+}
 
-                case 0x105:
-                    val = RishkaVM::arithmeticShiftRightInt64(val1, (val2 & 0x1f));
-                    break;
+bool RishkaVM::fillMemory(uint64_t address, uint8_t value, uint64_t size) {
+    while(size > 0) {
+        uint8_t* page = this->mapPage(address, true);
+        uint64_t offset = (address &(RISHKA_VM_PAGE_SIZE - 1)), length = RISHKA_VM_PAGE_SIZE - offset;
 
-                case 0x6:
-                    val = (val1 | val2);
-                    break;
+        if(page == NULL)
+            return false;
+        if(length > size)
+            length = size;
 
-                case 0x7:
-                    val = (val1 &val2);
-                    break;
+        memset(&page[offset], value, length);
+        address += length;
+        size -= length;
+    }
 
-                case 0x8:
-                    val = (val1 * val2);
-                    break;
+    return true;
+}
 
-                case 0x9:
-                    val = RishkaVM::shiftRightInt128(((int64_t) val1 * (int64_t) val2), 64);
-                    break;
+bool RishkaVM::moveMemory(uint64_t dest, uint64_t src, uint64_t size) {
+    // Moves to a higher, overlapping destination copy from the end.
+    bool backward = (dest > src && dest < src + size);
+
+    while(size > 0) {
+        uint64_t to = backward ? dest + size - 1 : dest, from = backward ? src + size - 1 : src;
+        uint8_t* target = this->mapPage(to, true);
+        uint8_t* source = this->mapPage(from, false);
+
+        if(target == NULL || source == NULL)
+            return false;
+
+        // Bytes left in both pages in the direction of the copy.
+        uint64_t toOffset = (to &(RISHKA_VM_PAGE_SIZE - 1)), fromOffset = (from &(RISHKA_VM_PAGE_SIZE - 1));
+        uint64_t length = backward ? toOffset + 1 : RISHKA_VM_PAGE_SIZE - toOffset;
+        uint64_t other = backward ? fromOffset + 1 : RISHKA_VM_PAGE_SIZE - fromOffset;
+
+        if(length > other)
+            length = other;
+        if(length > size)
+            length = size;
+
+        if(backward)
+            memmove(&target[toOffset + 1 - length], &source[fromOffset + 1 - length], length);
+        else {
+            memmove(&target[toOffset], &source[fromOffset], length);
+            dest += length;
+            src += length;
+        }
 
-                case 0xa:
-                    val = (int64_t)(uint64_t) RishkaVM::shiftRightInt128(((int64_t) val1 * (int64_t)(uint64_t) val2), 64);
-                    break;
+        size -= length;
+    }
 
-                case 0xb:
-                    val = (int64_t)(uint64_t) RishkaVM::shiftRightInt128(((int64_t)(uint64_t) val1 * (int64_t)(uint64_t) val2), 64);
-                    break;
+    return true;
+}
 
-                case 0xc: {
-                    int64_t dividend = val1, divisor = val2;
+void* RishkaVM::pinParam(uint8_t pos, uint32_t size) {
+    uint64_t address = (uint64_t) this->registers[10 + pos];
+    uint8_t* page = this->mapPage(address, true);
 
-                    if(dividend == (-9223372036854775807LL - 1) && divisor == -1)
-                        val = (-9223372036854775807LL - 1);
-                    else if(divisor == 0)
-                        val = -1;
-                    else val = (dividend / divisor);
-                    break;
-                }
+    if(page == NULL)
+        return NULL;
 
-                case 0xd: {
-                    uint64_t dividend = (uint64_t) val1, divisor = (uint64_t) val2;
+    uint32_t offset = (uint32_t)(address &(RISHKA_VM_PAGE_SIZE - 1)), room = RISHKA_VM_PAGE_SIZE - offset;
+    if(size == 0) {
+        if(memchr(&page[offset], 0, room) != NULL)
+            return &page[offset];
 
-                    if(divisor == 0)
-                        val = -1;
-                    else val = (int64_t)(dividend / divisor);
-                    break;
-                }
+        // The string goes on in the following pages, up to its terminator.
+        for(size = room;; size += RISHKA_VM_PAGE_SIZE) {
+            uint8_t* next = this->mapPage(address + size, false);
+            if(next == NULL)
+                return NULL;
 
-                case 0xe: {
-                    int64_t dividend = val1, divisor = val2;
+            uint8_t* end = (uint8_t*) memchr(next, 0, RISHKA_VM_PAGE_SIZE);
+            if(end != NULL) {
+                size += (uint32_t)(end - next) + 1;
+                break;
+            }
+        }
+    }
+    else if(size <= room)
+        return &page[offset];
 
-                    if(dividend == (-9223372036854775807LL - 1) && divisor == -1)
-                        val = 0;
-                    else if(divisor == 0)
-                        val = dividend;
-                    else val = (dividend % divisor);
-                    break;
-                }
+    uint8_t* buffer = (uint8_t*) realloc(this->pinned[pos], size);
+    if(buffer == NULL)
+        return NULL;
 
-                case 0xf: {
-                    uint64_t dividend = (uint64_t) val1, divisor = (uint64_t) val2;
+    this->pinned[pos] = buffer;
+    return this->readMemory(address, buffer, size) ? buffer : NULL;
+}
 
-                    if(divisor == 0)
-                        val = (int64_t) dividend;
-                    else val = (int64_t)(dividend % divisor);
-                    break;
-                }
+void RishkaVM::releaseParams() {
+    for(uint8_t pos = 0; pos < 8; pos++)
+        if(this->pinned[pos] != NULL) {
+            free(this->pinned[pos]);
+            this->pinned[pos] = NULL;
+        }
+}
+#endif
 
-                default:
-                    this->panic("Invalid arithmetic instruction.");
-                    break;
-            }
+bool RishkaVM::readMemory(uint64_t address, void* data, uint32_t size) {
+#if RISHKA_VM_PAGED_MEMORY
+    uint8_t* bytes = (uint8_t*) data;
 
-            if(rd != 0)
-                (((rishka_u64_arrptr*) &this->registers)->a).v[rd] = (uint64_t) val;
-            break;
-        }
+    while(size > 0) {
+        uint8_t* page = this->mapPage(address, false);
+        uint32_t offset = (uint32_t)(address &(RISHKA_VM_PAGE_SIZE - 1)), length = RISHKA_VM_PAGE_SIZE - offset;
 
-        case RISHKA_OPINST_RT32: {
-            uint32_t function_code_3 = ((inst >> 12) &7);
-            uint32_t function_code_7 = ((inst >> 25) &127);
+        if(page == NULL)
+            return false;
+        if(length > size)
+            length = size;
 
-            int64_t val1 = (int64_t)(((rishka_u64_arrptr*) &this->registers)->a).v[rs1];
-            int64_t val2 = (int64_t)(((rishka_u64_arrptr*) &this->registers)->a).v[rs2];
+        memcpy(bytes, &page[offset], length);
+        bytes += length;
+        address += length;
+        size -= length;
+    }
+#else
+    if(this->memory == NULL || address > this->layout.memorySize || size > this->layout.memorySize - address)
+        return false;
 
-            int64_t val;
-            switch(((function_code_7 << 3) | function_code_3)) {
-                case 0x0:
-                    val = (int64_t)(val1 + val2);
-                    break;
+    memcpy(data, &this->memory[address], size);
+#endif
 
-                case 0x100:
-                    val = (int64_t)(val1 - val2);
-                    break;
+    return true;
+}
 
-                case 0x1:
-                    val = RishkaVM::shiftLeftInt64(val1, (val2 & 0x1f));
-                    break;
-        
-                case 0x5:
-                    val = RishkaVM::shiftRightInt64(val1, (val2 & 0x1f));
-                    break;
+bool RishkaVM::writeMemory(uint64_t address, const void* data, uint32_t size) {
+#if RISHKA_VM_PAGED_MEMORY
+    const uint8_t* bytes = (const uint8_t*) data;
 
-                case 0x105:
-                    val = (int64_t) RishkaVM::arithmeticShiftRightInt64(val1, (val2 & 0x1f));
-                    break;
+    while(size > 0) {
+        uint8_t* page = this->mapPage(address, true);
+        uint32_t offset = (uint32_t)(address &(RISHKA_VM_PAGE_SIZE - 1)), length = RISHKA_VM_PAGE_SIZE - offset;
 
-                case 0x8:
-                    val = (int64_t)((int32_t) val1 * (int32_t) val2);
-                    break;
+        if(page == NULL)
+            return false;
+        if(length > size)
+            length = size;
 
-                case 0xc: {
-                    int32_t dividend = (int32_t) val1, divisor = (int32_t) val2;
+        memcpy(&page[offset], bytes, length);
+        bytes += length;
+        address += length;
+        size -= length;
+    }
+#else
+    if(this->memory == NULL || address > this->layout.memorySize || size > this->layout.memorySize - address)
+        return false;
 
-                    if(dividend == (-2147483647 - 1) && divisor == -1)
-                        val = -2147483648LL;
-                    else if(divisor == 0)
-                        val = -1;
-                    else val = (int64_t)(dividend / divisor);
-                    break;
-                }
+    this->markDirty(address, size);
+    memcpy(&this->memory[address], data, size);
+#endif
 
-                case 0xd: {
-                    uint32_t dividend = (uint32_t) val1, divisor = (uint32_t) val2;
+    return true;
+}
 
-                    if(divisor == 0)
-                        val = -1;
-                    else val = (int64_t)(dividend / divisor);
-                    break;
-                }
+size_t RishkaVM::getMemoryUsage() const {
+#if RISHKA_VM_PAGED_MEMORY
+    size_t touched = 0;
 
-                case 0xe: {
-                    int32_t dividend = (int32_t) val1, divisor = (int32_t) val2;
+    if(this->pages != NULL)
+        for(uint64_t page = 0; page < this->layout.memorySize / RISHKA_VM_PAGE_SIZE; page++)
+            if(__atomic_load_n(&this->pages[page], __ATOMIC_RELAXED) != NULL)
+                touched++;
 
-                    if(dividend == (-2147483647 - 1) && divisor == -1)
-                        val = 0;
-                    else if(divisor == 0)
-                        val = (int64_t) dividend;
-                    else val = (int64_t)(dividend % divisor);
-                    break;
-                }
+    return touched * RISHKA_VM_PAGE_SIZE;
+#else
+    return this->memory != NULL ? (size_t) this->layout.memorySize : 0;
+#endif
+}
+
+#if RISHKA_VM_PAGED_MEMORY
+void RishkaVM::setMemoryPlacement(rishka_memory_region region, rishka_memory_tier tier) {
+    if(region < RISHKA_REGION_COUNT && tier < RISHKA_MEMORY_TIER_COUNT)
+        this->placement[region] = tier;
+}
 
-                case 0xf: {
-                    uint32_t dividend = (uint32_t) val1, divisor = (uint32_t) val2;
+rishka_memory_tier RishkaVM::getMemoryPlacement(rishka_memory_region region) const {
+    return region < RISHKA_REGION_COUNT ? this->placement[region] : RISHKA_MEMORY_PSRAM;
+}
 
-                    if(divisor == 0)
-                        val = (int64_t) dividend;
-                    else val = (int64_t)(dividend % divisor);
-                    break;
-                }
+rishka_memory_stats RishkaVM::getMemoryStats() const {
+    rishka_memory_stats stats;
 
-                default:
-                    this->panic("Invalid store doubleword instruction.");
-                    break;
-            }
+    memcpy(stats.accesses, this->tierAccesses, sizeof(stats.accesses));
+    memset(stats.bytes, 0, sizeof(stats.bytes));
 
-            if(rd != 0)
-                (((rishka_u64_arrptr*) &this->registers)->a).v[rd] = (uint64_t) val;
-            break;
-        }
+    if(this->pages != NULL)
+        for(uint64_t page = 0; page < this->layout.memorySize / RISHKA_VM_PAGE_SIZE; page++)
+            if(__atomic_load_n(&this->pages[page], __ATOMIC_ACQUIRE) != NULL)
+                stats.bytes[__atomic_load_n(&this->pageTiers[page], __ATOMIC_RELAXED)] += RISHKA_VM_PAGE_SIZE;
 
-        case RISHKA_OPINST_LUI: {
-            int64_t immediate = (int64_t)(((int32_t)((uint32_t)((inst << 0) &4294963200LL) << 0)) >> 0);
+    return stats;
+}
 
-            if(rd != 0)
-                (((rishka_u64_arrptr*) &this->registers)->a).v[rd] = (uint64_t) immediate;
-            break;
-        }
+void RishkaVM::resetMemoryStats() {
+    memset(this->tierAccesses, 0, sizeof(this->tierAccesses));
+}
+#endif
 
-        case RISHKA_OPINST_AUIPC: {
-            int64_t immediate = (int64_t)(((int32_t)((uint32_t)((inst << 0) &4294963200LL) << 0)) >> 0);
+#if RISHKA_VM_HEATMAP
+static const char* const rishka_region_names[RISHKA_REGION_COUNT] = {"image", "heap", "stack"};
 
-            if(rd != 0)
-                (((rishka_u64_arrptr*) &this->registers)->a).v[rd] = (uint64_t)(this->pc + immediate);
-            break;
-        }
+void RishkaVM::setHeatmapFile(String path) {
+    this->heatmapFile = path;
+}
 
-        case RISHKA_OPINST_JAL: {
-            int64_t immediate = (int64_t)(((int32_t)((uint32_t)(((((inst >> 11) &1048576) | ((inst >> 20) &2046)) | ((inst >> 9) &2048)) | ((inst << 0) &1044480)) << 11)) >> 11);
+rishka_page_heat RishkaVM::getPageHeat(uint64_t page) const {
+    rishka_page_heat heat;
 
-            if(rd != 0)
-                (((rishka_u64_arrptr*) &this->registers)->a).v[rd] = (uint64_t)(this->pc + 4);
-            this->pc = (this->pc + immediate);
+    if(page < this->layout.memorySize / RISHKA_VM_PAGE_SIZE)
+        heat = this->heat[page];
+    else memset(&heat, 0, sizeof(heat));
 
-            return;
-        }
+    return heat;
+}
 
-        case RISHKA_OPINST_JALR: {
-            int64_t immediate = (int64_t)(((int32_t)((uint32_t)((inst >> 20) &4095) << 20)) >> 20);
-            int64_t pc = (this->pc + 4);
+rishka_page_heat RishkaVM::getRegionHeat(rishka_memory_region region) const {
+    rishka_page_heat heat;
+    memset(&heat, 0, sizeof(heat));
 
-            this->pc = ((int64_t)((((rishka_u64_arrptr*) &this->registers)->a).v[rs1] + immediate) &- 2);
+    for(uint64_t page = 0; page < this->layout.memorySize / RISHKA_VM_PAGE_SIZE; page++)
+        if(this->regionOf(page * RISHKA_VM_PAGE_SIZE) == region)
+            for(uint8_t kind = 0; kind < RISHKA_HEAT_KIND_COUNT; kind++)
+                heat.counts[kind] += this->heat[page].counts[kind];
 
-            if(rd != 0)
-                (((rishka_u64_arrptr*) &this->registers)->a).v[rd] = (uint64_t) pc;
-            return;
-        }
+    return heat;
+}
 
-        case RISHKA_OPINST_BRANCH: {
-            uint32_t function_code_3 = ((inst >> 12) &7);
-            int64_t immediate = (int64_t)(((int32_t)((uint32_t)(((((inst >> 19) &4096) | ((inst >> 20) &2016)) | ((inst >> 7) &30)) | ((inst << 4) &2048)) << 19)) >> 19);
+bool RishkaVM::writeHeatmap(String path) const {
+    if(SD.exists(path) && !SD.remove(path))
+        return false;
 
-            uint64_t val1 = (((rishka_u64_arrptr*) &this->registers)->a).v[rs1];
-            uint64_t val2 = (((rishka_u64_arrptr*) &this->registers)->a).v[rs2];
+    File file = SD.open(path, FILE_WRITE);
+    if(!file)
+        return false;
 
-            bool condition;
-            switch(function_code_3) {
-                case RISHKA_FC3_BEQ:
-                    condition = (val1 == val2);
-                    break;
+    bool written = file.print("address,region,fetches,loads,stores\n") != 0;
+    char line[96];
+
+    for(uint64_t page = 0; written && page < this->layout.memorySize / RISHKA_VM_PAGE_SIZE; page++) {
+        const uint64_t* counts = this->heat[page].counts;
+        if(counts[RISHKA_HEAT_FETCH] == 0 && counts[RISHKA_HEAT_LOAD] == 0 && counts[RISHKA_HEAT_STORE] == 0)
+            continue;
+
+        snprintf(line, sizeof(line), "0x%llx,%s,%llu,%llu,%llu\n",
+            (unsigned long long)(page * RISHKA_VM_PAGE_SIZE),
+            rishka_region_names[this->regionOf(page * RISHKA_VM_PAGE_SIZE)],
+            (unsigned long long) counts[RISHKA_HEAT_FETCH],
+            (unsigned long long) counts[RISHKA_HEAT_LOAD],
+            (unsigned long long) counts[RISHKA_HEAT_STORE]);
+        written = file.print(line) != 0;
+    }
 
-                case RISHKA_FC3_BNE:
-                    condition = (val1 != val2);
-                    break;
+    for(uint8_t region = 0; written && region < RISHKA_REGION_COUNT; region++) {
+        rishka_page_heat heat = this->getRegionHeat((rishka_memory_region) region);
 
-                case RISHKA_FC3_BLT:
-                    condition = ((int64_t) val1 < (int64_t) val2);
-                    break;
+        snprintf(line, sizeof(line), "total,%s,%llu,%llu,%llu\n", rishka_region_names[region],
+            (unsigned long long) heat.counts[RISHKA_HEAT_FETCH],
+            (unsigned long long) heat.counts[RISHKA_HEAT_LOAD],
+            (unsigned long long) heat.counts[RISHKA_HEAT_STORE]);
+        written = file.print(line) != 0;
+    }
 
-                case RISHKA_FC3_BGE:
-                    condition = ((int64_t) val1 >= (int64_t) val2);
-                    break;
+    file.close();
+    return written;
+}
 
-                case RISHKA_FC3_BLTU:
-                    condition = (val1 < val2);
+void RishkaVM::resetHeatmap() {
+    if(this->heat != NULL)
+        memset(this->heat, 0, (size_t)(this->layout.memorySize / RISHKA_VM_PAGE_SIZE) * sizeof(rishka_page_heat));
+}
+#endif
+
+uint64_t RishkaVM::readCsr(uint16_t csr) {
+    switch(csr) {
+        case RISHKA_CSR_FFLAGS:   return (this->fcsr &31);
+        case RISHKA_CSR_FRM:      return ((this->fcsr >> 5) &7);
+        case RISHKA_CSR_FCSR:     return (this->fcsr &255);
+        case RISHKA_CSR_CYCLE:
+        case RISHKA_CSR_INSTRET:  return this->instret;
+        case RISHKA_CSR_TIME:     return (uint64_t) micros();
+        case RISHKA_CSR_CYCLEH:
+        case RISHKA_CSR_INSTRETH: return (this->instret >> 32);
+        case RISHKA_CSR_TIMEH:    return ((uint64_t) micros() >> 32);
+        case RISHKA_CSR_VL:       return this->vl;
+        case RISHKA_CSR_VTYPE:    return this->vtype;
+        case RISHKA_CSR_VLENB:    return RISHKA_VM_VLENB;
+        case RISHKA_CSR_MHARTID:  return this->hartId;
+        default:                  return 0;
+    }
+}
+
+void RishkaVM::writeCsr(uint16_t csr, uint64_t value) {
+    switch(csr) {
+        case RISHKA_CSR_FFLAGS:
+            this->fcsr = ((this->fcsr &~31U) | (uint32_t)(value &31));
+            break;
+
+        case RISHKA_CSR_FRM:
+            this->fcsr = ((this->fcsr &31U) | (uint32_t)((value &7) << 5));
+            break;
+
+        case RISHKA_CSR_FCSR:
+            this->fcsr = (uint32_t)(value &255);
+            break;
+    }
+}
+
+void RishkaVM::configureVector(rishka_uxlen_t vtype, uint64_t avl) {
+    uint32_t lmul = (vtype &7), sew = ((vtype >> 3) &7);
+
+    // Fractional groups (lmul 5 to 7 for 1/8 to 1/2) must still hold an
+    // element of the widest 64-bit type, and lmul 4 is reserved.
+    if((vtype >> 8) != 0 || sew > 3 || lmul == 4 || (lmul > 4 && sew > lmul - 5)) {
+        this->vtype = ((rishka_uxlen_t) 1 << (RISHKA_VM_XLEN - 1));
+        this->vl = 0;
+        return;
+    }
+
+    uint32_t vlmax = (RISHKA_VM_VLEN >> (3 + sew));
+    vlmax = (lmul < 4 ? (vlmax << lmul) : (vlmax >> (8 - lmul)));
+
+    this->vtype = vtype;
+    this->vl = (avl < vlmax ? (uint32_t) avl : vlmax);
+}
+
+bool RishkaVM::executeVector(const rishka_decoded_inst& inst) {
+    if((this->vtype >> (RISHKA_VM_XLEN - 1)) != 0)
+        return false;
+
+    uint8_t sew = ((this->vtype >> 3) &7), lmul = (this->vtype &7);
+    uint8_t size = (1 << sew), group = (lmul < 4 ? (1 << lmul) : 1);
+    uint32_t count = this->vl;
+
+    bool masked = ((inst.imm &1) == 0);
+    uint8_t kernel = ((inst.imm >> 3) &31);
+    const uint8_t* mask = (masked ? this->vregisters : NULL);
+
+    #define RISHKA_VM_VREG(index)       (&this->vregisters[(index) * RISHKA_VM_VLENB])
+    #define RISHKA_VM_VALIGNED(index)   (((index) &(group - 1)) == 0)
+
+    // Vector and splatted operands, and results merged under a mask, use
+    // temporaries as large as a group of eight registers.
+    uint64_t operand[RISHKA_VM_VLEN / 8], result[RISHKA_VM_VLEN / 8];
+    const uint8_t* source = (const uint8_t*) operand;
+
+    switch(inst.op) {
+        case RISHKA_DOP_VALU:
+        case RISHKA_DOP_VCMP:
+        case RISHKA_DOP_VMERGE:
+            if(!RISHKA_VM_VALIGNED(inst.rs2))
+                return false;
+
+            switch((inst.imm >> 1) &3) {
+                case 0:
+                    if(!RISHKA_VM_VALIGNED(inst.rs1))
+                        return false;
+                    source = RISHKA_VM_VREG(inst.rs1);
                     break;
 
-                case RISHKA_FC3_BGEU:
-                    condition = (val1 >= val2);
+                case 1:
+                    rishka_vector_splat(size, (uint8_t*) operand,
+                        (uint64_t)(int64_t)(rishka_xlen_t) this->registers[inst.rs1], count);
                     break;
 
                 default:
-                    this->panic("Invalid branch instruction.");
+                    rishka_vector_splat(size, (uint8_t*) operand, (uint64_t)(int64_t)(inst.imm >> 8), count);
                     break;
             }
+            break;
+    }
 
-            if(condition) {
-                this->pc = (this->pc + immediate);
-                return;
+    switch(inst.op) {
+        case RISHKA_DOP_VLE:
+        case RISHKA_DOP_VSE: {
+            // The element width of the instruction sets the register group
+            // size (EMUL), keeping the ratio of the element width to LMUL.
+            int8_t width = ((inst.imm >> 1) &3);
+            int8_t emul = (width - sew + (lmul < 4 ? lmul : lmul - 8));
+            if(emul < -3 || emul > 3 || (inst.rd &((emul > 0 ? (1 << emul) : 1) - 1)) != 0)
+                return false;
+
+            uint8_t* vector = RISHKA_VM_VREG(inst.rd);
+            uint64_t addr = this->registers[inst.rs1];
+            uint32_t bytes = (count << width);
+
+            RISHKA_VM_HEAT(addr, inst.op == RISHKA_DOP_VLE ? RISHKA_HEAT_LOAD : RISHKA_HEAT_STORE);
+
+#if RISHKA_VM_PAGED_MEMORY
+            // Elements are staged in a buffer, as they may span pages.
+            uint8_t elements[8 * RISHKA_VM_VLENB];
+
+            if(inst.op == RISHKA_DOP_VLE) {
+                if((masked && inst.rd == 0) || !this->readMemory(addr, elements, bytes))
+                    return false;
+
+                if(masked)
+                    rishka_vector_select(1 << width, vector, elements, mask, count);
+                else memcpy(vector, elements, bytes);
+                break;
+            }
+
+            if(masked) {
+                // Inactive elements are left untouched in guest memory.
+                for(uint32_t i = 0; i < count; i++)
+                    if(((mask[i >> 3] >> (i &7)) &1) != 0 &&
+                        !this->writeMemory(addr + ((uint64_t) i << width), vector + (i << width), 1 << width))
+                        return false;
+            }
+            else if(!this->writeMemory(addr, vector, bytes))
+                return false;
+#else
+            if(inst.op == RISHKA_DOP_VLE) {
+                if(masked && inst.rd == 0)
+                    return false;
+
+                if(masked)
+                    rishka_vector_select(1 << width, vector, &this->memory[addr], mask, count);
+                else memcpy(vector, &this->memory[addr], bytes);
+                break;
             }
 
+            this->markDirty(addr, bytes);
+            if(masked)
+                rishka_vector_select(1 << width, &this->memory[addr], vector, mask, count);
+            else memcpy(&this->memory[addr], vector, bytes);
+#endif
+
+            for(uint32_t offset = 0; offset < bytes; offset += RISHKA_VM_VLENB)
+                this->invalidateDecoded(addr + offset,
+                    (uint8_t)(bytes - offset < RISHKA_VM_VLENB ? bytes - offset : RISHKA_VM_VLENB));
             break;
         }
 
-        case RISHKA_OPINST_FENCE:
-            break;
+        case RISHKA_DOP_VALU:
+            if(!RISHKA_VM_VALIGNED(inst.rd) || (masked && inst.rd == 0))
+                return false;
 
-        case RISHKA_OPINST_CALL: {
-            uint32_t function_code_11 = ((inst >> 20) &4095);
+            if(!masked)
+                rishka_vector_binary(kernel, size, RISHKA_VM_VREG(inst.rd), RISHKA_VM_VREG(inst.rs2), source, count);
+            else {
+                rishka_vector_binary(kernel, size, (uint8_t*) result, RISHKA_VM_VREG(inst.rs2), source, count);
+                rishka_vector_select(size, RISHKA_VM_VREG(inst.rd), (const uint8_t*) result, mask, count);
+            }
+            break;
 
-            switch(function_code_11) {
-                case 0x0: {
-                    uint64_t code = (((rishka_u64_arrptr*) &this->registers)->a).v[17];
-                    (((rishka_u64_arrptr*) &this->registers)->a).v[10] = this->handleSyscall(code);
-                    break;
-                }
+        case RISHKA_DOP_VCMP:
+            rishka_vector_compare(kernel, size, (uint8_t*) result, RISHKA_VM_VREG(inst.rs2), source, count);
+            rishka_vector_select_bits(RISHKA_VM_VREG(inst.rd), (const uint8_t*) result, mask, count);
+            break;
 
-                case 0x1:
-                    this->exitCode = -1;
-                    this->running = false;
-                    break;
+        case RISHKA_DOP_VMERGE:
+            if(!RISHKA_VM_VALIGNED(inst.rd) || (masked && inst.rd == 0))
+                return false;
 
-                default:
-                    this->panic("Invalid system instruction.");
-                    break;
+            if(masked) {
+                memcpy(result, RISHKA_VM_VREG(inst.rs2), count * size);
+                rishka_vector_select(size, (uint8_t*) result, source, mask, count);
+                source = (const uint8_t*) result;
             }
 
+            memmove(RISHKA_VM_VREG(inst.rd), source, count * size);
             break;
-        }
 
-        default:
-            this->panic("Invalid opcode instruction.");
+        case RISHKA_DOP_VRED:
+            if(!RISHKA_VM_VALIGNED(inst.rs2))
+                return false;
+
+            if(count != 0)
+                rishka_vector_set(size, RISHKA_VM_VREG(inst.rd), 0, rishka_vector_reduce(kernel, size,
+                    (uint64_t) rishka_vector_get(size, RISHKA_VM_VREG(inst.rs1), 0),
+                    RISHKA_VM_VREG(inst.rs2), mask, count));
             break;
-    }
 
-    this->pc = (this->pc + 4);
-}
+        case RISHKA_DOP_VMASK:
+            rishka_vector_mask_logic(kernel, (uint8_t*) result, RISHKA_VM_VREG(inst.rs2), RISHKA_VM_VREG(inst.rs1), count);
+            rishka_vector_select_bits(RISHKA_VM_VREG(inst.rd), (const uint8_t*) result, NULL, count);
+            break;
+
+        case RISHKA_DOP_VMV_X_S:
+            if(inst.rd != 0)
+                this->registers[inst.rd] = (rishka_uxlen_t) rishka_vector_get(size, RISHKA_VM_VREG(inst.rs2), 0);
+            break;
+
+        case RISHKA_DOP_VMV_S_X:
+            if(count != 0)
+                rishka_vector_set(size, RISHKA_VM_VREG(inst.rd), 0, this->registers[inst.rs1]);
+            break;
+
+        case RISHKA_DOP_VCPOP:
+            if(inst.rd != 0)
+                this->registers[inst.rd] = rishka_vector_popcount(RISHKA_VM_VREG(inst.rs2), mask, count);
+            break;
+
+        case RISHKA_DOP_VFIRST:
+            if(inst.rd != 0)
+                this->registers[inst.rd] = (rishka_uxlen_t) rishka_vector_first(RISHKA_VM_VREG(inst.rs2), mask, count);
+            break;
+
+        case RISHKA_DOP_VID:
+            if(!RISHKA_VM_VALIGNED(inst.rd) || (masked && inst.rd == 0))
+                return false;
+
+            rishka_vector_index(size, (uint8_t*) result, count);
+            if(masked)
+                rishka_vector_select(size, RISHKA_VM_VREG(inst.rd), (const uint8_t*) result, mask, count);
+            else memcpy(RISHKA_VM_VREG(inst.rd), result, count * size);
+            break;
+
+        default:
+            return false;
+    }
 
-inline uint32_t RishkaVM::fetch() {
-    return (*(uint32_t*)(&(((rishka_u8_arrptr*) &this->memory)->a).v[this->pc]));
+    #undef RISHKA_VM_VREG
+    #undef RISHKA_VM_VALIGNED
+    return true;
 }
 
 uint64_t RishkaVM::handleSyscall(uint64_t code) {
@@ -1151,12 +5483,18 @@ uint64_t RishkaVM::handleSyscall(uint64_t code) {
             return RishkaSyscall::Runtime::strpass();
 
         case RISHKA_SC_RT_YIELD:
-            RishkaSyscall::Runtime::yield();
+            RishkaSyscall::Runtime::yield(this);
             break;
 
         case RISHKA_SC_RT_FORK_STREAM:
             return RishkaSyscall::Runtime::getForkString(this);
 
+        case RISHKA_SC_SYS_SPAWN:
+            return RishkaSyscall::Sys::spawn(this);
+
+        case RISHKA_SC_SYS_FORK:
+            return RishkaSyscall::Sys::fork(this);
+
         default:
             this->panic("Invalid system call.");
             break;
@@ -1185,20 +5523,28 @@ void RishkaVM::appendToOutputStream(char ch) {
     this->outputStream += ch;
 }
 
-inline int64_t RishkaVM::shiftLeftInt64(int64_t a, int64_t b) {
-    if(b >= 0 && b < 64)
-        return ((uint64_t) a) << b;
-    else if(b < 0 && b > -64)
-        return (uint64_t) a >> -b;
+template<typename T>
+inline T RishkaVM::shiftLeft(T a, int64_t b) {
+    typedef typename rishka_xlen_traits<sizeof(T) * 8>::unsigned_type U;
+    const int64_t bits = sizeof(T) * 8;
+
+    if(b >= 0 && b < bits)
+        return ((U) a) << b;
+    else if(b < 0 && b > -bits)
+        return (U) a >> -b;
 
     return 0;
 }
 
-inline int64_t RishkaVM::shiftRightInt64(int64_t a, int64_t b) {
-    if(b >= 0 && b < 64)
-        return (uint64_t) a >> b;
-    else if(b < 0 && b > -64)
-        return (uint64_t) a << -b;
+template<typename T>
+inline T RishkaVM::shiftRight(T a, int64_t b) {
+    typedef typename rishka_xlen_traits<sizeof(T) * 8>::unsigned_type U;
+    const int64_t bits = sizeof(T) * 8;
+
+    if(b >= 0 && b < bits)
+        return (U) a >> b;
+    else if(b < 0 && b > -bits)
+        return (U) a << -b;
 
     return 0;
 }
@@ -1212,12 +5558,15 @@ inline int64_t RishkaVM::shiftRightInt128(int64_t a, int64_t b) {
     return 0;
 }
 
-inline int64_t RishkaVM::arithmeticShiftRightInt64(int64_t a, int64_t b) {
-    if(b >= 0 && b < 64)
+template<typename T>
+inline T RishkaVM::arithmeticShiftRight(T a, int64_t b) {
+    const int64_t bits = sizeof(T) * 8;
+
+    if(b >= 0 && b < bits)
         return a >> b;
-    else if(b >= 64)
+    else if(b >= bits)
         return a < 0 ? -1 : 0;
-    else if(b < 0 && b > -64)
+    else if(b < 0 && b > -bits)
         return a << -b;
 
     return 0;
@@ -31,9 +31,55 @@
 #include <ArduinoNvs.h>
 #include <fabgl.h>
 #include <List.hpp>
+#include <rishka_aot.h>
+#include <rishka_code_cache.h>
+#include <rishka_jit.h>
+#include <rishka_mmu.h>
 #include <rishka_types.h>
 #include <SD.h>
 
+class RishkaVMPool;
+
+/**
+ * @enum rishka_tier_policy
+ * @brief Enumeration of the policies deciding when code leaves the interpreter tier.
+ */
+enum rishka_tier_policy {
+    RISHKA_TIER_HOTNESS,    /**< Promote loop headers and function entries once their hotness
+                                 counter reaches the promotion threshold, and the code reached
+                                 from promoted blocks. */
+    RISHKA_TIER_EAGER,      /**< Promote every block on its first execution. */
+    RISHKA_TIER_INTERPRET   /**< Never promote; run from the decode cache without block descriptors. */
+};
+
+/**
+ * @enum rishka_run_status
+ * @brief Enumeration of the reasons RishkaVM::runFor() returned.
+ */
+enum rishka_run_status {
+    RISHKA_RUN_BUDGET_EXHAUSTED,    /**< The instruction budget or time limit ran out; call runFor() again to resume. */
+    RISHKA_RUN_SYSCALL_BLOCKED,     /**< The guest waits in a delay or yield system call; resume with a later runFor(). */
+    RISHKA_RUN_EXITED,              /**< The guest exited or was stopped. */
+    RISHKA_RUN_PANICKED             /**< The virtual machine panicked on an invalid instruction or system call. */
+};
+
+/**
+ * @enum rishka_hle_routine
+ * @brief Enumeration of the guest routines that can run as native host code.
+ *
+ * Each routine is recognized by the symbol name listed in
+ * rishka_hle_symbols, in the same order.
+ */
+enum rishka_hle_routine {
+    RISHKA_HLE_MEMORY_SET,  /**< Memory::set() of the SDK. */
+    RISHKA_HLE_MEMORY_COPY, /**< Memory::copy() of the SDK, which copies forward one byte at a time. */
+    RISHKA_HLE_MEMSET,      /**< memset() of the C library, if the program links one. */
+    RISHKA_HLE_MEMCPY,      /**< memcpy() of the C library. */
+    RISHKA_HLE_MEMMOVE,     /**< memmove() of the C library. */
+    RISHKA_HLE_STRLEN,      /**< strlen() of the C library. */
+    RISHKA_HLE_COUNT        /**< Number of routines. */
+};
+
 /**
  * @brief RishkaVM class for simulating a Rishka virtual machine.
  * 
@@ -43,17 +89,88 @@
  */
 class RishkaVM final {
 private:
-    uint64_t registers[32];                 ///< CPU registers
-    uint8_t memory[RISHKA_VM_STACK_SIZE];   ///< Memory space for the virtual machine
+    rishka_uxlen_t registers[32];           ///< CPU registers, RISHKA_VM_XLEN bits wide
+    uint64_t fregisters[32];                ///< Floating-point registers, with single-precision values NaN-boxed
+    uint8_t vregisters[32 * RISHKA_VM_VLENB];   ///< Vector registers, RISHKA_VM_VLEN bits each
+    uint32_t fcsr;                          ///< Floating-point rounding mode (bits 7:5) and accrued exception flags (bits 4:0)
+    uint32_t vl;                            ///< Number of elements processed by vector instructions
+    rishka_uxlen_t vtype;                   ///< Vector element width and grouping, with vill in the most significant bit
+    uint64_t instret;                       ///< Instructions retired by the guest, backing the cycle and instret CSRs
+
+#if RISHKA_VM_PAGED_MEMORY
+    uint8_t** pages;                        ///< Page table of the guest memory, shared by all harts, with NULL for pages not touched yet
+    rishka_tlb_entry tlb[RISHKA_VM_TLB_SIZE];   ///< Recently used pages of this hart, indexed by page number modulo the TLB size
+    uint8_t* pinned[8];                     ///< Contiguous copies of the pointer parameters of the current system call, or NULL
+    uint8_t* pageTiers;                     ///< Memory tier of each touched page, shared by all harts
+    uint8_t* dirtyPages;                    ///< Flag of each page written since the last reset, shared by all harts
+    rishka_memory_tier placement[RISHKA_REGION_COUNT];  ///< Memory tier new pages of each region are allocated from
+    uint64_t tierAccesses[RISHKA_MEMORY_TIER_COUNT];    ///< Guest memory accesses of this hart served by each memory tier
+#else
+    uint8_t* memory;                        ///< Memory space of the guest, shared by all harts, after the written flags of its pages (see rishka_mark_dirty())
+#endif
+    rishka_memory_layout layout;            ///< Size and layout of the guest memory, with a zero size while none is allocated
+    uint64_t imageEnd;                      ///< End address of the loaded program binary, where the heap region begins
+    String programFile;                     ///< SD card path of the loaded program binary, or empty
+
+#if RISHKA_VM_HEATMAP
+    rishka_page_heat* heat;                 ///< Access counters of each guest page, shared by all harts
+    String heatmapFile;                     ///< SD card file the heatmap is written to when the program exits, or empty
+#endif
+
+    RishkaVM* primary;                      ///< Hart that allocated the memory, this VM itself unless it was created by spawnHart()
+    RishkaVM* harts[RISHKA_VM_MAX_HARTS - 1];   ///< Additional harts sharing the memory of this one, or NULL
+    uint32_t hartId;                        ///< Index of this hart, 0 for the hart that allocated the memory
+    bool finished;                          ///< Flag set once the host task of an additional hart has returned
+    RishkaVM* syscallOwner;                 ///< Hart holding the lock that serializes system calls, used on the primary hart
+
+    rishka_uxlen_t reservation;             ///< Address reserved by the last load-reserved instruction
+    uint64_t reservedValue;                 ///< Value read by the last load-reserved instruction
+    bool reserved;                          ///< Flag indicating whether the reservation is still valid
+
+    rishka_decoded_inst decodeCache[RISHKA_VM_DECODE_CACHE_SIZE + 2]; ///< Pre-decoded instructions indexed by pc >> 1, plus two undecoded sentinels
+    rishka_block blockCache[RISHKA_VM_BLOCK_CACHE_SIZE];              ///< Translated basic blocks indexed by (pc >> 2) modulo the cache size
+
+    uint16_t hotness[RISHKA_VM_HOTNESS_TABLE_SIZE];                     ///< Hotness counters of branch and call targets
+
+    rishka_return_entry returnStack[RISHKA_VM_RETURN_STACK_SIZE];       ///< Return addresses of the calls in flight, used circularly
+    uint32_t returnTop;                                                 ///< Number of pushes minus pops of the return-address stack
+    rishka_jump_entry jumpCache[RISHKA_VM_JUMP_CACHE_SIZE];             ///< Last targets of indirect jumps, indexed by (address >> 1) modulo the cache size
+
+    rishka_tier_policy tierPolicy;          ///< Policy for promoting code to the block tier
+    uint16_t promotionThreshold;            ///< Counted entries before code is promoted to a block
+    rishka_tier_stats tierStats;            ///< Promotion statistics
+
+#if RISHKA_VM_HLE
+    int64_t routines[RISHKA_HLE_COUNT];     ///< Entry address of each known routine in the loaded program, or -1
+    bool hasRoutines;                       ///< Flag indicating whether any known routine was found
+#endif
+
+#if RISHKA_VM_AOT
+    const rishka_aot_program* translations; ///< Ahead-of-time translation of the loaded program, or NULL
+#endif
+
+#if RISHKA_VM_CODE_CACHE
+    rishka_code_image codeImage;            ///< Identity of the loaded binary in the code cache
+#endif
+
+#if RISHKA_VM_JIT
+    RishkaJIT jit;                          ///< Native translator for hot blocks
+    uint32_t nativeThreshold;               ///< Block executions before native translation
+#endif
 
     int64_t pc;                             ///< Program counter
     fabgl::Terminal* terminal;              ///< Terminal for input/output operations
     fabgl::BaseDisplayController* display;  ///< Base display controller of the VM
     ArduinoNvs* nvsStorage;                 ///< Non-volatile Storage class pointer
+    RishkaVMPool* pool;                     ///< Pool the VM was leased from, or NULL
 
     bool running;                           ///< Flag indicating whether the VM is running
+    bool panicked;                          ///< Flag indicating whether the VM stopped on a panic
     int64_t exitCode;                       ///< Exit code of the VM after execution
 
+    bool suspended;                         ///< Flag indicating whether a system call suspended the guest
+    unsigned long resumeTime;               ///< Value of millis() at which a suspended guest resumes
+
     char** argv;                            ///< Command-line arguments
     uint8_t argc;                           ///< Number of command-line arguments
 
@@ -61,15 +178,237 @@ private:
     String outputStream;                    ///< Output stream from the VM system calls
 
     /**
-     * @brief Fetches the next instruction to be executed in a virtual machine.
+     * @brief Fetches an instruction from the memory of a virtual machine.
+     *
+     * The instruction is read one halfword at a time, so it only needs to be
+     * 2-byte aligned. For compressed instructions only the low halfword is
+     * read and the upper one is left zero.
+     *
+     * @param address The guest address of the instruction.
+     * @return The fetched instruction.
+     */
+    uint32_t fetch(int64_t address);
+
+    /**
+     * @brief Finds the region of the address space an address belongs to.
+     *
+     * @param address The guest address.
+     * @return The region, which decides the memory tier of a new page.
+     */
+    rishka_memory_region regionOf(uint64_t address) const;
+
+#if RISHKA_VM_HEATMAP
+    /**
+     * @brief Counts an access of the program in the heatmap.
+     *
+     * Accesses outside of guest memory are left to fault as usual.
+     *
+     * @param address The guest address of the access.
+     * @param kind The kind of the access.
+     */
+    inline void recordAccess(uint64_t address, rishka_heat_kind kind) {
+        if(address < this->layout.memorySize)
+            this->heat[address / RISHKA_VM_PAGE_SIZE].counts[kind]++;
+    }
+#endif
+
+#if RISHKA_VM_PAGED_MEMORY
+    /**
+     * @brief Maps the page holding a guest address into the TLB.
+     *
+     * The page is allocated on its first touch, from PSRAM if there is
+     * any. Pages are shared by all harts and kept until the virtual
+     * machine is destroyed or its memory is resized, so TLB entries never
+     * go stale while a program runs. A page shared with a forked virtual
+     * machine is mapped read-only, and copied when mapped for writing.
+     * Pages not written since the last reset are mapped read-only as
+     * well, and flagged as written once mapped for writing.
+     *
+     * @param address The guest address.
+     * @param write true if the page is about to be written.
+     * @return The host memory of the page, or NULL if `address` is outside
+     *         of guest memory or the page could not be allocated.
+     */
+    uint8_t* mapPage(uint64_t address, bool write);
+
+    /**
+     * @brief Gives this virtual machine its own copy of a touched page shared with forked ones.
+     *
+     * @param index The index of the page.
+     * @return The host memory of the page, or NULL if it could not be copied.
+     */
+    uint8_t* unsharePage(uint64_t index);
+
+    /**
+     * @brief Copies every page shared with forked virtual machines and flushes the TLB.
+     *
+     * @return false if a page could not be copied.
+     */
+    bool unsharePages();
+#else
+    /**
+     * @brief Flags the pages of a range of guest memory as written since the last reset.
+     *
+     * @param address The guest address of the range.
+     * @param size The size of the range in bytes.
+     */
+    inline void markDirty(uint64_t address, uint64_t size) {
+        for(uint64_t page = address / RISHKA_VM_PAGE_SIZE; size > 0 && page <= (address + size - 1) / RISHKA_VM_PAGE_SIZE; page++)
+            rishka_mark_dirty(this->memory, page * RISHKA_VM_PAGE_SIZE, 1);
+    }
+#endif
+
+    /**
+     * @brief Checks whether a guest page was written since the last reset.
+     *
+     * @param index The index of the page.
+     * @return true if the page was written.
+     */
+    inline bool isDirty(uint64_t index) const {
+#if RISHKA_VM_PAGED_MEMORY
+        return __atomic_load_n(&this->dirtyPages[index], __ATOMIC_RELAXED) != 0;
+#else
+        return this->memory[-1 - (int64_t) index] != 0;
+#endif
+    }
+
+    /**
+     * @brief Zeroes the guest pages written since the last reset.
+     *
+     * Pages still shared with forked virtual machines are dropped instead,
+     * to be allocated again on their next touch.
+     */
+    void clearDirtyPages();
+
+    /**
+     * @brief Looks up what accompanies a loaded program binary on the SD card.
+     *
+     * Reads the symbol table of its known routines and finds its
+     * ahead-of-time translation, as far as the build supports them.
+     *
+     * @param fileName The path of the program binary on the SD card.
+     */
+    void attachProgram(String fileName);
+
+#if RISHKA_VM_PAGED_MEMORY
+    /**
+     * @brief Translates a guest address for an access within a single page.
+     *
+     * The page is mapped for writing, as for the atomic instructions.
+     *
+     * @tparam T The type of the access.
+     * @param address The guest address of the access.
+     * @return The host address of the access, or NULL if it spans two
+     *         pages or falls outside of guest memory.
+     */
+    template<typename T>
+    inline T* translate(uint64_t address) {
+        T* host = rishka_tlb_lookup<T, true>(this->tlb, address);
+        if(host != NULL)
+            return host;
+
+        if((address &(RISHKA_VM_PAGE_SIZE - 1)) + sizeof(T) > RISHKA_VM_PAGE_SIZE)
+            return NULL;
+
+        uint8_t* page = this->mapPage(address, true);
+        return page != NULL ? (T*)(&page[address &(RISHKA_VM_PAGE_SIZE - 1)]) : NULL;
+    }
+
+    /**
+     * @brief Loads a value from guest memory.
+     *
+     * @tparam T The type of the value.
+     * @param address The guest address of the value.
+     * @param value Output pointer receiving the value.
+     * @return false if the value is outside of guest memory.
+     */
+    template<typename T>
+    inline bool load(uint64_t address, T* value) {
+        const T* host = rishka_tlb_lookup<T>(this->tlb, address);
+        if(host == NULL)
+            return this->readMemory(address, value, sizeof(T));
+
+        *value = *host;
+        return true;
+    }
+
+    /**
+     * @brief Stores a value to guest memory.
      *
-     * This function fetches the next instruction from the program counter of
-     * the specified Rishka virtual machine instance `vm`. It returns the fetched
-     * instruction for execution by the virtual machine.
+     * The decode cache is left to the caller, as for every store.
      *
-     * @return The next instruction to be executed.
+     * @tparam T The type of the value.
+     * @param address The guest address of the value.
+     * @param value The value.
+     * @return false if the value is outside of guest memory.
      */
-    uint32_t fetch();
+    template<typename T>
+    inline bool store(uint64_t address, T value) {
+        T* host = rishka_tlb_lookup<T, true>(this->tlb, address);
+        if(host == NULL)
+            return this->writeMemory(address, &value, sizeof(T));
+
+        *host = value;
+        return true;
+    }
+
+    /**
+     * @brief Fills a range of guest memory with a byte value.
+     *
+     * @param address The guest address of the range.
+     * @param value The byte value.
+     * @param size The size of the range in bytes.
+     * @return false if the range is outside of guest memory.
+     */
+    bool fillMemory(uint64_t address, uint8_t value, uint64_t size);
+
+    /**
+     * @brief Copies a range of guest memory, which may overlap the destination, like memmove().
+     *
+     * @param dest The guest address of the destination.
+     * @param src The guest address of the source.
+     * @param size The size of the range in bytes.
+     * @return false if either range is outside of guest memory.
+     */
+    bool moveMemory(uint64_t dest, uint64_t src, uint64_t size);
+
+    /**
+     * @brief Returns a contiguous host copy of a pointer parameter, see getPointerParam().
+     *
+     * Parameters lying within a single page are returned in place, the
+     * others are copied to a buffer released by releaseParams().
+     *
+     * @param pos The position of the parameter.
+     * @param size The size of the pointed object in bytes, or 0 for a NUL-terminated string.
+     * @return The host address of the object, or NULL if it is not inside guest memory.
+     */
+    void* pinParam(uint8_t pos, uint32_t size);
+
+    /**
+     * @brief Frees the buffers of the pointer parameters of the last system call.
+     */
+    void releaseParams();
+#endif
+
+    /**
+     * @brief Returns the guest memory as seen by the code cache and translated block checks.
+     *
+     * @return The page table, or the flat memory without RISHKA_VM_PAGED_MEMORY.
+     */
+    inline rishka_guest_memory guestMemory() const {
+#if RISHKA_VM_PAGED_MEMORY
+        return this->pages;
+#else
+        return this->memory;
+#endif
+    }
+
+    /**
+     * @brief Frees the guest memory of the virtual machine, leaving it with none.
+     *
+     * Only the hart that allocated the memory may release it.
+     */
+    void releaseMemory();
 
     /**
      * @brief Handles a system call in a Rishka virtual machine instance.
@@ -84,24 +423,335 @@ private:
     uint64_t handleSyscall(uint64_t code);
 
     /**
-     * @brief Executes the given instruction.
-     * 
-     * @param inst The instruction to execute.
+     * @brief Acquires the lock serializing the system calls of all harts.
+     *
+     * @return true once the lock is held, false if this hart was stopped
+     *         while waiting for it.
+     */
+    bool lockSyscalls();
+
+    /**
+     * @brief Releases the lock acquired by lockSyscalls().
+     */
+    void unlockSyscalls();
+
+    /**
+     * @brief Runs a started program until it exits, waiting out its delays and yields.
+     */
+    void runUntilExit();
+
+    /**
+     * @brief Host task of an additional hart, started by spawnHart().
+     *
+     * @param hart The RishkaVM instance of the hart.
+     */
+    static void runHart(void* hart);
+
+#if defined(__linux__) && !defined(ESP_PLATFORM)
+    /**
+     * @brief Host thread of an additional hart on Linux, running runHart().
+     *
+     * @param hart The RishkaVM instance of the hart.
+     * @return NULL, as the thread is not joined for a result.
+     */
+    static void* runHartThread(void* hart);
+#endif
+
+    /**
+     * @brief Reads a control and status register.
+     *
+     * @param csr The CSR number (see rishka_csr).
+     * @return The value of the register.
+     */
+    uint64_t readCsr(uint16_t csr);
+
+    /**
+     * @brief Writes a control and status register.
+     *
+     * Bits outside the fields of the register are ignored.
+     *
+     * @param csr The CSR number (see rishka_csr).
+     * @param value The new value of the register.
+     */
+    void writeCsr(uint16_t csr, uint64_t value);
+
+    /**
+     * @brief Sets the vector type and length, as vsetvli, vsetivli and vsetvl do.
+     *
+     * An unsupported type sets vill in `vtype` and the vector length to 0.
+     * Otherwise the vector length becomes the smaller of `avl` and the
+     * number of elements of a register group of the type.
+     *
+     * @param vtype The new value of the vtype register.
+     * @param avl The application vector length.
+     */
+    void configureVector(rishka_uxlen_t vtype, uint64_t avl);
+
+    /**
+     * @brief Executes a vector load, store, arithmetic, mask or move instruction.
+     *
+     * Elements past the vector length, and elements disabled by the v0 mask,
+     * are left undisturbed.
+     *
+     * @param inst The decoded vector instruction.
+     * @return false if the instruction is illegal with the current vector
+     *         type, or uses misaligned register groups.
+     */
+    bool executeVector(const rishka_decoded_inst& inst);
+
+    /**
+     * @brief Finds the promoted block starting at a guest address.
+     *
+     * @param pc The guest address of the first instruction of the block.
+     * @return The block descriptor, or NULL if no block starts at `pc`.
+     */
+    rishka_block* lookupBlock(int64_t pc);
+
+    /**
+     * @brief Decides whether code entered at a guest address is promoted.
+     *
+     * Under RISHKA_TIER_HOTNESS, code reached from a promoted block is
+     * promoted right away. Otherwise, only counted entries (backward branches
+     * and jumps, and function calls) bump the hotness counter of `pc`, and
+     * the code is promoted when the counter reaches the promotion threshold.
+     *
+     * @param pc The guest address being entered.
+     * @param fromBlock Whether control comes from a promoted block.
+     * @param counted Whether the entry is a backward branch, jump or call.
+     * @return true if a block should be translated at `pc`.
+     */
+    bool isHot(int64_t pc, bool fromBlock, bool counted);
+
+    /**
+     * @brief Translates the basic block starting at a guest address.
+     *
+     * The instructions from `pc` up to the next control transfer or system
+     * instruction are decoded into the decode cache and the block cache slot
+     * of `pc` is reused for the new block, evicting its previous occupant.
+     *
+     * @param pc The guest address of the first instruction of the block.
+     * @return The block descriptor, or NULL if `pc` is misaligned or outside
+     *         the range covered by the decode cache.
+     */
+    rishka_block* translateBlock(int64_t pc);
+
+    /**
+     * @brief Measures the straight-line run of instructions starting at a guest address.
+     *
+     * Undecoded entries of the run are decoded on the way.
+     *
+     * @param pc The guest address of the first instruction, inside the decode cache.
+     * @param limit The number of instructions after which measuring stops.
+     * @return The number of instructions up to and including the first control
+     *         transfer or system instruction, or `limit + 1` if there are more.
+     */
+    uint32_t measureRun(int64_t pc, uint32_t limit);
+
+    /**
+     * @brief Decodes a raw instruction word into its resolved form.
+     *
+     * This function resolves the opcode, funct3 and funct7 fields of `inst`
+     * into a single rishka_decoded_op value and extracts the register indices
+     * and the sign-extended immediate. Register writes to x0 without any side
+     * effect are resolved to RISHKA_DOP_NOP. Compressed instructions, whose
+     * two low bits are not both set, are expanded with expandCompressed()
+     * first.
+     *
+     * @param inst The raw instruction word, of which only the low halfword
+     *             is used for compressed instructions.
+     * @param decoded Output pointer receiving the decoded instruction.
+     */
+    static void decode(uint32_t inst, rishka_decoded_inst* decoded);
+
+    /**
+     * @brief Fetches and decodes the instruction at a guest address.
+     *
+     * The entry instruction of a known routine of the loaded program is
+     * decoded to RISHKA_DOP_HLE instead, with the rishka_hle_routine in
+     * the immediate field, so that calls to it run emulateRoutine().
+     *
+     * @param pc The guest address of the instruction.
+     * @param decoded Output pointer receiving the decoded instruction.
+     */
+    void decodeAt(int64_t pc, rishka_decoded_inst* decoded);
+
+#if RISHKA_VM_HLE
+    /**
+     * @brief Reads the entry addresses of known routines from a symbol table.
+     *
+     * The symbol table is the output of `nm` for the ELF file of the program,
+     * one `<hex address> <type> <name>` line per symbol, as written next to
+     * the binary by rishka-cc. Routines missing from it, or a missing file,
+     * simply leave the guest code interpreted.
+     *
+     * @param fileName The path of the symbol table on the SD card.
+     */
+    void loadSymbols(String fileName);
+
+    /**
+     * @brief Runs a known routine natively on the guest memory.
+     *
+     * The arguments are taken from a0 to a2 following the calling convention
+     * and the result is written to a0; the caller then returns to ra.
+     *
+     * @param routine The rishka_hle_routine to run.
+     * @return false if the routine would access memory outside of the guest memory.
+     */
+    bool emulateRoutine(uint8_t routine);
+#endif
+
+    /**
+     * @brief Decodes a floating-point arithmetic, conversion or move instruction.
+     *
+     * Called by decode() for the fused multiply-add and floating-point
+     * opcodes. The rounding mode of the instruction is stored in the
+     * immediate field, and fused multiply-add instructions keep rs3 in its
+     * low five bits and the rounding mode above them.
+     *
+     * @param inst The raw instruction word.
+     * @param decoded Output pointer receiving the decoded instruction, with
+     *                its register indices and length already set.
+     */
+    static void decodeFloat(uint32_t inst, rishka_decoded_inst* decoded);
+
+    /**
+     * @brief Decodes a vector instruction.
+     *
+     * Called by decode() for the vector opcode and for the element widths of
+     * the floating-point load and store opcodes. The configuration
+     * instructions keep their vtype immediate in the immediate field, and
+     * vsetivli its vector length in rs1. For the other instructions, the
+     * immediate field holds the unmasked flag (vm) in bit 0, the operand
+     * form in bits 2:1 (0 for a vector, 1 for a scalar register, 2 for an
+     * immediate), the rishka_vector_op in bits 7:3 and the immediate operand
+     * above them. Loads and stores keep the log2 of their element width in
+     * bytes in bits 2:1 instead, and the stored register in rd.
+     *
+     * @param inst The raw instruction word.
+     * @param decoded Output pointer receiving the decoded instruction, with
+     *                its register indices and length already set.
+     */
+    static void decodeVector(uint32_t inst, rishka_decoded_inst* decoded);
+
+    /**
+     * @brief Expands a compressed (RVC) instruction into its 32-bit equivalent.
+     *
+     * The RV64-only forms are not supported when RISHKA_VM_XLEN is 32, where
+     * their encodings load and store single-precision floats instead.
+     *
+     * @param inst The 16-bit compressed instruction.
+     * @return The equivalent 32-bit instruction, or 0 if `inst` is reserved
+     *         or not supported.
+     */
+    static uint32_t expandCompressed(uint16_t inst);
+
+    /**
+     * @brief Invalidates the decode cache entries overlapping a memory range.
+     *
+     * This function is called on every guest store that lands inside the
+     * range covered by the decode cache, so that rewritten instructions are
+     * decoded again on their next execution. Rewriting an instruction that
+     * was already decoded also drops every translated block.
+     *
+     * @param address The guest address of the first written byte.
+     * @param size The number of bytes written.
+     * @return true if translated blocks were dropped.
+     */
+    bool invalidateDecoded(uint64_t address, uint32_t size);
+
+    /**
+     * @brief Invalidates all entries of the decode cache and the block cache,
+     *        and clears the hotness counters.
      */
-    void execute(uint32_t inst);
+    void invalidateDecodeCache();
 
     /**
-     * @brief Performs left shift operation on a 64-bit signed integer.
+     * @brief Invalidates all translated blocks and their successor links.
+     */
+    void invalidateBlockCache();
+
+#if RISHKA_VM_JIT
+    /**
+     * @brief Translates a hot block to native code.
+     *
+     * If the native code buffer is full, every native translation is
+     * dropped and the translation is retried once.
+     *
+     * @param block The block to be translated.
+     */
+    void translateNative(rishka_block* block);
+#endif
+
+#if RISHKA_VM_AOT
+    /**
+     * @brief Runs a new block from the ahead-of-time translation of the program.
+     *
+     * The block is left to the other tiers if the translation has no
+     * block at its address, or if the instructions in guest memory no
+     * longer match the ones the translation was made from.
      *
-     * This function performs a left shift operation on the 64-bit signed integer
+     * @param block The block, freshly measured by translateBlock().
+     */
+    void attachTranslation(rishka_block* block);
+#endif
+
+#if RISHKA_VM_CODE_CACHE
+    /**
+     * @brief Fills the decode cache with the entries cached for the program just loaded.
+     *
+     * @param size The size of the program binary in bytes.
+     */
+    void restoreCodeCache(uint32_t size);
+
+    /**
+     * @brief Writes the decode cache of the loaded program to the code cache, once.
+     */
+    void storeCodeCache();
+#endif
+
+    /**
+     * @brief Runs the interpreter loop until the virtual machine stops or a budget runs out.
+     *
+     * Cold code is decoded lazily into the decode cache and run from it
+     * without a block descriptor. Code promoted by the tier policy is
+     * executed one basic block at a time. Inside a block, handlers step
+     * through the decode cache without updating the program counter or
+     * checking the running flag; both happen once per block, when control
+     * leaves it through a branch, jump or system instruction and the next
+     * block is entered through its chained successor link. When
+     * RISHKA_VM_THREADED_DISPATCH is enabled and the compiler supports
+     * labels as values, every handler jumps directly to the handler of the
+     * next instruction (direct-threaded dispatch). Otherwise, the same
+     * handlers are dispatched from a portable switch loop. On host builds
+     * with RISHKA_VM_JIT enabled, blocks executed getNativeThreshold()
+     * times are translated to native code and run natively from then on.
+     * Blocks of a program with a registered ahead-of-time translation are
+     * promoted on their first execution and run from that translation.
+     *
+     * The instruction budget is accounted once per block as well. When it
+     * would run out inside the next block, the rest of the budget is
+     * stepped through one instruction at a time.
+     *
+     * @param budget The maximum number of instructions to execute.
+     * @param timeLimit The maximum time to run in microseconds, or 0 for no limit.
+     * @return The reason execution stopped.
+     */
+    rishka_run_status interpret(uint64_t budget, uint32_t timeLimit);
+
+    /**
+     * @brief Performs left shift operation on a signed register value.
+     *
+     * This function performs a left shift operation on the register value
      * `a` by the number of bits specified by `b`. It returns the result of the
      * left shift operation.
      *
-     * @param a The 64-bit signed integer value to be shifted.
+     * @tparam T The signed register type (rishka_xlen_t).
+     * @param a The register value to be shifted.
      * @param b The number of bits to shift `a` by.
      * @return The result of the left shift operation.
      */
-    static int64_t shiftLeftInt64(int64_t a, int64_t b);
+    template<typename T>
+    static T shiftLeft(T a, int64_t b);
 
     /**
      * @brief Performs right shift operation on a 128-bit signed integer.
@@ -117,34 +767,56 @@ private:
     static int64_t shiftRightInt128(int64_t a, int64_t b);
 
     /**
-     * @brief Performs right shift operation on a 64-bit signed integer.
+     * @brief Performs logical right shift operation on a signed register value.
      *
-     * This function performs a right shift operation on the 64-bit signed integer
+     * This function performs a right shift operation on the register value
      * `a` by the number of bits specified by `b`. It returns the result of the
      * right shift operation.
      *
-     * @param a The 64-bit signed integer value to be shifted.
+     * @tparam T The signed register type (rishka_xlen_t).
+     * @param a The register value to be shifted.
      * @param b The number of bits to shift `a` by.
      * @return The result of the right shift operation.
      */
-    static int64_t shiftRightInt64(int64_t a, int64_t b);
+    template<typename T>
+    static T shiftRight(T a, int64_t b);
 
     /**
-     * @brief Performs arithmetic right shift operation on a 64-bit signed integer.
+     * @brief Performs arithmetic right shift operation on a signed register value.
      *
-     * This function performs an arithmetic right shift operation on the 64-bit
-     * signed integer `a` by the number of bits specified by `b`. It returns the
-     * result of the arithmetic right shift operation.
+     * This function performs an arithmetic right shift operation on the
+     * register value `a` by the number of bits specified by `b`. It returns
+     * the result of the arithmetic right shift operation.
      *
-     * @param a The 64-bit signed integer value to be shifted.
+     * @tparam T The signed register type (rishka_xlen_t).
+     * @param a The register value to be shifted.
      * @param b The number of bits to shift `a` by.
      * @return The result of the arithmetic right shift operation.
      */
-    static int64_t arithmeticShiftRightInt64(int64_t a, int64_t b);
+    template<typename T>
+    static T arithmeticShiftRight(T a, int64_t b);
+
+    friend class RishkaVMPool;
 
 public:
     List<File> fileHandles; ///< List of file handles used by the VM system calls
 
+    /**
+     * @brief Creates a virtual machine with the default tiering configuration.
+     *
+     * The tier policy, thresholds and statistics are kept across
+     * initialize() and reset(), so they can be tuned once per deployment.
+     */
+    RishkaVM();
+
+    /**
+     * @brief Destroys the virtual machine.
+     *
+     * Additional harts are stopped first, and the guest memory is freed
+     * by the hart that allocated it.
+     */
+    ~RishkaVM();
+
     /**
      * @brief Stops the execution of the virtual machine.
      * 
@@ -195,6 +867,228 @@ public:
      */
     char* getArgValue(const uint8_t index) const;
 
+    /**
+     * @brief Sets the policy for promoting code out of the interpreter tier.
+     *
+     * @param policy The new tier policy.
+     */
+    void setTierPolicy(rishka_tier_policy policy);
+
+    /**
+     * @brief Gets the policy for promoting code out of the interpreter tier.
+     *
+     * @return The current tier policy.
+     */
+    rishka_tier_policy getTierPolicy() const;
+
+    /**
+     * @brief Sets the number of counted entries after which code is promoted.
+     *
+     * Counted entries are backward branches and jumps to, and calls of, the
+     * code's address. The threshold only applies to RISHKA_TIER_HOTNESS.
+     *
+     * @param threshold The promotion threshold; 0 is treated as 1.
+     */
+    void setPromotionThreshold(uint16_t threshold);
+
+    /**
+     * @brief Gets the number of counted entries after which code is promoted.
+     *
+     * @return The promotion threshold.
+     */
+    uint16_t getPromotionThreshold() const;
+
+#if RISHKA_VM_JIT
+    /**
+     * @brief Sets the number of executions after which a block is translated to native code.
+     *
+     * @param threshold The native threshold; 0 disables native translation.
+     */
+    void setNativeThreshold(uint32_t threshold);
+
+    /**
+     * @brief Gets the number of executions after which a block is translated to native code.
+     *
+     * @return The native threshold.
+     */
+    uint32_t getNativeThreshold() const;
+#endif
+
+#if RISHKA_VM_JIT || RISHKA_VM_AOT
+    /**
+     * @brief Store callback of native blocks, see rishka_native_store_hook.
+     *
+     * @param vm The RishkaVM running the block.
+     * @param address The guest address of the first written byte.
+     * @param size The number of bytes written.
+     * @return true if the store invalidated translated blocks.
+     */
+    static bool nativeStoreHook(void* vm, uint64_t address, uint8_t size);
+#endif
+
+#if RISHKA_VM_AOT && RISHKA_VM_PAGED_MEMORY
+    /**
+     * @brief Memory access callback of translated blocks, see rishka_aot_access().
+     *
+     * @param vm The RishkaVM running the block.
+     * @param address The guest address of the access.
+     * @param data The value to be read or written.
+     * @param size The size of the access in bytes.
+     * @param write true to write `data` to guest memory, false to read it.
+     */
+    static void nativeAccessHook(void* vm, uint64_t address, void* data, uint8_t size, bool write);
+#endif
+
+    /**
+     * @brief Copies bytes out of guest memory.
+     *
+     * @param address The guest address of the first byte.
+     * @param data The host buffer receiving the bytes.
+     * @param size The number of bytes.
+     * @return false if the range is outside of guest memory.
+     */
+    bool readMemory(uint64_t address, void* data, uint32_t size);
+
+    /**
+     * @brief Copies bytes into guest memory.
+     *
+     * Instructions already decoded from the range are not decoded again, so
+     * this is meant for data rather than code.
+     *
+     * @param address The guest address of the first byte.
+     * @param data The bytes to be written.
+     * @param size The number of bytes.
+     * @return false if the range is outside of guest memory.
+     */
+    bool writeMemory(uint64_t address, const void* data, uint32_t size);
+
+    /**
+     * @brief Gets the amount of host memory holding the guest memory.
+     *
+     * With RISHKA_VM_PAGED_MEMORY, this counts the pages touched so far by
+     * the program and the harts sharing its memory; otherwise it is the
+     * whole memory size of the layout once the virtual machine is
+     * initialized.
+     *
+     * @return The size of the guest memory allocated, in bytes.
+     */
+    size_t getMemoryUsage() const;
+
+#if RISHKA_VM_PAGED_MEMORY
+    /**
+     * @brief Sets the memory tier the pages of a region are allocated from.
+     *
+     * Pages already touched stay where they are, so the placement is best
+     * set before loadFile(). A tier that runs out of memory falls back to
+     * the other; on the ESP32, internal SRAM is only used while
+     * RISHKA_VM_SRAM_RESERVE bytes of it stay free. By default the stack
+     * is placed in SRAM and the program image and heap in PSRAM.
+     *
+     * @param region The region of the address space.
+     * @param tier The memory tier of its new pages.
+     */
+    void setMemoryPlacement(rishka_memory_region region, rishka_memory_tier tier);
+
+    /**
+     * @brief Gets the memory tier the pages of a region are allocated from.
+     *
+     * @param region The region of the address space.
+     * @return The memory tier of its new pages.
+     */
+    rishka_memory_tier getMemoryPlacement(rishka_memory_region region) const;
+
+    /**
+     * @brief Gets the accesses and allocations of each memory tier.
+     *
+     * Accesses are those of this hart since the last resetMemoryStats(),
+     * counted with RISHKA_VM_MEMORY_STATS; allocations are those of the
+     * whole address space.
+     *
+     * @return The statistics of each memory tier.
+     */
+    rishka_memory_stats getMemoryStats() const;
+
+    /**
+     * @brief Clears the access counters of the memory tiers.
+     */
+    void resetMemoryStats();
+#endif
+
+#if RISHKA_VM_HEATMAP
+    /**
+     * @brief Sets the SD card file the heatmap is written to when the program exits.
+     *
+     * The file is written by runFor() once the program exits or panics,
+     * see writeHeatmap(). It defaults to RISHKA_VM_HEATMAP_FILE.
+     *
+     * @param path The path of the file, or an empty string to only keep
+     *             the counters in memory.
+     */
+    void setHeatmapFile(String path);
+
+    /**
+     * @brief Gets the accesses of the program to a page of guest memory.
+     *
+     * Counters start over when a program is loaded or resetHeatmap() is
+     * called. The accesses of every hart are counted, those made by system
+     * calls on behalf of the program are not.
+     *
+     * @param page The index of the page, its guest address divided by RISHKA_VM_PAGE_SIZE.
+     * @return The accesses of each kind, all zero if the page is outside of guest memory.
+     */
+    rishka_page_heat getPageHeat(uint64_t page) const;
+
+    /**
+     * @brief Gets the accesses of the program to a region of the address space.
+     *
+     * Pages are counted in the region of their first byte. Code and data
+     * of the program image are told apart by their fetches and loads.
+     *
+     * @param region The region of the address space.
+     * @return The accesses of each kind, summed over the pages of the region.
+     */
+    rishka_page_heat getRegionHeat(rishka_memory_region region) const;
+
+    /**
+     * @brief Writes the heatmap to a CSV file on the SD card.
+     *
+     * The file has an `address,region,fetches,loads,stores` header, one
+     * row for each page accessed, with its guest address in hexadecimal,
+     * and one row for each region with `total` in place of the address.
+     *
+     * @param path The path of the file, which is replaced.
+     * @return true if the file was written.
+     */
+    bool writeHeatmap(String path) const;
+
+    /**
+     * @brief Clears the access counters of every page.
+     */
+    void resetHeatmap();
+#endif
+
+    /**
+     * @brief Gets the promotion statistics of the tiered execution engine.
+     *
+     * @return A copy of the statistics accumulated since the last reset.
+     */
+    rishka_tier_stats getTierStats() const;
+
+    /**
+     * @brief Clears the promotion statistics.
+     */
+    void resetTierStats();
+
+    /**
+     * @brief Gets the number of instructions retired by the guest.
+     *
+     * This is the value the guest reads from the `instret` and `cycle` CSRs,
+     * counted since the virtual machine was last initialized.
+     *
+     * @return The retired instruction count.
+     */
+    uint64_t getRetiredCount() const;
+
     /**
      * @brief Initializes the virtual machine instance.
      *
@@ -203,34 +1097,83 @@ public:
      * state of the virtual machine, including resetting registers, memory, and file
      * handles. Once initialized, the virtual machine is ready for execution.
      *
+     * The guest memory is allocated for `layout`, and reallocated if an
+     * earlier initialization used another memory size. An invalid layout
+     * leaves the virtual machine without memory, so that loadFile() fails.
+     *
      * @param stream A pointer to the Terminal object for input/output operations.
      * @param displayCtrl The base display controller of the VM
      * @param nvsStorage Non-volatile Storage class pointer for the VM
      * @param directory The path to the new working directory.
+     * @param layout The size of the guest memory and the regions of the program in it.
      */
     void initialize(
         fabgl::Terminal* terminal,
         fabgl::BaseDisplayController* displayCtrl,
         ArduinoNvs* nvsStorage,
-        String workingDirectory = "/"
+        String workingDirectory = "/",
+        rishka_memory_layout layout = {RISHKA_VM_STACK_SIZE, RISHKA_VM_CODE_ADDRESS, RISHKA_VM_STACK_RESERVE}
     );
 
+    /**
+     * @brief Gets the layout of the guest memory.
+     *
+     * @return The layout passed to initialize(), with a zero memory size
+     *         if it was invalid or could not be allocated.
+     */
+    rishka_memory_layout getMemoryLayout() const;
+
     /**
      * @brief Resets the Rishka virtual machine instance to its initial state.
      *
      * This function resets the specified Rishka VM instance to its initial
      * state, clearing registers, memory, and file handles. It prepares the
-     * virtual machine for re-initialization or re-execution.
+     * virtual machine for re-initialization or re-execution. The decoded
+     * instructions of the program are kept in the code cache for its next
+     * run (see rishka_code_cache.h).
+     *
+     * Only the pages of guest memory written since the last reset are
+     * cleared, so a reset costs what the program wrote rather than the
+     * whole memory size. Pages the program only read stay allocated.
      */
     void reset();
 
+    /**
+     * @brief Gets the number of guest pages written since the last reset.
+     *
+     * Loading a program writes the pages it is loaded into, and every page
+     * the program or its system calls write afterwards counts too. These
+     * are the pages the next reset() clears.
+     *
+     * @return The number of pages written, of RISHKA_VM_PAGE_SIZE bytes each.
+     */
+    uint32_t getDirtyPageCount() const;
+
+    /**
+     * @brief Checks that the virtual machine is in the state of a newly initialized one.
+     *
+     * This holds after initialize() and reset(): no page of guest memory
+     * was written, every register is zero, and no program is loaded or
+     * running. With `scanMemory`, every byte of guest memory is also
+     * checked to be zero, which takes time proportional to the memory size
+     * and is meant for tests of the page tracking.
+     *
+     * @param scanMemory true to read the whole guest memory as well.
+     * @return true if the virtual machine cannot be told from a new one.
+     */
+    bool isPristine(bool scanMemory = false) const;
+
     /**
      * @brief Loads a program file into a Rishka virtual machine instance.
      *
      * This function loads the program file specified by `fileName` into the
      * Rishka virtual machine instance. It checks if the file exists and is
      * readable, then loads its contents into the memory of the virtual machine
-     * for execution.
+     * at the code address of its layout for execution, failing if they do
+     * not fit below the stack region. If an ahead-of-time translation was registered under
+     * the name of the file, without directory and `.bin` extension, the
+     * program runs from it (see rishka_aot.h), and the instructions decoded
+     * by its previous runs are restored from the code cache.
      *
      * @param fileName The name of the program file to be loaded.
      * @param enableBoot Enable loading the /bin/boot.bin program.
@@ -238,6 +1181,45 @@ public:
      */
     bool loadFile(const char* fileName, bool enableBoot = false);
 
+    /**
+     * @brief Saves the state of the loaded program to a snapshot file on the SD card.
+     *
+     * The snapshot holds the registers and program counter, the working
+     * directory, the path and position of each open file, and the pages
+     * of guest memory the program wrote that are not all zero, so its size
+     * follows what the program uses rather than the memory size. It is
+     * meant to be taken between two runFor() calls, or before the program
+     * is started. The file is written next to `path` and renamed over it
+     * once complete, so a power loss while saving keeps the previous
+     * snapshot. Only a hart that runs no additional ones can be saved.
+     *
+     * @param path The path of the snapshot file, which is replaced.
+     * @return true if the snapshot was written.
+     */
+    bool saveSnapshot(String path);
+
+    /**
+     * @brief Resumes a program from a snapshot file written by saveSnapshot().
+     *
+     * The virtual machine is reset and takes the memory layout, registers,
+     * memory, working directory and open files of the snapshot, keeping its
+     * devices. The program then continues where it was saved once started
+     * with run() or start(), which pass its command-line arguments again.
+     * Files are reopened for reading and writing at their saved position,
+     * and those missing from the SD card are left closed. A delay the
+     * program was waiting in is cut short.
+     *
+     * The snapshot must come from a build with the same RISHKA_VM_XLEN,
+     * RISHKA_VM_VLEN and RISHKA_VM_PAGE_SIZE. The whole file is checked
+     * against its checksum first, so a snapshot that does not match, or
+     * that is damaged, leaves the virtual machine and its program as they
+     * were. Only a read error while restoring leaves it reset.
+     *
+     * @param path The path of the snapshot file.
+     * @return true if the program was restored.
+     */
+    bool loadSnapshot(String path);
+
     /**
      * @brief Runs the Rishka virtual machine instance.
      *
@@ -245,13 +1227,120 @@ public:
      * instance with the provided command line arguments `argc` and `argv`.
      * It executes the loaded program, if any, and handles any system calls or
      * instructions encountered during execution until the program exits or an
-     * error occurs.
+     * error occurs. Delays and yields of the guest block the calling task.
      *
      * @param argc The number of command line arguments.
      * @param argv An array of pointers to command line argument strings.
      */
     void run(int argc, char** argv);
 
+    /**
+     * @brief Prepares the loaded program to be run with runFor() or step().
+     *
+     * @param argc The number of command line arguments.
+     * @param argv An array of pointers to command line argument strings.
+     */
+    void start(int argc, char** argv);
+
+    /**
+     * @brief Runs the started program for a bounded number of instructions.
+     *
+     * Execution stops after at most `instructionBudget` instructions, once
+     * `timeLimit` microseconds have passed (checked every
+     * RISHKA_VM_DEADLINE_INTERVAL block exits), when the guest waits in a
+     * delay or yield system call, or when it exits. The program resumes
+     * where it stopped on the next call, so a host sketch can interleave
+     * guests with its own work.
+     *
+     * @param instructionBudget The maximum number of instructions to execute.
+     * @param timeLimit The maximum time to run in microseconds, or 0 for no limit.
+     * @return The reason execution stopped.
+     */
+    rishka_run_status runFor(uint64_t instructionBudget, uint32_t timeLimit = 0);
+
+    /**
+     * @brief Executes a single instruction of the started program.
+     *
+     * @return The reason execution stopped, RISHKA_RUN_BUDGET_EXHAUSTED
+     *         if the guest can go on.
+     */
+    rishka_run_status step();
+
+    /**
+     * @brief Starts an additional hart sharing the memory of this virtual machine.
+     *
+     * The hart gets its own registers, program counter and decode cache, and
+     * runs on a host task of its own: a FreeRTOS task pinned to the other core
+     * on the ESP32, or a thread on Linux. It starts at `entry` with `sp` set to
+     * `stackPointer`, `a0` to `argument`, and `gp` and `tp` copied from this hart.
+     * The system calls of all harts are serialized, and every hart keeps its
+     * own file handles. Additional harts stop when the first one exits from
+     * run(), is reset or is destroyed; hosts driving it with runFor() call
+     * stopHarts() themselves.
+     *
+     * @param entry The guest address the hart starts at.
+     * @param stackPointer The initial stack pointer of the hart.
+     * @param argument The value of the `a0` register of the hart.
+     * @return The index of the new hart, or -1 if all RISHKA_VM_MAX_HARTS are
+     *         running or the host could not start a task.
+     */
+    int64_t spawnHart(int64_t entry, rishka_uxlen_t stackPointer, rishka_uxlen_t argument);
+
+    /**
+     * @brief Creates a copy of the virtual machine sharing its memory copy-on-write.
+     *
+     * The copy starts with the registers, program counter, memory, working
+     * directory and decoded instructions of this virtual machine, without
+     * running: the host starts it with run() or runFor(), on any task. With
+     * RISHKA_VM_PAGED_MEMORY both share the pages touched so far until
+     * either writes one, so a copy only costs the pages it changes; of
+     * flat memory, the pages written since the last reset are copied. A
+     * template loaded once can thus be forked for every request instead of
+     * loading the program again. Open files are not inherited. Only a hart
+     * that runs no additional ones can be forked, and only from the task
+     * running it, or while it is stopped.
+     *
+     * @return The new virtual machine, deleted by the caller, or NULL if this
+     *         one has no memory or runs additional harts, or if memory ran out.
+     */
+    RishkaVM* fork();
+
+    /**
+     * @brief Runs a routine of the program in a fork of the virtual machine, see fork().
+     *
+     * The fork starts at `entry` on the stack of this hart, with `a0` set to
+     * `routine` and `a1` to `argument`, and runs until it exits before this
+     * method returns, like the commands of shellExec() do.
+     *
+     * @param entry The guest address the fork starts at.
+     * @param routine The value of the `a0` register of the fork.
+     * @param argument The value of the `a1` register of the fork.
+     * @return The exit code of the fork, or -1 if it could not be created.
+     */
+    int64_t runFork(int64_t entry, rishka_uxlen_t routine, rishka_uxlen_t argument);
+
+    /**
+     * @brief Stops the additional harts and waits for their host tasks to return.
+     */
+    void stopHarts();
+
+    /**
+     * @brief Gets the index of this hart, as read by the guest from `mhartid`.
+     *
+     * @return 0 for the hart that loaded the program, 1 and up for those started by spawnHart().
+     */
+    uint32_t getHartId() const;
+
+    /**
+     * @brief Suspends the guest after the current system call.
+     *
+     * runFor() returns RISHKA_RUN_SYSCALL_BLOCKED until the time has passed,
+     * while run() waits for it.
+     *
+     * @param milliseconds The time to suspend the guest for, 0 to only yield.
+     */
+    void suspend(uint32_t milliseconds);
+
     /**
      * @brief Checks if the virtual machine is running.
      *
@@ -309,6 +1398,16 @@ public:
      */
     ArduinoNvs* getNvsStorage() const;
 
+    /**
+     * @brief Gets the pool the virtual machine was leased from.
+     *
+     * The commands the program runs through shellExec() are leased from
+     * the same pool, so that nested commands reuse its instances too.
+     *
+     * @return The pool of the primary hart, or NULL if it was not leased from one.
+     */
+    RishkaVMPool* getPool() const;
+
     /**
      * @brief Retrieves the current output stream of the virtual machine.
      *
@@ -345,28 +1444,44 @@ public:
     /**
      * @brief Template function to retrieve a parameter from the registers.
      * 
+     * The register is sign-extended from RISHKA_VM_XLEN bits, so signed
+     * 64-bit parameters keep their value on RV32IM guests.
+     *
      * @tparam T The type of the parameter.
      * @param pos The position of the parameter.
      * @return The value of the parameter.
      */
     template<typename T>
     inline constexpr T getParam(const uint8_t pos) const {
-        return (T)(((rishka_u64_arrptr*) &this->registers)->a).v[10 + pos];
+        return (T)(rishka_xlen_t)(((rishka_uxlen_arrptr*) &this->registers)->a).v[10 + pos];
     }
 
     /**
      * @brief Template function to retrieve a pointer parameter from memory.
      * 
+     * With RISHKA_VM_PAGED_MEMORY, an object spanning two pages is copied
+     * to a contiguous buffer that lives until the system call returns, so
+     * the pointer must not be written through, and `size` must be given
+     * for objects other than NUL-terminated strings.
+     *
      * @tparam T The type of the pointer parameter.
      * @param pos The position of the pointer parameter.
-     * @return The pointer value.
+     * @param size The size of the pointed object in bytes, or 0 for a NUL-terminated string.
+     * @return The pointer value, or NULL if the object is not inside paged guest memory.
      */
+#if RISHKA_VM_PAGED_MEMORY
+    template<typename T>
+    inline T getPointerParam(const uint8_t pos, uint32_t size = 0) {
+        return (T) this->pinParam(pos, size);
+    }
+#else
     template<typename T>
-    inline constexpr T getPointerParam(const uint8_t pos) const {
+    inline constexpr T getPointerParam(const uint8_t pos, uint32_t = 0) const {
         return (T)(&(((rishka_u8_arrptr*) this->memory)->a).v[
-            (((rishka_u64_arrptr*) &this->registers)->a).v[10 + pos]
+            (((rishka_uxlen_arrptr*) &this->registers)->a).v[10 + pos]
         ]);
     }
+#endif
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,139 @@
+/* 
+ * This file is part of the Rishka distribution (https://github.com/rishka-esp32/rishka).
+ * Copyright (c) 2024 Nathanne Isip.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include <rishka_util.h>
+#include <rishka_vm_pool.h>
+
+RishkaVMPool::RishkaVMPool() {
+    memset(this->instances, 0, sizeof(this->instances));
+    memset(this->leased, 0, sizeof(this->leased));
+    this->capacity = 0;
+    this->layout = {RISHKA_VM_STACK_SIZE, RISHKA_VM_CODE_ADDRESS, RISHKA_VM_STACK_RESERVE};
+
+    for(uint8_t i = 0; i < RISHKA_VM_POOL_SIZE; i++)
+        for(uint8_t j = 0; j < RISHKA_VM_ARG_COUNT; j++)
+            this->argumentList[i][j] = this->arguments[i][j];
+}
+
+RishkaVMPool::~RishkaVMPool() {
+    for(uint8_t i = 0; i < this->capacity; i++)
+        delete this->instances[i];
+}
+
+uint8_t RishkaVMPool::initialize(uint8_t capacity, rishka_memory_layout layout) {
+    if(capacity > RISHKA_VM_POOL_SIZE)
+        capacity = RISHKA_VM_POOL_SIZE;
+    if(this->capacity == 0)
+        this->layout = layout;
+
+    while(this->capacity < capacity) {
+        RishkaVM* vm = new RishkaVM();
+
+        vm->initialize(NULL, NULL, NULL, "/", layout);
+        if(vm->getMemoryLayout().memorySize == 0) {
+            delete vm;
+            break;
+        }
+
+        vm->pool = this;
+        this->instances[this->capacity++] = vm;
+    }
+
+    return this->capacity;
+}
+
+int RishkaVMPool::findInstance(RishkaVM* vm) const {
+    for(uint8_t i = 0; i < this->capacity; i++)
+        if(this->instances[i] == vm)
+            return i;
+
+    return -1;
+}
+
+RishkaVM* RishkaVMPool::lease(
+    fabgl::Terminal* terminal,
+    fabgl::BaseDisplayController* displayCtrl,
+    ArduinoNvs* nvsStorage,
+    String workingDirectory
+) {
+    for(uint8_t i = 0; i < this->capacity; i++) {
+        if(__atomic_load_n(&this->leased[i], __ATOMIC_RELAXED) ||
+            __atomic_exchange_n(&this->leased[i], true, __ATOMIC_ACQUIRE))
+            continue;
+
+        RishkaVM* vm = this->instances[i];
+        vm->initialize(terminal, displayCtrl, nvsStorage, workingDirectory, vm->getMemoryLayout());
+
+        return vm;
+    }
+
+    return NULL;
+}
+
+RishkaVM* RishkaVMPool::create(
+    fabgl::Terminal* terminal,
+    fabgl::BaseDisplayController* displayCtrl,
+    ArduinoNvs* nvsStorage,
+    String workingDirectory
+) {
+    RishkaVM* vm = new RishkaVM();
+    vm->initialize(terminal, displayCtrl, nvsStorage, workingDirectory, this->layout);
+
+    if(vm->getMemoryLayout().memorySize == 0) {
+        delete vm;
+        return NULL;
+    }
+
+    vm->pool = this;
+    return vm;
+}
+
+void RishkaVMPool::release(RishkaVM* vm) {
+    int index = this->findInstance(vm);
+    if(index == -1)
+        return;
+
+    vm->stopVM();
+    vm->reset();
+    __atomic_store_n(&this->leased[index], false, __ATOMIC_RELEASE);
+}
+
+char** RishkaVMPool::splitArguments(RishkaVM* vm, const String& cmdline, int& count) {
+    int index = this->findInstance(vm);
+    if(index == -1)
+        return NULL;
+
+    count = 0;
+    rishka_split_cmd(cmdline, this->argumentList[index], RISHKA_VM_ARG_COUNT, RISHKA_VM_ARG_LENGTH, count);
+
+    return this->argumentList[index];
+}
+
+uint8_t RishkaVMPool::getCapacity() const {
+    return this->capacity;
+}
+
+uint8_t RishkaVMPool::getAvailable() const {
+    uint8_t available = 0;
+
+    for(uint8_t i = 0; i < this->capacity; i++)
+        if(!__atomic_load_n(&this->leased[i], __ATOMIC_RELAXED))
+            available++;
+
+    return available;
+}
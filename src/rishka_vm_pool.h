@@ -0,0 +1,171 @@
+/* 
+ * This file is part of the Rishka distribution (https://github.com/rishka-esp32/rishka).
+ * Copyright (c) 2024 Nathanne Isip.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file rishka_vm_pool.h
+ * @author [Nathanne Isip](https://github.com/nthnn)
+ * @brief Pool of virtual machines reused from one program to the next.
+ *
+ * A virtual machine holds its decode and block caches inline and its guest
+ * memory on the heap, so creating one for every command of a shell churns
+ * through large allocations and fragments the heap of the ESP32 over time.
+ * A pool allocates a bounded number of them once; programs lease one,
+ * load and run a binary in it, and return it, which resets it for the next
+ * lease while keeping its memory. Each instance also owns the buffers its
+ * command line is split into, so running a command allocates nothing.
+ */
+
+#ifndef RISHKA_VM_POOL_H
+#define RISHKA_VM_POOL_H
+
+#include <ArduinoNvs.h>
+#include <fabgl.h>
+#include <rishka_types.h>
+#include <rishka_vm.h>
+
+/**
+ * @brief Bounded set of virtual machines allocated once and leased out.
+ *
+ * Leasing and returning instances is safe from several tasks at once.
+ */
+class RishkaVMPool final {
+private:
+    RishkaVM* instances[RISHKA_VM_POOL_SIZE];   ///< Allocated virtual machines, or NULL past the capacity
+    bool leased[RISHKA_VM_POOL_SIZE];           ///< Flag set while the instance of the same index is leased
+    char arguments[RISHKA_VM_POOL_SIZE][RISHKA_VM_ARG_COUNT][RISHKA_VM_ARG_LENGTH];  ///< Command line tokens of each instance
+    char* argumentList[RISHKA_VM_POOL_SIZE][RISHKA_VM_ARG_COUNT];   ///< Pointers to the tokens of each instance, passed as argv
+    uint8_t capacity;                           ///< Number of allocated instances
+    rishka_memory_layout layout;                ///< Guest memory layout of the instances
+
+    /**
+     * @brief Finds the index of an instance of this pool.
+     *
+     * @param vm The virtual machine to look for.
+     * @return The index of `vm`, or -1 if it was not leased from this pool.
+     */
+    int findInstance(RishkaVM* vm) const;
+
+public:
+    /**
+     * @brief Creates an empty pool, filled by initialize().
+     */
+    RishkaVMPool();
+
+    /**
+     * @brief Deletes the instances of the pool, which must all have been returned.
+     */
+    ~RishkaVMPool();
+
+    /**
+     * @brief Allocates the virtual machines of the pool and their guest memory.
+     *
+     * Instances already allocated by an earlier call are kept. If memory
+     * runs out, the pool is left with the instances allocated so far.
+     *
+     * @param capacity The number of instances, at most RISHKA_VM_POOL_SIZE.
+     * @param layout The size of the guest memory of every instance and the regions of the program in it.
+     * @return The number of instances of the pool.
+     */
+    uint8_t initialize(
+        uint8_t capacity = RISHKA_VM_POOL_SIZE,
+        rishka_memory_layout layout = {RISHKA_VM_STACK_SIZE, RISHKA_VM_CODE_ADDRESS, RISHKA_VM_STACK_RESERVE}
+    );
+
+    /**
+     * @brief Leases a virtual machine of the pool, ready for RishkaVM::loadFile().
+     *
+     * The instance is attached to the given devices and working directory,
+     * as by RishkaVM::initialize(), and keeps the guest memory layout of
+     * the pool. Programs it runs lease the instances of their commands from
+     * this pool too, see RishkaVM::getPool().
+     *
+     * @param terminal The terminal of the program.
+     * @param displayCtrl The display controller of the program.
+     * @param nvsStorage The non-volatile storage of the program.
+     * @param workingDirectory The working directory of the program.
+     * @return The leased virtual machine, or NULL if all instances are leased.
+     */
+    RishkaVM* lease(
+        fabgl::Terminal* terminal,
+        fabgl::BaseDisplayController* displayCtrl,
+        ArduinoNvs* nvsStorage,
+        String workingDirectory = "/"
+    );
+
+    /**
+     * @brief Creates a virtual machine outside the pool, for when all instances are leased.
+     *
+     * The instance is initialized as by lease(), with the guest memory
+     * layout of the pool, and the programs it runs lease the instances of
+     * their commands from this pool too. It is not returned with
+     * release(), but reset and deleted by the caller.
+     *
+     * @param terminal The terminal of the program.
+     * @param displayCtrl The display controller of the program.
+     * @param nvsStorage The non-volatile storage of the program.
+     * @param workingDirectory The working directory of the program.
+     * @return The new virtual machine, or NULL if memory ran out.
+     */
+    RishkaVM* create(
+        fabgl::Terminal* terminal,
+        fabgl::BaseDisplayController* displayCtrl,
+        ArduinoNvs* nvsStorage,
+        String workingDirectory = "/"
+    );
+
+    /**
+     * @brief Resets a leased virtual machine and returns it to the pool.
+     *
+     * Its program is stopped first if still running. Settings changed
+     * during the lease, such as the tier policy, are kept as by
+     * RishkaVM::reset().
+     *
+     * @param vm The virtual machine returned by lease().
+     */
+    void release(RishkaVM* vm);
+
+    /**
+     * @brief Splits a command line into the argument buffers of a leased virtual machine.
+     *
+     * Tokens are separated by spaces, except within double quotes. At most
+     * RISHKA_VM_ARG_COUNT tokens are kept, each truncated to
+     * RISHKA_VM_ARG_LENGTH - 1 characters. The buffers stay valid until the
+     * virtual machine is returned, so they can be passed to RishkaVM::run().
+     *
+     * @param vm The virtual machine returned by lease().
+     * @param cmdline The command line to split.
+     * @param count Set to the number of tokens.
+     * @return The tokens, or NULL if `vm` was not leased from this pool.
+     */
+    char** splitArguments(RishkaVM* vm, const String& cmdline, int& count);
+
+    /**
+     * @brief Gets the number of instances of the pool.
+     *
+     * @return The number of instances allocated by initialize().
+     */
+    uint8_t getCapacity() const;
+
+    /**
+     * @brief Gets the number of instances not leased.
+     *
+     * @return The number of instances lease() can still return.
+     */
+    uint8_t getAvailable() const;
+};
+
+#endif /* RISHKA_VM_POOL_H */
@@ -0,0 +1,90 @@
+/* 
+ * This file is part of the Rishka distribution (https://github.com/nthnn/rishka).
+ * Copyright (c) 2024 Nathanne Isip.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+extern crate clap;
+
+use crate::banner;
+use clap::*;
+use std::path::Path;
+use std::process::exit;
+
+pub struct Options {
+    pub output: String,
+    pub name:   String,
+    pub arch:   String,
+    pub file:   String
+}
+
+fn parse_args() -> ArgMatches {
+    Command::new("rishka-aot")
+        .disable_help_flag(true)
+        .ignore_errors(true)
+        .arg(Arg::new("output")
+            .short('o')
+            .long("output")
+            .value_parser(value_parser!(String))
+            .action(ArgAction::Set))
+        .arg(Arg::new("name")
+            .short('n')
+            .long("name")
+            .value_parser(value_parser!(String))
+            .action(ArgAction::Set))
+        .arg(Arg::new("arch")
+            .short('a')
+            .long("arch")
+            .value_parser(value_parser!(String))
+            .action(ArgAction::Set))
+        .arg(Arg::new("file")
+            .value_parser(value_parser!(String))
+            .action(ArgAction::Set))
+        .get_matches()
+}
+
+pub fn get_args() -> Options {
+    let argv: ArgMatches = parse_args();
+    let file: String = match argv.get_one::<String>("file") {
+        Some(value)=> value.to_string(),
+        None=> {
+            banner::print_usage();
+            exit(0);
+        }
+    };
+
+    let stem: String = match file.strip_suffix(".bin") {
+        Some(value)=> value.to_string(),
+        None=> file.clone()
+    };
+
+    Options {
+        output: match argv.get_one::<String>("output") {
+            Some(value)=> value.to_string(),
+            None=> format!("{}_aot.cpp", stem)
+        },
+        name: match argv.get_one::<String>("name") {
+            Some(value)=> value.to_string(),
+            None=> match Path::new(&stem).file_name() {
+                Some(value)=> value.to_string_lossy().to_string(),
+                None=> stem.clone()
+            }
+        },
+        arch: match argv.get_one::<String>("arch") {
+            Some(value)=> value.to_string(),
+            None=> "rv64im".to_string()
+        },
+        file: file
+    }
+}
@@ -0,0 +1,62 @@
+/* 
+ * This file is part of the Rishka distribution (https://github.com/nthnn/rishka).
+ * Copyright (c) 2024 Nathanne Isip.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+extern crate colored;
+
+use colored::Colorize;
+
+fn print_banner() {
+    println!("{}", "_______________________________________________".cyan());
+    println!("{}", "  ______ _____ _______ _     _ _     _ _______".yellow().bold());
+    println!("{}", " |_____/   |   |______ |_____| |____/  |_____|".yellow().bold());
+    println!("{}", " |    \\_ __|__ ______| |     | |    \\_ |     |\r\n".yellow().bold());
+    println!("{} {}", "      Rishka Ahead-of-Time Translator".cyan().bold(), "v0.0.1".italic());
+    println!("{}\r\n", "_______________________________________________".cyan());
+    println!("Rishka tool for translating program binaries into C++.\r\n");
+}
+
+fn print_help() {
+    println!("{}:", "Usage".underline());
+    println!("  {} [{}] <{}>",
+        "rishka-aot".italic().bold(),
+        "options".italic(),
+        "file.bin".italic());
+
+    println!("\r\n{}:", "Options".underline());
+    println!(
+        "  {}  Output file name of the generated\r\n{}",
+        "--output, -o".italic(),
+        "                source (default: <file>_aot.cpp)");
+    println!(
+        "  {}    Program name the translation is\r\n{}",
+        "--name, -n".italic(),
+        "                registered under, which is the\r\n                file name without .bin (default)");
+    println!(
+        "  {}    Architecture the binary was built\r\n{}",
+        "--arch, -a".italic(),
+        "                for with rishka-cc: rv64im\r\n                (default) or any other rv64 or\r\n                rv32 target.");
+
+    println!("\r\nFor more details see:\r\n  {}",
+        "https://github.com/nthnn/rishka".underline());
+
+    println!();
+}
+
+pub fn print_usage() {
+    print_banner();
+    print_help();
+}
@@ -0,0 +1,460 @@
+/* 
+ * This file is part of the Rishka distribution (https://github.com/nthnn/rishka).
+ * Copyright (c) 2024 Nathanne Isip.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Mirrors RishkaVM::decode() and RishkaVM::expandCompressed() for the
+// instructions rishka-aot translates, quirks included, so that translated
+// blocks compute exactly what the interpreter would. Every other valid
+// instruction decodes to Op::Other and is left to the interpreter.
+
+#[derive(Clone, Copy, PartialEq, Eq, Debug)]
+pub enum Op {
+    Nop,
+    Lb, Lhw, Lw, Ldw, Lbu, Lhu, Lres,
+    Sb, Shw, Sw, Sdw,
+    Addi, Slli, Slti, Sltiu, Xori, Srli, Srai, Ori, Andi,
+    Add, Sub, Sll, Slt, Sltu, Xor, Srl, Sra, Or, And,
+    Mul, Mulh, Mulhsu, Mulhu, Div, Divu, Rem, Remu,
+    Mulw, Divw, Divuw, Remw, Remuw,
+    Lui, Auipc, Jal, Jalr,
+    Beq, Bne, Blt, Bge, Bltu, Bgeu,
+    Fence, FenceI, Ecall, Ebreak,
+    Other, Invalid
+}
+
+#[derive(Clone, Copy, Debug)]
+pub struct Inst {
+    pub op:     Op,
+    pub rd:     u32,
+    pub rs1:    u32,
+    pub rs2:    u32,
+    pub imm:    i32,
+    pub size:   u32
+}
+
+impl Op {
+    pub fn ends_block(self) -> bool {
+        matches!(self,
+            Op::Jal | Op::Jalr | Op::Beq | Op::Bne | Op::Blt | Op::Bge | Op::Bltu | Op::Bgeu |
+            Op::FenceI | Op::Ecall | Op::Ebreak | Op::Invalid)
+    }
+}
+
+fn encode_i(opcode: u32, fc3: u32, rd: u32, rs1: u32, imm: i32) -> u32 {
+    (((imm as u32) & 4095) << 20) | (rs1 << 15) | (fc3 << 12) | (rd << 7) | opcode
+}
+
+fn encode_r(opcode: u32, fc3: u32, fc7: u32, rd: u32, rs1: u32, rs2: u32) -> u32 {
+    (fc7 << 25) | (rs2 << 20) | (rs1 << 15) | (fc3 << 12) | (rd << 7) | opcode
+}
+
+fn encode_s(opcode: u32, fc3: u32, rs1: u32, rs2: u32, imm: i32) -> u32 {
+    let imm = imm as u32;
+    ((imm & 4064) << 20) | (rs2 << 20) | (rs1 << 15) | (fc3 << 12) | ((imm & 31) << 7) | opcode
+}
+
+fn encode_b(fc3: u32, rs1: u32, imm: i32) -> u32 {
+    let imm = imm as u32;
+    ((imm & 4096) << 19) | ((imm & 2016) << 20) | (rs1 << 15) | (fc3 << 12) |
+        ((imm & 30) << 7) | ((imm & 2048) >> 4) | 0x63
+}
+
+fn encode_j(rd: u32, imm: i32) -> u32 {
+    let imm = imm as u32;
+    ((imm & 1048576) << 11) | ((imm & 2046) << 20) | ((imm & 2048) << 9) |
+        (imm & 1044480) | (rd << 7) | 0x6f
+}
+
+fn compressed_jump_offset(inst: u32) -> i32 {
+    ((((inst >> 1) & 2048) | ((inst >> 7) & 16) | ((inst >> 1) & 768) | ((inst << 2) & 1024) |
+        ((inst >> 1) & 64) | ((inst << 1) & 128) | ((inst >> 2) & 14) | ((inst << 3) & 32)) << 20) as i32 >> 20
+}
+
+fn expand_compressed(inst: u16, xlen: u32) -> u32 {
+    let inst = inst as u32;
+    let rd = (inst >> 7) & 31;
+    let rs2 = (inst >> 2) & 31;
+    let rdc = ((inst >> 2) & 7) + 8;
+    let rs1c = ((inst >> 7) & 7) + 8;
+    let shamt = ((inst >> 7) & 32) | ((inst >> 2) & 31);
+    let immediate = ((shamt << 26) as i32) >> 26;
+
+    match ((inst & 3) << 3) | ((inst >> 13) & 7) {
+        0x00 => {
+            let offset = ((inst >> 7) & 48) | ((inst >> 1) & 960) | ((inst >> 4) & 4) | ((inst >> 2) & 8);
+            if offset == 0 {
+                return 0;
+            }
+            encode_i(0x13, 0, rdc, 2, offset as i32)
+        },
+        0x01 => encode_i(0x07, 3, rdc, rs1c, (((inst >> 7) & 56) | ((inst << 1) & 192)) as i32),
+        0x02 => encode_i(0x03, 2, rdc, rs1c, (((inst >> 7) & 56) | ((inst >> 4) & 4) | ((inst << 1) & 64)) as i32),
+        0x03 => if xlen == 64 {
+            encode_i(0x03, 3, rdc, rs1c, (((inst >> 7) & 56) | ((inst << 1) & 192)) as i32)
+        }
+        else {
+            encode_i(0x07, 2, rdc, rs1c, (((inst >> 7) & 56) | ((inst >> 4) & 4) | ((inst << 1) & 64)) as i32)
+        },
+        0x05 => encode_s(0x27, 3, rs1c, rdc, (((inst >> 7) & 56) | ((inst << 1) & 192)) as i32),
+        0x06 => encode_s(0x23, 2, rs1c, rdc, (((inst >> 7) & 56) | ((inst >> 4) & 4) | ((inst << 1) & 64)) as i32),
+        0x07 => if xlen == 64 {
+            encode_s(0x23, 3, rs1c, rdc, (((inst >> 7) & 56) | ((inst << 1) & 192)) as i32)
+        }
+        else {
+            encode_s(0x27, 2, rs1c, rdc, (((inst >> 7) & 56) | ((inst >> 4) & 4) | ((inst << 1) & 64)) as i32)
+        },
+        0x08 => encode_i(0x13, 0, rd, rd, immediate),
+        0x09 => if xlen == 64 {
+            if rd == 0 {
+                return 0;
+            }
+            encode_i(0x1b, 0, rd, rd, immediate)
+        }
+        else {
+            encode_j(1, compressed_jump_offset(inst))
+        },
+        0x0a => encode_i(0x13, 0, rd, 0, immediate),
+        0x0b => {
+            if rd == 2 {
+                let offset = ((inst >> 3) & 512) | ((inst >> 2) & 16) | ((inst << 1) & 64) |
+                    ((inst << 4) & 384) | ((inst << 3) & 32);
+                if offset == 0 {
+                    return 0;
+                }
+                return encode_i(0x13, 0, 2, 2, ((offset << 22) as i32) >> 22);
+            }
+
+            if immediate == 0 {
+                return 0;
+            }
+            (((immediate as u32) << 12) & 0xfffff000) | (rd << 7) | 0x37
+        },
+        0x0c => {
+            match (inst >> 10) & 3 {
+                0 => return encode_i(0x13, 5, rs1c, rs1c, shamt as i32),
+                1 => return encode_i(0x13, 5, rs1c, rs1c, (shamt | 1024) as i32),
+                2 => return encode_i(0x13, 7, rs1c, rs1c, immediate),
+                _ => {}
+            }
+
+            match ((inst >> 10) & 4) | ((inst >> 5) & 3) {
+                0 => encode_r(0x33, 0, 32, rs1c, rs1c, rdc),
+                1 => encode_r(0x33, 4, 0, rs1c, rs1c, rdc),
+                2 => encode_r(0x33, 6, 0, rs1c, rs1c, rdc),
+                3 => encode_r(0x33, 7, 0, rs1c, rs1c, rdc),
+                4 if xlen == 64 => encode_r(0x3b, 0, 32, rs1c, rs1c, rdc),
+                5 if xlen == 64 => encode_r(0x3b, 0, 0, rs1c, rs1c, rdc),
+                _ => 0
+            }
+        },
+        0x0d => encode_j(0, compressed_jump_offset(inst)),
+        0x0e | 0x0f => encode_b(if (inst >> 13) == 6 { 0 } else { 1 }, rs1c,
+            ((((inst >> 4) & 256) | ((inst >> 7) & 24) | ((inst << 1) & 192) |
+            ((inst >> 2) & 6) | ((inst << 3) & 32)) << 23) as i32 >> 23),
+        0x10 => encode_i(0x13, 1, rd, rd, shamt as i32),
+        0x11 => encode_i(0x07, 3, rd, 2, (((inst >> 7) & 32) | ((inst >> 2) & 24) | ((inst << 4) & 448)) as i32),
+        0x12 => {
+            if rd == 0 {
+                return 0;
+            }
+            encode_i(0x03, 2, rd, 2, (((inst >> 7) & 32) | ((inst >> 2) & 28) | ((inst << 4) & 192)) as i32)
+        },
+        0x13 => if xlen == 64 {
+            if rd == 0 {
+                return 0;
+            }
+            encode_i(0x03, 3, rd, 2, (((inst >> 7) & 32) | ((inst >> 2) & 24) | ((inst << 4) & 448)) as i32)
+        }
+        else {
+            encode_i(0x07, 2, rd, 2, (((inst >> 7) & 32) | ((inst >> 2) & 28) | ((inst << 4) & 192)) as i32)
+        },
+        0x14 => {
+            if (inst >> 12) & 1 == 0 {
+                if rs2 != 0 {
+                    return encode_r(0x33, 0, 0, rd, 0, rs2);
+                }
+                else if rd == 0 {
+                    return 0;
+                }
+                return encode_i(0x67, 0, 0, rd, 0);
+            }
+
+            if rs2 != 0 {
+                encode_r(0x33, 0, 0, rd, rd, rs2)
+            }
+            else if rd == 0 {
+                encode_i(0x73, 0, 0, 0, 1)
+            }
+            else {
+                encode_i(0x67, 0, 1, rd, 0)
+            }
+        },
+        0x15 => encode_s(0x27, 3, 2, rs2, (((inst >> 7) & 56) | ((inst >> 1) & 448)) as i32),
+        0x16 => encode_s(0x23, 2, 2, rs2, (((inst >> 7) & 60) | ((inst >> 1) & 192)) as i32),
+        0x17 => if xlen == 64 {
+            encode_s(0x23, 3, 2, rs2, (((inst >> 7) & 56) | ((inst >> 1) & 448)) as i32)
+        }
+        else {
+            encode_s(0x27, 2, 2, rs2, (((inst >> 7) & 60) | ((inst >> 1) & 192)) as i32)
+        },
+        _ => 0
+    }
+}
+
+fn decode_register(inst: u32, xlen: u32) -> Op {
+    let rs2 = (inst >> 20) & 31;
+
+    match (((inst >> 25) & 127) << 3) | ((inst >> 12) & 7) {
+        0x0 => Op::Add,
+        0x100 => Op::Sub,
+        0x1 => Op::Sll,
+        0x2 => Op::Slt,
+        0x3 => Op::Sltu,
+        0x4 => Op::Xor,
+        0x5 => Op::Srl,
+        0x105 => Op::Sra,
+        0x6 => Op::Or,
+        0x7 => Op::And,
+        0x8 => Op::Mul,
+        0x9 => Op::Mulh,
+        0xa => Op::Mulhsu,
+        0xb => Op::Mulhu,
+        0xc => Op::Div,
+        0xd => Op::Divu,
+        0xe => Op::Rem,
+        0xf => Op::Remu,
+        0x82 | 0x84 | 0x86 | 0x107 | 0x106 | 0x104 | 0x2c | 0x2d | 0x2e | 0x2f |
+            0x181 | 0x185 | 0x121 | 0x125 | 0x1a1 | 0xa1 => Op::Other,
+        0x24 if xlen == 32 && rs2 == 0 => Op::Other,
+        _ => Op::Invalid
+    }
+}
+
+fn decode_register_word(inst: u32) -> Op {
+    let rs2 = (inst >> 20) & 31;
+
+    match (((inst >> 25) & 127) << 3) | ((inst >> 12) & 7) {
+        0x0 => Op::Add,
+        0x100 => Op::Sub,
+        0x1 => Op::Sll,
+        0x5 => Op::Srl,
+        0x105 => Op::Sra,
+        0x8 => Op::Mulw,
+        0xc => Op::Divw,
+        0xd => Op::Divuw,
+        0xe => Op::Remw,
+        0xf => Op::Remuw,
+        0x20 | 0x82 | 0x84 | 0x86 | 0x181 | 0x185 => Op::Other,
+        0x24 if rs2 == 0 => Op::Other,
+        _ => Op::Invalid
+    }
+}
+
+pub fn decode(inst: u32, xlen: u32) -> Inst {
+    if inst & 3 != 3 {
+        let expanded = expand_compressed(inst as u16, xlen);
+        let mut decoded = if expanded != 0 {
+            decode(expanded, xlen)
+        }
+        else {
+            Inst { op: Op::Invalid, rd: 0, rs1: 0, rs2: 0, imm: 0, size: 0 }
+        };
+
+        decoded.size = 2;
+        return decoded;
+    }
+
+    let opcode = inst & 127;
+    let function_code_3 = (inst >> 12) & 7;
+    let function_code_6 = (inst >> 26) & 63;
+    let immediate = (inst as i32) >> 20;
+    let mut writes_register = true;
+
+    let mut decoded = Inst {
+        op: Op::Invalid,
+        rd: (inst >> 7) & 31,
+        rs1: (inst >> 15) & 31,
+        rs2: (inst >> 20) & 31,
+        imm: immediate,
+        size: 4
+    };
+
+    match opcode {
+        0x03 => decoded.op = match function_code_3 {
+            0 => Op::Lb,
+            1 => Op::Lhw,
+            2 => Op::Lw,
+            4 => Op::Lbu,
+            5 => Op::Lhu,
+            3 if xlen == 64 => Op::Ldw,
+            6 if xlen == 64 => Op::Lres,
+            _ => Op::Invalid
+        },
+
+        0x23 => {
+            writes_register = false;
+            decoded.imm = ((((inst >> 20) & 4064) | ((inst >> 7) & 31)) << 20) as i32 >> 20;
+            decoded.op = match function_code_3 {
+                0 => Op::Sb,
+                1 => Op::Shw,
+                2 => Op::Sw,
+                3 if xlen == 64 => Op::Sdw,
+                _ => Op::Invalid
+            };
+        },
+
+        0x13 => match function_code_3 {
+            0 => decoded.op = Op::Addi,
+            2 => decoded.op = Op::Slti,
+            3 => decoded.op = Op::Sltiu,
+            4 => decoded.op = Op::Xori,
+            6 => decoded.op = Op::Ori,
+            7 => decoded.op = Op::Andi,
+
+            1 => match (inst >> 20) & 4095 {
+                0x600 | 0x601 | 0x602 | 0x604 | 0x605 => decoded.op = Op::Other,
+                _ => {
+                    decoded.op = match function_code_6 {
+                        0x12 | 0x1a | 0x0a => Op::Other,
+                        _ => Op::Slli
+                    };
+                    decoded.imm = ((inst >> 20) & (xlen - 1)) as i32;
+                }
+            },
+
+            _ => match (inst >> 20) & 4095 {
+                0x287 => decoded.op = Op::Other,
+                0x6b8 if xlen == 64 => decoded.op = Op::Other,
+                0x698 if xlen == 32 => decoded.op = Op::Other,
+                _ => {
+                    decoded.op = match function_code_6 {
+                        0x18 | 0x12 => Op::Other,
+                        _ => match function_code_6 >> 4 {
+                            0 => Op::Srli,
+                            1 => Op::Srai,
+                            _ => Op::Invalid
+                        }
+                    };
+                    decoded.imm = ((inst >> 20) & (xlen - 1)) as i32;
+                }
+            }
+        },
+
+        0x1b if xlen == 64 => match function_code_3 {
+            0 => decoded.op = Op::Addi,
+
+            1 => decoded.op = match (inst >> 20) & 4095 {
+                0x600 | 0x601 | 0x602 => Op::Other,
+                _ if function_code_6 == 0x02 => Op::Other,
+                _ => Op::Slli
+            },
+
+            2 => {
+                decoded.op = match ((inst >> 25) & 127) >> 5 {
+                    0 => Op::Srli,
+                    1 => Op::Srai,
+                    _ => Op::Invalid
+                };
+                decoded.imm = decoded.rs2 as i32;
+            },
+
+            3 => {
+                decoded.op = Op::Slli;
+                decoded.imm = immediate & 0x3f;
+            },
+
+            4 => {
+                decoded.op = Op::Srli;
+                decoded.imm = immediate & 0x3f;
+            },
+
+            5 => if ((inst >> 25) & 127) == 0x30 {
+                decoded.op = Op::Other;
+            }
+            else {
+                decoded.op = Op::Srai;
+                decoded.imm = immediate & 0x3f;
+            },
+
+            _ => {}
+        },
+
+        0x33 => decoded.op = decode_register(inst, xlen),
+        0x3b if xlen == 64 => decoded.op = decode_register_word(inst),
+
+        0x37 | 0x17 => {
+            decoded.op = if opcode == 0x37 { Op::Lui } else { Op::Auipc };
+            decoded.imm = (inst & 0xfffff000) as i32;
+        },
+
+        0x6f => {
+            writes_register = false;
+            decoded.op = Op::Jal;
+            decoded.imm = (((((inst >> 11) & 1048576) | ((inst >> 20) & 2046)) |
+                ((inst >> 9) & 2048) | (inst & 1044480)) << 11) as i32 >> 11;
+        },
+
+        0x67 => {
+            writes_register = false;
+            decoded.op = Op::Jalr;
+        },
+
+        0x63 => {
+            writes_register = false;
+            decoded.imm = (((((inst >> 19) & 4096) | ((inst >> 20) & 2016)) |
+                ((inst >> 7) & 30) | ((inst << 4) & 2048)) << 19) as i32 >> 19;
+            decoded.op = match function_code_3 {
+                0 => Op::Beq,
+                1 => Op::Bne,
+                4 => Op::Blt,
+                5 => Op::Bge,
+                6 => Op::Bltu,
+                7 => Op::Bgeu,
+                _ => Op::Invalid
+            };
+        },
+
+        0x0f => {
+            writes_register = false;
+            decoded.op = if function_code_3 == 1 { Op::FenceI } else { Op::Fence };
+        },
+
+        0x73 => {
+            writes_register = false;
+            decoded.op = match (function_code_3, (inst >> 20) & 4095) {
+                (0, 0) => Op::Ecall,
+                (0, 1) => Op::Ebreak,
+                (0, _) => Op::Invalid,
+                _ => Op::Other
+            };
+        },
+
+        // Atomics, floating-point and vector instructions are only
+        // interpreted, which also decides whether they are valid.
+        0x2f | 0x07 | 0x27 | 0x43 | 0x47 | 0x4b | 0x4f | 0x53 | 0x57 => {
+            writes_register = false;
+            decoded.op = Op::Other;
+        },
+
+        _ => {}
+    }
+
+    if writes_register && decoded.rd == 0 && decoded.op != Op::Invalid {
+        decoded.op = Op::Nop;
+    }
+
+    decoded
+}
@@ -0,0 +1,66 @@
+/* 
+ * This file is part of the Rishka distribution (https://github.com/nthnn/rishka).
+ * Copyright (c) 2024 Nathanne Isip.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+use crate::translate::DEFAULT_LOAD_ADDRESS;
+use std::fs;
+
+pub fn read_binary(file: &str) -> Option<Vec<u8>> {
+    fs::read(file).ok()
+}
+
+// Reads the address, type and name of each line of the symbol table
+// rishka-cc writes next to the binary, if there is one.
+fn read_table(file: &str) -> Vec<(u64, String, String)> {
+    let table: String = match file.strip_suffix(".bin") {
+        Some(stem)=> format!("{}.sym", stem),
+        None=> format!("{}.sym", file)
+    };
+
+    let contents: String = match fs::read_to_string(table) {
+        Ok(contents)=> contents,
+        Err(_)=> return Vec::new()
+    };
+
+    contents.lines()
+        .filter_map(|line| {
+            let mut fields = line.split_whitespace();
+            let address = u64::from_str_radix(fields.next()?, 16).ok()?;
+
+            Some((address, fields.next()?.to_string(), fields.next()?.to_string()))
+        })
+        .collect()
+}
+
+// Reads the function addresses of the symbol table.
+pub fn read_symbols(file: &str) -> Vec<u64> {
+    read_table(file).into_iter()
+        .filter(|(_, kind, _)| matches!(kind.as_str(), "T" | "t" | "W" | "w"))
+        .map(|(address, _, _)| address)
+        .collect()
+}
+
+// Reads the address the program was linked to be loaded at, which the
+// link script of rishka-cc exports as __rishka_code_address.
+pub fn read_load_address(file: &str) -> u64 {
+    read_table(file).into_iter()
+        .find(|(_, _, name)| name == "__rishka_code_address")
+        .map_or(DEFAULT_LOAD_ADDRESS, |(address, _, _)| address)
+}
+
+pub fn write_source(file: &str, source: &str) -> bool {
+    fs::write(file, source).is_ok()
+}
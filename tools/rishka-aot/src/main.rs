@@ -0,0 +1,82 @@
+/* 
+ * This file is part of the Rishka distribution (https://github.com/nthnn/rishka).
+ * Copyright (c) 2024 Nathanne Isip.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+extern crate colored;
+
+mod args;
+mod banner;
+mod decode;
+mod io;
+mod translate;
+
+use colored::Colorize;
+use crate::args::Options;
+use std::path::Path;
+use std::process::exit;
+
+fn translate_task(argv: Options, xlen: u32) {
+    print!("{} program binary... ", "Reading".blue().bold());
+
+    let image: Vec<u8> = match io::read_binary(&argv.file) {
+        Some(image)=> image,
+        None=> {
+            println!("something went {}.", "wrong".red().bold());
+            exit(0);
+        }
+    };
+    let entries: Vec<u64> = io::read_symbols(&argv.file);
+    let base: u64 = io::read_load_address(&argv.file);
+    println!("{}!", "done".yellow().bold());
+
+    print!("{} basic blocks... ", "Finding".blue().bold());
+    let blocks = translate::find_blocks(&image, base, xlen, &entries);
+    println!("{} {}!", blocks.len(), "found".yellow().bold());
+
+    print!("{} blocks to C++... ", "Translating".blue().bold());
+    let source: String = match Path::new(&argv.file).file_name() {
+        Some(value)=> value.to_string_lossy().to_string(),
+        None=> argv.file.clone()
+    };
+    let output: String = translate::emit_program(&argv.name, &source, xlen, &image, base, &blocks);
+    println!("{}!", "done".yellow().bold());
+
+    print!("{} translated source... ", "Writing".blue().bold());
+    if !io::write_source(&argv.output, &output) {
+        println!("something went {}.", "wrong".red().bold());
+        exit(0);
+    }
+    else {
+        println!("{}!", "done".yellow().bold());
+    }
+}
+
+fn main() {
+    let argv: Options = args::get_args();
+    let xlen: u32 = if argv.arch.starts_with("rv64") {
+        64
+    }
+    else if argv.arch.starts_with("rv32") {
+        32
+    }
+    else {
+        println!("Unsupported target architecture '{}'.", argv.arch.cyan().italic());
+        exit(0);
+    };
+
+    translate_task(argv, xlen);
+    println!("Task {}!", "done".green().bold());
+}
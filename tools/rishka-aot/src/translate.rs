@@ -0,0 +1,552 @@
+/* 
+ * This file is part of the Rishka distribution (https://github.com/nthnn/rishka).
+ * Copyright (c) 2024 Nathanne Isip.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+use crate::decode::{decode, Inst, Op};
+use std::collections::{BTreeMap, BTreeSet};
+use std::fmt::Write;
+
+// Programs are loaded at this guest address, which is also their entry
+// point, unless they were linked for another one.
+pub const DEFAULT_LOAD_ADDRESS: u64 = 4096;
+
+// Longest run of instructions translated into one function.
+const MAX_TRANSLATED: usize = 1024;
+
+pub struct Block {
+    pub pc:         u64,
+    pub insts:      Vec<(u64, Inst)>,
+    pub translated: usize,
+    pub complete:   bool
+}
+
+impl Block {
+    // The instructions the block must at least have for the translation
+    // to apply: the translated ones, plus the one it resumes the
+    // interpreter at, if any.
+    pub fn length(&self) -> usize {
+        if self.complete { self.translated } else { self.translated + 1 }
+    }
+
+    pub fn size(&self) -> u64 {
+        self.insts[..self.translated].iter()
+            .map(|(_, inst)| inst.size as u64)
+            .sum()
+    }
+}
+
+fn fetch(image: &[u8], base: u64, pc: u64) -> Option<u32> {
+    let offset = pc.checked_sub(base)? as usize;
+    if offset + 2 > image.len() {
+        return None;
+    }
+
+    let low = u16::from_le_bytes([image[offset], image[offset + 1]]) as u32;
+    if low & 3 != 3 {
+        return Some(low);
+    }
+    else if offset + 4 > image.len() {
+        return None;
+    }
+
+    Some(low | ((u16::from_le_bytes([image[offset + 2], image[offset + 3]]) as u32) << 16))
+}
+
+fn translatable(op: Op, xlen: u32) -> bool {
+    match op {
+        Op::FenceI | Op::Ecall | Op::Ebreak | Op::Other | Op::Invalid => false,
+
+        // On RV64, the interpreter computes the upper half of the product
+        // with a shift the host does not define, so it keeps these.
+        Op::Mulh | Op::Mulhsu | Op::Mulhu => xlen == 32,
+        _ => true
+    }
+}
+
+pub fn checksum(data: &[u8]) -> u32 {
+    let mut hash: u32 = 2166136261;
+
+    for byte in data {
+        hash = (hash ^ *byte as u32).wrapping_mul(16777619);
+    }
+    hash
+}
+
+// Finds the basic blocks reachable from the entry point and the given
+// addresses (the function symbols of the program), following the same
+// block boundaries as the interpreter. Indirect jump targets other than
+// return addresses are only known through the symbols; blocks missed
+// that way are interpreted.
+pub fn find_blocks(image: &[u8], base: u64, xlen: u32, entries: &[u64]) -> Vec<Block> {
+    let end = base + image.len() as u64;
+    let mut pending: Vec<u64> = vec![base];
+    let mut seen: BTreeSet<u64> = BTreeSet::new();
+    let mut blocks: BTreeMap<u64, Block> = BTreeMap::new();
+
+    pending.extend(entries.iter().filter(|pc| **pc >= base && **pc < end));
+    while let Some(start) = pending.pop() {
+        if start & 1 != 0 || !seen.insert(start) {
+            continue;
+        }
+
+        let mut insts: Vec<(u64, Inst)> = Vec::new();
+        let mut pc = start;
+        let mut terminated = false;
+
+        while let Some(word) = fetch(image, base, pc) {
+            let inst = decode(word, xlen);
+
+            insts.push((pc, inst));
+            pc += inst.size as u64;
+
+            if inst.op.ends_block() {
+                terminated = true;
+                break;
+            }
+        }
+
+        // Blocks running off the end of the binary are left to the
+        // interpreter, since whatever follows is only known at run time.
+        if !terminated {
+            continue;
+        }
+
+        let (last, inst) = insts[insts.len() - 1];
+        let next = last + inst.size as u64;
+
+        match inst.op {
+            Op::Jal => {
+                pending.push(last.wrapping_add(inst.imm as i64 as u64));
+                if inst.rd != 0 {
+                    pending.push(next);
+                }
+            },
+            Op::Jalr => if inst.rd != 0 {
+                pending.push(next);
+            },
+            Op::Beq | Op::Bne | Op::Blt | Op::Bge | Op::Bltu | Op::Bgeu => {
+                pending.push(last.wrapping_add(inst.imm as i64 as u64));
+                pending.push(next);
+            },
+            Op::FenceI | Op::Ecall | Op::Ebreak => pending.push(next),
+            _ => {}
+        }
+
+        // Instructions the interpreter may end the block at are never
+        // translated, so the translation ends there too.
+        let mut translated = insts.iter()
+            .position(|(_, inst)| !translatable(inst.op, xlen))
+            .unwrap_or(insts.len());
+        let mut complete = translated == insts.len();
+
+        if translated > MAX_TRANSLATED {
+            translated = MAX_TRANSLATED;
+            complete = false;
+        }
+
+        if translated != 0 {
+            blocks.insert(start, Block { pc: start, insts, translated, complete });
+        }
+    }
+
+    blocks.into_values().collect()
+}
+
+struct Emitter {
+    xlen:       u32,
+    used:       BTreeSet<u32>,
+    written:    BTreeSet<u32>,
+    body:       String,
+    memory:     bool,
+    stores:     bool
+}
+
+fn literal(value: i64) -> String {
+    if value == i32::MIN as i64 {
+        "(-2147483647 - 1)".to_string()
+    }
+    else {
+        value.to_string()
+    }
+}
+
+fn address(value: i64) -> String {
+    if value < 0 {
+        format!("{}LL", value)
+    }
+    else {
+        format!("0x{:x}", value)
+    }
+}
+
+fn imm(value: i32) -> String {
+    format!("(rishka_uxlen_t)(rishka_xlen_t) {}", literal(value as i64))
+}
+
+impl Emitter {
+    fn reg(&mut self, r: u32) -> String {
+        if r == 0 {
+            return "(rishka_uxlen_t) 0".to_string();
+        }
+
+        self.used.insert(r);
+        format!("x{}", r)
+    }
+
+    fn line(&mut self, text: &str) {
+        if text.is_empty() {
+            self.body.push('\n');
+        }
+        else {
+            let _ = writeln!(self.body, "    {}", text);
+        }
+    }
+
+    fn set(&mut self, rd: u32, value: String) {
+        self.used.insert(rd);
+        self.written.insert(rd);
+        self.line(&format!("x{} = {};", rd, value));
+    }
+
+    fn exit(&mut self, indent: &str, pc: i64, kind: &str) {
+        for r in self.written.clone() {
+            self.line(&format!("{}registers[{}] = x{};", indent, r, r));
+        }
+        self.line(&format!("{}return {{{}, {}}};", indent, address(pc), kind));
+    }
+
+    fn load(&mut self, inst: &Inst, kind: &str) {
+        self.memory = true;
+        let base = self.reg(inst.rs1);
+        self.set(inst.rd, format!("(rishka_uxlen_t)(rishka_xlen_t) rishka_aot_read<{}>(memory, vm, {} + {})",
+            kind, base, imm(inst.imm)));
+    }
+
+    fn store(&mut self, inst: &Inst, kind: &str, size: u32, next: i64) {
+        self.memory = true;
+        self.stores = true;
+
+        let (base, value) = (self.reg(inst.rs1), self.reg(inst.rs2));
+        self.line(&format!("address = ({} + {});", base, imm(inst.imm)));
+        self.line(&format!("rishka_aot_write<{}>(memory, vm, address, ({}) {});", kind, kind, value));
+        self.line(&format!("if(address < (RISHKA_VM_DECODE_CACHE_SIZE << 1) && rishka_aot_store(vm, address, {})) {{", size));
+        self.exit("    ", next, "RISHKA_NATIVE_RESUME");
+        self.line("}");
+    }
+
+    // Shifts by a constant follow RishkaVM::shiftLeft(), shiftRight() and
+    // arithmeticShiftRight(), whose amount may be out of range here.
+    fn shift_left(&self, value: String, amount: i64) -> String {
+        let bits = self.xlen as i64;
+
+        if amount >= 0 && amount < bits {
+            format!("(rishka_uxlen_t)({} << {})", value, amount)
+        }
+        else if amount < 0 && amount > -bits {
+            format!("(rishka_uxlen_t)({} >> {})", value, -amount)
+        }
+        else {
+            "0".to_string()
+        }
+    }
+
+    fn shift_right(&self, value: String, amount: i64) -> String {
+        self.shift_left(value, -amount)
+    }
+
+    fn shift_arithmetic(&self, value: String, amount: i64) -> String {
+        let bits = self.xlen as i64;
+
+        if amount >= 0 && amount < bits {
+            format!("(rishka_uxlen_t)((rishka_xlen_t) {} >> {})", value, amount)
+        }
+        else if amount >= bits {
+            format!("(rishka_uxlen_t)((rishka_xlen_t) {} < 0 ? -1 : 0)", value)
+        }
+        else {
+            self.shift_left(value, -amount)
+        }
+    }
+
+    fn divide(&mut self, inst: &Inst, signed: &str, unsigned: &str, minimum: &str, remainder: bool, word: bool) {
+        let (a, b, d) = (self.reg(inst.rs1), self.reg(inst.rs2), inst.rd);
+        let extend = if word { "(rishka_uxlen_t)(rishka_xlen_t) " } else { "(rishka_uxlen_t) " };
+
+        self.used.insert(d);
+        self.written.insert(d);
+        self.line("{");
+        if signed.is_empty() {
+            self.line(&format!("    {} dividend = ({}) {}, divisor = ({}) {};", unsigned, unsigned, a, unsigned, b));
+            self.line("");
+            self.line("    if(divisor == 0)");
+            if remainder {
+                self.line(&format!("        x{} = (rishka_uxlen_t) dividend;", d));
+                self.line(&format!("    else x{} = (rishka_uxlen_t)(dividend % divisor);", d));
+            }
+            else {
+                self.line(&format!("        x{} = (rishka_uxlen_t) -1;", d));
+                self.line(&format!("    else x{} = (rishka_uxlen_t)(dividend / divisor);", d));
+            }
+        }
+        else {
+            self.line(&format!("    {} dividend = ({}) {}, divisor = ({}) {};", signed, signed, a, signed, b));
+            self.line("");
+            self.line(&format!("    if(dividend == {} && divisor == -1)", minimum));
+            if remainder {
+                self.line(&format!("        x{} = 0;", d));
+                self.line("    else if(divisor == 0)");
+                self.line(&format!("        x{} = {}dividend;", d, extend));
+                self.line(&format!("    else x{} = {}(dividend % divisor);", d, extend.trim_end()));
+            }
+            else {
+                self.line(&format!("        x{} = (rishka_uxlen_t) {};", d, if word { "-2147483648LL" } else { minimum }));
+                self.line("    else if(divisor == 0)");
+                self.line(&format!("        x{} = (rishka_uxlen_t) -1;", d));
+                self.line(&format!("    else x{} = {}(dividend / divisor);", d, extend.trim_end()));
+            }
+        }
+        self.line("}");
+    }
+
+    fn branch(&mut self, pc: u64, inst: &Inst, condition: String) {
+        let target = (pc as i64).wrapping_add(inst.imm as i64);
+
+        // Comparing a register with itself decides the branch here.
+        if inst.rs1 == inst.rs2 {
+            if matches!(inst.op, Op::Beq | Op::Bge | Op::Bgeu) {
+                self.exit("", target, "RISHKA_NATIVE_TAKEN");
+            }
+            else {
+                self.exit("", pc as i64 + inst.size as i64, "RISHKA_NATIVE_FALLTHROUGH");
+            }
+            return;
+        }
+
+        self.line(&format!("if({})", condition));
+        if self.written.is_empty() {
+            self.line(&format!("    return {{{}, RISHKA_NATIVE_TAKEN}};", address(target)));
+        }
+        else {
+            self.body.truncate(self.body.len() - 1);
+            self.body.push_str(" {\n");
+            self.exit("    ", target, "RISHKA_NATIVE_TAKEN");
+            self.line("}");
+        }
+
+        self.line("");
+        self.exit("", pc as i64 + inst.size as i64, "RISHKA_NATIVE_FALLTHROUGH");
+    }
+
+    fn instruction(&mut self, pc: u64, inst: &Inst) {
+        let branch = matches!(inst.op, Op::Beq | Op::Bne | Op::Blt | Op::Bge | Op::Bltu | Op::Bgeu);
+        let reads_rs1 = !matches!(inst.op, Op::Nop | Op::Lui | Op::Auipc | Op::Jal | Op::Fence) &&
+            !(branch && inst.rs1 == inst.rs2);
+        let reads_rs2 = matches!(inst.op,
+            Op::Sb | Op::Shw | Op::Sw | Op::Sdw |
+            Op::Add | Op::Sub | Op::Sll | Op::Slt | Op::Sltu | Op::Xor | Op::Srl | Op::Sra | Op::Or | Op::And |
+            Op::Mul | Op::Mulh | Op::Mulhsu | Op::Mulhu | Op::Div | Op::Divu | Op::Rem | Op::Remu |
+            Op::Mulw | Op::Divw | Op::Divuw | Op::Remw | Op::Remuw) || (branch && inst.rs1 != inst.rs2);
+
+        let a = if reads_rs1 { self.reg(inst.rs1) } else { String::new() };
+        let b = if reads_rs2 { self.reg(inst.rs2) } else { String::new() };
+        let d = inst.rd;
+        let next = pc as i64 + inst.size as i64;
+        let minimum = "rishka_xlen_traits<RISHKA_VM_XLEN>::minimum";
+
+        match inst.op {
+            Op::Nop => {},
+
+            Op::Lb | Op::Lbu => self.load(inst, "uint8_t"),
+            Op::Lhw | Op::Lhu => self.load(inst, "uint16_t"),
+            Op::Lw | Op::Lres => self.load(inst, "uint32_t"),
+            Op::Ldw => self.load(inst, "uint64_t"),
+
+            Op::Sb => self.store(inst, "uint8_t", 1, next),
+            Op::Shw => self.store(inst, "uint16_t", 2, next),
+            Op::Sw => self.store(inst, "uint32_t", 4, next),
+            Op::Sdw => self.store(inst, "uint64_t", 8, next),
+
+            Op::Addi => self.set(d, format!("({} + {})", a, imm(inst.imm))),
+            Op::Slti => self.set(d, format!("((rishka_xlen_t) {} < (rishka_xlen_t) {}) ? 1 : 0", a, literal(inst.imm as i64))),
+            Op::Sltiu => self.set(d, format!("({} < {}) ? 1 : 0", a, imm(inst.imm))),
+            Op::Xori => self.set(d, format!("({} ^ {})", a, imm(inst.imm))),
+            Op::Ori => self.set(d, format!("({} | {})", a, imm(inst.imm))),
+            Op::Andi => self.set(d, format!("({} & {})", a, imm(inst.imm))),
+            Op::Slli => {
+                let value = self.shift_left(a, inst.imm as i64);
+                self.set(d, value);
+            },
+            Op::Srli => {
+                let value = self.shift_right(a, inst.imm as i64);
+                self.set(d, value);
+            },
+            Op::Srai => {
+                let value = self.shift_arithmetic(a, inst.imm as i64);
+                self.set(d, value);
+            },
+
+            Op::Add => self.set(d, format!("({} + {})", a, b)),
+            Op::Sub => self.set(d, format!("({} - {})", a, b)),
+            Op::Sll => self.set(d, format!("(rishka_uxlen_t)({} << ({} & 0x1f))", a, b)),
+            Op::Slt => self.set(d, format!("((rishka_xlen_t) {} < (rishka_xlen_t) {}) ? 1 : 0", a, b)),
+            Op::Sltu => self.set(d, format!("({} < {}) ? 1 : 0", a, b)),
+            Op::Xor => self.set(d, format!("({} ^ {})", a, b)),
+            Op::Srl => self.set(d, format!("(rishka_uxlen_t)({} >> ({} & 0x1f))", a, b)),
+            Op::Sra => self.set(d, format!("(rishka_uxlen_t)((rishka_xlen_t) {} >> ({} & 0x1f))", a, b)),
+            Op::Or => self.set(d, format!("({} | {})", a, b)),
+            Op::And => self.set(d, format!("({} & {})", a, b)),
+
+            Op::Mul => self.set(d, format!("(rishka_uxlen_t)({} * {})", a, b)),
+            Op::Mulh => self.set(d, format!("(rishka_uxlen_t)(((int64_t)(rishka_xlen_t) {} * (int64_t)(rishka_xlen_t) {}) >> 32)", a, b)),
+            Op::Mulhsu => self.set(d, format!("(rishka_uxlen_t)(((int64_t)(rishka_xlen_t) {} * (int64_t) {}) >> 32)", a, b)),
+            Op::Mulhu => self.set(d, format!("(rishka_uxlen_t)(((uint64_t) {} * (uint64_t) {}) >> 32)", a, b)),
+            Op::Div => self.divide(inst, "rishka_xlen_t", "", minimum, false, false),
+            Op::Divu => self.divide(inst, "", "rishka_uxlen_t", minimum, false, false),
+            Op::Rem => self.divide(inst, "rishka_xlen_t", "", minimum, true, false),
+            Op::Remu => self.divide(inst, "", "rishka_uxlen_t", minimum, true, false),
+
+            Op::Mulw => self.set(d, format!("(rishka_uxlen_t)(rishka_xlen_t)((int32_t) {} * (int32_t) {})", a, b)),
+            Op::Divw => self.divide(inst, "int32_t", "", "(-2147483647 - 1)", false, true),
+            Op::Divuw => self.divide(inst, "", "uint32_t", "", false, true),
+            Op::Remw => self.divide(inst, "int32_t", "", "(-2147483647 - 1)", true, true),
+            Op::Remuw => self.divide(inst, "", "uint32_t", "", true, true),
+
+            Op::Lui => self.set(d, imm(inst.imm)),
+            Op::Auipc => self.set(d, format!("(rishka_uxlen_t) {}", address((pc as i64).wrapping_add(inst.imm as i64)))),
+
+            Op::Fence => self.line("__atomic_thread_fence(__ATOMIC_SEQ_CST);"),
+
+            Op::Jal => {
+                if d != 0 {
+                    self.set(d, format!("(rishka_uxlen_t) {}", address(next)));
+                }
+                self.exit("", (pc as i64).wrapping_add(inst.imm as i64), "RISHKA_NATIVE_TAKEN");
+            },
+
+            Op::Jalr => {
+                self.line(&format!("int64_t target = ((int64_t)(rishka_uxlen_t)({} + {}) &- 2);", a, imm(inst.imm)));
+                if d != 0 {
+                    self.set(d, format!("(rishka_uxlen_t) {}", address(next)));
+                }
+
+                for r in self.written.clone() {
+                    self.line(&format!("registers[{}] = x{};", r, r));
+                }
+                self.line("return {target, RISHKA_NATIVE_TAKEN};");
+            },
+
+            Op::Beq => self.branch(pc, inst, format!("{} == {}", a, b)),
+            Op::Bne => self.branch(pc, inst, format!("{} != {}", a, b)),
+            Op::Blt => self.branch(pc, inst, format!("(rishka_xlen_t) {} < (rishka_xlen_t) {}", a, b)),
+            Op::Bge => self.branch(pc, inst, format!("(rishka_xlen_t) {} >= (rishka_xlen_t) {}", a, b)),
+            Op::Bltu => self.branch(pc, inst, format!("{} < {}", a, b)),
+            Op::Bgeu => self.branch(pc, inst, format!("{} >= {}", a, b)),
+
+            Op::FenceI | Op::Ecall | Op::Ebreak | Op::Other | Op::Invalid => unreachable!()
+        }
+    }
+}
+
+pub fn emit_block(out: &mut String, block: &Block, xlen: u32) {
+    let mut emitter = Emitter {
+        xlen,
+        used: BTreeSet::new(),
+        written: BTreeSet::new(),
+        body: String::new(),
+        memory: false,
+        stores: false
+    };
+
+    for (pc, inst) in &block.insts[..block.translated] {
+        emitter.instruction(*pc, inst);
+    }
+
+    if !block.complete {
+        let (pc, _) = block.insts[block.translated];
+        emitter.exit("", pc as i64, "RISHKA_NATIVE_RESUME");
+    }
+
+    // Guest registers live in host variables for the whole block and are
+    // written back on every exit.
+    let used: BTreeSet<u32> = emitter.used.clone();
+
+    let _ = writeln!(out, "static rishka_native_exit rishka_aot_block_{:x}(rishka_uxlen_t*{}, rishka_native_memory{}, void*{}) {{",
+        block.pc,
+        if used.is_empty() { "" } else { " registers" },
+        if emitter.memory { " memory" } else { "" },
+        if emitter.memory { " vm" } else { "" });
+
+    if !used.is_empty() {
+        let loads: Vec<String> = used.iter()
+            .map(|r| format!("x{} = registers[{}]", r, r))
+            .collect();
+        let _ = writeln!(out, "    rishka_uxlen_t {};", loads.join(", "));
+    }
+    if emitter.stores {
+        let _ = writeln!(out, "    uint64_t address;");
+    }
+    if !used.is_empty() || emitter.stores {
+        let _ = writeln!(out);
+    }
+
+    out.push_str(&emitter.body);
+    let _ = writeln!(out, "}}\n");
+}
+
+fn escape(text: &str) -> String {
+    text.chars()
+        .flat_map(|c| match c {
+            '"' | '\\' => vec!['\\', c],
+            _ => vec![c]
+        })
+        .collect()
+}
+
+pub fn emit_program(name: &str, source: &str, xlen: u32, image: &[u8], base: u64, blocks: &[Block]) -> String {
+    let mut out = String::new();
+
+    let _ = writeln!(out, "/*\n * Generated by rishka-aot from {}, do not edit.\n *", source);
+    let _ = writeln!(out, " * Ahead-of-time translation of the Rishka program \"{}\", registered", name);
+    let _ = writeln!(out, " * when this file is compiled into the firmware (see rishka_aot.h).\n */\n");
+    let _ = writeln!(out, "#include <rishka_aot.h>\n");
+    let _ = writeln!(out, "#if RISHKA_VM_AOT\n");
+    let _ = writeln!(out, "#if RISHKA_VM_XLEN != {}", xlen);
+    let _ = writeln!(out, "#error \"{} was translated for RISHKA_VM_XLEN {}.\"", escape(name), xlen);
+    let _ = writeln!(out, "#endif\n");
+
+    for block in blocks {
+        emit_block(&mut out, block, xlen);
+    }
+
+    let _ = writeln!(out, "static const rishka_aot_block rishka_aot_blocks[] = {{");
+    for block in blocks {
+        let offset = (block.pc - base) as usize;
+        let size = block.size();
+
+        let _ = writeln!(out, "    {{0x{:x}, {}, {}, 0x{:08x}U, rishka_aot_block_{:x}}},",
+            block.pc, block.length(), size,
+            checksum(&image[offset..offset + size as usize]), block.pc);
+    }
+    let _ = writeln!(out, "}};\n");
+
+    let _ = writeln!(out, "static rishka_aot_program rishka_aot_translation = {{");
+    let _ = writeln!(out, "    \"{}\", rishka_aot_blocks, {}, NULL", escape(name), blocks.len());
+    let _ = writeln!(out, "}};\n");
+    let _ = writeln!(out, "static const bool rishka_aot_registered = rishka_aot_register(&rishka_aot_translation);\n");
+    let _ = writeln!(out, "#endif");
+
+    out
+}
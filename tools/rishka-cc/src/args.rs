@@ -24,6 +24,10 @@ use std::process::exit;
 pub struct Options {
     pub flags:  String,
     pub output: String,
+    pub arch:   String,
+    pub code:   String,
+    pub memory: String,
+    pub stack:  String,
     pub files:  Vec<String>
 }
 
@@ -41,6 +45,26 @@ fn parse_args() -> ArgMatches {
             .long("output")
             .value_parser(value_parser!(String))
             .action(ArgAction::Set))
+        .arg(Arg::new("arch")
+            .short('a')
+            .long("arch")
+            .value_parser(value_parser!(String))
+            .action(ArgAction::Set))
+        .arg(Arg::new("code")
+            .short('c')
+            .long("code")
+            .value_parser(value_parser!(String))
+            .action(ArgAction::Set))
+        .arg(Arg::new("memory")
+            .short('m')
+            .long("memory")
+            .value_parser(value_parser!(String))
+            .action(ArgAction::Set))
+        .arg(Arg::new("stack")
+            .short('s')
+            .long("stack")
+            .value_parser(value_parser!(String))
+            .action(ArgAction::Set))
         .arg(Arg::new("file")
             .value_parser(value_parser!(String))
             .action(ArgAction::Append))
@@ -71,6 +95,22 @@ pub fn get_args() -> Options {
             Some(value)=> value.to_string(),
             None=> "".to_string()
         },
+        arch: match argv.get_one::<String>("arch") {
+            Some(value)=> value.to_string(),
+            None=> "rv64im".to_string()
+        },
+        code: match argv.get_one::<String>("code") {
+            Some(value)=> value.to_string(),
+            None=> "".to_string()
+        },
+        memory: match argv.get_one::<String>("memory") {
+            Some(value)=> value.to_string(),
+            None=> "".to_string()
+        },
+        stack: match argv.get_one::<String>("stack") {
+            Some(value)=> value.to_string(),
+            None=> "".to_string()
+        },
         files: files_vec.into_iter()
             .flatten()
             .map(|s| s.to_string())
@@ -45,6 +45,22 @@ fn print_help() {
         "  {}  Output file name of the compiled\r\n{}",
         "--output, -o".italic(),
         "                binary (shouldn't end with .bin)");
+    println!(
+        "  {}    Target architecture: rv64im\r\n{}",
+        "--arch, -a".italic(),
+        "                (default), rv64imc, rv64imfd,\r\n                rv64imfdc, rv32im, rv32imc,\r\n                rv32imfd or rv32imfdc, with an \"a\"\r\n                after \"im\" for atomics (e.g.\r\n                rv64imac), optionally followed\r\n                by _zba, _zbb, _zbs and _zve64x.");
+    println!(
+        "  {}    Address the program is loaded at\r\n{}",
+        "--code, -c".italic(),
+        "                (default 0x1000).");
+    println!(
+        "  {}  Size of the memory of the virtual\r\n{}",
+        "--memory, -m".italic(),
+        "                machine, e.g. 64K or 4M (default 1M).");
+    println!(
+        "  {}   Size of the stack region at the top\r\n{}",
+        "--stack, -s".italic(),
+        "                of the memory (default 64K).");
 
     println!("\r\nFor more details see:\r\n  {}",
         "https://github.com/nthnn/rishka".underline());
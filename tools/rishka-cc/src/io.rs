@@ -18,6 +18,10 @@
 use crate::args::Options;
 use std::fs;
 
+pub fn write_symbol_table(options: &Options, symbols: &[u8]) -> bool {
+    fs::write(format!("{}.sym", options.output), symbols).is_ok()
+}
+
 pub fn delete_gpp_output(options: &Options) -> bool {
     fs::remove_file(format!("{}.out", options.output)).is_ok()
 }
@@ -50,6 +50,15 @@ fn compile_task(argv: Options, envvars: RishkaEnv) {
         println!("{}!", "done".yellow().bold());
     }
 
+    print!("{} symbol table from ELF file... ", "Generating".blue().bold());
+    if !process::run_riscv64_nm(&argv) {
+        println!("something went {}.", "wrong".red().bold());
+        exit(0);
+    }
+    else {
+        println!("{}!", "done".yellow().bold());
+    }
+
     print!("{} ELF binary output file... ", "Deleting".red().bold());
     if !io::delete_gpp_output(&argv) {
         println!("something went {}.", "wrong".red().bold());
@@ -62,6 +71,16 @@ fn compile_task(argv: Options, envvars: RishkaEnv) {
 
 fn main() {
     let mut argv: Options = args::get_args();
+    if process::arch_flags(&argv.arch).is_none() {
+        println!("Unsupported target architecture '{}'.", argv.arch.cyan().italic());
+        exit(0);
+    }
+
+    if process::layout_flags(&argv).is_none() {
+        println!("Invalid {} given to the code, memory or stack option.", "size".cyan().italic());
+        exit(0);
+    }
+
     process::check_req_deps();
 
     let envvars: RishkaEnv = env::check_req_env();
@@ -19,6 +19,7 @@ extern crate colored;
 
 use crate::args::Options;
 use crate::env::RishkaEnv;
+use crate::io;
 use colored::Colorize;
 use std::io::Read;
 use std::process::Command;
@@ -42,14 +43,67 @@ fn check_dep(dep: &str) {
     }
 }
 
+pub fn arch_flags(arch: &str) -> Option<(String, &'static str, &'static str)> {
+    let mut parts = arch.split('_');
+    let (mabi, script) = match parts.next().unwrap_or("") {
+        "rv64im" | "rv64imc" | "rv64ima" | "rv64imac"=> ("-mabi=lp64", "link.ld"),
+        "rv32im" | "rv32imc" | "rv32ima" | "rv32imac"=> ("-mabi=ilp32", "link32.ld"),
+        "rv64imfd" | "rv64imfdc" | "rv64imafd" | "rv64imafdc"=> ("-mabi=lp64d", "link.ld"),
+        "rv32imfd" | "rv32imfdc" | "rv32imafd" | "rv32imafdc"=> ("-mabi=ilp32d", "link32.ld"),
+        _=> return None
+    };
+
+    for extension in parts {
+        match extension {
+            "zba" | "zbb" | "zbs" | "zve64x"=> {},
+            _=> return None
+        }
+    }
+
+    Some((format!("-march={}", arch), mabi, script))
+}
+
+fn parse_size(value: &str) -> Option<u64> {
+    let (digits, scale) = match value.chars().last() {
+        Some('k') | Some('K')=> (&value[..value.len() - 1], 1024),
+        Some('m') | Some('M')=> (&value[..value.len() - 1], 1024 * 1024),
+        _=> (value, 1)
+    };
+
+    let number = match digits.strip_prefix("0x").or(digits.strip_prefix("0X")) {
+        Some(hex)=> u64::from_str_radix(hex, 16).ok()?,
+        None=> digits.parse::<u64>().ok()?
+    };
+
+    number.checked_mul(scale)
+}
+
+pub fn layout_flags(options: &Options) -> Option<Vec<String>> {
+    let mut flags: Vec<String> = Vec::new();
+
+    for (symbol, value) in [
+        ("__rishka_code_address", &options.code),
+        ("__rishka_memory_size", &options.memory),
+        ("__rishka_stack_size", &options.stack)
+    ] {
+        if value != "" {
+            flags.push(format!("-Wl,--defsym={}={}", symbol, parse_size(value)?));
+        }
+    }
+
+    Some(flags)
+}
+
 pub fn run_riscv64_gpp(options: &Options, cc_env: RishkaEnv) -> (bool, String) {
+    let (march, mabi, script) = arch_flags(&options.arch).unwrap();
     let mut binding = Command::new("riscv64-unknown-elf-g++");
     let command = binding
-        .arg("-march=rv64im")
-        .arg("-mabi=lp64")
+        .arg(march)
+        .arg(mabi)
         .arg("-nostdlib")
         .arg("-O2")
-        .arg(format!("-Wl,-T,{}/link.ld", cc_env.scripts))
+        .args(layout_flags(options).unwrap())
+        .arg(format!("-Wl,-T,{}/{}", cc_env.scripts, script))
         .arg(format!("-I{}", cc_env.library))
         .arg(format!("-o{}.out", options.output))
         .arg(format!("{}/*.cpp", cc_env.library))
@@ -89,7 +143,20 @@ pub fn run_riscv64_objcopy(options: &Options) -> bool {
     }
 }
 
+pub fn run_riscv64_nm(options: &Options) -> bool {
+    match Command::new("riscv64-unknown-elf-nm")
+        .arg("--defined-only")
+        .arg("-g")
+        .arg(format!("{}.out", options.output))
+        .output() {
+        Ok(proc)=> proc.status.success() &&
+            io::write_symbol_table(options, &proc.stdout),
+        Err(_)=> false
+    }
+}
+
 pub fn check_req_deps() {
     check_dep("riscv64-unknown-elf-g++");
     check_dep("riscv64-unknown-elf-objcopy");
+    check_dep("riscv64-unknown-elf-nm");
 }
\ No newline at end of file